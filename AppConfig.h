@@ -32,6 +32,7 @@
 /* Network Configuration */
 #define TCP_ECHO_PORT              8765
 #define UDP_DOIP_PORT              13400
+#define DOIP_TCP_PORT              13400
 
 #define VMG_IP_ADDR_0              192
 #define VMG_IP_ADDR_1              168
@@ -39,6 +40,13 @@
 #define VMG_IP_ADDR_3              100
 #define VMG_PORT                   13400
 
+/* Standby VMG (hot-standby uplink, takes over when the primary fails) */
+#define VMG2_IP_ADDR_0             192
+#define VMG2_IP_ADDR_1             168
+#define VMG2_IP_ADDR_2             1
+#define VMG2_IP_ADDR_3             101
+#define VMG2_PORT                  13400
+
 /* VCI Configuration */
 #define VCI_MAGIC                  0x56434921
 #define VCI_COLLECTION_TIMEOUT_MS  10000
@@ -48,9 +56,34 @@
 #define ZGW_SW_VERSION             "0.0.0"
 #define ZGW_HW_VERSION             "0.0.0"
 #define ZGW_SERIAL_NUM             "091000001"
+#define ZGW_VIN                    "KMZGW000000000091"   /* 17 characters, reported in vehicle identification */
 
 /* Zone ECU Identity */
 #define ZONE_ECU_ID                "ECU_011"
+#define ZONE_ECU_LOGICAL_ADDR      0x0011
+#define ZONE_ECU_IP_ADDR_0         192
+#define ZONE_ECU_IP_ADDR_1         168
+#define ZONE_ECU_IP_ADDR_2         1
+#define ZONE_ECU_IP_ADDR_3         11
+#define ZONE_ECU_DOIP_PORT         13400
+
+/* Flash4 staging area for RequestDownload (sector aligned; the driver's
+ * 3-byte addressing reaches the lower 16 MB of the S25FL512S) */
+#define FLASH4_STAGING_ADDR        0x00800000UL
+#define FLASH4_STAGING_SIZE        0x00800000UL
+
+/* RequestUpload sources: Flash4 below the 3-byte address limit, CPU0 DSPR */
+#define FLASH4_UPLOAD_LIMIT        0x01000000UL
+#define UPLOAD_RAM_ADDR            0x70000000UL
+#define UPLOAD_RAM_SIZE            0x0003C000UL   /* 240 KB */
+
+/* ReadMemoryByAddress windows: PFLASH (PF0 + PF1, 6 MB) through the cached and
+ * the non-cached segment; Flash4 (lower 16 MB) mapped at a virtual address in
+ * segment 2, which is unpopulated on the TC37x */
+#define PFLASH_READ_ADDR           0x80000000UL
+#define PFLASH_READ_NC_ADDR        0xA0000000UL
+#define PFLASH_READ_SIZE           0x00600000UL
+#define FLASH4_VIRTUAL_ADDR        0x20000000UL
 
 /* Timer Configuration */
 #define STM_TIMER_INTERVAL_MS      10
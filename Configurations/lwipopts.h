@@ -42,6 +42,11 @@
 #define LWIP_NETCONN            0                   /* Disable Netconn API                                                  */
 #define LWIP_SOCKET             0                   /* Disable the Socket API                                               */
 #define SYS_LIGHTWEIGHT_PROT    0                   /* Disable inter-task protection                                        */
+#define MEMP_NUM_TCP_PCB        10                  /* 2 VMG links + 4 DoIP tester sockets + echo + TIME_WAIT headroom      */
+#define LWIP_TCP_KEEPALIVE      1                   /* Per-PCB keepalive idle/interval/count (VMG half-open detection)      */
+#define TCP_MSS                 1460                /* Full-size Ethernet segments                                          */
+#define TCP_WND                 (8 * TCP_MSS)       /* Receive window holds a whole 8 KB TransferData block                 */
+#define TCP_SND_BUF             (4 * TCP_MSS)       /* Send buffer holds a whole 4 KB upload block                          */
 
 
 #define ETH_PAD_SIZE            2                   /* Add 2 bytes before the Ethernet header to ensure payload alignment   */
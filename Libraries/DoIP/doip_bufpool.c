@@ -0,0 +1,59 @@
+/**
+ * @file doip_bufpool.c
+ * @brief Fixed-Block Buffer Pool Implementation
+ */
+
+#include "doip_bufpool.h"
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void DoIP_BufPool_Init(DoIP_BufPool *pool, uint8 *storage, uint16 block_size, uint8 block_count)
+{
+    if (block_count > DOIP_BUFPOOL_MAX_BLOCKS)
+    {
+        block_count = DOIP_BUFPOOL_MAX_BLOCKS;
+    }
+
+    pool->storage = storage;
+    pool->block_size = block_size;
+    pool->block_count = block_count;
+    pool->free_count = block_count;
+    pool->used_peak = 0;
+    pool->alloc_failures = 0;
+
+    for (uint8 i = 0; i < block_count; i++)
+    {
+        pool->free_list[i] = (uint8)(block_count - 1 - i);
+    }
+}
+
+uint8 *DoIP_BufPool_Alloc(DoIP_BufPool *pool)
+{
+    if (pool->free_count == 0)
+    {
+        pool->alloc_failures++;
+        return NULL;
+    }
+
+    uint8 index = pool->free_list[--pool->free_count];
+
+    uint8 used = pool->block_count - pool->free_count;
+    if (used > pool->used_peak)
+    {
+        pool->used_peak = used;
+    }
+
+    return &pool->storage[(uint32)index * pool->block_size];
+}
+
+void DoIP_BufPool_Free(DoIP_BufPool *pool, uint8 *block)
+{
+    if (block == NULL || pool->free_count >= pool->block_count)
+    {
+        return;
+    }
+
+    pool->free_list[pool->free_count++] = (uint8)((uint32)(block - pool->storage) / pool->block_size);
+}
@@ -0,0 +1,63 @@
+/**
+ * @file doip_bufpool.h
+ * @brief Fixed-Block Buffer Pool for DoIP Connections
+ * @details Per-connection buffers are taken from a pool when a socket is
+ *          accepted and returned when it closes, so memory is only bound to
+ *          sockets that actually exist. Allocation and release are O(1).
+ */
+
+#ifndef DOIP_BUFPOOL_H
+#define DOIP_BUFPOOL_H
+
+#include "doip_types.h"
+
+/*******************************************************************************
+ * Pool Configuration
+ ******************************************************************************/
+
+#define DOIP_BUFPOOL_MAX_BLOCKS     8       /* Upper bound for blocks per pool */
+
+/*******************************************************************************
+ * Pool Structures
+ ******************************************************************************/
+
+typedef struct
+{
+    uint8  *storage;                            /* block_count * block_size bytes */
+    uint16  block_size;
+    uint8   block_count;
+    uint8   free_count;
+    uint8   free_list[DOIP_BUFPOOL_MAX_BLOCKS]; /* Stack of free block indices */
+    uint8   used_peak;                          /* Most blocks in use at once */
+    uint32  alloc_failures;                     /* Allocations refused (pool empty) */
+
+} DoIP_BufPool;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize a pool on caller-provided storage
+ * @param pool Pool instance
+ * @param storage Block storage (block_count * block_size bytes, 4-byte aligned)
+ * @param block_size Size of one block in bytes
+ * @param block_count Number of blocks (max DOIP_BUFPOOL_MAX_BLOCKS)
+ */
+void DoIP_BufPool_Init(DoIP_BufPool *pool, uint8 *storage, uint16 block_size, uint8 block_count);
+
+/**
+ * @brief Take a block from the pool
+ * @param pool Pool instance
+ * @return Block pointer, or NULL if all blocks are in use
+ */
+uint8 *DoIP_BufPool_Alloc(DoIP_BufPool *pool);
+
+/**
+ * @brief Return a block to the pool (NULL is ignored)
+ * @param pool Pool instance
+ * @param block Block obtained from DoIP_BufPool_Alloc()
+ */
+void DoIP_BufPool_Free(DoIP_BufPool *pool, uint8 *block);
+
+#endif /* DOIP_BUFPOOL_H */
@@ -0,0 +1,263 @@
+/**
+ * @file doip_capture.c
+ * @brief Ethernet Frame Capture Ring Implementation
+ */
+
+#include "doip_capture.h"
+#include "IfxStm.h"
+#include <string.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define CAPTURE_SLOT_MASK       (DOIP_CAPTURE_SLOTS - 1)
+
+/* Frame layout used by the port filter (IPv4 over Ethernet II) */
+#define ETH_HEADER_LEN          14
+#define IP_MIN_HEADER_LEN       20
+#define IP_PROTO_OFFSET         (ETH_HEADER_LEN + 9)
+#define IP_PROTO_TCP            6
+#define IP_PROTO_UDP            17
+
+#define PCAP_MAGIC              0xA1B2C3D4UL
+#define PCAP_LINKTYPE_ETHERNET  1
+
+typedef struct
+{
+    uint64 timestamp;                   /* STM ticks */
+    uint16 orig_len;
+    uint16 cap_len;
+    uint8  data[DOIP_CAPTURE_SNAPLEN];
+
+} DoIP_CaptureSlot;
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static DoIP_CaptureSlot  g_slots[DOIP_CAPTURE_SLOTS];
+static uint32            g_write_index = 0;     /* Free-running, masked on use */
+static DoIP_CaptureStats g_stats;
+
+/* pcap export cursor */
+static struct {
+    uint32 first;                       /* Ring index of the oldest frame */
+    uint8  count;
+    uint8  record;                      /* Frame being read */
+    uint32 offset;                      /* Byte offset within the frame's record */
+    uint32 header_offset;               /* Byte offset within the global header */
+    uint32 ticks_per_us;
+} g_export;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static void PutLe16(uint8 *dst, uint16 value)
+{
+    dst[0] = (uint8)value;
+    dst[1] = (uint8)(value >> 8);
+}
+
+static void PutLe32(uint8 *dst, uint32 value)
+{
+    dst[0] = (uint8)value;
+    dst[1] = (uint8)(value >> 8);
+    dst[2] = (uint8)(value >> 16);
+    dst[3] = (uint8)(value >> 24);
+}
+
+static boolean MatchesPort(const uint8 *frame, uint32 len, uint16 port)
+{
+    if (len < ETH_HEADER_LEN + IP_MIN_HEADER_LEN || frame[12] != 0x08 || frame[13] != 0x00)
+    {
+        return FALSE;
+    }
+
+    if (frame[IP_PROTO_OFFSET] != IP_PROTO_TCP && frame[IP_PROTO_OFFSET] != IP_PROTO_UDP)
+    {
+        return FALSE;
+    }
+
+    /* IHL gives the transport header offset (IP options included) */
+    uint32 l4 = ETH_HEADER_LEN + ((uint32)(frame[ETH_HEADER_LEN] & 0x0F) << 2);
+    if (len < l4 + 4)
+    {
+        return FALSE;
+    }
+
+    uint16 src_port = ((uint16)frame[l4] << 8) | frame[l4 + 1];
+    uint16 dst_port = ((uint16)frame[l4 + 2] << 8) | frame[l4 + 3];
+    return (src_port == port || dst_port == port);
+}
+
+static void BuildFileHeader(uint8 *header)
+{
+    PutLe32(&header[0], PCAP_MAGIC);
+    PutLe16(&header[4], 2);                         /* Version 2.4 */
+    PutLe16(&header[6], 4);
+    PutLe32(&header[8], 0);                         /* GMT offset */
+    PutLe32(&header[12], 0);                        /* Timestamp accuracy */
+    PutLe32(&header[16], DOIP_CAPTURE_SNAPLEN);
+    PutLe32(&header[20], PCAP_LINKTYPE_ETHERNET);
+}
+
+static void BuildRecordHeader(const DoIP_CaptureSlot *slot, uint8 *header)
+{
+    /* Time since STM start; the capture host only needs relative times */
+    uint64 us = slot->timestamp / g_export.ticks_per_us;
+
+    PutLe32(&header[0], (uint32)(us / 1000000));
+    PutLe32(&header[4], (uint32)(us % 1000000));
+    PutLe32(&header[8], slot->cap_len);
+    PutLe32(&header[12], slot->orig_len);
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void DoIP_Capture_Init(void)
+{
+    memset(&g_stats, 0, sizeof(g_stats));
+    memset(&g_export, 0, sizeof(g_export));
+    g_write_index = 0;
+}
+
+void DoIP_Capture_Start(uint16 filter_port)
+{
+    g_write_index = 0;
+    g_stats.stored = 0;
+    g_stats.captured = 0;
+    g_stats.overwritten = 0;
+    g_stats.truncated = 0;
+    g_stats.filter_port = filter_port;
+    g_stats.running = TRUE;
+}
+
+void DoIP_Capture_Stop(void)
+{
+    g_stats.running = FALSE;
+}
+
+void DoIP_Capture_Frame(const uint8 *frame, uint32 len, uint32 frame_len)
+{
+    if (!g_stats.running)
+    {
+        return;
+    }
+
+    if (g_stats.filter_port != DOIP_CAPTURE_PORT_ALL && !MatchesPort(frame, len, g_stats.filter_port))
+    {
+        return;
+    }
+
+    DoIP_CaptureSlot *slot = &g_slots[g_write_index & CAPTURE_SLOT_MASK];
+    uint32 cap_len = (len < DOIP_CAPTURE_SNAPLEN) ? len : DOIP_CAPTURE_SNAPLEN;
+
+    slot->timestamp = IfxStm_get(&MODULE_STM0);
+    slot->orig_len = (uint16)frame_len;
+    slot->cap_len = (uint16)cap_len;
+    memcpy(slot->data, frame, cap_len);
+    g_write_index++;
+
+    g_stats.captured++;
+    if (g_stats.stored < DOIP_CAPTURE_SLOTS)
+    {
+        g_stats.stored++;
+    }
+    else
+    {
+        g_stats.overwritten++;
+    }
+
+    if (frame_len > cap_len)
+    {
+        g_stats.truncated++;
+    }
+}
+
+uint32 DoIP_Capture_ExportRewind(void)
+{
+    DoIP_Capture_Stop();
+
+    g_export.first = g_write_index - g_stats.stored;
+    g_export.count = g_stats.stored;
+    g_export.record = 0;
+    g_export.offset = 0;
+    g_export.header_offset = 0;
+    g_export.ticks_per_us = (uint32)IfxStm_getTicksFromMicroseconds(&MODULE_STM0, 1);
+
+    uint32 size = DOIP_CAPTURE_PCAP_HEADER;
+    for (uint8 i = 0; i < g_export.count; i++)
+    {
+        size += DOIP_CAPTURE_PCAP_RECORD + g_slots[(g_export.first + i) & CAPTURE_SLOT_MASK].cap_len;
+    }
+
+    return size;
+}
+
+uint32 DoIP_Capture_ExportRead(uint8 *dst, uint32 max)
+{
+    uint32 written = 0;
+
+    while (written < max)
+    {
+        uint8 header[DOIP_CAPTURE_PCAP_HEADER];
+        const uint8 *src;
+        uint32 avail;
+        const DoIP_CaptureSlot *slot = NULL;
+
+        if (g_export.header_offset < DOIP_CAPTURE_PCAP_HEADER)
+        {
+            BuildFileHeader(header);
+            src = &header[g_export.header_offset];
+            avail = DOIP_CAPTURE_PCAP_HEADER - g_export.header_offset;
+        }
+        else if (g_export.record < g_export.count)
+        {
+            slot = &g_slots[(g_export.first + g_export.record) & CAPTURE_SLOT_MASK];
+            if (g_export.offset < DOIP_CAPTURE_PCAP_RECORD)
+            {
+                BuildRecordHeader(slot, header);
+                src = &header[g_export.offset];
+                avail = DOIP_CAPTURE_PCAP_RECORD - g_export.offset;
+            }
+            else
+            {
+                src = &slot->data[g_export.offset - DOIP_CAPTURE_PCAP_RECORD];
+                avail = DOIP_CAPTURE_PCAP_RECORD + slot->cap_len - g_export.offset;
+            }
+        }
+        else
+        {
+            break;
+        }
+
+        uint32 n = (avail < max - written) ? avail : (max - written);
+        memcpy(&dst[written], src, n);
+        written += n;
+
+        if (slot == NULL)
+        {
+            g_export.header_offset += n;
+        }
+        else
+        {
+            g_export.offset += n;
+            if (g_export.offset >= DOIP_CAPTURE_PCAP_RECORD + (uint32)slot->cap_len)
+            {
+                g_export.record++;
+                g_export.offset = 0;
+            }
+        }
+    }
+
+    return written;
+}
+
+const DoIP_CaptureStats *DoIP_Capture_GetStats(void)
+{
+    return &g_stats;
+}
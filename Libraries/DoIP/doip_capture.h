@@ -0,0 +1,97 @@
+/**
+ * @file doip_capture.h
+ * @brief Ethernet Frame Capture Ring with pcap Export
+ * @details Frames are captured at the driver boundary (ifx_netif_input /
+ *          low_level_output) into a RAM ring of fixed-size slots holding the
+ *          STM timestamp, the original length and the first
+ *          DOIP_CAPTURE_SNAPLEN bytes - enough for the Ethernet, IP and TCP
+ *          headers, the DoIP header and the start of the UDS message.
+ *          Capturing a frame is a port check and one bounded copy, so the
+ *          ring can stay enabled in production. When full, the oldest frame
+ *          is overwritten.
+ *          The ring is read out as a standard pcap stream (LINKTYPE_ETHERNET)
+ *          through UDS RoutineControl.
+ */
+
+#ifndef DOIP_CAPTURE_H
+#define DOIP_CAPTURE_H
+
+#include "doip_types.h"
+
+/*******************************************************************************
+ * Capture Configuration
+ ******************************************************************************/
+
+#define DOIP_CAPTURE_SLOTS          64      /* Frames kept (power of two) */
+#define DOIP_CAPTURE_SNAPLEN        128     /* Bytes stored per frame */
+#define DOIP_CAPTURE_PORT_ALL       0       /* Filter: capture every frame */
+#define DOIP_CAPTURE_PORT_DOIP      13400   /* Filter: DoIP traffic only (TCP/UDP 13400) */
+
+/* pcap stream: global header, then a record header and the data per frame */
+#define DOIP_CAPTURE_PCAP_HEADER    24
+#define DOIP_CAPTURE_PCAP_RECORD    16
+
+/*******************************************************************************
+ * Capture Structures
+ ******************************************************************************/
+
+typedef struct
+{
+    boolean running;
+    uint16  filter_port;            /* DOIP_CAPTURE_PORT_ALL or a TCP/UDP port */
+    uint8   stored;                 /* Frames currently in the ring */
+    uint32  captured;               /* Frames stored since start */
+    uint32  overwritten;            /* Oldest frames replaced by newer ones */
+    uint32  truncated;              /* Frames longer than DOIP_CAPTURE_SNAPLEN */
+
+} DoIP_CaptureStats;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize the capture ring (capture stopped)
+ */
+void DoIP_Capture_Init(void);
+
+/**
+ * @brief Clear the ring and start capturing
+ * @param filter_port DOIP_CAPTURE_PORT_ALL, or only frames from/to this TCP/UDP port
+ */
+void DoIP_Capture_Start(uint16 filter_port);
+
+/**
+ * @brief Stop capturing (the ring keeps its frames)
+ */
+void DoIP_Capture_Stop(void);
+
+/**
+ * @brief Capture one Ethernet frame (called from the netif driver)
+ * @param frame Frame bytes starting at the Ethernet header (contiguous part)
+ * @param len Contiguous bytes available at frame
+ * @param frame_len Total frame length on the wire
+ */
+void DoIP_Capture_Frame(const uint8 *frame, uint32 len, uint32 frame_len);
+
+/**
+ * @brief Stop capturing and rewind the pcap export to the oldest frame
+ * @return Size of the complete pcap stream in bytes
+ */
+uint32 DoIP_Capture_ExportRewind(void);
+
+/**
+ * @brief Read the next part of the pcap stream
+ * @param dst Output buffer
+ * @param max Buffer size
+ * @return Bytes written, 0 once the whole stream has been read
+ */
+uint32 DoIP_Capture_ExportRead(uint8 *dst, uint32 max);
+
+/**
+ * @brief Get capture counters
+ * @return Statistics
+ */
+const DoIP_CaptureStats *DoIP_Capture_GetStats(void);
+
+#endif /* DOIP_CAPTURE_H */
@@ -5,7 +5,12 @@
 
 #include "doip_client.h"
 #include "doip_message.h"
+#include "doip_stream.h"
+#include "doip_txqueue.h"
+#include "doip_router.h"
 #include "uds_handler.h"
+#include "uds_comm.h"
+#include "uds_dtc.h"
 #include "Ifx_Lwip.h"
 #include "IfxStm.h"
 #include "UART_Logging.h"
@@ -15,24 +20,74 @@
  * Client State Variables
  ******************************************************************************/
 
-static DoIP_ClientConfig    g_config;
-static struct tcp_pcb      *g_pcb = NULL;
-static DoIP_ClientState     g_state = DOIP_STATE_IDLE;
+/* One TCP connection to a VMG endpoint */
+typedef struct
+{
+    struct tcp_pcb   *pcb;
+    DoIP_ClientState  state;
+    uint8             endpoint;                 /* Index into g_config.vmg */
+    uint8             generation;               /* Incremented whenever the connection is torn down */
+    
+    /* Timing */
+    uint32 connect_start_time;
+    uint32 routing_request_time;
+    uint32 last_reconnect_attempt;
+    
+    /* Reconnect backoff: first retry immediate, then exponential with jitter */
+    uint32 reconnect_delay_ms;
+    uint8  retry_count;
+    
+    /* Receive stream (frames are parsed straight off the pbuf chain) */
+    DoIP_Stream rx_stream;
+    
+    /* Payload of the frame being received: Routing (4) + SID (1) + UDS data */
+    uint8   rx_payload[4 + 1 + UDS_MAX_REQUEST_SIZE];
+    boolean rx_payload_overflow;
+    boolean rx_streaming;                       /* Diagnostic data goes to UDS_StreamChunk() */
+    
+    /* Outbound queue (drained by tcp_sent and DoIP_Client_Poll) */
+    uint8        tx_buffer[DOIP_TX_QUEUE_SIZE];
+    DoIP_TxQueue tx_queue;
+    uint32       tx_base_sent;                  /* Queue counters when the connection came up */
+    uint32       tx_base_acked;
+    
+    /* Flags for async events */
+    volatile boolean connected_flag;
+    volatile boolean error_flag;
+    
+} DoIP_ClientLink;
+
+/* Report kept until the VMG's TCP stack has acknowledged it */
+typedef struct
+{
+    uint8   *frame;
+    uint16   capacity;
+    uint16   length;
+    uint8    link;                  /* Link and connection the frame was queued on */
+    uint8    generation;
+    uint32   end_offset;            /* Stream position just past the frame */
+    boolean  pending;
+    
+} DoIP_ReplaySlot;
 
-/* Timing */
-static uint32 g_connect_start_time = 0;
-static uint32 g_routing_request_time = 0;
-static uint32 g_last_reconnect_attempt = 0;
-static uint32 g_connection_ready_time = 0;
+static DoIP_ClientConfig g_config;
 
-/* Receive buffer */
-static uint8  g_rx_buffer[DOIP_RX_BUFFER_SIZE];
-static uint16 g_rx_length = 0;
+static DoIP_ClientLink   g_links[DOIP_CLIENT_MAX_LINKS];
+static uint8             g_link_count = 1;
+static uint8             g_active_link = 0;     /* Carries reports; the other link is the standby */
 
-/* Flags for async events */
-static volatile boolean g_connected_flag = FALSE;
-static volatile boolean g_error_flag = FALSE;
-static volatile boolean g_send_routing_activation = FALSE;
+static uint32            g_jitter_seed = 0;
+
+/* Time to ACTIVE: measured from losing the active link (or boot) with 64-bit ticks */
+static uint64  g_outage_start_time = 0;
+static boolean g_outage_active = FALSE;
+static DoIP_ClientLinkStats g_link_stats;
+
+/* Latest VCI / health report frames, replayed after a failover */
+static uint8 g_vci_frame[DOIP_HEADER_SIZE + 1 + (sizeof(DoIP_VCI_Info) * (MAX_ZONE_ECUS + 1))];
+static uint8 g_health_frame[DOIP_HEADER_SIZE + 1 + (sizeof(DoIP_HealthStatus_Info) * (MAX_ZONE_ECUS + 1))];
+static DoIP_ReplaySlot g_replay_vci;
+static DoIP_ReplaySlot g_replay_health;
 
 /*******************************************************************************
  * Helper Functions
@@ -52,16 +107,168 @@ static uint32 GetElapsedMs(uint32 start_time)
     return (now - start_time) / (uint32)ticks_per_ms;
 }
 
-static void SetState(DoIP_ClientState new_state)
+static void SetState(DoIP_ClientLink *link, DoIP_ClientState new_state)
+{
+    link->state = new_state;
+}
+
+static uint8 GetLinkIndex(const DoIP_ClientLink *link)
+{
+    return (uint8)(link - g_links);
+}
+
+static DoIP_ClientLink *GetActiveLink(void)
+{
+    return &g_links[g_active_link];
+}
+
+static uint32 NextJitter(void)
+{
+    /* xorshift32, seeded from the free-running timer */
+    g_jitter_seed ^= g_jitter_seed << 13;
+    g_jitter_seed ^= g_jitter_seed >> 17;
+    g_jitter_seed ^= g_jitter_seed << 5;
+    return g_jitter_seed;
+}
+
+/* Attempt failed or link lost: pick the delay before the next connect */
+static void ScheduleReconnect(DoIP_ClientLink *link)
+{
+    if (link->retry_count == 0)
+    {
+        link->reconnect_delay_ms = 0;  /* Most blips recover on the first retry */
+    }
+    else
+    {
+        /* Equal jitter: half fixed, half random - spreads out gateways reconnecting together */
+        uint32 backoff = DOIP_RECONNECT_BACKOFF_MIN << (link->retry_count - 1);
+        if (backoff > DOIP_RECONNECT_INTERVAL)
+        {
+            backoff = DOIP_RECONNECT_INTERVAL;
+        }
+        link->reconnect_delay_ms = (backoff / 2) + (NextJitter() % (backoff / 2 + 1));
+    }
+    
+    if (link->retry_count < 16)
+    {
+        link->retry_count++;
+    }
+    link->last_reconnect_attempt = GetTimestamp();
+}
+
+static void EndOutage(void)
+{
+    /* A link carries the reports again */
+    UDS_DTC_SetTestResult(UDS_DTC_VMG_LINK_LOST, FALSE);
+    
+    if (!g_outage_active)
+    {
+        return;
+    }
+    
+    uint64 elapsed = IfxStm_get(&MODULE_STM0) - g_outage_start_time;
+    uint32 ms = (uint32)(elapsed / IfxStm_getTicksFromMilliseconds(&MODULE_STM0, 1));
+    
+    g_link_stats.time_to_active_last_ms = ms;
+    if (ms > g_link_stats.time_to_active_max_ms)
+    {
+        g_link_stats.time_to_active_max_ms = ms;
+    }
+    g_outage_active = FALSE;
+}
+
+/* Next endpoint for a link, skipping the one the other link is connected to */
+static uint8 SelectEndpoint(const DoIP_ClientLink *link)
 {
-    g_state = new_state;
+    uint8 endpoint = link->endpoint;
+    
+    for (uint8 i = 0; i < g_config.vmg_count; i++)
+    {
+        endpoint = (uint8)((endpoint + 1) % g_config.vmg_count);
+        
+        boolean in_use = FALSE;
+        for (uint8 j = 0; j < g_link_count; j++)
+        {
+            if (&g_links[j] != link && g_links[j].state != DOIP_STATE_IDLE && g_links[j].endpoint == endpoint)
+            {
+                in_use = TRUE;
+            }
+        }
+        
+        if (!in_use)
+        {
+            break;
+        }
+    }
+    
+    return endpoint;
+}
+
+/*******************************************************************************
+ * Report Replay
+ ******************************************************************************/
+
+/* Byte position in the current connection's stream (queued or written) */
+static uint32 GetStreamPosition(const DoIP_ClientLink *link)
+{
+    const DoIP_TxQueue *queue = &link->tx_queue;
+    return (queue->stats.bytes_sent - link->tx_base_sent) + (uint32)(queue->tail - queue->head);
+}
+
+static boolean IsAcknowledged(const DoIP_ReplaySlot *slot)
+{
+    const DoIP_ClientLink *link = &g_links[slot->link];
+    uint32 acked = link->tx_queue.stats.bytes_acked - link->tx_base_acked;
+    
+    return (link->generation == slot->generation) && (sint32)(acked - slot->end_offset) >= 0;
+}
+
+/* Queue a report on the active link and remember it until it is acknowledged */
+static boolean SendReport(DoIP_ReplaySlot *slot)
+{
+    DoIP_ClientLink *link = GetActiveLink();
+    
+    if (!DoIP_TxQueue_Send(&link->tx_queue, slot->frame, slot->length))
+    {
+        return FALSE;
+    }
+    
+    slot->link = g_active_link;
+    slot->generation = link->generation;
+    slot->end_offset = GetStreamPosition(link);
+    slot->pending = TRUE;
+    return TRUE;
+}
+
+static void CheckReplay(DoIP_ReplaySlot *slot)
+{
+    if (!slot->pending)
+    {
+        return;
+    }
+    
+    if (IsAcknowledged(slot))
+    {
+        slot->pending = FALSE;
+        return;
+    }
+    
+    /* Connection it was queued on is gone: send it again on the active link
+     * (held while reports are switched off by CommunicationControl) */
+    if (g_links[slot->link].generation != slot->generation &&
+        GetActiveLink()->state == DOIP_STATE_ACTIVE &&
+        UDS_Comm_TxEnabled(UDS_COMM_SUBNET_ETHERNET, UDS_COMM_TYPE_NORMAL) && SendReport(slot))
+    {
+        g_link_stats.replayed_reports++;
+        sendUARTMessage("[DoIP] Report replayed to VMG\r\n", 31);
+    }
 }
 
 /*******************************************************************************
  * Forward Declarations
  ******************************************************************************/
 
-static void ProcessReceivedMessages(void);
+static void ProcessReceivedMessage(DoIP_ClientLink *link, const DoIP_Header *header);
 
 /*******************************************************************************
  * lwIP Callback Functions
@@ -69,17 +276,32 @@ static void ProcessReceivedMessages(void);
 
 static err_t doip_connected_callback(void *arg, struct tcp_pcb *tpcb, err_t err)
 {
-    (void)arg;
-    (void)tpcb;
+    DoIP_ClientLink *link = (DoIP_ClientLink *)arg;
     
-    if (err == ERR_OK)
+    if (err != ERR_OK)
+    {
+        link->error_flag = TRUE;
+        return ERR_OK;
+    }
+    
+    /* Routing activation leaves with the handshake ACK - no wait for the next poll */
+    DoIP_TxQueue_Attach(&link->tx_queue, tpcb);
+    link->tx_base_sent = link->tx_queue.stats.bytes_sent;
+    link->tx_base_acked = link->tx_queue.stats.bytes_acked;
+    SetState(link, DOIP_STATE_CONNECTED);
+    
+    uint8 request_buffer[DOIP_HEADER_SIZE + 7];
+    uint16 len = DoIP_CreateRoutingActivationRequest(request_buffer, g_config.source_address);
+    
+    if (DoIP_TxQueue_Send(&link->tx_queue, request_buffer, len))
     {
-        /* Set flag - actual processing in Poll */
-        g_connected_flag = TRUE;
+        DoIP_TxQueue_Flush(&link->tx_queue);
+        link->routing_request_time = GetTimestamp();
+        link->connected_flag = TRUE;  /* Logged from Poll */
     }
     else
     {
-        g_error_flag = TRUE;
+        link->error_flag = TRUE;
     }
     
     return ERR_OK;
@@ -87,25 +309,57 @@ static err_t doip_connected_callback(void *arg, struct tcp_pcb *tpcb, err_t err)
 
 static void doip_error_callback(void *arg, err_t err)
 {
-    (void)arg;
+    DoIP_ClientLink *link = (DoIP_ClientLink *)arg;
     (void)err;
     
+    if (link == NULL)
+    {
+        return;
+    }
+    
     /* Connection error - set flag */
-    g_error_flag = TRUE;
-    g_pcb = NULL;  /* lwIP already freed the PCB */
+    link->error_flag = TRUE;
+    link->pcb = NULL;  /* lwIP already freed the PCB */
+    DoIP_TxQueue_Attach(&link->tx_queue, NULL);
+}
+
+static err_t doip_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len)
+{
+    DoIP_ClientLink *link = (DoIP_ClientLink *)arg;
+    (void)tpcb;
+    
+    /* Send buffer space freed - push out queued frames */
+    if (link != NULL)
+    {
+        DoIP_TxQueue_OnSent(&link->tx_queue, len);
+    }
+    
+    return ERR_OK;
 }
 
 static err_t doip_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
 {
-    (void)arg;
+    DoIP_ClientLink *link = (DoIP_ClientLink *)arg;
     
-    if (p == NULL)
+    if (p == NULL || link == NULL)
     {
         /* Connection closed by remote */
-        sendUARTMessage("[DoIP] Connection closed by VMG\r\n", 35);
+        if (p != NULL)
+        {
+            pbuf_free(p);
+        }
+        sendUARTMessage("[DoIP] Connection closed by VMG\r\n", 33);
+        tcp_arg(tpcb, NULL);
+        tcp_recv(tpcb, NULL);
+        tcp_sent(tpcb, NULL);
+        tcp_err(tpcb, NULL);
         tcp_close(tpcb);
-        g_pcb = NULL;
-        g_error_flag = TRUE;
+        if (link != NULL)
+        {
+            DoIP_TxQueue_Attach(&link->tx_queue, NULL);
+            link->pcb = NULL;
+            link->error_flag = TRUE;
+        }
         return ERR_OK;
     }
     
@@ -115,26 +369,22 @@ static err_t doip_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p,
         return err;
     }
     
-    /* Copy data to receive buffer */
-    uint16 copy_len = p->tot_len;
-    if (copy_len > (DOIP_RX_BUFFER_SIZE - g_rx_length))
-    {
-        copy_len = DOIP_RX_BUFFER_SIZE - g_rx_length;
-    }
-    
-    pbuf_copy_partial(p, &g_rx_buffer[g_rx_length], copy_len, 0);
-    g_rx_length += copy_len;
-    
     sendUARTMessage("[DoIP] RX: ", 11);
     char buf[20];
     uint8 len = 0;
-    uint32 val = copy_len;
+    uint32 val = p->tot_len;
     do { buf[len++] = '0' + (val % 10); val /= 10; } while (val > 0);
     while (len > 0) { char c = buf[--len]; sendUARTMessage(&c, 1); }
     sendUARTMessage(" bytes\r\n", 8);
     
-    /* Process received data immediately */
-    ProcessReceivedMessages();
+    /* Feed each pbuf of the chain into the reassembler - no flat copy */
+    for (struct pbuf *q = p; q != NULL; q = q->next)
+    {
+        DoIP_Stream_Feed(&link->rx_stream, (const uint8 *)q->payload, q->len);
+    }
+    
+    /* Responses generated for this segment leave in one tcp_output */
+    DoIP_TxQueue_Flush(&link->tx_queue);
     
     /* Acknowledge received data */
     tcp_recved(tpcb, p->tot_len);
@@ -144,219 +394,362 @@ static err_t doip_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p,
 }
 
 /*******************************************************************************
- * Message Processing
+ * Receive Stream Callbacks
  ******************************************************************************/
 
-static void ProcessReceivedMessages(void)
+static void doip_stream_header(void *ctx, const DoIP_Header *header)
 {
-    while (g_rx_length >= DOIP_HEADER_SIZE)
+    DoIP_ClientLink *link = (DoIP_ClientLink *)ctx;
+    (void)header;
+    
+    link->rx_payload_overflow = FALSE;
+    link->rx_streaming = FALSE;
+}
+
+static void doip_stream_payload(void *ctx, const DoIP_Header *header, uint32 offset, const uint8 *data, uint32 len)
+{
+    DoIP_ClientLink *link = (DoIP_ClientLink *)ctx;
+    
+    if (link->rx_streaming)
     {
-        /* Parse header */
-        DoIP_Header header;
-        if (!DoIP_ParseHeader(g_rx_buffer, &header))
+        UDS_StreamChunk(&link->tx_queue, offset - UDS_STREAM_HEAD_SIZE, data, len);
+        return;
+    }
+    
+    /* Once SA, TA and SID are in, a streaming service may take a local request directly */
+    if (header->payloadType == DOIP_DIAGNOSTIC_MESSAGE && link->state == DOIP_STATE_ACTIVE
+        && offset < UDS_STREAM_HEAD_SIZE && offset + len >= UDS_STREAM_HEAD_SIZE)
+    {
+        uint32 head_len = UDS_STREAM_HEAD_SIZE - offset;
+        memcpy(&link->rx_payload[offset], data, head_len);
+        
+        uint16 target = ((uint16)link->rx_payload[2] << 8) | link->rx_payload[3];
+        if (target == g_config.source_address
+            && UDS_StreamBegin(&link->tx_queue, link->rx_payload, header->payloadLength))
         {
-            /* Invalid header - discard 1 byte and retry */
-            sendUARTMessage("[DoIP] Invalid header\r\n", 23);
-            memmove(g_rx_buffer, &g_rx_buffer[1], g_rx_length - 1);
-            g_rx_length--;
-            continue;
+            link->rx_streaming = TRUE;
+            UDS_StreamChunk(&link->tx_queue, 0, &data[head_len], len - head_len);
+            return;
         }
-        
-        /* Check if we have complete message */
-        uint32 total_len = DOIP_HEADER_SIZE + header.payloadLength;
-        if (g_rx_length < total_len)
+    }
+    
+    /* Keep what fits; the handler rejects an oversized request as a whole */
+    if (offset + len > sizeof(link->rx_payload))
+    {
+        link->rx_payload_overflow = TRUE;
+        len = (offset < sizeof(link->rx_payload)) ? (sizeof(link->rx_payload) - offset) : 0;
+    }
+    
+    if (len > 0)
+    {
+        memcpy(&link->rx_payload[offset], data, len);
+    }
+}
+
+static void doip_stream_frame_end(void *ctx, const DoIP_Header *header)
+{
+    ProcessReceivedMessage((DoIP_ClientLink *)ctx, header);
+}
+
+static void doip_stream_nack(void *ctx, uint8 nack_code)
+{
+    DoIP_ClientLink *link = (DoIP_ClientLink *)ctx;
+    
+    sendUARTMessage("[DoIP] Invalid header - Generic NACK\r\n", 38);
+    
+    uint8 nack_buffer[DOIP_HEADER_SIZE + 1];
+    uint16 len = DoIP_CreateGenericNack(nack_buffer, nack_code);
+    DoIP_TxQueue_Send(&link->tx_queue, nack_buffer, len);
+}
+
+static const DoIP_StreamHandlers g_rx_stream_handlers = {
+    doip_stream_header,
+    doip_stream_payload,
+    doip_stream_frame_end,
+    doip_stream_nack
+};
+
+/*******************************************************************************
+ * Message Processing
+ ******************************************************************************/
+
+static void SendDiagnosticAck(DoIP_ClientLink *link, const uint8 *payload, uint8 ack_code)
+{
+    /* ACK/NACK goes from the addressed target back to the requester */
+    uint16 requester = ((uint16)payload[0] << 8) | payload[1];
+    uint16 target = ((uint16)payload[2] << 8) | payload[3];
+    uint8 ack_buffer[DOIP_HEADER_SIZE + 5];
+    uint16 len = DoIP_CreateDiagnosticAck(ack_buffer, target, requester, ack_code);
+    DoIP_TxQueue_Send(&link->tx_queue, ack_buffer, len);
+}
+
+/* UDS response sink - runs from UDS_Poll() in the main loop; ctx is the link's queue */
+static boolean doip_uds_response(void *ctx, uint32 tag, const uint8 *frame, uint16 len)
+{
+    DoIP_TxQueue *queue = (DoIP_TxQueue *)ctx;
+    (void)tag;
+    
+    /* The response arrives encoded: its frame goes out as it is */
+    if (!DoIP_TxQueue_Write(queue, frame, len))
+    {
+        return FALSE;  /* Offered again once queued frames are sent */
+    }
+    
+    sendUARTMessage("[DoIP] TX: Diagnostic Response queued\r\n", 39);
+    return TRUE;
+}
+
+static void ProcessDiagnosticMessage(DoIP_ClientLink *link, const uint8 *payload, uint32 payload_len)
+{
+    uint16 target = ((uint16)payload[2] << 8) | payload[3];
+    uint8 ack_code = DOIP_DIAG_ACK;
+    
+    if (link->rx_streaming)
+    {
+        /* Data already went to the streaming service; queue its completion */
+        link->rx_streaming = FALSE;
+        if (!UDS_StreamEnd(&link->tx_queue, doip_uds_response, 0))
         {
-            /* Wait for more data */
-            break;
+            ack_code = DOIP_DIAG_NACK_OUT_OF_MEMORY;
         }
-        
-        /* Process message based on type */
-        const uint8 *payload = &g_rx_buffer[DOIP_HEADER_SIZE];
-        
-        if (header.payloadType == DOIP_ROUTING_ACTIVATION_RES)
+    }
+    else if (link->rx_payload_overflow)
+    {
+        ack_code = DOIP_DIAG_NACK_MESSAGE_TOO_LARGE;
+    }
+    else if (target != g_config.source_address)
+    {
+        /* Zone ECU: forwarded, the response comes back through this link's queue */
+        ack_code = DoIP_Router_Forward(payload, payload_len, &link->tx_queue);
+    }
+    else if (!UDS_SubmitRequest(payload, payload_len, doip_uds_response, &link->tx_queue, 0))
+    {
+        /* All in-flight slots used: the VMG pipelines too deep */
+        ack_code = DOIP_DIAG_NACK_OUT_OF_MEMORY;
+    }
+    
+    /* Immediate ACK - the UDS response follows from the main loop */
+    SendDiagnosticAck(link, payload, ack_code);
+    
+    if (ack_code != DOIP_DIAG_ACK)
+    {
+        sendUARTMessage("[DoIP] TX: Diagnostic Message NACK\r\n", 36);
+    }
+}
+
+static void OnRoutingActive(DoIP_ClientLink *link)
+{
+    SetState(link, DOIP_STATE_ACTIVE);
+    link->retry_count = 0;
+    g_link_stats.activations++;
+    
+    if (GetActiveLink()->state != DOIP_STATE_ACTIVE || GetActiveLink() == link)
+    {
+        /* No usable link so far: this one carries the reports */
+        g_active_link = GetLinkIndex(link);
+        EndOutage();
+        sendUARTMessage("[DoIP] Routing Activation SUCCESS\r\n", 35);
+    }
+    else
+    {
+        sendUARTMessage("[DoIP] Standby link ready\r\n", 27);
+    }
+}
+
+static void ProcessReceivedMessage(DoIP_ClientLink *link, const DoIP_Header *header)
+{
+    const uint8 *payload = link->rx_payload;
+    
+    /* Process message based on type */
+    if (header->payloadType == DOIP_ROUTING_ACTIVATION_RES)
+    {
+        sendUARTMessage("[DoIP] RX: Routing Activation Response\r\n", 40);
+        uint8 response_code;
+        if (DoIP_ParseRoutingActivationResponse(payload, header->payloadLength, &response_code))
         {
-            sendUARTMessage("[DoIP] RX: Routing Activation Response\r\n", 41);
-            uint8 response_code;
-            if (DoIP_ParseRoutingActivationResponse(payload, header.payloadLength, &response_code))
+            if (response_code == DOIP_RA_RES_SUCCESS)
             {
-                if (response_code == DOIP_RA_RES_SUCCESS)
-                {
-                    SetState(DOIP_STATE_ACTIVE);
-                    sendUARTMessage("[DoIP] Routing Activation SUCCESS\r\n", 37);
-                }
-                else
-                {
-                    sendUARTMessage("[DoIP] Routing Activation FAILED\r\n", 36);
-                    g_error_flag = TRUE;
-                }
+                OnRoutingActive(link);
             }
             else
             {
-                sendUARTMessage("[DoIP] Parse error\r\n", 20);
+                sendUARTMessage("[DoIP] Routing Activation FAILED\r\n", 34);
+                link->error_flag = TRUE;
             }
         }
-        else if (header.payloadType == DOIP_ALIVE_CHECK_REQ)
+        else
         {
-            sendUARTMessage("[DoIP] RX: Alive Check Request\r\n", 34);
-            /* Send Alive Check Response */
-            uint8 response_buffer[DOIP_HEADER_SIZE + 2];
-            uint16 len = DoIP_CreateAliveCheckResponse(response_buffer, g_config.source_address);
-            tcp_write(g_pcb, response_buffer, len, TCP_WRITE_FLAG_COPY);
-            sendUARTMessage("[DoIP] TX: Alive Check Response\r\n", 35);
-        }
-        else if (header.payloadType == DOIP_DIAGNOSTIC_MESSAGE)
-        {
-            sendUARTMessage("[DoIP] RX: Diagnostic Message\r\n", 33);
-            
-            /* Parse UDS request from DoIP payload */
-            UDS_Request uds_request;
-            if (UDS_ParseDoIPDiagnostic(payload, header.payloadLength, &uds_request))
-            {
-                /* Handle UDS request and generate response */
-                UDS_Response uds_response;
-                if (UDS_HandleRequest(&uds_request, &uds_response))
-                {
-                    /* Build DoIP diagnostic message with UDS response */
-                    uint8 response_buffer[DOIP_RX_BUFFER_SIZE];
-                    uint16 response_len = UDS_BuildDoIPDiagnostic(&uds_response, response_buffer, sizeof(response_buffer));
-                    
-                    if (response_len > 0 && g_pcb != NULL)
-                    {
-                        /* Send response */
-                        err_t err = tcp_write(g_pcb, response_buffer, response_len, TCP_WRITE_FLAG_COPY);
-                        if (err == ERR_OK)
-                        {
-                            tcp_output(g_pcb);  /* Flush immediately */
-                            sendUARTMessage("[DoIP] TX: Diagnostic Response sent\r\n", 39);
-                        }
-                        else
-                        {
-                            sendUARTMessage("[DoIP] TX: Failed to send response\r\n", 38);
-                        }
-                    }
-                }
-            }
-        }
-        
-        /* Remove processed message from buffer */
-        g_rx_length -= total_len;
-        if (g_rx_length > 0)
-        {
-            memmove(g_rx_buffer, &g_rx_buffer[total_len], g_rx_length);
+            sendUARTMessage("[DoIP] Parse error\r\n", 20);
         }
     }
+    else if (header->payloadType == DOIP_ALIVE_CHECK_REQ)
+    {
+        sendUARTMessage("[DoIP] RX: Alive Check Request\r\n", 32);
+        /* Send Alive Check Response */
+        uint8 response_buffer[DOIP_HEADER_SIZE + 2];
+        uint16 len = DoIP_CreateAliveCheckResponse(response_buffer, g_config.source_address);
+        DoIP_TxQueue_Send(&link->tx_queue, response_buffer, len);
+        sendUARTMessage("[DoIP] TX: Alive Check Response\r\n", 33);
+    }
+    else if (header->payloadType == DOIP_DIAGNOSTIC_MESSAGE)
+    {
+        sendUARTMessage("[DoIP] RX: Diagnostic Message\r\n", 31);
+        ProcessDiagnosticMessage(link, payload, header->payloadLength);
+    }
+    else if (header->payloadType == DOIP_DIAGNOSTIC_MESSAGE_NACK)
+    {
+        /* VMG rejected one of our requests (VCI / Health) */
+        sendUARTMessage("[DoIP] RX: Diagnostic Message NACK\r\n", 36);
+    }
 }
 
 /*******************************************************************************
  * Connection Management
  ******************************************************************************/
 
-static void DoIP_ConnectToVMG(void)
+static void DoIP_ConnectToVMG(DoIP_ClientLink *link)
 {
-    if (g_pcb != NULL)
+    if (link->pcb != NULL)
     {
         return;  /* Already have a PCB */
     }
     
     /* Create new TCP PCB */
-    g_pcb = tcp_new();
-    if (g_pcb == NULL)
+    link->pcb = tcp_new();
+    if (link->pcb == NULL)
     {
-        SetState(DOIP_STATE_ERROR);
+        SetState(link, DOIP_STATE_ERROR);
         return;
     }
     
+    /* Keepalive probes detect a half-open link (VMG gone without FIN/RST) */
+    ip_set_option(link->pcb, SOF_KEEPALIVE);
+    link->pcb->keep_idle = DOIP_KEEPALIVE_IDLE;
+    link->pcb->keep_intvl = DOIP_KEEPALIVE_INTERVAL;
+    link->pcb->keep_cnt = DOIP_KEEPALIVE_COUNT;
+    
     /* Set callbacks */
-    tcp_err(g_pcb, doip_error_callback);
-    tcp_recv(g_pcb, doip_recv_callback);
+    tcp_arg(link->pcb, link);
+    tcp_err(link->pcb, doip_error_callback);
+    tcp_recv(link->pcb, doip_recv_callback);
+    tcp_sent(link->pcb, doip_sent_callback);
     
     /* Initiate connection */
-    err_t err = tcp_connect(g_pcb, &g_config.vmg_ip, g_config.vmg_port, doip_connected_callback);
+    const DoIP_VmgEndpoint *vmg = &g_config.vmg[link->endpoint];
+    err_t err = tcp_connect(link->pcb, &vmg->ip, vmg->port, doip_connected_callback);
     
     if (err == ERR_OK)
     {
-        SetState(DOIP_STATE_CONNECTING);
-        g_connect_start_time = GetTimestamp();
-        g_connected_flag = FALSE;
-        g_error_flag = FALSE;
+        SetState(link, DOIP_STATE_CONNECTING);
+        g_link_stats.connect_attempts++;
+        link->connect_start_time = GetTimestamp();
+        link->connected_flag = FALSE;
+        link->error_flag = FALSE;
     }
     else
     {
-        tcp_abort(g_pcb);
-        g_pcb = NULL;
-        SetState(DOIP_STATE_ERROR);
+        tcp_abort(link->pcb);
+        link->pcb = NULL;
+        SetState(link, DOIP_STATE_ERROR);
     }
 }
 
-static void DoIP_Cleanup(void)
+static void DoIP_Cleanup(DoIP_ClientLink *link)
 {
-    if (g_pcb != NULL)
+    DoIP_TxQueue_Attach(&link->tx_queue, NULL);
+    UDS_CancelRequests(&link->tx_queue);
+    DoIP_Router_CancelOrigin(&link->tx_queue);
+    
+    if (link->pcb != NULL)
     {
-        tcp_abort(g_pcb);
-        g_pcb = NULL;
+        tcp_arg(link->pcb, NULL);
+        tcp_err(link->pcb, NULL);
+        tcp_abort(link->pcb);
+        link->pcb = NULL;
     }
     
-    g_rx_length = 0;
-    g_connected_flag = FALSE;
-    g_error_flag = FALSE;
-    g_send_routing_activation = FALSE;
-    SetState(DOIP_STATE_IDLE);
+    DoIP_Stream_Reset(&link->rx_stream);
+    link->rx_streaming = FALSE;
+    link->connected_flag = FALSE;
+    link->error_flag = FALSE;
+    link->generation++;
+    SetState(link, DOIP_STATE_IDLE);
 }
 
-/*******************************************************************************
- * Public Functions
- ******************************************************************************/
-
-void DoIP_Client_Init(const DoIP_ClientConfig *config)
+/* Link failed: tear it down, fail over if it carried the reports, retry */
+static void DoIP_LinkLost(DoIP_ClientLink *link)
 {
-    /* Copy configuration */
-    g_config = *config;
+    boolean was_active = (link->state == DOIP_STATE_ACTIVE);
+    
+    DoIP_Cleanup(link);
     
-    /* Initialize state */
-    g_state = DOIP_STATE_IDLE;
-    g_pcb = NULL;
-    g_rx_length = 0;
-    g_connected_flag = FALSE;
-    g_error_flag = FALSE;
-    g_send_routing_activation = FALSE;
+    if (GetActiveLink() == link)
+    {
+        if (was_active && !g_outage_active)
+        {
+            g_outage_active = TRUE;
+            g_outage_start_time = IfxStm_get(&MODULE_STM0);
+            g_link_stats.link_losses++;
+        }
+        
+        /* Hot standby already has routing activated: switch over right away */
+        for (uint8 i = 0; i < g_link_count; i++)
+        {
+            if (g_links[i].state == DOIP_STATE_ACTIVE)
+            {
+                g_active_link = i;
+                g_link_stats.failovers++;
+                EndOutage();
+                sendUARTMessage("[DoIP] Failover to standby VMG link\r\n", 37);
+                break;
+            }
+        }
+        
+        if (g_outage_active)
+        {
+            UDS_DTC_SetTestResult(UDS_DTC_VMG_LINK_LOST, TRUE);
+        }
+    }
+    else if (was_active)
+    {
+        g_link_stats.link_losses++;  /* Standby lost */
+    }
     
-    sendUARTMessage("[DoIP] Client initialized\r\n", 29);
+    /* Retry towards the next endpoint that the other link does not use */
+    link->endpoint = SelectEndpoint(link);
+    ScheduleReconnect(link);
 }
 
-void DoIP_Client_Poll(void)
+static void PollLink(DoIP_ClientLink *link)
 {
-    uint32 now = GetTimestamp();
-    
-    /* Handle async connection event */
-    if (g_connected_flag)
+    /* Handle async connection event (routing activation already sent) */
+    if (link->connected_flag)
     {
-        g_connected_flag = FALSE;
-        SetState(DOIP_STATE_CONNECTED);
-        g_connection_ready_time = now;
-        g_send_routing_activation = TRUE;
-        sendUARTMessage("[DoIP] TCP connected\r\n", 24);
+        link->connected_flag = FALSE;
+        sendUARTMessage("[DoIP] TCP connected\r\n", 22);
+        sendUARTMessage("[DoIP] Routing Activation Request sent\r\n", 40);
     }
     
     /* Handle async error event */
-    if (g_error_flag)
+    if (link->error_flag)
     {
-        g_error_flag = FALSE;
-        sendUARTMessage("[DoIP] Connection error\r\n", 27);
-        DoIP_Cleanup();
-        g_last_reconnect_attempt = now;
+        link->error_flag = FALSE;
+        sendUARTMessage("[DoIP] Connection error\r\n", 25);
+        DoIP_LinkLost(link);
         return;
     }
     
     /* State machine */
-    switch (g_state)
+    switch (link->state)
     {
         case DOIP_STATE_IDLE:
         {
-            /* Try to connect after reconnect interval */
-            if (GetElapsedMs(g_last_reconnect_attempt) >= DOIP_RECONNECT_INTERVAL)
+            /* Connect once the backoff delay has passed; without a link the
+             * attempt could only fail and push the next one back */
+            if (netif_is_link_up(&g_Lwip.netif) &&
+                GetElapsedMs(link->last_reconnect_attempt) >= link->reconnect_delay_ms)
             {
-                DoIP_ConnectToVMG();
-                g_last_reconnect_attempt = now;
+                DoIP_ConnectToVMG(link);
             }
             break;
         }
@@ -364,45 +757,21 @@ void DoIP_Client_Poll(void)
         case DOIP_STATE_CONNECTING:
         {
             /* Check connection timeout */
-            if (GetElapsedMs(g_connect_start_time) >= DOIP_TIMEOUT_CONNECTION)
+            if (GetElapsedMs(link->connect_start_time) >= DOIP_TIMEOUT_CONNECTION)
             {
-                sendUARTMessage("[DoIP] Connection timeout\r\n", 29);
-                DoIP_Cleanup();
-                g_last_reconnect_attempt = now;
+                sendUARTMessage("[DoIP] Connection timeout\r\n", 27);
+                DoIP_LinkLost(link);
             }
             break;
         }
         
         case DOIP_STATE_CONNECTED:
         {
-            /* Wait 200ms for TCP buffers to be ready */
-            if (g_send_routing_activation && 
-                GetElapsedMs(g_connection_ready_time) >= 200)
-            {
-                g_send_routing_activation = FALSE;
-                
-                /* Send Routing Activation Request */
-                uint8 request_buffer[DOIP_HEADER_SIZE + 7];
-                uint16 len = DoIP_CreateRoutingActivationRequest(request_buffer, g_config.source_address);
-                
-                if (tcp_write(g_pcb, request_buffer, len, TCP_WRITE_FLAG_COPY) == ERR_OK)
-                {
-                    g_routing_request_time = now;
-                    sendUARTMessage("[DoIP] Routing Activation Request sent\r\n", 43);
-                }
-                else
-                {
-                    g_error_flag = TRUE;
-                }
-            }
-            
             /* Check routing activation timeout */
-            if (!g_send_routing_activation && 
-                GetElapsedMs(g_routing_request_time) >= DOIP_TIMEOUT_ROUTING)
+            if (GetElapsedMs(link->routing_request_time) >= DOIP_TIMEOUT_ROUTING)
             {
-                sendUARTMessage("[DoIP] Routing timeout\r\n", 26);
-                DoIP_Cleanup();
-                g_last_reconnect_attempt = now;
+                sendUARTMessage("[DoIP] Routing timeout\r\n", 24);
+                DoIP_LinkLost(link);
             }
             
             break;
@@ -410,33 +779,117 @@ void DoIP_Client_Poll(void)
         
         case DOIP_STATE_ACTIVE:
         {
-            /* Process received messages */
-            ProcessReceivedMessages();
+            /* Received frames are processed as the stream completes them */
             break;
         }
         
         case DOIP_STATE_ERROR:
         {
-            DoIP_Cleanup();
-            g_last_reconnect_attempt = now;
+            DoIP_LinkLost(link);
             break;
         }
     }
+    
+    /* Retry frames that did not fit into the send buffer and batch new ones */
+    DoIP_TxQueue_Flush(&link->tx_queue);
+}
+
+/* Build a report (VCI / health) in its replay slot */
+static boolean BuildReport(DoIP_ReplaySlot *slot, uint16 payloadType, uint8 count, const void *data, uint32 entry_size)
+{
+    /* Payload length = 1 byte (count) + (size per ECU * count) */
+    uint32 payload_len = 1 + (entry_size * count);
+    uint32 total_len = DOIP_HEADER_SIZE + payload_len;
+    
+    if (total_len > slot->capacity)
+    {
+        return FALSE;
+    }
+    
+    DoIP_CreateHeader(slot->frame, payloadType, payload_len);
+    slot->frame[8] = count;
+    memcpy(&slot->frame[9], data, entry_size * count);
+    slot->length = (uint16)total_len;
+    
+    /* A new report supersedes an unacknowledged older one */
+    slot->pending = FALSE;
+    return TRUE;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void DoIP_Client_Init(const DoIP_ClientConfig *config)
+{
+    /* Copy configuration */
+    g_config = *config;
+    if (g_config.vmg_count == 0 || g_config.vmg_count > DOIP_CLIENT_MAX_ENDPOINTS)
+    {
+        g_config.vmg_count = 1;
+    }
+    
+    /* Standby link only makes sense towards a second VMG */
+    g_link_count = (g_config.vmg_count >= 2) ? DOIP_CLIENT_MAX_LINKS : 1;
+    g_active_link = 0;
+    g_jitter_seed = GetTimestamp() | 1;
+    memset(&g_link_stats, 0, sizeof(g_link_stats));
+    
+    for (uint8 i = 0; i < DOIP_CLIENT_MAX_LINKS; i++)
+    {
+        DoIP_ClientLink *link = &g_links[i];
+        
+        memset(link, 0, sizeof(DoIP_ClientLink));
+        link->state = DOIP_STATE_IDLE;
+        link->endpoint = (uint8)(i % g_config.vmg_count);
+        DoIP_Stream_Init(&link->rx_stream, &g_rx_stream_handlers, link);
+        DoIP_TxQueue_Init(&link->tx_queue, link->tx_buffer, sizeof(link->tx_buffer));
+        
+        /* First connect right away */
+        link->retry_count = 1;
+        link->reconnect_delay_ms = 0;
+        link->last_reconnect_attempt = GetTimestamp();
+    }
+    
+    memset(&g_replay_vci, 0, sizeof(g_replay_vci));
+    g_replay_vci.frame = g_vci_frame;
+    g_replay_vci.capacity = sizeof(g_vci_frame);
+    memset(&g_replay_health, 0, sizeof(g_replay_health));
+    g_replay_health.frame = g_health_frame;
+    g_replay_health.capacity = sizeof(g_health_frame);
+    
+    /* Boot counts as an outage: time to ACTIVE from the reset (STM starts at 0) */
+    g_outage_start_time = 0;
+    g_outage_active = TRUE;
+    
+    sendUARTMessage("[DoIP] Client initialized\r\n", 27);
+}
+
+void DoIP_Client_Poll(void)
+{
+    for (uint8 i = 0; i < g_link_count; i++)
+    {
+        PollLink(&g_links[i]);
+    }
+    
+    /* Reports lost with a failed link go out on the active one */
+    CheckReplay(&g_replay_vci);
+    CheckReplay(&g_replay_health);
 }
 
 DoIP_ClientState DoIP_Client_GetState(void)
 {
-    return g_state;
+    return GetActiveLink()->state;
 }
 
 boolean DoIP_Client_IsActive(void)
 {
-    return (g_state == DOIP_STATE_ACTIVE);
+    return (GetActiveLink()->state == DOIP_STATE_ACTIVE);
 }
 
 boolean DoIP_Client_SendHealthStatusReport(uint8 ecu_count, const DoIP_HealthStatus_Info *health_data)
 {
-    if (g_state != DOIP_STATE_ACTIVE || g_pcb == NULL)
+    if (!DoIP_Client_IsActive() || !UDS_Comm_TxEnabled(UDS_COMM_SUBNET_ETHERNET, UDS_COMM_TYPE_NORMAL))
     {
         return FALSE;
     }
@@ -446,53 +899,24 @@ boolean DoIP_Client_SendHealthStatusReport(uint8 ecu_count, const DoIP_HealthSta
         return FALSE;
     }
     
-    /* Create Health Status Report message */
-    uint8 buffer[DOIP_HEADER_SIZE + 1 + (sizeof(DoIP_HealthStatus_Info) * MAX_ZONE_ECUS)];
-    
-    /* DoIP Header */
-    buffer[0] = DOIP_PROTOCOL_VERSION;
-    buffer[1] = DOIP_INVERSE_VERSION;
-    buffer[2] = (DOIP_HEALTH_STATUS_REPORT >> 8) & 0xFF;
-    buffer[3] = DOIP_HEALTH_STATUS_REPORT & 0xFF;
-    
-    /* Payload length = 1 byte (count) + (size per ECU * ecu_count) */
-    uint32 payload_len = 1 + (sizeof(DoIP_HealthStatus_Info) * ecu_count);
-    buffer[4] = (payload_len >> 24) & 0xFF;
-    buffer[5] = (payload_len >> 16) & 0xFF;
-    buffer[6] = (payload_len >> 8) & 0xFF;
-    buffer[7] = payload_len & 0xFF;
-    
-    /* ECU Count */
-    buffer[8] = ecu_count;
-    
-    /* Copy Health data for each ECU */
-    uint16 offset = 9;
-    for (uint8 i = 0; i < ecu_count; i++)
+    /* Built once in the replay slot, copied into the TX queue */
+    if (!BuildReport(&g_replay_health, DOIP_HEALTH_STATUS_REPORT, ecu_count, health_data, sizeof(DoIP_HealthStatus_Info)) ||
+        !SendReport(&g_replay_health))
     {
-        memcpy(&buffer[offset], &health_data[i], sizeof(DoIP_HealthStatus_Info));
-        offset += sizeof(DoIP_HealthStatus_Info);
-    }
-    
-    /* Send */
-    uint16 total_len = DOIP_HEADER_SIZE + payload_len;
-    err_t err = tcp_write(g_pcb, buffer, total_len, TCP_WRITE_FLAG_COPY);
-    
-    if (err == ERR_OK)
-    {
-        sendUARTMessage("[Health] Status report sent (", 29);
-        char count_str[4];
-        count_str[0] = '0' + ecu_count;
-        sendUARTMessage(count_str, 1);
-        sendUARTMessage(" ECUs)\r\n", 8);
-        return TRUE;
+        return FALSE;
     }
     
-    return FALSE;
+    sendUARTMessage("[Health] Status report queued (", 31);
+    char count_str[4];
+    count_str[0] = '0' + ecu_count;
+    sendUARTMessage(count_str, 1);
+    sendUARTMessage(" ECUs)\r\n", 8);
+    return TRUE;
 }
 
 boolean DoIP_Client_SendVCIReport(uint8 vci_count, const DoIP_VCI_Info *vci_database)
 {
-    if (g_state != DOIP_STATE_ACTIVE || g_pcb == NULL)
+    if (!DoIP_Client_IsActive() || !UDS_Comm_TxEnabled(UDS_COMM_SUBNET_ETHERNET, UDS_COMM_TYPE_NORMAL))
     {
         return FALSE;
     }
@@ -502,99 +926,91 @@ boolean DoIP_Client_SendVCIReport(uint8 vci_count, const DoIP_VCI_Info *vci_data
         return FALSE;
     }
     
-    /* Create VCI Report message */
-    uint8 buffer[DOIP_HEADER_SIZE + 1 + (sizeof(DoIP_VCI_Info) * MAX_ZONE_ECUS)];
-    
-    /* DoIP Header */
-    buffer[0] = DOIP_PROTOCOL_VERSION;
-    buffer[1] = DOIP_INVERSE_VERSION;
-    buffer[2] = (DOIP_VCI_REPORT >> 8) & 0xFF;
-    buffer[3] = DOIP_VCI_REPORT & 0xFF;
-    
-    /* Payload length = 1 byte (count) + (48 bytes per ECU * vci_count) */
-    uint32 payload_len = 1 + (sizeof(DoIP_VCI_Info) * vci_count);
-    buffer[4] = (payload_len >> 24) & 0xFF;
-    buffer[5] = (payload_len >> 16) & 0xFF;
-    buffer[6] = (payload_len >> 8) & 0xFF;
-    buffer[7] = payload_len & 0xFF;
-    
-    /* VCI Count */
-    buffer[8] = vci_count;
-    
-    /* Copy VCI data for each ECU */
-    uint16 offset = 9;
-    for (uint8 i = 0; i < vci_count; i++)
+    /* Built once in the replay slot, copied into the TX queue */
+    if (!BuildReport(&g_replay_vci, DOIP_VCI_REPORT, vci_count, vci_database, sizeof(DoIP_VCI_Info)) ||
+        !SendReport(&g_replay_vci))
     {
-        memcpy(&buffer[offset], &vci_database[i], sizeof(DoIP_VCI_Info));
-        offset += sizeof(DoIP_VCI_Info);
+        return FALSE;
     }
     
-    /* Send */
-    uint16 total_len = DOIP_HEADER_SIZE + payload_len;
-    err_t err = tcp_write(g_pcb, buffer, total_len, TCP_WRITE_FLAG_COPY);
-    
-    if (err == ERR_OK)
+    sendUARTMessage("[VCI] Report queued for VMG (", 29);
+    char count_str[4];
+    count_str[0] = '0' + vci_count;
+    sendUARTMessage(count_str, 1);
+    sendUARTMessage(" ECUs)\r\n", 8);
+    return TRUE;
+}
+
+void DoIP_Client_Close(void)
+{
+    for (uint8 i = 0; i < g_link_count; i++)
     {
-        sendUARTMessage("[VCI] Report sent to VMG (", 26);
-        char count_str[4];
-        count_str[0] = '0' + vci_count;
-        count_str[1] = ' ';
-        count_str[2] = 'E';
-        count_str[3] = 'C';
-        sendUARTMessage(count_str, 1);
-        sendUARTMessage(" ECUs)\r\n", 8);
-        return TRUE;
+        DoIP_Cleanup(&g_links[i]);
+    }
+}
+
+void DoIP_Client_Suspend(DoIP_ClientResume *resume)
+{
+    resume->endpoint = GetActiveLink()->endpoint;
+    resume->stats = g_link_stats;
+}
+
+void DoIP_Client_Resume(const DoIP_ClientResume *resume)
+{
+    /* The active link goes straight back to the VMG it was connected to */
+    if (resume->endpoint < g_config.vmg_count)
+    {
+        for (uint8 i = 0; i < DOIP_CLIENT_MAX_LINKS; i++)
+        {
+            g_links[i].endpoint = (uint8)((resume->endpoint + i) % g_config.vmg_count);
+        }
     }
     
-    return FALSE;
+    g_link_stats = resume->stats;
 }
 
-void DoIP_Client_Close(void)
+const DoIP_TxQueueStats *DoIP_Client_GetTxStats(void)
+{
+    return &GetActiveLink()->tx_queue.stats;
+}
+
+const DoIP_ClientLinkStats *DoIP_Client_GetLinkStats(void)
 {
-    DoIP_Cleanup();
+    return &g_link_stats;
 }
 
 /*******************************************************************************
  * UDS-based VCI Request Functions
  ******************************************************************************/
 
-boolean DoIP_Client_RequestConsolidatedVCI(void)
+/* ReadDataByIdentifier request to the VMG, encoded straight into the active link's queue */
+static boolean SendReadDataRequest(uint16 did)
 {
-    if (g_state != DOIP_STATE_ACTIVE || g_pcb == NULL)
+    uint16 frame_len = UDS_RESPONSE_HEADROOM + 2;
+    uint8 *frame = DoIP_TxQueue_Reserve(&GetActiveLink()->tx_queue, frame_len);
+    
+    if (frame == NULL)
     {
         return FALSE;
     }
     
-    /* Create UDS Request for Consolidated VCI (DID 0xF195) */
-    UDS_Request request;
-    request.source_address = ZGW_ADDRESS;     /* 0x0100 - Zonal Gateway */
-    request.target_address = VMG_ADDRESS;     /* 0x0200 - VMG */
-    request.service_id = UDS_SID_READ_DATA_BY_IDENTIFIER;  /* 0x22 */
-    request.data_len = 2;
-    request.data[0] = (UDS_DID_VCI_CONSOLIDATED >> 8) & 0xFF;  /* DID High */
-    request.data[1] = UDS_DID_VCI_CONSOLIDATED & 0xFF;         /* DID Low (0xF195) */
-    
-    /* Build DoIP Diagnostic Message */
-    uint8 buffer[256];
-    UDS_Response dummy_response;  /* Not used for requests */
-    dummy_response.source_address = request.source_address;
-    dummy_response.target_address = request.target_address;
-    dummy_response.is_positive = TRUE;
-    dummy_response.service_id = request.service_id;
-    dummy_response.data_len = request.data_len;
-    memcpy(dummy_response.data, request.data, request.data_len);
-    
-    uint16 msg_len = UDS_BuildDoIPDiagnostic(&dummy_response, buffer, sizeof(buffer));
+    UDS_EncodeDoIPHeader(frame, ZGW_ADDRESS, VMG_ADDRESS, UDS_SID_READ_DATA_BY_IDENTIFIER, 2);
+    frame[UDS_RESPONSE_HEADROOM] = (did >> 8) & 0xFF;      /* DID High */
+    frame[UDS_RESPONSE_HEADROOM + 1] = did & 0xFF;         /* DID Low */
+    DoIP_TxQueue_Commit(&GetActiveLink()->tx_queue, frame_len);
     
-    if (msg_len == 0)
+    return TRUE;
+}
+
+boolean DoIP_Client_RequestConsolidatedVCI(void)
+{
+    if (!DoIP_Client_IsActive())
     {
         return FALSE;
     }
     
-    /* Send via TCP */
-    err_t err = tcp_write(g_pcb, buffer, msg_len, TCP_WRITE_FLAG_COPY);
-    
-    if (err == ERR_OK)
+    /* Consolidated VCI (DID 0xF195) */
+    if (SendReadDataRequest(UDS_DID_VCI_CONSOLIDATED))
     {
         sendUARTMessage("[UDS] VCI Request sent (DID 0xF195)\r\n", 38);
         return TRUE;
@@ -605,41 +1021,13 @@ boolean DoIP_Client_RequestConsolidatedVCI(void)
 
 boolean DoIP_Client_RequestHealthStatus(void)
 {
-    if (g_state != DOIP_STATE_ACTIVE || g_pcb == NULL)
-    {
-        return FALSE;
-    }
-    
-    /* Create UDS Request for Health Status (DID 0xF1A0) */
-    UDS_Request request;
-    request.source_address = ZGW_ADDRESS;
-    request.target_address = VMG_ADDRESS;
-    request.service_id = UDS_SID_READ_DATA_BY_IDENTIFIER;
-    request.data_len = 2;
-    request.data[0] = (UDS_DID_HEALTH_STATUS >> 8) & 0xFF;
-    request.data[1] = UDS_DID_HEALTH_STATUS & 0xFF;
-    
-    /* Build DoIP Diagnostic Message */
-    uint8 buffer[256];
-    UDS_Response dummy_response;
-    dummy_response.source_address = request.source_address;
-    dummy_response.target_address = request.target_address;
-    dummy_response.is_positive = TRUE;
-    dummy_response.service_id = request.service_id;
-    dummy_response.data_len = request.data_len;
-    memcpy(dummy_response.data, request.data, request.data_len);
-    
-    uint16 msg_len = UDS_BuildDoIPDiagnostic(&dummy_response, buffer, sizeof(buffer));
-    
-    if (msg_len == 0)
+    if (!DoIP_Client_IsActive())
     {
         return FALSE;
     }
     
-    /* Send via TCP */
-    err_t err = tcp_write(g_pcb, buffer, msg_len, TCP_WRITE_FLAG_COPY);
-    
-    if (err == ERR_OK)
+    /* Health Status (DID 0xF1A0) */
+    if (SendReadDataRequest(UDS_DID_HEALTH_STATUS))
     {
         sendUARTMessage("[UDS] Health Request sent (DID 0xF1A0)\r\n", 41);
         return TRUE;
@@ -1,12 +1,18 @@
 /**
  * @file doip_client.h
  * @brief DoIP Client for Zonal Gateway
+ * @details Keeps an active link to the first reachable VMG endpoint and, when
+ *          more than one endpoint is configured, a routing-activated standby
+ *          link to another one. If the active link fails the standby takes
+ *          over immediately and VCI / health reports the VMG has not yet
+ *          acknowledged are replayed on it.
  */
 
 #ifndef DOIP_CLIENT_H
 #define DOIP_CLIENT_H
 
 #include "doip_types.h"
+#include "doip_txqueue.h"
 #include "lwip/tcp.h"
 #include "Ifx_Types.h"
 
@@ -16,12 +22,40 @@
 
 typedef struct
 {
-    ip_addr_t vmg_ip;               /* VMG IP address */
-    uint16    vmg_port;             /* VMG port (default: 13400) */
-    uint16    source_address;       /* Zonal Gateway logical address */
+    ip_addr_t ip;                   /* VMG IP address */
+    uint16    port;                 /* VMG port (default: 13400) */
+    
+} DoIP_VmgEndpoint;
+
+typedef struct
+{
+    DoIP_VmgEndpoint vmg[DOIP_CLIENT_MAX_ENDPOINTS];    /* VMG endpoints, primary first */
+    uint8            vmg_count;                         /* Endpoints used (>= 2 enables the standby) */
+    uint16           source_address;                    /* Zonal Gateway logical address */
     
 } DoIP_ClientConfig;
 
+/* VMG link recovery statistics (UDS DID 0xF1C0) */
+typedef struct
+{
+    uint32 connect_attempts;        /* TCP connections started */
+    uint32 activations;             /* Routing activations that succeeded */
+    uint32 link_losses;             /* Errors, resets and keepalive timeouts */
+    uint32 failovers;               /* Active link replaced by the standby */
+    uint32 replayed_reports;        /* Unacknowledged reports sent again */
+    uint32 time_to_active_last_ms;  /* Link loss (or boot) -> routing active */
+    uint32 time_to_active_max_ms;
+    
+} DoIP_ClientLinkStats;
+
+/* Link state carried across a warm reset (ECUReset softReset) */
+typedef struct
+{
+    uint8                endpoint;  /* Endpoint of the active link: reconnected first */
+    DoIP_ClientLinkStats stats;
+    
+} DoIP_ClientResume;
+
 /*******************************************************************************
  * Function Prototypes
  ******************************************************************************/
@@ -40,7 +74,7 @@ void DoIP_Client_Poll(void);
 
 /**
  * @brief Get current DoIP client state
- * @return Current state
+ * @return State of the active link
  */
 DoIP_ClientState DoIP_Client_GetState(void);
 
@@ -67,10 +101,34 @@ boolean DoIP_Client_SendHealthStatusReport(uint8 ecu_count, const DoIP_HealthSta
 boolean DoIP_Client_SendVCIReport(uint8 vci_count, const DoIP_VCI_Info *vci_database);
 
 /**
- * @brief Close DoIP connection
+ * @brief Close DoIP connections (active and standby)
  */
 void DoIP_Client_Close(void);
 
+/**
+ * @brief Save the link state to be resumed after a warm reset
+ * @param resume Output
+ */
+void DoIP_Client_Suspend(DoIP_ClientResume *resume);
+
+/**
+ * @brief Resume the link state saved before a warm reset (call after DoIP_Client_Init)
+ * @param resume State from DoIP_Client_Suspend()
+ */
+void DoIP_Client_Resume(const DoIP_ClientResume *resume);
+
+/**
+ * @brief Get outbound queue statistics (depth, drops, bytes sent)
+ * @return Pointer to the live statistics of the active VMG link
+ */
+const DoIP_TxQueueStats *DoIP_Client_GetTxStats(void);
+
+/**
+ * @brief Get VMG link recovery statistics (time to ACTIVE, reconnects)
+ * @return Pointer to the live statistics
+ */
+const DoIP_ClientLinkStats *DoIP_Client_GetLinkStats(void);
+
 /*******************************************************************************
  * UDS-based VCI/Health Request Functions (New)
  ******************************************************************************/
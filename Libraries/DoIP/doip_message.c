@@ -91,6 +91,35 @@ boolean DoIP_ParseRoutingActivationResponse(const uint8 *payload, uint32 payload
     return TRUE;
 }
 
+boolean DoIP_ParseRoutingActivationRequest(const uint8 *payload, uint32 payloadLength, uint16 *sourceAddress, uint8 *activationType)
+{
+    /* Source (2) + Activation Type (1) + Reserved (4) [+ OEM specific (4)] */
+    if (payloadLength < 7)
+    {
+        return FALSE;
+    }
+    
+    *sourceAddress = readUint16BE(&payload[0]);
+    *activationType = payload[2];
+    
+    return TRUE;
+}
+
+uint16 DoIP_CreateRoutingActivationResponse(uint8 *buffer, uint16 testerAddress, uint16 entityAddress, uint8 responseCode)
+{
+    /* Create header */
+    uint32 payloadLength = 9;  /* Tester (2) + Entity (2) + Response Code (1) + Reserved (4) */
+    DoIP_CreateHeader(buffer, DOIP_ROUTING_ACTIVATION_RES, payloadLength);
+    
+    /* Create payload */
+    writeUint16BE(&buffer[8], testerAddress);
+    writeUint16BE(&buffer[10], entityAddress);
+    buffer[12] = responseCode;
+    writeUint32BE(&buffer[13], 0x00000000);     /* Reserved */
+    
+    return DOIP_HEADER_SIZE + (uint16)payloadLength;
+}
+
 uint16 DoIP_CreateAliveCheckResponse(uint8 *buffer, uint16 sourceAddress)
 {
     /* Create header */
@@ -103,6 +132,35 @@ uint16 DoIP_CreateAliveCheckResponse(uint8 *buffer, uint16 sourceAddress)
     return DOIP_HEADER_SIZE + (uint16)payloadLength;
 }
 
+uint16 DoIP_CreateGenericNack(uint8 *buffer, uint8 nackCode)
+{
+    /* Create header */
+    uint32 payloadLength = 1;  /* NACK Code (1) */
+    DoIP_CreateHeader(buffer, DOIP_GENERIC_NACK, payloadLength);
+    
+    /* Create payload */
+    buffer[8] = nackCode;
+    
+    return DOIP_HEADER_SIZE + (uint16)payloadLength;
+}
+
+uint16 DoIP_CreateDiagnosticAck(uint8 *buffer, uint16 sourceAddress, uint16 targetAddress, uint8 ackCode)
+{
+    /* Positive ACK (0x00) is 0x8002, every other code is a NACK (0x8003) */
+    uint16 payloadType = (ackCode == DOIP_DIAG_ACK) ? DOIP_DIAGNOSTIC_MESSAGE_ACK : DOIP_DIAGNOSTIC_MESSAGE_NACK;
+    
+    /* Create header */
+    uint32 payloadLength = 5;  /* Source (2) + Target (2) + ACK/NACK Code (1) */
+    DoIP_CreateHeader(buffer, payloadType, payloadLength);
+    
+    /* Create payload */
+    writeUint16BE(&buffer[8], sourceAddress);
+    writeUint16BE(&buffer[10], targetAddress);
+    buffer[12] = ackCode;
+    
+    return DOIP_HEADER_SIZE + (uint16)payloadLength;
+}
+
 /* Legacy function - No longer used (replaced by DoIP_Client_SendHealthStatusReport) */
 uint16 DoIP_CreateZoneStatusReport(uint8 *buffer, uint8 zoneCount, const uint8 *zoneData)
 {
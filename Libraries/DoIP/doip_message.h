@@ -45,6 +45,26 @@ uint16 DoIP_CreateRoutingActivationRequest(uint8 *buffer, uint16 sourceAddress);
  */
 boolean DoIP_ParseRoutingActivationResponse(const uint8 *payload, uint32 payloadLength, uint8 *responseCode);
 
+/**
+ * @brief Parse Routing Activation Request (entity side)
+ * @param payload Payload data (without header)
+ * @param payloadLength Payload length
+ * @param sourceAddress Output tester logical address
+ * @param activationType Output activation type
+ * @return TRUE if successful, FALSE otherwise
+ */
+boolean DoIP_ParseRoutingActivationRequest(const uint8 *payload, uint32 payloadLength, uint16 *sourceAddress, uint8 *activationType);
+
+/**
+ * @brief Create Routing Activation Response (entity side)
+ * @param buffer Output buffer (min 17 bytes)
+ * @param testerAddress Logical address of the requesting tester
+ * @param entityAddress Logical address of this DoIP entity
+ * @param responseCode Routing activation response code
+ * @return Message length
+ */
+uint16 DoIP_CreateRoutingActivationResponse(uint8 *buffer, uint16 testerAddress, uint16 entityAddress, uint8 responseCode);
+
 /**
  * @brief Create Alive Check Response
  * @param buffer Output buffer
@@ -53,6 +73,24 @@ boolean DoIP_ParseRoutingActivationResponse(const uint8 *payload, uint32 payload
  */
 uint16 DoIP_CreateAliveCheckResponse(uint8 *buffer, uint16 sourceAddress);
 
+/**
+ * @brief Create Generic DoIP Header Negative Acknowledge
+ * @param buffer Output buffer
+ * @param nackCode NACK code (DoIP_GenericNackCode)
+ * @return Message length
+ */
+uint16 DoIP_CreateGenericNack(uint8 *buffer, uint8 nackCode);
+
+/**
+ * @brief Create Diagnostic Message ACK (0x8002) or NACK (0x8003)
+ * @param buffer Output buffer (min 13 bytes)
+ * @param sourceAddress Logical address of this entity (target of the request)
+ * @param targetAddress Logical address of the requester
+ * @param ackCode DOIP_DIAG_ACK or a NACK code (DoIP_DiagAckCode)
+ * @return Message length
+ */
+uint16 DoIP_CreateDiagnosticAck(uint8 *buffer, uint16 sourceAddress, uint16 targetAddress, uint8 ackCode);
+
 /**
  * @brief Create Zone Status Report
  * @param buffer Output buffer
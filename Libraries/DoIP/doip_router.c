@@ -0,0 +1,914 @@
+/**
+ * @file doip_router.c
+ * @brief DoIP-to-Zone-ECU Diagnostic Routing Engine Implementation
+ */
+
+#include "doip_router.h"
+#include "doip_message.h"
+#include "doip_bufpool.h"
+#include "IfxStm.h"
+#include "UART_Logging.h"
+#include <string.h>
+#include <stdio.h>
+
+/*******************************************************************************
+ * Router State Variables
+ ******************************************************************************/
+
+#define ROUTE_NONE                  0xFF
+
+/* Space a link needs in the requester's queue before it reads: the largest
+ * response plus one NRC 0x78 frame arriving in the same segment */
+#define ROUTE_RX_RESERVE            ((DOIP_HEADER_SIZE + 5 + UDS_MAX_RESPONSE_SIZE) + (DOIP_HEADER_SIZE + 7))
+
+typedef struct
+{
+    DoIP_TxQueue *origin;           /* Requester's TX queue, NULL once cancelled */
+    uint16        tester_address;   /* Original source address */
+    uint16        length;           /* Payload length */
+    uint8         next;             /* Next request of the same target / free list */
+    uint8         payload[DOIP_ROUTE_REQUEST_SIZE];
+
+} DoIP_PendingRequest;
+
+static uint16          g_entity_address = DOIP_ZONAL_GW_ADDRESS;
+static struct udp_pcb *g_udp_pcb = NULL;
+
+static DoIP_Route      g_routes[DOIP_ROUTE_MAX_TARGETS];
+static uint8           g_route_count = 0;
+
+/* Two-level lookup: address high byte -> page, low byte -> route (both stored +1, 0 = none) */
+static uint8           g_page_index[256];
+static uint8           g_pages[DOIP_ROUTE_MAX_PAGES][256];
+static uint8           g_page_count = 0;
+
+/* Pending request pool shared by all targets */
+static DoIP_PendingRequest g_pending[DOIP_ROUTE_MAX_PENDING];
+static uint8               g_free_head = ROUTE_NONE;
+
+/* Response frames being received on TCP links */
+static DoIP_BufPool g_rx_pool;
+static uint8        g_rx_pool_storage[DOIP_ROUTE_RX_BLOCKS][DOIP_ROUTE_RX_FRAME_SIZE];
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static uint32 GetTimestamp(void)
+{
+    return (uint32)IfxStm_get(&MODULE_STM0);
+}
+
+static uint32 MsToTicks(uint32 ms)
+{
+    return (uint32)IfxStm_getTicksFromMilliseconds(&MODULE_STM0, ms);
+}
+
+static uint32 TicksToUs(uint32 ticks)
+{
+    return ticks / (uint32)IfxStm_getTicksFromMicroseconds(&MODULE_STM0, 1);
+}
+
+static boolean IsExpired(uint32 deadline)
+{
+    return (sint32)(GetTimestamp() - deadline) >= 0;
+}
+
+static DoIP_Route *FindRoute(uint16 logical_address)
+{
+    uint8 page = g_page_index[logical_address >> 8];
+    if (page == 0)
+    {
+        return NULL;
+    }
+
+    uint8 route = g_pages[page - 1][logical_address & 0xFF];
+    return (route != 0) ? &g_routes[route - 1] : NULL;
+}
+
+/* Requests with the suppressPosRspMsgIndicationBit set get no positive response
+ * (same service set as the local UDS handler) */
+static boolean IsResponseSuppressed(const DoIP_PendingRequest *request)
+{
+    return (request->length >= 5 && UDS_IsPosRspSuppressed(request->payload[4], &request->payload[5],
+                                                            request->length - 5));
+}
+
+/* Response of the request: positive response to its SID or an NRC naming it */
+static boolean IsResponseTo(const DoIP_PendingRequest *request, const uint8 *payload, uint32 payload_len)
+{
+    uint8 sid = request->payload[4];
+
+    if (payload_len >= 6 && payload[4] == UDS_SID_NEGATIVE_RESPONSE)
+    {
+        return (payload[5] == sid);
+    }
+
+    return (payload_len >= 5 && payload[4] == (uint8)(sid + UDS_POSITIVE_RESPONSE_OFFSET));
+}
+
+/*******************************************************************************
+ * Pending Request Queues
+ ******************************************************************************/
+
+static DoIP_PendingRequest *GetHead(const DoIP_Route *route)
+{
+    return (route->queue_head != ROUTE_NONE) ? &g_pending[route->queue_head] : NULL;
+}
+
+static uint8 AllocRequest(void)
+{
+    uint8 index = g_free_head;
+
+    if (index != ROUTE_NONE)
+    {
+        g_free_head = g_pending[index].next;
+        g_pending[index].next = ROUTE_NONE;
+    }
+
+    return index;
+}
+
+static void PopHead(DoIP_Route *route)
+{
+    uint8 index = route->queue_head;
+
+    route->queue_head = g_pending[index].next;
+    if (route->queue_head == ROUTE_NONE)
+    {
+        route->queue_tail = ROUTE_NONE;
+    }
+
+    g_pending[index].next = g_free_head;
+    g_free_head = index;
+
+    /* A response still held for the popped request is never delivered */
+    if (route->rx_held != NULL)
+    {
+        DoIP_BufPool_Free(&g_rx_pool, route->rx_held);
+        route->rx_held = NULL;
+        route->stats.dropped++;
+    }
+
+    /* Next request gets its own timeout from now */
+    route->in_flight = FALSE;
+    route->nrc_only = FALSE;
+    route->deadline = GetTimestamp() + MsToTicks(DOIP_ROUTE_TIMEOUT_P2_EXT);
+}
+
+/* Answer the head request locally with a negative response (e.g. NRC 0x25) */
+static void RejectHead(DoIP_Route *route, uint8 nrc)
+{
+    DoIP_PendingRequest *request = GetHead(route);
+
+    if (request->origin != NULL)
+    {
+        uint8 frame[DOIP_HEADER_SIZE + 7];
+        DoIP_CreateHeader(frame, DOIP_DIAGNOSTIC_MESSAGE, 7);
+        frame[8] = (uint8)(route->logical_address >> 8);
+        frame[9] = (uint8)(route->logical_address & 0xFF);
+        frame[10] = (uint8)(request->tester_address >> 8);
+        frame[11] = (uint8)(request->tester_address & 0xFF);
+        frame[12] = UDS_SID_NEGATIVE_RESPONSE;
+        frame[13] = request->payload[4];
+        frame[14] = nrc;
+
+        if (DoIP_TxQueue_Send(request->origin, frame, sizeof(frame)))
+        {
+            DoIP_TxQueue_Flush(request->origin);
+        }
+    }
+
+    PopHead(route);
+}
+
+/*******************************************************************************
+ * Response Path (link -> requester)
+ ******************************************************************************/
+
+/* Check that the response belongs to the request in flight; redirect it to the tester */
+static boolean AcceptResponse(DoIP_Route *route, uint8 *payload, uint32 payload_len)
+{
+    DoIP_PendingRequest *request = GetHead(route);
+    uint16 source = ((uint16)payload[0] << 8) | payload[1];
+
+    if (!route->in_flight || request->origin == NULL || source != route->logical_address ||
+        !IsResponseTo(request, payload, payload_len))
+    {
+        route->stats.dropped++;
+        return FALSE;
+    }
+
+    payload[2] = (uint8)(request->tester_address >> 8);
+    payload[3] = (uint8)(request->tester_address & 0xFF);
+    return TRUE;
+}
+
+/* Response has been queued to the requester: final response or NRC 0x78 */
+static void CompleteResponse(DoIP_Route *route, const uint8 *payload, uint32 payload_len)
+{
+    DoIP_TxQueue_Flush(GetHead(route)->origin);
+
+    /* NRC 0x78: the final response is still to come, positive even under SPRMIB */
+    if (payload_len >= 7 && payload[4] == UDS_SID_NEGATIVE_RESPONSE &&
+        payload[6] == UDS_NRC_REQUEST_CORRECTLY_RECEIVED)
+    {
+        route->nrc_only = FALSE;
+        route->deadline = GetTimestamp() + MsToTicks(DOIP_ROUTE_TIMEOUT_P2_EXT);
+        return;
+    }
+
+    uint32 latency = TicksToUs(GetTimestamp() - route->sent_time);
+    route->stats.responses++;
+    route->stats.latency_last_us = latency;
+    if (latency > route->stats.latency_max_us)
+    {
+        route->stats.latency_max_us = latency;
+    }
+
+    PopHead(route);
+}
+
+/* Response could not be delivered */
+static void DropResponse(DoIP_Route *route)
+{
+    route->stats.dropped++;
+
+    if (route->in_flight && route->rx_too_large)
+    {
+        RejectHead(route, UDS_NRC_RESPONSE_TOO_LONG);
+    }
+}
+
+/* Queue an accepted response to the requester; FALSE if its queue is full */
+static boolean DeliverResponse(DoIP_Route *route, const uint8 *frame, uint16 frame_len)
+{
+    if (!DoIP_TxQueue_Send(GetHead(route)->origin, frame, frame_len))
+    {
+        return FALSE;
+    }
+
+    CompleteResponse(route, &frame[DOIP_HEADER_SIZE], frame_len - DOIP_HEADER_SIZE);
+    return TRUE;
+}
+
+/* Requester's queue full: keep the accepted response (pool block) for
+ * DoIP_Router_Poll() to retry. The ECU has executed the request, so without
+ * room to keep it the tester is told at once instead of at the timeout. */
+static void HoldResponse(DoIP_Route *route, uint8 *frame, uint16 frame_len)
+{
+    if (frame == NULL || route->rx_held != NULL)
+    {
+        if (frame != NULL)
+        {
+            DoIP_BufPool_Free(&g_rx_pool, frame);
+        }
+        route->stats.dropped++;
+        RejectHead(route, UDS_NRC_BUSY_REPEAT_REQUEST);
+        return;
+    }
+
+    route->rx_held = frame;
+    route->rx_held_len = frame_len;
+}
+
+static void RetryHeldResponse(DoIP_Route *route)
+{
+    uint8 *frame = route->rx_held;
+
+    if (frame == NULL)
+    {
+        return;
+    }
+
+    /* Requester gone: its request runs into the timeout as usual */
+    if (GetHead(route)->origin == NULL)
+    {
+        route->rx_held = NULL;
+        route->stats.dropped++;
+        DoIP_BufPool_Free(&g_rx_pool, frame);
+        return;
+    }
+
+    route->rx_held = NULL;
+    if (DeliverResponse(route, frame, route->rx_held_len))
+    {
+        DoIP_BufPool_Free(&g_rx_pool, frame);
+    }
+    else
+    {
+        route->rx_held = frame;
+    }
+}
+
+/*******************************************************************************
+ * Request Path (requester -> link)
+ ******************************************************************************/
+
+/* Write the head request as DoIP frame with the gateway as source address */
+static void BuildRequestFrame(const DoIP_PendingRequest *request, uint8 *frame)
+{
+    DoIP_CreateHeader(frame, DOIP_DIAGNOSTIC_MESSAGE, request->length);
+    memcpy(&frame[DOIP_HEADER_SIZE], request->payload, request->length);
+    frame[DOIP_HEADER_SIZE + 0] = (uint8)(g_entity_address >> 8);
+    frame[DOIP_HEADER_SIZE + 1] = (uint8)(g_entity_address & 0xFF);
+}
+
+static boolean SendHeadUdp(DoIP_Route *route, const DoIP_PendingRequest *request)
+{
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, DOIP_HEADER_SIZE + request->length, PBUF_RAM);
+    if (p == NULL)
+    {
+        return FALSE;
+    }
+
+    BuildRequestFrame(request, (uint8 *)p->payload);
+    err_t err = udp_sendto(g_udp_pcb, p, &route->ip, route->port);
+    pbuf_free(p);
+
+    return (err == ERR_OK);
+}
+
+static boolean SendHeadTcp(DoIP_Route *route, const DoIP_PendingRequest *request)
+{
+    if (route->link_state != DOIP_LINK_ACTIVE)
+    {
+        return FALSE;  /* Sent once routing is activated */
+    }
+
+    uint8 *frame = DoIP_TxQueue_Reserve(&route->tx_queue, DOIP_HEADER_SIZE + request->length);
+    if (frame == NULL)
+    {
+        return FALSE;
+    }
+
+    BuildRequestFrame(request, frame);
+    DoIP_TxQueue_Commit(&route->tx_queue, DOIP_HEADER_SIZE + request->length);
+    DoIP_TxQueue_Flush(&route->tx_queue);
+
+    return TRUE;
+}
+
+static void SendHead(DoIP_Route *route)
+{
+    DoIP_PendingRequest *request = GetHead(route);
+
+    if (request == NULL || route->in_flight)
+    {
+        return;
+    }
+
+    if (request->origin == NULL)
+    {
+        PopHead(route);  /* Requester went away before forwarding */
+        return;
+    }
+
+    boolean sent = (route->transport == DOIP_ROUTE_UDP) ? SendHeadUdp(route, request)
+                                                         : SendHeadTcp(route, request);
+    if (!sent)
+    {
+        return;
+    }
+
+    route->stats.forwarded++;
+    route->sent_time = GetTimestamp();
+
+    /* SPRMIB: no positive response, but the ECU still sends NRCs (0x78
+     * included); the request stays in flight for them until the window passes */
+    route->in_flight = TRUE;
+    route->nrc_only = IsResponseSuppressed(request);
+    route->deadline = route->sent_time + MsToTicks(route->nrc_only ? DOIP_ROUTE_NRC_WINDOW : DOIP_ROUTE_TIMEOUT_P2);
+}
+
+/*******************************************************************************
+ * TCP Link
+ ******************************************************************************/
+
+static void LinkReset(DoIP_Route *route)
+{
+    struct tcp_pcb *pcb = route->pcb;
+
+    route->pcb = NULL;
+    route->link_state = DOIP_LINK_IDLE;
+    route->next_connect = GetTimestamp() + MsToTicks(DOIP_ROUTE_RECONNECT);
+    DoIP_TxQueue_Attach(&route->tx_queue, NULL);
+    DoIP_Stream_Reset(&route->rx_stream);
+
+    if (route->rx_frame != NULL)
+    {
+        DoIP_BufPool_Free(&g_rx_pool, route->rx_frame);
+        route->rx_frame = NULL;
+    }
+
+    if (pcb != NULL)
+    {
+        tcp_arg(pcb, NULL);
+        tcp_recv(pcb, NULL);
+        tcp_sent(pcb, NULL);
+        tcp_err(pcb, NULL);
+        if (tcp_close(pcb) != ERR_OK)
+        {
+            tcp_abort(pcb);
+        }
+    }
+}
+
+static void link_stream_header(void *ctx, const DoIP_Header *header)
+{
+    DoIP_Route *route = (DoIP_Route *)ctx;
+
+    route->rx_too_large = FALSE;
+    if (header->payloadType != DOIP_DIAGNOSTIC_MESSAGE || !route->in_flight)
+    {
+        return;
+    }
+
+    if (DOIP_HEADER_SIZE + header->payloadLength > DOIP_ROUTE_RX_FRAME_SIZE)
+    {
+        route->rx_too_large = TRUE;
+        return;
+    }
+
+    route->rx_frame = DoIP_BufPool_Alloc(&g_rx_pool);
+}
+
+static void link_stream_payload(void *ctx, const DoIP_Header *header, uint32 offset, const uint8 *data, uint32 len)
+{
+    DoIP_Route *route = (DoIP_Route *)ctx;
+
+    if (header->payloadType == DOIP_DIAGNOSTIC_MESSAGE)
+    {
+        if (route->rx_frame != NULL)
+        {
+            memcpy(&route->rx_frame[DOIP_HEADER_SIZE + offset], data, len);
+        }
+    }
+    else if (offset + len <= sizeof(route->rx_ctrl))
+    {
+        memcpy(&route->rx_ctrl[offset], data, len);
+    }
+}
+
+static void link_stream_frame_end(void *ctx, const DoIP_Header *header)
+{
+    DoIP_Route *route = (DoIP_Route *)ctx;
+
+    switch (header->payloadType)
+    {
+        case DOIP_DIAGNOSTIC_MESSAGE:
+        {
+            uint8 *frame = route->rx_frame;
+            if (frame == NULL)
+            {
+                DropResponse(route);
+                break;
+            }
+
+            route->rx_frame = NULL;
+            DoIP_CreateHeader(frame, DOIP_DIAGNOSTIC_MESSAGE, header->payloadLength);
+            if (AcceptResponse(route, &frame[DOIP_HEADER_SIZE], header->payloadLength)
+                && !DeliverResponse(route, frame, (uint16)(DOIP_HEADER_SIZE + header->payloadLength)))
+            {
+                HoldResponse(route, frame, (uint16)(DOIP_HEADER_SIZE + header->payloadLength));
+                break;
+            }
+            DoIP_BufPool_Free(&g_rx_pool, frame);
+            break;
+        }
+
+        case DOIP_DIAGNOSTIC_MESSAGE_NACK:
+        {
+            /* ECU refused the forwarded request */
+            if (route->in_flight)
+            {
+                route->stats.timeouts++;
+                RejectHead(route, UDS_NRC_NO_RESPONSE_FROM_SUBNET);
+            }
+            break;
+        }
+
+        case DOIP_ROUTING_ACTIVATION_RES:
+        {
+            uint8 response_code;
+            if (route->link_state == DOIP_LINK_ROUTING &&
+                DoIP_ParseRoutingActivationResponse(route->rx_ctrl, header->payloadLength, &response_code) &&
+                response_code == DOIP_RA_RES_SUCCESS)
+            {
+                route->link_state = DOIP_LINK_ACTIVE;
+                SendHead(route);
+            }
+            else
+            {
+                sendUARTMessage("[Router] Zone ECU denied routing activation\r\n", 45);
+                LinkReset(route);
+            }
+            break;
+        }
+
+        case DOIP_ALIVE_CHECK_REQ:
+        {
+            uint8 response_buffer[DOIP_HEADER_SIZE + 2];
+            uint16 len = DoIP_CreateAliveCheckResponse(response_buffer, g_entity_address);
+            DoIP_TxQueue_Send(&route->tx_queue, response_buffer, len);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+static void link_stream_nack(void *ctx, uint8 nack_code)
+{
+    DoIP_Route *route = (DoIP_Route *)ctx;
+    (void)nack_code;
+
+    /* Corrupt stream from the zone ECU: reconnect */
+    LinkReset(route);
+}
+
+static const DoIP_StreamHandlers g_link_stream_handlers = {
+    link_stream_header,
+    link_stream_payload,
+    link_stream_frame_end,
+    link_stream_nack
+};
+
+static void link_error_callback(void *arg, err_t err)
+{
+    DoIP_Route *route = (DoIP_Route *)arg;
+    (void)err;
+
+    if (route != NULL)
+    {
+        route->pcb = NULL;  /* lwIP already freed the PCB */
+        LinkReset(route);
+    }
+}
+
+static err_t link_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len)
+{
+    DoIP_Route *route = (DoIP_Route *)arg;
+    (void)tpcb;
+
+    if (route != NULL)
+    {
+        DoIP_TxQueue_OnSent(&route->tx_queue, len);
+    }
+
+    return ERR_OK;
+}
+
+static err_t link_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+{
+    DoIP_Route *route = (DoIP_Route *)arg;
+
+    if (p == NULL || route == NULL)
+    {
+        if (p != NULL)
+        {
+            pbuf_free(p);
+        }
+        if (route != NULL)
+        {
+            LinkReset(route);
+        }
+        else
+        {
+            tcp_close(tpcb);
+        }
+        return ERR_OK;
+    }
+
+    if (err != ERR_OK)
+    {
+        pbuf_free(p);
+        return err;
+    }
+
+    /* Back-pressure: leave the data with lwIP (redelivered later) until the
+     * requester's queue can take a complete response and none is held */
+    DoIP_PendingRequest *request = GetHead(route);
+    if (route->rx_held != NULL ||
+        (route->in_flight && request->origin != NULL &&
+         DoIP_TxQueue_GetFree(request->origin) < ROUTE_RX_RESERVE &&
+         request->origin->size >= ROUTE_RX_RESERVE))
+    {
+        return ERR_MEM;
+    }
+
+    for (struct pbuf *q = p; q != NULL && route->pcb == tpcb; q = q->next)
+    {
+        DoIP_Stream_Feed(&route->rx_stream, (const uint8 *)q->payload, q->len);
+    }
+
+    /* The link may have been reset by one of the frames */
+    if (route->pcb == tpcb)
+    {
+        DoIP_TxQueue_Flush(&route->tx_queue);
+        tcp_recved(tpcb, p->tot_len);
+    }
+    pbuf_free(p);
+
+    return ERR_OK;
+}
+
+static err_t link_connected_callback(void *arg, struct tcp_pcb *tpcb, err_t err)
+{
+    DoIP_Route *route = (DoIP_Route *)arg;
+
+    if (route == NULL || err != ERR_OK)
+    {
+        return ERR_OK;
+    }
+
+    /* Gateway acts as tester towards the zone ECU */
+    DoIP_TxQueue_Attach(&route->tx_queue, tpcb);
+
+    uint8 request_buffer[DOIP_HEADER_SIZE + 7];
+    uint16 len = DoIP_CreateRoutingActivationRequest(request_buffer, g_entity_address);
+    DoIP_TxQueue_Send(&route->tx_queue, request_buffer, len);
+    DoIP_TxQueue_Flush(&route->tx_queue);
+
+    route->link_state = DOIP_LINK_ROUTING;
+    return ERR_OK;
+}
+
+static void LinkConnect(DoIP_Route *route)
+{
+    if (!IsExpired(route->next_connect))
+    {
+        return;
+    }
+
+    route->next_connect = GetTimestamp() + MsToTicks(DOIP_ROUTE_RECONNECT);
+
+    route->pcb = tcp_new();
+    if (route->pcb == NULL)
+    {
+        return;
+    }
+
+    tcp_nagle_disable(route->pcb);
+    tcp_arg(route->pcb, route);
+    tcp_err(route->pcb, link_error_callback);
+    tcp_recv(route->pcb, link_recv_callback);
+    tcp_sent(route->pcb, link_sent_callback);
+
+    DoIP_Stream_Reset(&route->rx_stream);
+
+    if (tcp_connect(route->pcb, &route->ip, route->port, link_connected_callback) != ERR_OK)
+    {
+        tcp_abort(route->pcb);
+        route->pcb = NULL;
+        return;
+    }
+
+    route->link_state = DOIP_LINK_CONNECTING;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void DoIP_Router_Init(uint16 entity_address, struct udp_pcb *udp_pcb)
+{
+    g_entity_address = entity_address;
+    g_udp_pcb = udp_pcb;
+    g_route_count = 0;
+    g_page_count = 0;
+    memset(g_page_index, 0, sizeof(g_page_index));
+    memset(g_pages, 0, sizeof(g_pages));
+
+    for (uint8 i = 0; i < DOIP_ROUTE_MAX_PENDING; i++)
+    {
+        g_pending[i].next = (i + 1 < DOIP_ROUTE_MAX_PENDING) ? (uint8)(i + 1) : ROUTE_NONE;
+    }
+    g_free_head = 0;
+
+    DoIP_BufPool_Init(&g_rx_pool, &g_rx_pool_storage[0][0], DOIP_ROUTE_RX_FRAME_SIZE, DOIP_ROUTE_RX_BLOCKS);
+}
+
+boolean DoIP_Router_AddRoute(uint16 logical_address, const ip_addr_t *ip, uint16 port, DoIP_RouteTransport transport)
+{
+    if (g_route_count >= DOIP_ROUTE_MAX_TARGETS || FindRoute(logical_address) != NULL)
+    {
+        return FALSE;
+    }
+
+    uint8 page = g_page_index[logical_address >> 8];
+    if (page == 0)
+    {
+        if (g_page_count >= DOIP_ROUTE_MAX_PAGES)
+        {
+            return FALSE;
+        }
+        page = ++g_page_count;
+        g_page_index[logical_address >> 8] = page;
+    }
+
+    DoIP_Route *route = &g_routes[g_route_count];
+    memset(route, 0, sizeof(DoIP_Route));
+    route->logical_address = logical_address;
+    ip_addr_copy(route->ip, *ip);
+    route->port = port;
+    route->transport = transport;
+    route->queue_head = ROUTE_NONE;
+    route->queue_tail = ROUTE_NONE;
+    route->link_state = DOIP_LINK_IDLE;
+    route->next_connect = GetTimestamp();
+    DoIP_Stream_Init(&route->rx_stream, &g_link_stream_handlers, route);
+    DoIP_TxQueue_Init(&route->tx_queue, route->tx_buffer, sizeof(route->tx_buffer));
+
+    g_pages[page - 1][logical_address & 0xFF] = ++g_route_count;
+
+    char log_msg[64];
+    sprintf(log_msg, "[Router] Route 0x%04X -> %s port %u\r\n", logical_address,
+            (transport == DOIP_ROUTE_UDP) ? "UDP" : "TCP", port);
+    sendUARTMessage(log_msg, strlen(log_msg));
+
+    return TRUE;
+}
+
+boolean DoIP_Router_IsRouted(uint16 logical_address)
+{
+    return FindRoute(logical_address) != NULL;
+}
+
+uint8 DoIP_Router_Forward(const uint8 *payload, uint32 payload_len, DoIP_TxQueue *origin)
+{
+    uint16 target = ((uint16)payload[2] << 8) | payload[3];
+    DoIP_Route *route = FindRoute(target);
+
+    if (route == NULL)
+    {
+        return DOIP_DIAG_NACK_UNKNOWN_TA;
+    }
+
+    if (payload_len > DOIP_ROUTE_REQUEST_SIZE)
+    {
+        return DOIP_DIAG_NACK_MESSAGE_TOO_LARGE;
+    }
+
+    uint8 index = AllocRequest();
+    if (index == ROUTE_NONE)
+    {
+        return DOIP_DIAG_NACK_OUT_OF_MEMORY;
+    }
+
+    DoIP_PendingRequest *request = &g_pending[index];
+    request->origin = origin;
+    request->tester_address = ((uint16)payload[0] << 8) | payload[1];
+    request->length = (uint16)payload_len;
+    memcpy(request->payload, payload, payload_len);
+
+    /* Append to the target's FIFO */
+    if (route->queue_tail == ROUTE_NONE)
+    {
+        route->queue_head = index;
+        route->deadline = GetTimestamp() + MsToTicks(DOIP_ROUTE_TIMEOUT_P2_EXT);
+    }
+    else
+    {
+        g_pending[route->queue_tail].next = index;
+    }
+    route->queue_tail = index;
+
+    /* Idle target: forward right away instead of waiting for the next poll */
+    SendHead(route);
+
+    return DOIP_DIAG_ACK;
+}
+
+void DoIP_Router_CancelOrigin(const DoIP_TxQueue *origin)
+{
+    for (uint8 i = 0; i < DOIP_ROUTE_MAX_PENDING; i++)
+    {
+        if (g_pending[i].origin == origin)
+        {
+            g_pending[i].origin = NULL;
+        }
+    }
+}
+
+boolean DoIP_Router_HandleDatagram(struct pbuf *p, const ip_addr_t *addr)
+{
+    const uint8 *data = (const uint8 *)p->payload;
+    DoIP_Header header;
+
+    if (p->len < DOIP_HEADER_SIZE + 4 || !DoIP_ParseHeader(data, &header))
+    {
+        return FALSE;
+    }
+
+    if (header.payloadType != DOIP_DIAGNOSTIC_MESSAGE &&
+        header.payloadType != DOIP_DIAGNOSTIC_MESSAGE_ACK &&
+        header.payloadType != DOIP_DIAGNOSTIC_MESSAGE_NACK)
+    {
+        return FALSE;
+    }
+
+    /* Only frames from a zone ECU reached over UDP */
+    uint16 source = ((uint16)data[8] << 8) | data[9];
+    DoIP_Route *route = FindRoute(source);
+    if (route == NULL || route->transport != DOIP_ROUTE_UDP || !ip_addr_cmp(&route->ip, addr))
+    {
+        return FALSE;
+    }
+
+    if (header.payloadType == DOIP_DIAGNOSTIC_MESSAGE_NACK && route->in_flight)
+    {
+        route->stats.timeouts++;
+        RejectHead(route, UDS_NRC_NO_RESPONSE_FROM_SUBNET);
+    }
+    else if (header.payloadType == DOIP_DIAGNOSTIC_MESSAGE)
+    {
+        DoIP_PendingRequest *request = GetHead(route);
+        uint32 frame_len = DOIP_HEADER_SIZE + header.payloadLength;
+        uint8 *frame = NULL;
+
+        route->rx_too_large = (request != NULL && request->origin != NULL &&
+                               (frame_len > request->origin->size || frame_len > DOIP_ROUTE_RX_FRAME_SIZE));
+        if (!route->in_flight || request->origin == NULL || route->rx_too_large ||
+            p->tot_len != frame_len)
+        {
+            DropResponse(route);
+        }
+        else if (route->rx_held == NULL &&
+                 (frame = DoIP_TxQueue_Reserve(request->origin, (uint16)frame_len)) != NULL)
+        {
+            /* Single copy: datagram -> requester's TX queue */
+            pbuf_copy_partial(p, frame, (u16_t)frame_len, 0);
+            if (AcceptResponse(route, &frame[DOIP_HEADER_SIZE], header.payloadLength))
+            {
+                DoIP_TxQueue_Commit(request->origin, (uint16)frame_len);
+                CompleteResponse(route, &frame[DOIP_HEADER_SIZE], header.payloadLength);
+            }
+        }
+        else
+        {
+            /* Requester's queue full (or a response already held): keep a copy */
+            frame = (route->rx_held == NULL) ? DoIP_BufPool_Alloc(&g_rx_pool) : NULL;
+            if (frame != NULL)
+            {
+                pbuf_copy_partial(p, frame, (u16_t)frame_len, 0);
+                if (!AcceptResponse(route, &frame[DOIP_HEADER_SIZE], header.payloadLength))
+                {
+                    DoIP_BufPool_Free(&g_rx_pool, frame);
+                    return TRUE;
+                }
+            }
+            HoldResponse(route, frame, (uint16)frame_len);
+        }
+    }
+
+    return TRUE;
+}
+
+void DoIP_Router_Poll(void)
+{
+    for (uint8 i = 0; i < g_route_count; i++)
+    {
+        DoIP_Route *route = &g_routes[i];
+
+        if (route->queue_head == ROUTE_NONE)
+        {
+            continue;
+        }
+
+        if (route->transport == DOIP_ROUTE_TCP && route->link_state == DOIP_LINK_IDLE)
+        {
+            LinkConnect(route);
+        }
+
+        RetryHeldResponse(route);
+        SendHead(route);
+
+        /* SPRMIB request without NRC: done. Otherwise no (final) response
+         * in time, or the link never came up */
+        if (route->queue_head != ROUTE_NONE && IsExpired(route->deadline))
+        {
+            if (route->in_flight && route->nrc_only && route->rx_held == NULL)
+            {
+                PopHead(route);
+            }
+            else
+            {
+                route->stats.timeouts++;
+                RejectHead(route, UDS_NRC_NO_RESPONSE_FROM_SUBNET);
+            }
+        }
+
+        if (route->transport == DOIP_ROUTE_TCP)
+        {
+            DoIP_TxQueue_Flush(&route->tx_queue);
+        }
+    }
+}
+
+const DoIP_RouteStats *DoIP_Router_GetStats(uint16 logical_address)
+{
+    DoIP_Route *route = FindRoute(logical_address);
+    return (route != NULL) ? &route->stats : NULL;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file doip_router.h
+ * @brief DoIP-to-Zone-ECU Diagnostic Routing Engine
+ * @details Diagnostic messages whose target address is a zone ECU are
+ *          forwarded over that ECU's link (DoIP over TCP with routing
+ *          activation, or DoIP frames over UDP 13400). Each target has a FIFO
+ *          of pending requests with one request in flight; the response is
+ *          queued on the originating VMG or tester connection with the target
+ *          address rewritten to the tester.
+ *          Address lookup is a two-level table (high byte -> page, low byte ->
+ *          route), so it stays O(1) regardless of the number of zone ECUs.
+ */
+
+#ifndef DOIP_ROUTER_H
+#define DOIP_ROUTER_H
+
+#include "doip_types.h"
+#include "doip_stream.h"
+#include "doip_txqueue.h"
+#include "uds_handler.h"
+#include "lwip/ip_addr.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+
+/*******************************************************************************
+ * Router Configuration
+ ******************************************************************************/
+
+#define DOIP_ROUTE_MAX_TARGETS      8       /* Zone ECUs in the routing table */
+#define DOIP_ROUTE_MAX_PAGES        2       /* Distinct address high bytes */
+#define DOIP_ROUTE_MAX_PENDING      8       /* Pending requests shared by all targets */
+#define DOIP_ROUTE_TIMEOUT_P2       2000    /* Response timeout after forwarding (ms) */
+#define DOIP_ROUTE_TIMEOUT_P2_EXT   5000    /* Timeout after NRC 0x78 response pending (ms) */
+#define DOIP_ROUTE_NRC_WINDOW       100     /* SPRMIB request: time an NRC may still arrive (ms) */
+#define DOIP_ROUTE_RECONNECT        1000    /* Delay between TCP link connection attempts (ms) */
+
+/* Request frame on a link: Header + Routing (4) + SID (1) + UDS data */
+#define DOIP_ROUTE_REQUEST_SIZE     (4 + 1 + UDS_MAX_REQUEST_SIZE)
+#define DOIP_ROUTE_LINK_TX_SIZE     (DOIP_HEADER_SIZE + DOIP_ROUTE_REQUEST_SIZE)
+
+/* Response frames from TCP links are collected in a shared pool (a frame may span segments) */
+#define DOIP_ROUTE_RX_BLOCKS        2
+#define DOIP_ROUTE_RX_FRAME_SIZE    (DOIP_HEADER_SIZE + 4 + 1 + UDS_MAX_RESPONSE_SIZE)
+
+/*******************************************************************************
+ * Router Structures
+ ******************************************************************************/
+
+/* Transport to the zone ECU */
+typedef enum
+{
+    DOIP_ROUTE_TCP,                 /* DoIP over TCP, gateway activates routing as tester */
+    DOIP_ROUTE_UDP                  /* DoIP frames over UDP 13400 (lightweight zone ECUs) */
+
+} DoIP_RouteTransport;
+
+/* TCP link states */
+typedef enum
+{
+    DOIP_LINK_IDLE,
+    DOIP_LINK_CONNECTING,
+    DOIP_LINK_ROUTING,              /* Routing activation request sent */
+    DOIP_LINK_ACTIVE
+
+} DoIP_LinkState;
+
+/* Per-target counters */
+typedef struct
+{
+    uint32 forwarded;               /* Requests sent to the zone ECU */
+    uint32 responses;               /* Final responses returned to the requester */
+    uint32 timeouts;                /* Requests answered with NRC 0x25 */
+    uint32 dropped;                 /* Responses without matching request or space */
+    uint32 latency_last_us;         /* Request forwarded -> final response queued */
+    uint32 latency_max_us;
+
+} DoIP_RouteStats;
+
+typedef struct
+{
+    uint16              logical_address;
+    ip_addr_t           ip;
+    uint16              port;
+    DoIP_RouteTransport transport;
+
+    /* Pending requests (indices into the shared pool, 0xFF = none) */
+    uint8               queue_head;
+    uint8               queue_tail;
+    boolean             in_flight;      /* Queue head has been forwarded */
+    boolean             nrc_only;       /* Head is SPRMIB: completes silently once the NRC window passes */
+    uint32              deadline;       /* STM ticks */
+    uint32              sent_time;
+    uint8              *rx_held;        /* Response waiting for room at the requester (pool block) */
+    uint16              rx_held_len;
+
+    /* TCP link */
+    DoIP_LinkState      link_state;
+    struct tcp_pcb     *pcb;
+    uint32              next_connect;   /* STM ticks, throttles reconnects */
+    DoIP_Stream         rx_stream;
+    uint8               rx_ctrl[16];    /* Payload of link control messages (RA, alive check) */
+    uint8              *rx_frame;       /* Response frame being collected (pool block) */
+    boolean             rx_too_large;   /* Response exceeds the frame size */
+    DoIP_TxQueue        tx_queue;
+    uint8               tx_buffer[DOIP_ROUTE_LINK_TX_SIZE];
+
+    DoIP_RouteStats     stats;
+
+} DoIP_Route;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize the routing engine
+ * @param entity_address Logical address of the gateway (used as tester address on links)
+ * @param udp_pcb UDP 13400 socket used for UDP transport
+ */
+void DoIP_Router_Init(uint16 entity_address, struct udp_pcb *udp_pcb);
+
+/**
+ * @brief Add a zone ECU to the routing table
+ * @param logical_address DoIP logical address of the ECU
+ * @param ip ECU IP address
+ * @param port ECU DoIP port
+ * @param transport Link transport
+ * @return TRUE if added, FALSE if the table is full or the address is already routed
+ */
+boolean DoIP_Router_AddRoute(uint16 logical_address, const ip_addr_t *ip, uint16 port, DoIP_RouteTransport transport);
+
+/**
+ * @brief Check whether a logical address is routed to a zone ECU (O(1))
+ * @param logical_address Target address
+ * @return TRUE if a route exists
+ */
+boolean DoIP_Router_IsRouted(uint16 logical_address);
+
+/**
+ * @brief Forward a diagnostic message payload to its zone ECU
+ * @param payload DoIP diagnostic message payload (SA, TA, UDS data)
+ * @param payload_len Payload length
+ * @param origin TX queue of the requesting connection (response destination)
+ * @return DOIP_DIAG_ACK if queued, otherwise the diagnostic NACK code to send
+ */
+uint8 DoIP_Router_Forward(const uint8 *payload, uint32 payload_len, DoIP_TxQueue *origin);
+
+/**
+ * @brief Drop pending requests of a connection (call when it closes)
+ * @param origin TX queue given to DoIP_Router_Forward()
+ */
+void DoIP_Router_CancelOrigin(const DoIP_TxQueue *origin);
+
+/**
+ * @brief Handle a datagram received on UDP 13400 (UDP transport responses)
+ * @param p Received datagram (not freed)
+ * @param addr Sender address
+ * @return TRUE if the datagram was a routed diagnostic message
+ */
+boolean DoIP_Router_HandleDatagram(struct pbuf *p, const ip_addr_t *addr);
+
+/**
+ * @brief Poll router (call from main loop) - links, queued requests, timeouts
+ */
+void DoIP_Router_Poll(void);
+
+/**
+ * @brief Get counters of one route
+ * @param logical_address Target address
+ * @return Statistics, or NULL if the address is not routed
+ */
+const DoIP_RouteStats *DoIP_Router_GetStats(uint16 logical_address);
+
+#endif /* DOIP_ROUTER_H */
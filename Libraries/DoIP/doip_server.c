@@ -0,0 +1,636 @@
+/**
+ * @file doip_server.c
+ * @brief DoIP Server (Entity Mode) Implementation
+ */
+
+#include "doip_server.h"
+#include "doip_message.h"
+#include "doip_bufpool.h"
+#include "doip_router.h"
+#include "uds_periodic.h"
+#include "AppConfig.h"
+#include "IfxStm.h"
+#include "UART_Logging.h"
+#include <string.h>
+#include <stdio.h>
+
+/*******************************************************************************
+ * Server State Variables
+ ******************************************************************************/
+
+static struct tcp_pcb    *g_listen_pcb = NULL;
+static uint16             g_entity_address = DOIP_ZONAL_GW_ADDRESS;
+static DoIP_ServerSocket  g_sockets[DOIP_SERVER_MAX_SOCKETS];
+
+/* Buffer pools (blocks are bound to a socket only while it is connected) */
+static uint8        g_rx_pool_storage[DOIP_SERVER_MAX_SOCKETS * DOIP_SERVER_RX_BUFFER_SIZE];
+static uint8        g_tx_pool_storage[DOIP_SERVER_MAX_SOCKETS * DOIP_TX_QUEUE_SIZE];
+static DoIP_BufPool g_rx_pool;
+static DoIP_BufPool g_tx_pool;
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static uint64 GetTimestamp(void)
+{
+    return (uint64)IfxStm_get(&MODULE_STM0);
+}
+
+static uint32 TicksToMs(uint64 ticks)
+{
+    return (uint32)(ticks / (uint64)IfxStm_getTicksFromMilliseconds(&MODULE_STM0, 1));
+}
+
+static uint32 TicksToUs(uint64 ticks)
+{
+    return (uint32)(ticks / (uint64)IfxStm_getTicksFromMicroseconds(&MODULE_STM0, 1));
+}
+
+static uint8 GetSocketIndex(const DoIP_ServerSocket *sock)
+{
+    return (uint8)(sock - g_sockets);
+}
+
+static boolean IsTesterAddressValid(uint16 address)
+{
+    return (address >= DOIP_TESTER_ADDRESS_MIN && address <= DOIP_TESTER_ADDRESS_MAX) ||
+           (address == DOIP_VMG_ADDRESS);
+}
+
+static DoIP_ServerSocket *FindActiveSocket(uint16 tester_address)
+{
+    for (uint8 i = 0; i < DOIP_SERVER_MAX_SOCKETS; i++)
+    {
+        if (g_sockets[i].state == DOIP_SOCKET_ACTIVE && g_sockets[i].tester_address == tester_address)
+        {
+            return &g_sockets[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void LogSocketSummary(const DoIP_ServerSocket *sock)
+{
+    DoIP_SocketStats stats;
+    char log_msg[128];
+
+    DoIP_Server_GetSocketStats(GetSocketIndex(sock), &stats);
+    sprintf(log_msg, "[DoIP-S] Socket %d: %lu req, avg %lu us, max %lu us, rx %lu B/s, tx %lu B/s\r\n",
+            GetSocketIndex(sock), (unsigned long)stats.requests, (unsigned long)stats.latency_avg_us,
+            (unsigned long)stats.latency_max_us, (unsigned long)stats.rx_bytes_per_sec,
+            (unsigned long)stats.tx_bytes_per_sec);
+    sendUARTMessage(log_msg, strlen(log_msg));
+}
+
+/* Return the socket's buffers to the pools and free the slot */
+static void ReleaseSocket(DoIP_ServerSocket *sock)
+{
+    UDS_CancelRequests(sock);
+    DoIP_Router_CancelOrigin(&sock->tx_queue);
+    DoIP_TxQueue_Attach(&sock->tx_queue, NULL);
+    DoIP_BufPool_Free(&g_rx_pool, sock->rx_payload);
+    DoIP_BufPool_Free(&g_tx_pool, sock->tx_queue.buffer);
+
+    sock->rx_payload = NULL;
+    sock->tx_queue.buffer = NULL;
+    sock->pcb = NULL;
+    sock->state = DOIP_SOCKET_FREE;
+}
+
+static void CloseSocket(DoIP_ServerSocket *sock)
+{
+    struct tcp_pcb *pcb = sock->pcb;
+
+    LogSocketSummary(sock);
+    ReleaseSocket(sock);
+
+    if (pcb != NULL)
+    {
+        tcp_arg(pcb, NULL);
+        tcp_recv(pcb, NULL);
+        tcp_sent(pcb, NULL);
+        tcp_err(pcb, NULL);
+        if (tcp_close(pcb) != ERR_OK)
+        {
+            tcp_abort(pcb);
+        }
+    }
+}
+
+/*******************************************************************************
+ * Message Processing
+ ******************************************************************************/
+
+static void ProcessRoutingActivation(DoIP_ServerSocket *sock, const DoIP_Header *header)
+{
+    uint16 tester_address;
+    uint8  activation_type;
+    uint8  response_code;
+
+    if (!DoIP_ParseRoutingActivationRequest(sock->rx_payload, header->payloadLength,
+                                            &tester_address, &activation_type))
+    {
+        return;
+    }
+
+    DoIP_ServerSocket *owner = FindActiveSocket(tester_address);
+
+    if (!IsTesterAddressValid(tester_address))
+    {
+        response_code = DOIP_RA_RES_DENIED_UNKNOWN_SA;
+    }
+    else if (sock->state == DOIP_SOCKET_ACTIVE && sock->tester_address != tester_address)
+    {
+        response_code = DOIP_RA_RES_DENIED_SA_DIFF;
+    }
+    else if (owner != NULL && owner != sock)
+    {
+        response_code = DOIP_RA_RES_DENIED_SA_IN_USE;
+    }
+    else
+    {
+        response_code = DOIP_RA_RES_SUCCESS;
+    }
+
+    uint8 response_buffer[DOIP_HEADER_SIZE + 9];
+    uint16 len = DoIP_CreateRoutingActivationResponse(response_buffer, tester_address,
+                                                      g_entity_address, response_code);
+    DoIP_TxQueue_Send(&sock->tx_queue, response_buffer, len);
+
+    char log_msg[64];
+    if (response_code == DOIP_RA_RES_SUCCESS)
+    {
+        sock->state = DOIP_SOCKET_ACTIVE;
+        sock->tester_address = tester_address;
+        sprintf(log_msg, "[DoIP-S] Socket %d: Routing activated (SA=0x%04X)\r\n",
+                GetSocketIndex(sock), tester_address);
+    }
+    else
+    {
+        /* Denied activation closes the socket once the response is out */
+        sock->state = DOIP_SOCKET_CLOSING;
+        sprintf(log_msg, "[DoIP-S] Socket %d: Routing denied (0x%02X)\r\n",
+                GetSocketIndex(sock), response_code);
+    }
+    sendUARTMessage(log_msg, strlen(log_msg));
+}
+
+static void SendDiagnosticAck(DoIP_ServerSocket *sock, const uint8 *payload, uint8 ack_code)
+{
+    /* ACK/NACK goes from the addressed target back to the tester */
+    uint16 requester = ((uint16)payload[0] << 8) | payload[1];
+    uint16 target = ((uint16)payload[2] << 8) | payload[3];
+    uint8 ack_buffer[DOIP_HEADER_SIZE + 5];
+    uint16 len = DoIP_CreateDiagnosticAck(ack_buffer, target, requester, ack_code);
+    DoIP_TxQueue_Send(&sock->tx_queue, ack_buffer, len);
+}
+
+/* UDS response sink - runs from UDS_Poll() in the main loop */
+static boolean socket_uds_response(void *ctx, uint32 tag, const uint8 *frame, uint16 len)
+{
+    DoIP_ServerSocket *sock = (DoIP_ServerSocket *)ctx;
+
+    /* The response arrives encoded: its frame goes out as it is; DoIP_Server_Poll()
+     * pushes it with everything else written in this pass */
+    if (!DoIP_TxQueue_Write(&sock->tx_queue, frame, len))
+    {
+        return FALSE;  /* Offered again once queued frames are sent */
+    }
+
+    /* Periodic messages have no request to time */
+    if (tag == UDS_PERIODIC_TAG)
+    {
+        return TRUE;
+    }
+
+    /* tag = STM tick of the request header */
+    uint32 latency = (uint32)IfxStm_get(&MODULE_STM0) - tag;
+    sock->responses++;
+    sock->latency_last = latency;
+    sock->latency_total += latency;
+    if (latency > sock->latency_max)
+    {
+        sock->latency_max = latency;
+    }
+
+    return TRUE;
+}
+
+static void ProcessDiagnosticMessage(DoIP_ServerSocket *sock, const DoIP_Header *header)
+{
+    const uint8 *payload = sock->rx_payload;
+    uint16 source = ((uint16)payload[0] << 8) | payload[1];
+    uint16 target = ((uint16)payload[2] << 8) | payload[3];
+    uint8 ack_code = DOIP_DIAG_ACK;
+
+    if (sock->rx_streaming)
+    {
+        /* Data already went to the streaming service; queue its completion */
+        sock->rx_streaming = FALSE;
+        if (UDS_StreamEnd(sock, socket_uds_response, sock->request_start))
+        {
+            sock->requests++;
+        }
+        else
+        {
+            ack_code = DOIP_DIAG_NACK_OUT_OF_MEMORY;
+        }
+    }
+    /* Diagnostic messages are only routed on an activated socket from its tester */
+    else if (sock->state != DOIP_SOCKET_ACTIVE || source != sock->tester_address)
+    {
+        ack_code = DOIP_DIAG_NACK_INVALID_SA;
+    }
+    else if (sock->rx_overflow)
+    {
+        ack_code = DOIP_DIAG_NACK_MESSAGE_TOO_LARGE;
+    }
+    else if (target != g_entity_address)
+    {
+        /* Zone ECU: forwarded, the response is queued on this socket */
+        ack_code = DoIP_Router_Forward(payload, header->payloadLength, &sock->tx_queue);
+    }
+    else if (!UDS_SubmitRequest(payload, header->payloadLength, socket_uds_response, sock, sock->request_start))
+    {
+        ack_code = DOIP_DIAG_NACK_OUT_OF_MEMORY;
+    }
+    else
+    {
+        sock->requests++;
+    }
+
+    /* Immediate ACK - the UDS response follows from the main loop */
+    SendDiagnosticAck(sock, payload, ack_code);
+
+    if (ack_code == DOIP_DIAG_NACK_INVALID_SA)
+    {
+        /* ISO 13400-2: invalid source address closes the socket */
+        sock->state = DOIP_SOCKET_CLOSING;
+    }
+}
+
+/* SA, TA and SID received: hand a local request to a streaming service if one takes it */
+static boolean StartStream(DoIP_ServerSocket *sock, const DoIP_Header *header)
+{
+    const uint8 *head = sock->rx_payload;
+    uint16 source = ((uint16)head[0] << 8) | head[1];
+    uint16 target = ((uint16)head[2] << 8) | head[3];
+
+    if (sock->state != DOIP_SOCKET_ACTIVE || source != sock->tester_address || target != g_entity_address)
+    {
+        return FALSE;
+    }
+
+    sock->rx_streaming = UDS_StreamBegin(sock, head, header->payloadLength);
+    return sock->rx_streaming;
+}
+
+/*******************************************************************************
+ * Receive Stream Callbacks
+ ******************************************************************************/
+
+static void socket_stream_header(void *ctx, const DoIP_Header *header)
+{
+    DoIP_ServerSocket *sock = (DoIP_ServerSocket *)ctx;
+    (void)header;
+
+    sock->rx_overflow = FALSE;
+    sock->rx_streaming = FALSE;
+    sock->request_start = (uint32)IfxStm_get(&MODULE_STM0);
+}
+
+static void socket_stream_payload(void *ctx, const DoIP_Header *header, uint32 offset, const uint8 *data, uint32 len)
+{
+    DoIP_ServerSocket *sock = (DoIP_ServerSocket *)ctx;
+
+    if (sock->rx_streaming)
+    {
+        UDS_StreamChunk(sock, offset - UDS_STREAM_HEAD_SIZE, data, len);
+        return;
+    }
+
+    if (header->payloadType == DOIP_DIAGNOSTIC_MESSAGE && offset < UDS_STREAM_HEAD_SIZE
+        && offset + len >= UDS_STREAM_HEAD_SIZE)
+    {
+        uint32 head_len = UDS_STREAM_HEAD_SIZE - offset;
+        memcpy(&sock->rx_payload[offset], data, head_len);
+
+        if (StartStream(sock, header))
+        {
+            UDS_StreamChunk(sock, 0, &data[head_len], len - head_len);
+            return;
+        }
+    }
+
+    /* Keep what fits; the handler rejects an oversized request as a whole */
+    if (offset + len > DOIP_SERVER_RX_BUFFER_SIZE)
+    {
+        sock->rx_overflow = TRUE;
+        len = (offset < DOIP_SERVER_RX_BUFFER_SIZE) ? (DOIP_SERVER_RX_BUFFER_SIZE - offset) : 0;
+    }
+
+    if (len > 0)
+    {
+        memcpy(&sock->rx_payload[offset], data, len);
+    }
+}
+
+static void socket_stream_frame_end(void *ctx, const DoIP_Header *header)
+{
+    DoIP_ServerSocket *sock = (DoIP_ServerSocket *)ctx;
+
+    if (sock->state == DOIP_SOCKET_CLOSING)
+    {
+        return;
+    }
+
+    if (header->payloadType == DOIP_ROUTING_ACTIVATION_REQ)
+    {
+        ProcessRoutingActivation(sock, header);
+    }
+    else if (header->payloadType == DOIP_DIAGNOSTIC_MESSAGE)
+    {
+        ProcessDiagnosticMessage(sock, header);
+    }
+    else if (header->payloadType == DOIP_ALIVE_CHECK_REQ)
+    {
+        uint8 response_buffer[DOIP_HEADER_SIZE + 2];
+        uint16 len = DoIP_CreateAliveCheckResponse(response_buffer, g_entity_address);
+        DoIP_TxQueue_Send(&sock->tx_queue, response_buffer, len);
+    }
+}
+
+static void socket_stream_nack(void *ctx, uint8 nack_code)
+{
+    DoIP_ServerSocket *sock = (DoIP_ServerSocket *)ctx;
+
+    uint8 nack_buffer[DOIP_HEADER_SIZE + 1];
+    uint16 len = DoIP_CreateGenericNack(nack_buffer, nack_code);
+    DoIP_TxQueue_Send(&sock->tx_queue, nack_buffer, len);
+
+    /* Only an unknown payload type is skipped; after any other NACK (pattern,
+     * size, memory, payload length) the stream cannot be trusted */
+    if (nack_code != DOIP_NACK_UNKNOWN_PAYLOAD_TYPE)
+    {
+        sock->state = DOIP_SOCKET_CLOSING;
+    }
+}
+
+static const DoIP_StreamHandlers g_socket_stream_handlers = {
+    socket_stream_header,
+    socket_stream_payload,
+    socket_stream_frame_end,
+    socket_stream_nack
+};
+
+/*******************************************************************************
+ * lwIP Callback Functions
+ ******************************************************************************/
+
+static void doip_server_error_callback(void *arg, err_t err)
+{
+    DoIP_ServerSocket *sock = (DoIP_ServerSocket *)arg;
+    (void)err;
+
+    if (sock != NULL)
+    {
+        /* lwIP already freed the PCB */
+        sock->pcb = NULL;
+        LogSocketSummary(sock);
+        ReleaseSocket(sock);
+    }
+}
+
+static err_t doip_server_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len)
+{
+    DoIP_ServerSocket *sock = (DoIP_ServerSocket *)arg;
+    (void)tpcb;
+
+    if (sock != NULL)
+    {
+        DoIP_TxQueue_OnSent(&sock->tx_queue, len);
+    }
+
+    return ERR_OK;
+}
+
+static err_t doip_server_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+{
+    DoIP_ServerSocket *sock = (DoIP_ServerSocket *)arg;
+
+    if (p == NULL)
+    {
+        /* Connection closed by tester */
+        if (sock != NULL)
+        {
+            CloseSocket(sock);
+        }
+        else
+        {
+            tcp_close(tpcb);
+        }
+        return ERR_OK;
+    }
+
+    if (err != ERR_OK || sock == NULL)
+    {
+        pbuf_free(p);
+        return (err != ERR_OK) ? err : ERR_OK;
+    }
+
+    sock->bytes_received += p->tot_len;
+    sock->last_activity = GetTimestamp();
+
+    /* Feed each pbuf of the chain into the socket's reassembler */
+    for (struct pbuf *q = p; q != NULL; q = q->next)
+    {
+        DoIP_Stream_Feed(&sock->rx_stream, (const uint8 *)q->payload, q->len);
+    }
+
+    /* Responses generated for this segment leave in one tcp_output */
+    DoIP_TxQueue_Flush(&sock->tx_queue);
+
+    tcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+
+    return ERR_OK;
+}
+
+static err_t doip_server_accept_callback(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+    DoIP_ServerSocket *sock = NULL;
+    (void)arg;
+
+    if (err != ERR_OK || newpcb == NULL)
+    {
+        return ERR_VAL;
+    }
+
+    for (uint8 i = 0; i < DOIP_SERVER_MAX_SOCKETS; i++)
+    {
+        if (g_sockets[i].state == DOIP_SOCKET_FREE)
+        {
+            sock = &g_sockets[i];
+            break;
+        }
+    }
+
+    uint8 *rx_buffer = (sock != NULL) ? DoIP_BufPool_Alloc(&g_rx_pool) : NULL;
+    uint8 *tx_buffer = (rx_buffer != NULL) ? DoIP_BufPool_Alloc(&g_tx_pool) : NULL;
+
+    if (tx_buffer == NULL)
+    {
+        DoIP_BufPool_Free(&g_rx_pool, rx_buffer);
+        sendUARTMessage("[DoIP-S] No socket available - connection refused\r\n", 51);
+        tcp_abort(newpcb);
+        return ERR_ABRT;
+    }
+
+    memset(sock, 0, sizeof(DoIP_ServerSocket));
+    sock->state = DOIP_SOCKET_REGISTERED;
+    sock->pcb = newpcb;
+    sock->rx_payload = rx_buffer;
+    sock->connect_time = GetTimestamp();
+    sock->last_activity = sock->connect_time;
+    DoIP_Stream_Init(&sock->rx_stream, &g_socket_stream_handlers, sock);
+    DoIP_TxQueue_Init(&sock->tx_queue, tx_buffer, DOIP_TX_QUEUE_SIZE);
+    DoIP_TxQueue_Attach(&sock->tx_queue, newpcb);
+
+    /* Responses are already batched by the queue - don't hold them back */
+    tcp_nagle_disable(newpcb);
+    tcp_arg(newpcb, sock);
+    tcp_recv(newpcb, doip_server_recv_callback);
+    tcp_sent(newpcb, doip_server_sent_callback);
+    tcp_err(newpcb, doip_server_error_callback);
+
+    char log_msg[48];
+    sprintf(log_msg, "[DoIP-S] Tester connected (socket %d)\r\n", GetSocketIndex(sock));
+    sendUARTMessage(log_msg, strlen(log_msg));
+
+    return ERR_OK;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+boolean DoIP_Server_Init(uint16 entity_address)
+{
+    g_entity_address = entity_address;
+    memset(g_sockets, 0, sizeof(g_sockets));
+    DoIP_BufPool_Init(&g_rx_pool, g_rx_pool_storage, DOIP_SERVER_RX_BUFFER_SIZE, DOIP_SERVER_MAX_SOCKETS);
+    DoIP_BufPool_Init(&g_tx_pool, g_tx_pool_storage, DOIP_TX_QUEUE_SIZE, DOIP_SERVER_MAX_SOCKETS);
+
+    struct tcp_pcb *pcb = tcp_new();
+    if (pcb == NULL)
+    {
+        sendUARTMessage("[DoIP-S] PCB creation failed\r\n", 30);
+        return FALSE;
+    }
+
+    if (tcp_bind(pcb, IP_ADDR_ANY, DOIP_TCP_PORT) != ERR_OK)
+    {
+        sendUARTMessage("[DoIP-S] Bind failed\r\n", 22);
+        tcp_close(pcb);
+        return FALSE;
+    }
+
+    g_listen_pcb = tcp_listen(pcb);
+    if (g_listen_pcb == NULL)
+    {
+        sendUARTMessage("[DoIP-S] Listen failed\r\n", 24);
+        return FALSE;
+    }
+
+    tcp_accept(g_listen_pcb, doip_server_accept_callback);
+    return TRUE;
+}
+
+void DoIP_Server_Poll(void)
+{
+    uint64 now = GetTimestamp();
+
+    for (uint8 i = 0; i < DOIP_SERVER_MAX_SOCKETS; i++)
+    {
+        DoIP_ServerSocket *sock = &g_sockets[i];
+
+        if (sock->state == DOIP_SOCKET_FREE)
+        {
+            continue;
+        }
+
+        /* Retry frames that did not fit into the send buffer */
+        DoIP_TxQueue_Flush(&sock->tx_queue);
+
+        if (sock->state == DOIP_SOCKET_CLOSING)
+        {
+            /* tcp_close still delivers what was handed to lwIP */
+            if (sock->tx_queue.stats.depth == 0)
+            {
+                CloseSocket(sock);
+            }
+        }
+        else if (sock->state == DOIP_SOCKET_REGISTERED
+                 && TicksToMs(now - sock->connect_time) > DOIP_TIMEOUT_INITIAL_INACTIVITY)
+        {
+            /* Counted from the connect: other traffic does not keep the socket */
+            sendUARTMessage("[DoIP-S] No routing activation - socket closed\r\n", 48);
+            CloseSocket(sock);
+        }
+        else if (sock->state == DOIP_SOCKET_ACTIVE
+                 && TicksToMs(now - sock->last_activity) > DOIP_TIMEOUT_GENERAL_INACTIVITY)
+        {
+            sendUARTMessage("[DoIP-S] Inactivity timeout - socket closed\r\n", 45);
+            CloseSocket(sock);
+        }
+    }
+}
+
+uint8 DoIP_Server_GetSocketCount(void)
+{
+    uint8 count = 0;
+
+    for (uint8 i = 0; i < DOIP_SERVER_MAX_SOCKETS; i++)
+    {
+        if (g_sockets[i].state != DOIP_SOCKET_FREE)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+boolean DoIP_Server_GetSocketStats(uint8 index, DoIP_SocketStats *stats)
+{
+    if (index >= DOIP_SERVER_MAX_SOCKETS || g_sockets[index].state == DOIP_SOCKET_FREE)
+    {
+        return FALSE;
+    }
+
+    const DoIP_ServerSocket *sock = &g_sockets[index];
+
+    stats->requests = sock->requests;
+    stats->responses = sock->responses;
+    stats->bytes_received = sock->bytes_received;
+    stats->bytes_sent = sock->tx_queue.stats.bytes_sent;
+    stats->latency_last_us = TicksToUs(sock->latency_last);
+    stats->latency_max_us = TicksToUs(sock->latency_max);
+    stats->latency_avg_us = (sock->responses > 0) ? TicksToUs(sock->latency_total / sock->responses) : 0;
+    stats->connected_ms = TicksToMs(GetTimestamp() - sock->connect_time);
+
+    if (stats->connected_ms > 0)
+    {
+        stats->rx_bytes_per_sec = (uint32)(((uint64)stats->bytes_received * 1000) / stats->connected_ms);
+        stats->tx_bytes_per_sec = (uint32)(((uint64)stats->bytes_sent * 1000) / stats->connected_ms);
+    }
+    else
+    {
+        stats->rx_bytes_per_sec = 0;
+        stats->tx_bytes_per_sec = 0;
+    }
+
+    return TRUE;
+}
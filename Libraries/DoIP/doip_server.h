@@ -0,0 +1,115 @@
+/**
+ * @file doip_server.h
+ * @brief DoIP Server (Entity Mode) for Tester Connections (ISO 13400-2)
+ * @details Listens on TCP 13400 so workshop testers and end-of-line tools can
+ *          connect directly to the Zonal Gateway. Every socket has its own
+ *          reassembler, routing activation state and outbound queue; the
+ *          buffers are taken from shared pools while the socket is open.
+ *          Diagnostic requests go to the same UDS back end as the VMG link.
+ */
+
+#ifndef DOIP_SERVER_H
+#define DOIP_SERVER_H
+
+#include "doip_types.h"
+#include "doip_stream.h"
+#include "doip_txqueue.h"
+#include "uds_handler.h"
+#include "lwip/tcp.h"
+
+/*******************************************************************************
+ * Server Configuration
+ ******************************************************************************/
+
+/* Payload of one received frame: Routing (4) + SID (1) + UDS data */
+#define DOIP_SERVER_RX_BUFFER_SIZE  (4 + 1 + UDS_MAX_REQUEST_SIZE)
+
+/*******************************************************************************
+ * Server Structures
+ ******************************************************************************/
+
+/* Socket states */
+typedef enum
+{
+    DOIP_SOCKET_FREE,               /* Slot unused */
+    DOIP_SOCKET_REGISTERED,         /* TCP connected, waiting for routing activation */
+    DOIP_SOCKET_ACTIVE,             /* Routing activated for tester_address */
+    DOIP_SOCKET_CLOSING             /* Close after the queued response is sent */
+
+} DoIP_SocketState;
+
+/* Per-socket latency and throughput counters */
+typedef struct
+{
+    uint32 requests;                /* Diagnostic requests received */
+    uint32 responses;               /* Diagnostic responses queued */
+    uint32 bytes_received;          /* Bytes received on the socket */
+    uint32 bytes_sent;              /* Bytes handed to lwIP */
+    uint32 latency_last_us;         /* Request header -> response queued */
+    uint32 latency_max_us;
+    uint32 latency_avg_us;
+    uint32 rx_bytes_per_sec;        /* Averaged over the connection lifetime */
+    uint32 tx_bytes_per_sec;
+    uint32 connected_ms;            /* Connection age */
+
+} DoIP_SocketStats;
+
+/* Per-socket connection context */
+typedef struct
+{
+    DoIP_SocketState state;
+    struct tcp_pcb  *pcb;
+    uint16           tester_address;    /* Source address from routing activation */
+
+    DoIP_Stream      rx_stream;
+    uint8           *rx_payload;        /* DOIP_SERVER_RX_BUFFER_SIZE, from pool */
+    boolean          rx_overflow;
+    boolean          rx_streaming;      /* Diagnostic data goes to UDS_StreamChunk() */
+    DoIP_TxQueue     tx_queue;          /* Storage from pool */
+
+    /* Timing (STM ticks) */
+    uint64           connect_time;
+    uint64           last_activity;
+    uint32           request_start;
+
+    /* Counters */
+    uint32           requests;
+    uint32           responses;
+    uint32           bytes_received;
+    uint32           latency_last;      /* STM ticks */
+    uint32           latency_max;
+    uint64           latency_total;
+
+} DoIP_ServerSocket;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize the DoIP server and start listening on DOIP_TCP_PORT
+ * @param entity_address Logical address of this DoIP entity
+ * @return TRUE if listening, FALSE otherwise
+ */
+boolean DoIP_Server_Init(uint16 entity_address);
+
+/**
+ * @brief Poll server (call from main loop) - flushes queues, enforces inactivity timers
+ */
+void DoIP_Server_Poll(void);
+
+/**
+ * @brief Get number of connected tester sockets
+ * @return Sockets in REGISTERED or ACTIVE state
+ */
+uint8 DoIP_Server_GetSocketCount(void);
+
+/**
+ * @brief Get latency and throughput counters of one socket
+ * @param index Socket index (0 .. DOIP_SERVER_MAX_SOCKETS-1)
+ * @param stats Output statistics
+ * @return TRUE if the socket is connected, FALSE otherwise
+ */
+boolean DoIP_Server_GetSocketStats(uint8 index, DoIP_SocketStats *stats);
+
+#endif /* DOIP_SERVER_H */
@@ -0,0 +1,243 @@
+/**
+ * @file doip_stream.c
+ * @brief Streaming DoIP Frame Reassembler Implementation
+ */
+
+#include "doip_stream.h"
+#include "doip_message.h"
+#include <string.h>
+
+/*******************************************************************************
+ * Payload Length Limits (ISO 13400-2)
+ ******************************************************************************/
+
+typedef struct
+{
+    uint16 payloadType;
+    uint32 minLength;
+    uint32 maxLength;
+
+} DoIP_PayloadLimit;
+
+static const DoIP_PayloadLimit g_payload_limits[] = {
+    { DOIP_GENERIC_NACK,             1,  1                       },
+    { DOIP_VEHICLE_ID_REQ,           0,  0                       },
+    { DOIP_VEHICLE_ID_REQ_EID,       6,  6                       },
+    { DOIP_VEHICLE_ID_REQ_VIN,       17, 17                      },
+    { DOIP_VEHICLE_ID_RES,           32, 33                      },
+    { DOIP_ROUTING_ACTIVATION_REQ,   7,  11                      },
+    { DOIP_ROUTING_ACTIVATION_RES,   9,  13                      },
+    { DOIP_ALIVE_CHECK_REQ,          0,  0                       },
+    { DOIP_ALIVE_CHECK_RES,          2,  2                       },
+    { DOIP_DIAGNOSTIC_MESSAGE,       5,  DOIP_MAX_DIAG_PAYLOAD   },
+    { DOIP_DIAGNOSTIC_MESSAGE_ACK,   5,  DOIP_MAX_DIAG_PAYLOAD   },
+    { DOIP_DIAGNOSTIC_MESSAGE_NACK,  5,  DOIP_MAX_DIAG_PAYLOAD   },
+    { DOIP_VCI_REPORT,               1,  DOIP_MAX_REPORT_PAYLOAD },
+    { DOIP_HEALTH_STATUS_REPORT,     1,  DOIP_MAX_REPORT_PAYLOAD },
+};
+
+#define PAYLOAD_LIMIT_COUNT (sizeof(g_payload_limits) / sizeof(g_payload_limits[0]))
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static void ReportPatternError(DoIP_Stream *stream)
+{
+    /* One NACK per garbage run, not one per skipped byte */
+    if (!stream->in_resync)
+    {
+        stream->in_resync = TRUE;
+        stream->stats.frames_rejected++;
+        stream->handlers->on_nack(stream->ctx, DOIP_NACK_INCORRECT_PATTERN);
+    }
+}
+
+static void EndFrame(DoIP_Stream *stream)
+{
+    if (stream->phase == DOIP_STREAM_PAYLOAD)
+    {
+        stream->stats.frames_completed++;
+        stream->handlers->on_frame_end(stream->ctx, &stream->header);
+    }
+
+    stream->phase = DOIP_STREAM_HEADER;
+}
+
+static void StartFrame(DoIP_Stream *stream)
+{
+    uint32 min_len;
+    uint32 max_len;
+    uint8  nack_code;
+
+    stream->offset = 0;
+    stream->in_resync = FALSE;
+
+    if (!DoIP_Stream_GetPayloadLimits(stream->header.payloadType, &min_len, &max_len))
+    {
+        nack_code = DOIP_NACK_UNKNOWN_PAYLOAD_TYPE;
+    }
+    else if (stream->header.payloadLength > max_len)
+    {
+        /* Fixed-size payload types have an invalid length, not a large one */
+        nack_code = (min_len == max_len) ? DOIP_NACK_INVALID_PAYLOAD_LEN : DOIP_NACK_MESSAGE_TOO_LARGE;
+    }
+    else if (stream->header.payloadLength < min_len)
+    {
+        nack_code = DOIP_NACK_INVALID_PAYLOAD_LEN;
+    }
+    else
+    {
+        stream->phase = DOIP_STREAM_PAYLOAD;
+        stream->handlers->on_header(stream->ctx, &stream->header);
+        if (stream->header.payloadLength == 0)
+        {
+            EndFrame(stream);
+        }
+        return;
+    }
+
+    /* Reject and skip the payload without buffering it */
+    stream->stats.frames_rejected++;
+    stream->handlers->on_nack(stream->ctx, nack_code);
+    stream->phase = (stream->header.payloadLength > 0) ? DOIP_STREAM_DISCARD : DOIP_STREAM_HEADER;
+}
+
+/* Skip to the next possible protocol version byte; returns bytes skipped */
+static uint32 SkipToNextPattern(const uint8 *data, uint32 len)
+{
+    const uint8 *next = (const uint8 *)memchr(data, DOIP_PROTOCOL_VERSION, len);
+    return (next != NULL) ? (uint32)(next - data) : len;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void DoIP_Stream_Init(DoIP_Stream *stream, const DoIP_StreamHandlers *handlers, void *ctx)
+{
+    memset(stream, 0, sizeof(DoIP_Stream));
+    stream->handlers = handlers;
+    stream->ctx = ctx;
+    stream->phase = DOIP_STREAM_HEADER;
+}
+
+void DoIP_Stream_Reset(DoIP_Stream *stream)
+{
+    stream->phase = DOIP_STREAM_HEADER;
+    stream->header_len = 0;
+    stream->in_resync = FALSE;
+    stream->offset = 0;
+}
+
+void DoIP_Stream_Feed(DoIP_Stream *stream, const uint8 *data, uint32 len)
+{
+    stream->stats.bytes_parsed += len;
+
+    while (len > 0)
+    {
+        if (stream->phase != DOIP_STREAM_HEADER)
+        {
+            /* Payload: hand the consumer whatever this segment holds */
+            uint32 take = stream->header.payloadLength - stream->offset;
+            if (take > len)
+            {
+                take = len;
+            }
+
+            if (stream->phase == DOIP_STREAM_PAYLOAD)
+            {
+                stream->handlers->on_payload(stream->ctx, &stream->header, stream->offset, data, take);
+            }
+
+            stream->offset += take;
+            data += take;
+            len -= take;
+
+            if (stream->offset == stream->header.payloadLength)
+            {
+                EndFrame(stream);
+            }
+            continue;
+        }
+
+        if (stream->header_len == 0)
+        {
+            if (data[0] != DOIP_PROTOCOL_VERSION)
+            {
+                /* Garbage: jump to the next candidate instead of shifting byte by byte */
+                uint32 skip = SkipToNextPattern(data, len);
+                ReportPatternError(stream);
+                stream->stats.resync_bytes += skip;
+                data += skip;
+                len -= skip;
+                continue;
+            }
+
+            if (len >= DOIP_HEADER_SIZE)
+            {
+                /* Fast path: header lies within this segment, parse in place */
+                if (DoIP_ParseHeader(data, &stream->header))
+                {
+                    data += DOIP_HEADER_SIZE;
+                    len -= DOIP_HEADER_SIZE;
+                    StartFrame(stream);
+                }
+                else
+                {
+                    ReportPatternError(stream);
+                    stream->stats.resync_bytes++;
+                    data++;
+                    len--;
+                }
+                continue;
+            }
+        }
+
+        /* Header spans segments: collect it in the small header buffer */
+        uint32 take = DOIP_HEADER_SIZE - stream->header_len;
+        if (take > len)
+        {
+            take = len;
+        }
+        memcpy(&stream->header_buf[stream->header_len], data, take);
+        stream->header_len += (uint8)take;
+        data += take;
+        len -= take;
+
+        if (stream->header_len < DOIP_HEADER_SIZE)
+        {
+            break;
+        }
+
+        if (DoIP_ParseHeader(stream->header_buf, &stream->header))
+        {
+            stream->header_len = 0;
+            StartFrame(stream);
+        }
+        else
+        {
+            /* Keep the bytes after the next candidate (at most 7 are moved) */
+            uint32 skip = 1 + SkipToNextPattern(&stream->header_buf[1], DOIP_HEADER_SIZE - 1);
+            ReportPatternError(stream);
+            stream->stats.resync_bytes += skip;
+            stream->header_len = (uint8)(DOIP_HEADER_SIZE - skip);
+            memmove(stream->header_buf, &stream->header_buf[skip], stream->header_len);
+        }
+    }
+}
+
+boolean DoIP_Stream_GetPayloadLimits(uint16 payloadType, uint32 *minLength, uint32 *maxLength)
+{
+    for (uint8 i = 0; i < PAYLOAD_LIMIT_COUNT; i++)
+    {
+        if (g_payload_limits[i].payloadType == payloadType)
+        {
+            *minLength = g_payload_limits[i].minLength;
+            *maxLength = g_payload_limits[i].maxLength;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
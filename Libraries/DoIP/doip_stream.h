@@ -0,0 +1,108 @@
+/**
+ * @file doip_stream.h
+ * @brief Streaming DoIP Frame Reassembler
+ * @details Parses DoIP headers directly from received TCP segments (one call
+ *          per pbuf of a chain) and hands payloads to the consumer in chunks.
+ *          A frame never has to fit into one flat receive buffer, so the
+ *          payload length is only bounded by the per-payload-type limits.
+ */
+
+#ifndef DOIP_STREAM_H
+#define DOIP_STREAM_H
+
+#include "doip_types.h"
+
+/*******************************************************************************
+ * Stream Consumer Interface
+ * Callbacks run inside DoIP_Stream_Feed() and must not reset the stream.
+ ******************************************************************************/
+
+typedef struct
+{
+    /* Valid header received, payload follows (may be empty) */
+    void (*on_header)(void *ctx, const DoIP_Header *header);
+
+    /* Payload chunk; offset is the position of data[0] within the payload */
+    void (*on_payload)(void *ctx, const DoIP_Header *header, uint32 offset, const uint8 *data, uint32 len);
+
+    /* Last payload byte delivered */
+    void (*on_frame_end)(void *ctx, const DoIP_Header *header);
+
+    /* Header rejected - consumer sends a generic NACK (DoIP_GenericNackCode) */
+    void (*on_nack)(void *ctx, uint8 nack_code);
+
+} DoIP_StreamHandlers;
+
+/*******************************************************************************
+ * Stream State
+ ******************************************************************************/
+
+typedef enum
+{
+    DOIP_STREAM_HEADER,             /* Collecting header bytes */
+    DOIP_STREAM_PAYLOAD,            /* Delivering payload to the consumer */
+    DOIP_STREAM_DISCARD             /* Skipping payload of a rejected frame */
+
+} DoIP_StreamPhase;
+
+typedef struct
+{
+    uint32 bytes_parsed;            /* Total bytes fed into the stream */
+    uint32 frames_completed;        /* Frames delivered to the consumer */
+    uint32 frames_rejected;         /* Frames answered with a generic NACK */
+    uint32 resync_bytes;            /* Bytes skipped while searching for a header */
+
+} DoIP_StreamStats;
+
+typedef struct
+{
+    const DoIP_StreamHandlers *handlers;
+    void                      *ctx;
+
+    DoIP_StreamPhase phase;
+    uint8            header_buf[DOIP_HEADER_SIZE];  /* Only used when a header spans segments */
+    uint8            header_len;
+    boolean          in_resync;     /* Pattern error already reported */
+    DoIP_Header      header;
+    uint32           offset;        /* Payload bytes delivered/skipped so far */
+
+    DoIP_StreamStats stats;
+
+} DoIP_Stream;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize a stream
+ * @param stream Stream instance
+ * @param handlers Consumer callbacks
+ * @param ctx Context passed to every callback
+ */
+void DoIP_Stream_Init(DoIP_Stream *stream, const DoIP_StreamHandlers *handlers, void *ctx);
+
+/**
+ * @brief Drop any partial frame (e.g. after reconnect); statistics are kept
+ * @param stream Stream instance
+ */
+void DoIP_Stream_Reset(DoIP_Stream *stream);
+
+/**
+ * @brief Feed received bytes into the stream
+ * @param stream Stream instance
+ * @param data Received bytes (e.g. pbuf->payload)
+ * @param len Number of bytes (e.g. pbuf->len)
+ */
+void DoIP_Stream_Feed(DoIP_Stream *stream, const uint8 *data, uint32 len);
+
+/**
+ * @brief Get the accepted payload length range of a payload type
+ * @param payloadType DoIP payload type
+ * @param minLength Output minimum payload length
+ * @param maxLength Output maximum payload length
+ * @return TRUE if the payload type is known, FALSE otherwise
+ */
+boolean DoIP_Stream_GetPayloadLimits(uint16 payloadType, uint32 *minLength, uint32 *maxLength);
+
+#endif /* DOIP_STREAM_H */
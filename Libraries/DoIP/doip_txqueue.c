@@ -0,0 +1,152 @@
+/**
+ * @file doip_txqueue.c
+ * @brief Bounded Outbound DoIP Message Queue Implementation
+ */
+
+#include "doip_txqueue.h"
+#include <string.h>
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static void UpdateDepth(DoIP_TxQueue *queue)
+{
+    queue->stats.depth = queue->tail - queue->head;
+    if (queue->stats.depth > queue->stats.depth_peak)
+    {
+        queue->stats.depth_peak = queue->stats.depth;
+    }
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void DoIP_TxQueue_Init(DoIP_TxQueue *queue, uint8 *buffer, uint16 size)
+{
+    memset(queue, 0, sizeof(DoIP_TxQueue));
+    queue->buffer = buffer;
+    queue->size = size;
+}
+
+void DoIP_TxQueue_Attach(DoIP_TxQueue *queue, struct tcp_pcb *pcb)
+{
+    queue->pcb = pcb;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->output_pending = FALSE;
+    queue->stats.depth = 0;
+}
+
+uint8 *DoIP_TxQueue_Reserve(DoIP_TxQueue *queue, uint16 len)
+{
+    if (queue->pcb == NULL || len > queue->size - (queue->tail - queue->head))
+    {
+        queue->stats.frames_dropped++;
+        return NULL;
+    }
+
+    if (len > queue->size - queue->tail)
+    {
+        /* Compact: move the unsent bytes to the front (rare, bounded by depth) */
+        memmove(queue->buffer, &queue->buffer[queue->head], queue->tail - queue->head);
+        queue->tail -= queue->head;
+        queue->head = 0;
+    }
+
+    return &queue->buffer[queue->tail];
+}
+
+void DoIP_TxQueue_Commit(DoIP_TxQueue *queue, uint16 len)
+{
+    queue->tail += len;
+    queue->stats.frames_queued++;
+    UpdateDepth(queue);
+}
+
+boolean DoIP_TxQueue_Send(DoIP_TxQueue *queue, const uint8 *frame, uint16 len)
+{
+    uint8 *space = DoIP_TxQueue_Reserve(queue, len);
+
+    if (space == NULL)
+    {
+        return FALSE;
+    }
+
+    memcpy(space, frame, len);
+    DoIP_TxQueue_Commit(queue, len);
+
+    return TRUE;
+}
+
+boolean DoIP_TxQueue_Write(DoIP_TxQueue *queue, const uint8 *frame, uint16 len)
+{
+    if (queue->pcb == NULL)
+    {
+        return FALSE;
+    }
+
+    /* Nothing queued ahead: lwIP's copy is the only one */
+    if (queue->head == queue->tail && len <= tcp_sndbuf(queue->pcb) &&
+        tcp_write(queue->pcb, frame, len, TCP_WRITE_FLAG_COPY) == ERR_OK)
+    {
+        queue->output_pending = TRUE;
+        queue->stats.frames_queued++;
+        queue->stats.frames_direct++;
+        queue->stats.bytes_sent += len;
+        return TRUE;
+    }
+
+    if (len > DoIP_TxQueue_GetFree(queue))
+    {
+        return FALSE;
+    }
+
+    return DoIP_TxQueue_Send(queue, frame, len);
+}
+
+uint16 DoIP_TxQueue_GetFree(const DoIP_TxQueue *queue)
+{
+    return (queue->pcb != NULL) ? (uint16)(queue->size - (queue->tail - queue->head)) : 0;
+}
+
+void DoIP_TxQueue_Flush(DoIP_TxQueue *queue)
+{
+    if (queue->pcb == NULL || (queue->head == queue->tail && !queue->output_pending))
+    {
+        return;
+    }
+
+    /* Everything queued since the last flush goes out in one write */
+    uint16 pending = queue->tail - queue->head;
+    uint16 space = tcp_sndbuf(queue->pcb);
+    uint16 chunk = (pending < space) ? pending : space;
+
+    if (chunk > 0 &&
+        tcp_write(queue->pcb, &queue->buffer[queue->head], chunk, TCP_WRITE_FLAG_COPY) == ERR_OK)
+    {
+        queue->head += chunk;
+        queue->stats.bytes_sent += chunk;
+
+        if (queue->head == queue->tail)
+        {
+            queue->head = 0;
+            queue->tail = 0;
+        }
+        UpdateDepth(queue);
+    }
+
+    /* Also pushes segments left over by an earlier partial or direct write */
+    tcp_output(queue->pcb);
+    queue->output_pending = FALSE;
+    queue->stats.flushes++;
+}
+
+void DoIP_TxQueue_OnSent(DoIP_TxQueue *queue, uint16 len)
+{
+    queue->stats.bytes_acked += len;
+
+    /* Send buffer space was freed - retry whatever is still queued */
+    DoIP_TxQueue_Flush(queue);
+}
@@ -0,0 +1,121 @@
+/**
+ * @file doip_txqueue.h
+ * @brief Bounded Outbound DoIP Message Queue (one per TCP connection)
+ * @details Frames are queued instead of being written straight to lwIP, so a
+ *          full send buffer (ERR_MEM) delays a message instead of losing it.
+ *          The queue is drained from the tcp_sent callback and the poll loop;
+ *          all frames queued between two flushes go out with one tcp_output.
+ *          A frame that finds the queue empty skips it and goes to lwIP directly.
+ */
+
+#ifndef DOIP_TXQUEUE_H
+#define DOIP_TXQUEUE_H
+
+#include "doip_types.h"
+#include "lwip/tcp.h"
+
+/*******************************************************************************
+ * Queue Structures
+ ******************************************************************************/
+
+typedef struct
+{
+    uint32 frames_queued;           /* Frames accepted */
+    uint32 frames_direct;           /* Frames written straight to lwIP, not queued */
+    uint32 frames_dropped;          /* Frames rejected because the queue was full */
+    uint32 bytes_sent;              /* Bytes handed to lwIP */
+    uint32 bytes_acked;             /* Bytes acknowledged by the peer */
+    uint32 flushes;                 /* tcp_output calls */
+    uint16 depth;                   /* Bytes currently queued */
+    uint16 depth_peak;              /* Highest depth seen */
+
+} DoIP_TxQueueStats;
+
+typedef struct
+{
+    struct tcp_pcb   *pcb;          /* Connection, NULL while disconnected */
+    uint8            *buffer;
+    uint16            size;
+    uint16            head;         /* First byte not yet handed to lwIP */
+    uint16            tail;         /* End of queued data */
+    boolean           output_pending;   /* Written to lwIP, tcp_output still due */
+
+    DoIP_TxQueueStats stats;
+
+} DoIP_TxQueue;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize a queue on caller-provided storage
+ * @param queue Queue instance
+ * @param buffer Queue storage
+ * @param size Storage size in bytes (largest frame that can be queued)
+ */
+void DoIP_TxQueue_Init(DoIP_TxQueue *queue, uint8 *buffer, uint16 size);
+
+/**
+ * @brief Bind the queue to a connection (NULL detaches and drops queued data)
+ * @param queue Queue instance
+ * @param pcb Connected TCP PCB
+ */
+void DoIP_TxQueue_Attach(DoIP_TxQueue *queue, struct tcp_pcb *pcb);
+
+/**
+ * @brief Queue a complete frame (copied into the queue)
+ * @param queue Queue instance
+ * @param frame DoIP frame (header + payload)
+ * @param len Frame length
+ * @return TRUE if queued, FALSE if dropped (queue full or not attached)
+ */
+boolean DoIP_TxQueue_Send(DoIP_TxQueue *queue, const uint8 *frame, uint16 len);
+
+/**
+ * @brief Send a frame from the caller's buffer: written straight to lwIP when
+ *        nothing is queued ahead of it (the only copy), otherwise queued;
+ *        tcp_output follows with the next flush either way
+ * @param queue Queue instance
+ * @param frame DoIP frame (header + payload)
+ * @param len Frame length
+ * @return TRUE if taken, FALSE if there is no room yet (not counted as drop)
+ */
+boolean DoIP_TxQueue_Write(DoIP_TxQueue *queue, const uint8 *frame, uint16 len);
+
+/**
+ * @brief Reserve contiguous space to build a frame in place
+ * @param queue Queue instance
+ * @param len Maximum frame length
+ * @return Pointer to the space, or NULL if the frame does not fit (counted as drop)
+ */
+uint8 *DoIP_TxQueue_Reserve(DoIP_TxQueue *queue, uint16 len);
+
+/**
+ * @brief Commit a frame built in reserved space
+ * @param queue Queue instance
+ * @param len Actual frame length (<= reserved length)
+ */
+void DoIP_TxQueue_Commit(DoIP_TxQueue *queue, uint16 len);
+
+/**
+ * @brief Get the largest frame that can currently be queued
+ * @param queue Queue instance
+ * @return Free bytes (0 while not attached)
+ */
+uint16 DoIP_TxQueue_GetFree(const DoIP_TxQueue *queue);
+
+/**
+ * @brief Hand queued bytes to lwIP as far as the send buffer allows
+ * @param queue Queue instance
+ */
+void DoIP_TxQueue_Flush(DoIP_TxQueue *queue);
+
+/**
+ * @brief Account acknowledged bytes and refill the send buffer (call from tcp_sent)
+ * @param queue Queue instance
+ * @param len Acknowledged length reported by lwIP
+ */
+void DoIP_TxQueue_OnSent(DoIP_TxQueue *queue, uint16 len);
+
+#endif /* DOIP_TXQUEUE_H */
@@ -16,6 +16,10 @@
 #define DOIP_PROTOCOL_VERSION       0x02
 #define DOIP_INVERSE_VERSION        0xFD
 
+/* Default version accepted in vehicle identification requests */
+#define DOIP_DEFAULT_VERSION        0xFF
+#define DOIP_DEFAULT_INVERSE        0x00
+
 /* DoIP Header Size */
 #define DOIP_HEADER_SIZE            8
 
@@ -63,6 +67,37 @@ typedef enum
     
 } DoIP_RoutingActivationResponse;
 
+/*******************************************************************************
+ * DoIP Generic Header Negative Acknowledge Codes
+ ******************************************************************************/
+
+typedef enum
+{
+    DOIP_NACK_INCORRECT_PATTERN     = 0x00,     /* Incorrect pattern format */
+    DOIP_NACK_UNKNOWN_PAYLOAD_TYPE  = 0x01,     /* Unknown payload type */
+    DOIP_NACK_MESSAGE_TOO_LARGE     = 0x02,     /* Message too large */
+    DOIP_NACK_OUT_OF_MEMORY         = 0x03,     /* Out of memory */
+    DOIP_NACK_INVALID_PAYLOAD_LEN   = 0x04      /* Invalid payload length */
+    
+} DoIP_GenericNackCode;
+
+/*******************************************************************************
+ * DoIP Diagnostic Message ACK / NACK Codes
+ ******************************************************************************/
+
+typedef enum
+{
+    DOIP_DIAG_ACK                   = 0x00,     /* Routing confirmation (positive ACK) */
+    DOIP_DIAG_NACK_INVALID_SA       = 0x02,     /* Invalid source address */
+    DOIP_DIAG_NACK_UNKNOWN_TA       = 0x03,     /* Unknown target address */
+    DOIP_DIAG_NACK_MESSAGE_TOO_LARGE = 0x04,    /* Diagnostic message too large */
+    DOIP_DIAG_NACK_OUT_OF_MEMORY    = 0x05,     /* Out of memory */
+    DOIP_DIAG_NACK_TARGET_UNREACHABLE = 0x06,   /* Target unreachable */
+    DOIP_DIAG_NACK_UNKNOWN_NETWORK  = 0x07,     /* Unknown network */
+    DOIP_DIAG_NACK_TP_ERROR         = 0x08      /* Transport protocol error */
+    
+} DoIP_DiagAckCode;
+
 /*******************************************************************************
  * DoIP Client States
  ******************************************************************************/
@@ -98,20 +133,55 @@ typedef struct
 #define DOIP_TIMEOUT_CONNECTION     3000    /* TCP connection timeout: 3 seconds */
 #define DOIP_TIMEOUT_ROUTING        2000    /* Routing activation response timeout: 2 seconds */
 #define DOIP_TIMEOUT_ALIVE_CHECK    500     /* Alive check response timeout: 500ms */
-#define DOIP_RECONNECT_INTERVAL     5000    /* Reconnection interval: 5 seconds */
+#define DOIP_RECONNECT_INTERVAL     5000    /* Reconnection backoff cap: 5 seconds */
+#define DOIP_RECONNECT_BACKOFF_MIN  100     /* First backoff step after the immediate retry */
+
+/* VMG uplinks */
+#define DOIP_CLIENT_MAX_ENDPOINTS   3       /* Configured VMG endpoints (in order of preference) */
+#define DOIP_CLIENT_MAX_LINKS       2       /* Active link + pre-connected hot standby */
+
+/* TCP keepalive on the VMG connection: half-open link detected after ~5 seconds */
+#define DOIP_KEEPALIVE_IDLE         2000    /* Idle time before the first probe */
+#define DOIP_KEEPALIVE_INTERVAL     1000    /* Interval between probes */
+#define DOIP_KEEPALIVE_COUNT        3       /* Unanswered probes before the link is dropped */
 
 /* Alive Check Configuration */
 #define DOIP_ALIVE_CHECK_INTERVAL   5000    /* Alive check interval: 5 seconds */
 
+/* Vehicle Announcement Configuration */
+#define DOIP_ANNOUNCE_COUNT         3       /* Announcements sent after startup */
+#define DOIP_ANNOUNCE_INTERVAL      500     /* Interval between announcements: 500ms */
+#define DOIP_ANNOUNCE_WAIT_MAX      500     /* Random initial delay: 0..500ms */
+
+/* Server (Entity) Mode Configuration */
+#define DOIP_SERVER_MAX_SOCKETS     4       /* Concurrent tester connections on TCP 13400 */
+#define DOIP_TIMEOUT_INITIAL_INACTIVITY 2000    /* No routing activation after connect: 2 seconds */
+#define DOIP_TIMEOUT_GENERAL_INACTIVITY 300000  /* No traffic on an active socket: 5 minutes */
+
 /* Buffer Sizes */
 #define DOIP_MAX_MESSAGE_SIZE       256     /* Maximum DoIP message size */
 #define DOIP_TX_BUFFER_SIZE         256     /* Transmit buffer size */
 #define DOIP_RX_BUFFER_SIZE         256     /* Receive buffer size */
+#define DOIP_TX_QUEUE_SIZE          4608    /* Outbound queue per connection (fits a 4 KB UDS response) */
+
+/* Maximum accepted payload length per frame (payloads are streamed, never buffered whole) */
+#define DOIP_MAX_DIAG_PAYLOAD       0x00400000UL    /* Diagnostic message: 4 MB */
+#define DOIP_MAX_REPORT_PAYLOAD     0x00010000UL    /* VCI / Health report: 64 KB */
+
+/* Vehicle Identification */
+#define DOIP_VIN_LENGTH             17
+#define DOIP_EID_LENGTH             6
+#define DOIP_GID_LENGTH             6
+#define DOIP_VEHICLE_ID_RES_LENGTH  33      /* VIN + LA + EID + GID + action + sync status */
 
 /* Logical Addresses */
 #define DOIP_ZONAL_GW_ADDRESS       0x0100  /* Zonal Gateway logical address */
 #define DOIP_VMG_ADDRESS            0x0200  /* VMG logical address */
 
+/* External test equipment address range (accepted in routing activation) */
+#define DOIP_TESTER_ADDRESS_MIN     0x0E00
+#define DOIP_TESTER_ADDRESS_MAX     0x0FFF
+
 /* Address Aliases for compatibility */
 #define ZGW_ADDRESS                 DOIP_ZONAL_GW_ADDRESS
 #define VMG_ADDRESS                 DOIP_VMG_ADDRESS
@@ -0,0 +1,201 @@
+/**
+ * @file doip_vehicle_id.c
+ * @brief DoIP Vehicle Identification and Announcement Implementation
+ */
+
+#include "doip_vehicle_id.h"
+#include "doip_message.h"
+#include "doip_stream.h"
+#include "uds_comm.h"
+#include "AppConfig.h"
+#include "Ifx_Lwip.h"
+#include "IfxStm.h"
+#include "UART_Logging.h"
+#include <string.h>
+
+/*******************************************************************************
+ * Responder State Variables
+ ******************************************************************************/
+
+static struct udp_pcb *g_pcb = NULL;
+
+/* Vehicle identification response / announcement, serialized once at init */
+static uint8 g_vehicle_id_frame[DOIP_HEADER_SIZE + DOIP_VEHICLE_ID_RES_LENGTH];
+
+static const uint8 g_vin[DOIP_VIN_LENGTH] = ZGW_VIN;
+static const uint8 g_eid[DOIP_EID_LENGTH] = {
+    ETH_MAC_ADDR_0, ETH_MAC_ADDR_1, ETH_MAC_ADDR_2, ETH_MAC_ADDR_3, ETH_MAC_ADDR_4, ETH_MAC_ADDR_5
+};
+
+/* Announcement burst */
+static uint8  g_announce_remaining = 0;
+static uint32 g_announce_next_time = 0;
+
+/*******************************************************************************
+ * Helper Functions
+ ******************************************************************************/
+
+static uint32 GetTimestamp(void)
+{
+    return (uint32)IfxStm_get(&MODULE_STM0);
+}
+
+static uint32 MsToTicks(uint32 ms)
+{
+    return (uint32)IfxStm_getTicksFromMilliseconds(&MODULE_STM0, ms);
+}
+
+static void BuildVehicleIdFrame(uint16 entity_address)
+{
+    uint8 *payload = &g_vehicle_id_frame[DOIP_HEADER_SIZE];
+
+    DoIP_CreateHeader(g_vehicle_id_frame, DOIP_VEHICLE_ID_RES, DOIP_VEHICLE_ID_RES_LENGTH);
+
+    memcpy(&payload[0], g_vin, DOIP_VIN_LENGTH);
+    payload[17] = (uint8)(entity_address >> 8);
+    payload[18] = (uint8)(entity_address & 0xFF);
+    memcpy(&payload[19], g_eid, DOIP_EID_LENGTH);
+    memcpy(&payload[25], g_eid, DOIP_GID_LENGTH);  /* No group master: GID = EID */
+    payload[31] = 0x00;                             /* Further action: none */
+    payload[32] = 0x00;                             /* VIN/GID synchronized */
+}
+
+/* Send the pre-built frame by reference - lwIP only prepends its headers */
+static void SendVehicleIdFrame(const ip_addr_t *addr, u16_t port)
+{
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, sizeof(g_vehicle_id_frame), PBUF_REF);
+    if (p == NULL)
+    {
+        return;
+    }
+
+    p->payload = g_vehicle_id_frame;
+    udp_sendto(g_pcb, p, addr, port);
+    pbuf_free(p);
+}
+
+static void SendGenericNack(const ip_addr_t *addr, u16_t port, uint8 nack_code)
+{
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, DOIP_HEADER_SIZE + 1, PBUF_RAM);
+    if (p == NULL)
+    {
+        return;
+    }
+
+    DoIP_CreateGenericNack((uint8 *)p->payload, nack_code);
+    udp_sendto(g_pcb, p, addr, port);
+    pbuf_free(p);
+}
+
+static boolean IsVehicleIdRequest(uint16 payload_type)
+{
+    return (payload_type == DOIP_VEHICLE_ID_REQ ||
+            payload_type == DOIP_VEHICLE_ID_REQ_EID ||
+            payload_type == DOIP_VEHICLE_ID_REQ_VIN);
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void DoIP_VehicleId_Init(struct udp_pcb *pcb, uint16 entity_address)
+{
+    g_pcb = pcb;
+    g_announce_remaining = 0;
+    BuildVehicleIdFrame(entity_address);
+}
+
+boolean DoIP_VehicleId_HandleDatagram(struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    /* Header is read in place from the first pbuf; no datagram copy */
+    const uint8 *data = (const uint8 *)p->payload;
+    DoIP_Header header;
+
+    if (g_pcb == NULL || p->len < DOIP_HEADER_SIZE)
+    {
+        return FALSE;
+    }
+
+    if (!DoIP_ParseHeader(data, &header))
+    {
+        /* Identification requests may also use the default version 0xFF */
+        if (data[0] != DOIP_DEFAULT_VERSION || data[1] != DOIP_DEFAULT_INVERSE)
+        {
+            return FALSE;  /* Not DoIP (e.g. VCI message) */
+        }
+        header.payloadType = ((uint16)data[2] << 8) | data[3];
+        header.payloadLength = ((uint32)data[4] << 24) | ((uint32)data[5] << 16) |
+                               ((uint32)data[6] << 8) | data[7];
+        if (!IsVehicleIdRequest(header.payloadType))
+        {
+            return FALSE;
+        }
+    }
+
+    if (!IsVehicleIdRequest(header.payloadType))
+    {
+        /* Other DoIP messages are not served over UDP */
+        SendGenericNack(addr, port, DOIP_NACK_UNKNOWN_PAYLOAD_TYPE);
+        return TRUE;
+    }
+
+    uint32 min_len;
+    uint32 max_len;
+    DoIP_Stream_GetPayloadLimits(header.payloadType, &min_len, &max_len);
+
+    if (header.payloadLength != min_len || p->tot_len != DOIP_HEADER_SIZE + header.payloadLength ||
+        p->len < p->tot_len)
+    {
+        SendGenericNack(addr, port, DOIP_NACK_INVALID_PAYLOAD_LEN);
+        return TRUE;
+    }
+
+    /* Filtered requests are only answered when EID / VIN match */
+    const uint8 *payload = &data[DOIP_HEADER_SIZE];
+    if ((header.payloadType == DOIP_VEHICLE_ID_REQ_EID && memcmp(payload, g_eid, DOIP_EID_LENGTH) != 0) ||
+        (header.payloadType == DOIP_VEHICLE_ID_REQ_VIN && memcmp(payload, g_vin, DOIP_VIN_LENGTH) != 0))
+    {
+        return TRUE;
+    }
+
+    SendVehicleIdFrame(addr, port);
+    return TRUE;
+}
+
+void DoIP_VehicleId_StartAnnouncement(void)
+{
+    /* Random initial delay (A_DoIP_Announce_Wait) from the free-running timer */
+    uint32 wait_ms = GetTimestamp() % (DOIP_ANNOUNCE_WAIT_MAX + 1);
+
+    g_announce_remaining = DOIP_ANNOUNCE_COUNT;
+    g_announce_next_time = GetTimestamp() + MsToTicks(wait_ms);
+}
+
+void DoIP_VehicleId_Poll(void)
+{
+    /* Held until the link is up: an announcement sent without it is lost;
+     * also held while NM transmission is off (CommunicationControl) */
+    if (g_announce_remaining == 0 || g_pcb == NULL || !netif_is_link_up(&g_Lwip.netif) ||
+        !UDS_Comm_TxEnabled(UDS_COMM_SUBNET_ETHERNET, UDS_COMM_TYPE_NM))
+    {
+        return;
+    }
+
+    uint32 now = GetTimestamp();
+    if ((sint32)(now - g_announce_next_time) < 0)
+    {
+        return;
+    }
+
+    ip_addr_t broadcast_addr;
+    IP4_ADDR(&broadcast_addr, 255, 255, 255, 255);
+    SendVehicleIdFrame(&broadcast_addr, UDP_DOIP_PORT);
+
+    g_announce_remaining--;
+    g_announce_next_time = now + MsToTicks(DOIP_ANNOUNCE_INTERVAL);
+
+    if (g_announce_remaining == 0)
+    {
+        sendUARTMessage("[DoIP] Vehicle announcement sent\r\n", 34);
+    }
+}
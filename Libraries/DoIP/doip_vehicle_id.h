@@ -0,0 +1,47 @@
+/**
+ * @file doip_vehicle_id.h
+ * @brief DoIP Vehicle Identification and Announcement (UDP 13400)
+ * @details Answers vehicle identification requests (0x0001/0x0002/0x0003)
+ *          and sends the vehicle announcement burst after startup, so testers
+ *          discover the gateway without a hard-coded IP address. The response
+ *          frame is serialized once and sent by reference (no copy per request).
+ *          Shares the UDP 13400 socket with the VCI collector.
+ */
+
+#ifndef DOIP_VEHICLE_ID_H
+#define DOIP_VEHICLE_ID_H
+
+#include "doip_types.h"
+#include "lwip/udp.h"
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize responder and pre-serialize the identification response
+ * @param pcb UDP socket bound to port 13400
+ * @param entity_address Logical address of this DoIP entity
+ */
+void DoIP_VehicleId_Init(struct udp_pcb *pcb, uint16 entity_address);
+
+/**
+ * @brief Handle a datagram received on UDP 13400 (call from the socket's recv callback)
+ * @param p Received datagram (not freed)
+ * @param addr Sender address
+ * @param port Sender port
+ * @return TRUE if the datagram was a DoIP message and has been handled, FALSE otherwise
+ */
+boolean DoIP_VehicleId_HandleDatagram(struct pbuf *p, const ip_addr_t *addr, u16_t port);
+
+/**
+ * @brief Start the vehicle announcement burst (after link up)
+ */
+void DoIP_VehicleId_StartAnnouncement(void);
+
+/**
+ * @brief Poll announcement timer (call from main loop)
+ */
+void DoIP_VehicleId_Poll(void);
+
+#endif /* DOIP_VEHICLE_ID_H */
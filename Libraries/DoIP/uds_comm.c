@@ -0,0 +1,160 @@
+/**
+ * @file uds_comm.c
+ * @brief UDS CommunicationControl Implementation
+ */
+
+#include "uds_comm.h"
+#include "UART_Logging.h"
+#include <string.h>
+#include <stdio.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+/* controlType: bit 0 disables Tx, bit 1 disables Rx */
+#define COMM_DISABLE_RX_AND_TX      0x03
+#define COMM_CONTROL_DISABLE_TX     0x01
+#define COMM_CONTROL_DISABLE_RX     0x02
+
+/* communicationType */
+#define COMM_TYPE_MASK              0x03
+#define COMM_TYPE_RESERVED          0x0C
+#define COMM_SUBNET_SHIFT           4
+#define COMM_SUBNET_ALL             0x0
+#define COMM_SUBNET_RECEIVING       0xF     /* Requests arrive over DoIP */
+
+#define COMM_SUBNET_COUNT           (UDS_COMM_SUBNET_UART + 1)  /* Index 0 unused */
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+/* Disabled UDS_COMM_TYPE_* bits per subnet */
+static uint8 g_tx_disabled[COMM_SUBNET_COUNT];
+static uint8 g_rx_disabled[COMM_SUBNET_COUNT];
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static boolean AnyDisabled(void)
+{
+    for (uint8 subnet = UDS_COMM_SUBNET_ETHERNET; subnet < COMM_SUBNET_COUNT; subnet++)
+    {
+        if (g_tx_disabled[subnet] != 0 || g_rx_disabled[subnet] != 0)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* Switches held outside the DoIP library */
+static void Apply(void)
+{
+    setUARTLogging(UDS_Comm_TxEnabled(UDS_COMM_SUBNET_UART, UDS_COMM_TYPE_NORMAL));
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+boolean UDS_Comm_TxEnabled(uint8 subnet, uint8 comm_type)
+{
+    return (subnet >= COMM_SUBNET_COUNT) || (g_tx_disabled[subnet] & comm_type) == 0;
+}
+
+boolean UDS_Comm_RxEnabled(uint8 subnet, uint8 comm_type)
+{
+    return (subnet >= COMM_SUBNET_COUNT) || (g_rx_disabled[subnet] & comm_type) == 0;
+}
+
+void UDS_Comm_EnableAll(void)
+{
+    if (!AnyDisabled())
+    {
+        return;
+    }
+
+    memset(g_tx_disabled, 0, sizeof(g_tx_disabled));
+    memset(g_rx_disabled, 0, sizeof(g_rx_disabled));
+    Apply();
+
+    sendUARTMessage("[UDS] Communication enabled\r\n", 29);
+}
+
+/*******************************************************************************
+ * UDS Service: 0x28 Communication Control
+ ******************************************************************************/
+
+boolean UDS_Service_CommunicationControl(const UDS_Request *request, UDS_Response *response)
+{
+    uint8 control_type = request->data[0] & UDS_SUBFUNCTION_MASK;
+    uint8 comm_type;
+    uint8 subnet;
+    uint8 first;
+    uint8 last;
+
+    /* Types with enhanced address information (0x04, 0x05) are not supported */
+    if (control_type > COMM_DISABLE_RX_AND_TX)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_SUBFUNCTION_NOT_SUPPORTED, response);
+        return TRUE;
+    }
+
+    if (request->data_len != 2)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return TRUE;
+    }
+
+    comm_type = request->data[1] & COMM_TYPE_MASK;
+    subnet = request->data[1] >> COMM_SUBNET_SHIFT;
+    if (subnet == COMM_SUBNET_RECEIVING)
+    {
+        subnet = UDS_COMM_SUBNET_ETHERNET;
+    }
+
+    if (comm_type == 0 || (request->data[1] & COMM_TYPE_RESERVED) != 0 || subnet >= COMM_SUBNET_COUNT)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+        return TRUE;
+    }
+
+    first = (subnet == COMM_SUBNET_ALL) ? UDS_COMM_SUBNET_ETHERNET : subnet;
+    last = (subnet == COMM_SUBNET_ALL) ? (COMM_SUBNET_COUNT - 1) : subnet;
+
+    /* Logged first: disabling the UART subnet mutes this very message */
+    char log_msg[48];
+    sprintf(log_msg, "[UDS] Communication control 0x%02X/0x%02X\r\n", control_type, request->data[1]);
+    sendUARTMessage(log_msg, strlen(log_msg));
+
+    for (subnet = first; subnet <= last; subnet++)
+    {
+        if (control_type & COMM_CONTROL_DISABLE_TX)
+        {
+            g_tx_disabled[subnet] |= comm_type;
+        }
+        else
+        {
+            g_tx_disabled[subnet] &= (uint8)~comm_type;
+        }
+
+        if (control_type & COMM_CONTROL_DISABLE_RX)
+        {
+            g_rx_disabled[subnet] |= comm_type;
+        }
+        else
+        {
+            g_rx_disabled[subnet] &= (uint8)~comm_type;
+        }
+    }
+    Apply();
+
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = control_type;
+    response->data_len = 1;
+    return TRUE;
+}
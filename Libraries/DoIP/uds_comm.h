@@ -0,0 +1,69 @@
+/**
+ * @file uds_comm.h
+ * @brief UDS CommunicationControl (0x28)
+ * @details Switches the gateway's own nonessential traffic off, e.g. to give
+ *          a flash download the whole link and CPU. Diagnostic requests and
+ *          responses are never affected. Producers query the switches:
+ *
+ *            Ethernet, normal:  health/VCI reports to the VMG (and their
+ *                               replay), periodic 0x2A messages, VCI
+ *                               collection broadcast (Tx) and the Zone ECU
+ *                               VCI answers (Rx)
+ *            Ethernet, NM:      DoIP vehicle announcements (Tx)
+ *            UART, normal:      debug log (Tx)
+ *
+ *          communicationType: bits 0-1 message types (UDS_COMM_TYPE_*),
+ *          bits 4-7 subnet (0 = all, UDS_COMM_SUBNET_*, 0xF = the network the
+ *          request came on: Ethernet). The default session enables all.
+ */
+
+#ifndef UDS_COMM_H
+#define UDS_COMM_H
+
+#include "uds_handler.h"
+
+/*******************************************************************************
+ * Communication Types and Subnets
+ ******************************************************************************/
+
+#define UDS_COMM_TYPE_NORMAL        0x01    /* Application messages */
+#define UDS_COMM_TYPE_NM            0x02    /* Network management messages */
+
+#define UDS_COMM_SUBNET_ETHERNET    0x01    /* DoIP/UDP to the VMG and the Zone ECUs */
+#define UDS_COMM_SUBNET_UART        0x02    /* ASCLIN0 debug log */
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Check whether messages may be sent
+ * @param subnet UDS_COMM_SUBNET_*
+ * @param comm_type UDS_COMM_TYPE_*
+ * @return TRUE if transmission is enabled
+ */
+boolean UDS_Comm_TxEnabled(uint8 subnet, uint8 comm_type);
+
+/**
+ * @brief Check whether received messages are processed
+ * @param subnet UDS_COMM_SUBNET_*
+ * @param comm_type UDS_COMM_TYPE_*
+ * @return TRUE if reception is enabled
+ */
+boolean UDS_Comm_RxEnabled(uint8 subnet, uint8 comm_type);
+
+/**
+ * @brief Enable reception and transmission on all subnets
+ *        (transition to the default session)
+ */
+void UDS_Comm_EnableAll(void);
+
+/**
+ * @brief Service 0x28 - Communication Control
+ * @param request UDS request [controlType][communicationType]
+ * @param response UDS response [controlType]
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_CommunicationControl(const UDS_Request *request, UDS_Response *response);
+
+#endif /* UDS_COMM_H */
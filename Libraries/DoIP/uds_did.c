@@ -0,0 +1,788 @@
+/**
+ * @file uds_did.c
+ * @brief UDS Data Identifier Registry Implementation
+ */
+
+#include "uds_did.h"
+#include "doip_types.h"
+#include "doip_client.h"
+#include "uds_memory.h"
+#include "AppConfig.h"
+#include <string.h>
+
+/*******************************************************************************
+ * External VCI / Health Database (from Cpu0_Main.c)
+ ******************************************************************************/
+
+extern DoIP_VCI_Info g_vci_database[MAX_ZONE_ECUS + 1];  /* +1 for ZGW itself */
+extern uint8 g_zone_ecu_count;
+extern boolean g_vci_collection_complete;
+extern DoIP_VCI_Info g_zgw_vci;
+extern DoIP_HealthStatus_Info g_health_data[MAX_ZONE_ECUS + 1];
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define LINK_STATS_COUNTERS     7
+#define LINK_STATS_LEN          (1 + (LINK_STATS_COUNTERS * 4))
+
+/* Largest cached record: 0xF195 (0xF194 and 0xF1A0 are shorter) */
+#define CACHE_RECORD_LEN        (1 + ((MAX_ZONE_ECUS + 1) * sizeof(DoIP_VCI_Info)))
+
+#define DYNAMIC_DID_FIRST       0xF200  /* dynamicallyDefinedDataIdentifier range */
+#define DYNAMIC_DID_LAST        0xF3FF
+
+/* 0x2C sub-functions (definitionType) */
+#define DDDID_DEFINE_BY_IDENTIFIER  0x01
+#define DDDID_DEFINE_BY_MEMORY      0x02
+#define DDDID_CLEAR                 0x03
+
+typedef struct
+{
+    uint16        did;
+    uint16        max_len;          /* Memory-backed: record length */
+    uint8         sessions;
+    UDS_DIDReader read;             /* NULL: memory-backed */
+    const uint8  *data;             /* Memory-backed record */
+
+} UDS_DIDEntry;
+
+/* One slice of a dynamically defined DID, resolved at definition time */
+typedef struct
+{
+    const uint8  *src;              /* Memory source: copied directly */
+    UDS_DIDReader read;             /* Provider source (src NULL), run into g_source_record */
+    uint16        source_did;
+    uint16        offset;           /* Slice start within the provider's record */
+    uint16        len;
+    boolean       fetch;            /* Provider differs from the previous step: run it */
+
+} UDS_CopyStep;
+
+/* Encoded positive response of a single-DID request: [DID][record] after the headroom */
+typedef struct
+{
+    uint16  did;
+    boolean valid;
+    uint32  version;                /* g_data_version the frame was built from */
+    uint16  data_len;               /* Response data: DID + record */
+    uint8   frame[UDS_RESPONSE_HEADROOM + 2 + CACHE_RECORD_LEN];
+
+} UDS_DIDCacheEntry;
+
+typedef struct
+{
+    uint16       did;               /* 0 = free */
+    uint16       record_len;
+    uint8        sessions;          /* Sessions all its sources are readable in */
+    uint8        step_count;
+    UDS_CopyStep steps[UDS_DDDID_MAX_STEPS];
+
+} UDS_DynamicDID;
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+/* Sorted by DID for the binary search */
+static UDS_DIDEntry g_did_table[UDS_DID_MAX_ENTRIES];
+static uint8        g_did_count = 0;
+
+/* Copy plans of the dynamically defined DIDs (0x2C) */
+static UDS_DynamicDID g_dynamic[UDS_DDDID_MAX_DEFINITIONS];
+
+/* Record of a provider source while a dynamic DID is read */
+static uint8 g_source_record[UDS_DDDID_MAX_SOURCE_LEN];
+
+/* Response frames of the slow-changing DIDs */
+static UDS_DIDCacheEntry g_cache[UDS_DID_CACHE_ENTRIES];
+static uint32            g_data_version = 0;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static const UDS_DIDEntry *FindDID(uint16 did)
+{
+    uint8 low = 0;
+    uint8 high = g_did_count;
+
+    while (low < high)
+    {
+        uint8 mid = (uint8)((low + high) / 2);
+        if (g_did_table[mid].did == did)
+        {
+            return &g_did_table[mid];
+        }
+        if (g_did_table[mid].did < did)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return NULL;
+}
+
+static boolean AddDID(uint16 did, uint16 max_len, uint8 sessions, UDS_DIDReader read, const uint8 *data)
+{
+    if (g_did_count >= UDS_DID_MAX_ENTRIES || FindDID(did) != NULL)
+    {
+        return FALSE;
+    }
+
+    /* Insertion keeps the table sorted */
+    uint8 pos = g_did_count;
+    while (pos > 0 && g_did_table[pos - 1].did > did)
+    {
+        g_did_table[pos] = g_did_table[pos - 1];
+        pos--;
+    }
+
+    g_did_table[pos].did = did;
+    g_did_table[pos].max_len = max_len;
+    g_did_table[pos].sessions = sessions;
+    g_did_table[pos].read = read;
+    g_did_table[pos].data = data;
+    g_did_count++;
+
+    return TRUE;
+}
+
+static void RemoveDID(uint16 did)
+{
+    const UDS_DIDEntry *entry = FindDID(did);
+
+    if (entry != NULL)
+    {
+        uint8 pos = (uint8)(entry - g_did_table);
+        g_did_count--;
+        memmove(&g_did_table[pos], &g_did_table[pos + 1], (g_did_count - pos) * sizeof(UDS_DIDEntry));
+    }
+}
+
+static const UDS_DIDEntry *FindReadableIn(uint16 did, uint8 session)
+{
+    const UDS_DIDEntry *entry = FindDID(did);
+
+    if (entry == NULL || (entry->sessions & UDS_SESSION_MASK(session)) == 0)
+    {
+        return NULL;
+    }
+
+    return entry;
+}
+
+static const UDS_DIDEntry *FindReadable(uint16 did)
+{
+    return FindReadableIn(did, UDS_GetSession());
+}
+
+static uint8 EcuCount(void)
+{
+    uint8 count = g_zone_ecu_count + 1;  /* +1 for ZGW itself */
+
+    return (count > MAX_ZONE_ECUS + 1) ? (MAX_ZONE_ECUS + 1) : count;
+}
+
+static uint32 ReadBigEndian(const uint8 *data, uint8 len)
+{
+    uint32 value = 0;
+
+    for (uint8 i = 0; i < len; i++)
+    {
+        value = (value << 8) | data[i];
+    }
+
+    return value;
+}
+
+/*******************************************************************************
+ * Response Cache
+ ******************************************************************************/
+
+/* Cached frame of did, rebuilt if the data changed; NULL if did is not cached
+ * or its record cannot be read (the regular path answers) */
+static UDS_DIDCacheEntry *GetCached(uint16 did)
+{
+    UDS_DIDCacheEntry *entry = NULL;
+    uint16 record_len = 0;
+
+    for (uint8 i = 0; i < UDS_DID_CACHE_ENTRIES; i++)
+    {
+        if (g_cache[i].did == did)
+        {
+            entry = &g_cache[i];
+        }
+    }
+
+    if (entry == NULL || (entry->valid && entry->version == g_data_version))
+    {
+        return entry;
+    }
+
+    entry->valid = FALSE;
+    if (UDS_DID_Read(did, &entry->frame[UDS_RESPONSE_HEADROOM + 2], CACHE_RECORD_LEN, &record_len) != 0)
+    {
+        return NULL;
+    }
+
+    /* The framework encodes the DoIP header and routing for each requester */
+    entry->frame[UDS_RESPONSE_HEADROOM - 1] = UDS_SID_READ_DATA_BY_IDENTIFIER + UDS_POSITIVE_RESPONSE_OFFSET;
+    entry->frame[UDS_RESPONSE_HEADROOM] = (uint8)(did >> 8);
+    entry->frame[UDS_RESPONSE_HEADROOM + 1] = (uint8)did;
+    entry->data_len = 2 + record_len;
+    entry->version = g_data_version;
+    entry->valid = TRUE;
+
+    return entry;
+}
+
+/*******************************************************************************
+ * Dynamically Defined DIDs
+ ******************************************************************************/
+
+static UDS_DynamicDID *FindDynamic(uint16 did)
+{
+    for (uint8 i = 0; i < UDS_DDDID_MAX_DEFINITIONS; i++)
+    {
+        if (g_dynamic[i].did == did && did != 0)
+        {
+            return &g_dynamic[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Reader of every dynamically defined DID: runs its copy plan */
+static uint16 ReadDynamic(uint16 did, uint8 *data, uint16 max_len)
+{
+    const UDS_DynamicDID *dynamic = FindDynamic(did);
+    uint16 source_len = 0;
+    uint16 pos = 0;
+
+    if (dynamic == NULL || dynamic->record_len > max_len)
+    {
+        return 0;
+    }
+
+    for (uint8 i = 0; i < dynamic->step_count; i++)
+    {
+        const UDS_CopyStep *step = &dynamic->steps[i];
+        const uint8 *src = step->src;
+
+        if (src == NULL)
+        {
+            if (step->fetch)
+            {
+                source_len = step->read(step->source_did, g_source_record, UDS_DDDID_MAX_SOURCE_LEN);
+            }
+
+            /* Provider record shorter than at definition (e.g. VCI not collected yet) */
+            if (step->offset + step->len > source_len)
+            {
+                return 0;
+            }
+            src = &g_source_record[step->offset];
+        }
+
+        memcpy(&data[pos], src, step->len);
+        pos += step->len;
+    }
+
+    return pos;
+}
+
+/* 0x2C defineByIdentifier: [srcDID][position (1-based)][memorySize] per slice;
+ * sessions is narrowed to those of the sources */
+static uint8 ResolveByIdentifier(const uint8 *record, uint8 count, UDS_CopyStep *steps, uint8 *sessions)
+{
+    for (uint8 i = 0; i < count; i++, record += 4)
+    {
+        uint16 source_did = ((uint16)record[0] << 8) | record[1];
+        uint16 offset = (uint16)record[2] - 1;
+        uint16 len = record[3];
+        const UDS_DIDEntry *source = FindReadable(source_did);
+
+        /* Dynamic DIDs are not sources: plans never chain */
+        if (source == NULL || FindDynamic(source_did) != NULL || record[2] == 0 || len == 0
+            || offset + len > source->max_len)
+        {
+            return UDS_NRC_REQUEST_OUT_OF_RANGE;
+        }
+
+        *sessions &= source->sessions;
+        steps[i].src = NULL;
+        steps[i].read = source->read;
+        steps[i].source_did = source_did;
+        steps[i].offset = offset;
+        steps[i].len = len;
+
+        if (source->read == NULL)
+        {
+            steps[i].src = &source->data[offset];
+        }
+        else if (source->max_len > UDS_DDDID_MAX_SOURCE_LEN)
+        {
+            return UDS_NRC_REQUEST_OUT_OF_RANGE;
+        }
+    }
+
+    return 0;
+}
+
+/* 0x2C defineByMemoryAddress: [memoryAddress][memorySize] per slice, any memory-mapped
+ * window readable by ReadMemoryByAddress (not Flash4) */
+static uint8 ResolveByMemory(const uint8 *record, uint8 count, uint8 address_len, uint8 size_len, UDS_CopyStep *steps)
+{
+    for (uint8 i = 0; i < count; i++, record += address_len + size_len)
+    {
+        uint32 address = ReadBigEndian(record, address_len);
+        uint32 size = ReadBigEndian(&record[address_len], size_len);
+
+        if (size > UDS_DDDID_MAX_RECORD_LEN || !UDS_Memory_IsMapped(address, size, UDS_MEMORY_READ))
+        {
+            return UDS_NRC_REQUEST_OUT_OF_RANGE;
+        }
+
+        steps[i].src = (const uint8 *)address;
+        steps[i].read = NULL;
+        steps[i].source_did = 0;
+        steps[i].offset = 0;
+        steps[i].len = (uint16)size;
+    }
+
+    return 0;
+}
+
+/* Append resolved slices to a dynamic DID (created on first use); all or nothing */
+static uint8 AppendSteps(uint16 did, const UDS_CopyStep *steps, uint8 count, uint8 sessions)
+{
+    UDS_DynamicDID *dynamic = FindDynamic(did);
+
+    if (did < DYNAMIC_DID_FIRST || did > DYNAMIC_DID_LAST)
+    {
+        return UDS_NRC_REQUEST_OUT_OF_RANGE;
+    }
+
+    if (dynamic == NULL)
+    {
+        /* A free definition, and the DID must not be a static one */
+        for (uint8 i = 0; i < UDS_DDDID_MAX_DEFINITIONS && dynamic == NULL; i++)
+        {
+            if (g_dynamic[i].did == 0)
+            {
+                dynamic = &g_dynamic[i];
+            }
+        }
+
+        if (dynamic == NULL || FindDID(did) != NULL || g_did_count >= UDS_DID_MAX_ENTRIES)
+        {
+            return UDS_NRC_REQUEST_OUT_OF_RANGE;
+        }
+        dynamic->step_count = 0;
+        dynamic->record_len = 0;
+        dynamic->sessions = UDS_SESSIONS_ALL;
+    }
+
+    uint32 record_len = dynamic->record_len;
+    for (uint8 i = 0; i < count; i++)
+    {
+        record_len += steps[i].len;
+    }
+
+    if (dynamic->step_count + count > UDS_DDDID_MAX_STEPS || record_len > UDS_DDDID_MAX_RECORD_LEN)
+    {
+        return UDS_NRC_REQUEST_OUT_OF_RANGE;
+    }
+
+    /* A provider runs once per read for consecutive slices of its record */
+    for (uint8 i = 0; i < count; i++)
+    {
+        UDS_CopyStep *step = &dynamic->steps[dynamic->step_count];
+        const UDS_CopyStep *prev = (dynamic->step_count > 0) ? (step - 1) : NULL;
+
+        *step = steps[i];
+        step->fetch = (step->src == NULL)
+                      && (prev == NULL || prev->src != NULL || prev->source_did != step->source_did);
+        dynamic->step_count++;
+    }
+
+    dynamic->did = did;
+    dynamic->record_len = (uint16)record_len;
+    dynamic->sessions &= sessions;
+
+    /* Registered with its new length, readable only where every source is */
+    RemoveDID(did);
+    AddDID(did, dynamic->record_len, dynamic->sessions, ReadDynamic, NULL);
+
+    return 0;
+}
+
+static void ClearDynamic(UDS_DynamicDID *dynamic)
+{
+    RemoveDID(dynamic->did);
+    dynamic->did = 0;
+    dynamic->step_count = 0;
+    dynamic->record_len = 0;
+}
+
+/*******************************************************************************
+ * Gateway DIDs
+ ******************************************************************************/
+
+/* 0xF195 - [Count][VCI_1][VCI_2]... (only the ZGW until collection completes) */
+static uint16 ReadConsolidatedVci(uint16 did, uint8 *data, uint16 max_len)
+{
+    (void)did;
+
+    if (!g_vci_collection_complete)
+    {
+        if (max_len < 1 + sizeof(DoIP_VCI_Info))
+        {
+            return 0;
+        }
+        data[0] = 1;
+        memcpy(&data[1], &g_zgw_vci, sizeof(DoIP_VCI_Info));
+        return 1 + sizeof(DoIP_VCI_Info);
+    }
+
+    uint8 count = EcuCount();
+    if (max_len < 1 + (count * sizeof(DoIP_VCI_Info)))
+    {
+        return 0;
+    }
+    data[0] = count;
+    memcpy(&data[1], g_vci_database, count * sizeof(DoIP_VCI_Info));
+    return (uint16)(1 + (count * sizeof(DoIP_VCI_Info)));
+}
+
+/* 0xF1A0 - [Count][Health_1][Health_2]... */
+static uint16 ReadHealthStatus(uint16 did, uint8 *data, uint16 max_len)
+{
+    uint8 count = EcuCount();
+
+    (void)did;
+    if (max_len < 1 + (count * sizeof(DoIP_HealthStatus_Info)))
+    {
+        return 0;
+    }
+
+    data[0] = count;
+    memcpy(&data[1], g_health_data, count * sizeof(DoIP_HealthStatus_Info));
+    return (uint16)(1 + (count * sizeof(DoIP_HealthStatus_Info)));
+}
+
+/* 0xF1C0 - [State][Attempts][Activations][Losses][TimeToActive last][max][Failovers][Replayed]
+ * (counters and ms, big endian) */
+static uint16 ReadLinkStats(uint16 did, uint8 *data, uint16 max_len)
+{
+    const DoIP_ClientLinkStats *stats = DoIP_Client_GetLinkStats();
+    const uint32 values[LINK_STATS_COUNTERS] = {
+        stats->connect_attempts, stats->activations, stats->link_losses,
+        stats->time_to_active_last_ms, stats->time_to_active_max_ms,
+        stats->failovers, stats->replayed_reports
+    };
+
+    (void)did;
+    if (max_len < LINK_STATS_LEN)
+    {
+        return 0;
+    }
+
+    data[0] = (uint8)DoIP_Client_GetState();
+    for (uint8 i = 0; i < LINK_STATS_COUNTERS; i++)
+    {
+        data[1 + (i * 4)] = (uint8)(values[i] >> 24);
+        data[2 + (i * 4)] = (uint8)(values[i] >> 16);
+        data[3 + (i * 4)] = (uint8)(values[i] >> 8);
+        data[4 + (i * 4)] = (uint8)(values[i] & 0xFF);
+    }
+
+    return LINK_STATS_LEN;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void UDS_DID_Init(void)
+{
+    g_did_count = 0;
+    memset(g_dynamic, 0, sizeof(g_dynamic));
+    memset(g_cache, 0, sizeof(g_cache));
+
+    UDS_DID_RegisterData(UDS_DID_VCI_ECU_ID, &g_zgw_vci, sizeof(DoIP_VCI_Info),
+                         UDS_SESSIONS_ALL);
+    UDS_DID_Register(UDS_DID_VCI_CONSOLIDATED, 1 + ((MAX_ZONE_ECUS + 1) * sizeof(DoIP_VCI_Info)),
+                     UDS_SESSIONS_ALL, ReadConsolidatedVci);
+    UDS_DID_Register(UDS_DID_HEALTH_STATUS, 1 + ((MAX_ZONE_ECUS + 1) * sizeof(DoIP_HealthStatus_Info)),
+                     UDS_SESSIONS_ALL, ReadHealthStatus);
+    UDS_DID_Register(UDS_DID_DOIP_LINK_STATS, LINK_STATS_LEN,
+                     UDS_SESSIONS_ALL, ReadLinkStats);
+
+    /* Same records under their periodic identifiers (0x2A) */
+    UDS_DID_Register(UDS_DID_PERIODIC_HEALTH_STATUS, 1 + ((MAX_ZONE_ECUS + 1) * sizeof(DoIP_HealthStatus_Info)),
+                     UDS_SESSIONS_ALL, ReadHealthStatus);
+    UDS_DID_Register(UDS_DID_PERIODIC_DOIP_LINK_STATS, LINK_STATS_LEN,
+                     UDS_SESSIONS_ALL, ReadLinkStats);
+
+    /* Polled by the VMG, changed only by the VCI and health writers */
+    g_cache[0].did = UDS_DID_VCI_ECU_ID;
+    g_cache[1].did = UDS_DID_VCI_CONSOLIDATED;
+    g_cache[2].did = UDS_DID_HEALTH_STATUS;
+}
+
+boolean UDS_DID_Register(uint16 did, uint16 max_len, uint8 sessions, UDS_DIDReader read)
+{
+    return (read != NULL) && AddDID(did, max_len, sessions, read, NULL);
+}
+
+boolean UDS_DID_RegisterData(uint16 did, const void *data, uint16 len, uint8 sessions)
+{
+    return (data != NULL) && AddDID(did, len, sessions, NULL, (const uint8 *)data);
+}
+
+void UDS_DID_DataChanged(void)
+{
+    g_data_version++;
+}
+
+boolean UDS_DID_IsReadable(uint16 did)
+{
+    return (FindReadable(did) != NULL);
+}
+
+uint8 UDS_DID_Read(uint16 did, uint8 *data, uint16 max_len, uint16 *data_len)
+{
+    return UDS_DID_ReadInSession(did, UDS_GetSession(), data, max_len, data_len);
+}
+
+uint8 UDS_DID_ReadInSession(uint16 did, uint8 session, uint8 *data, uint16 max_len, uint16 *data_len)
+{
+    const UDS_DIDEntry *entry = FindReadableIn(did, session);
+
+    if (entry == NULL)
+    {
+        return UDS_NRC_REQUEST_OUT_OF_RANGE;
+    }
+
+    if (entry->max_len > max_len)
+    {
+        return UDS_NRC_RESPONSE_TOO_LONG;
+    }
+
+    if (entry->read == NULL)
+    {
+        memcpy(data, entry->data, entry->max_len);
+        *data_len = entry->max_len;
+        return 0;
+    }
+
+    *data_len = entry->read(did, data, max_len);
+    return (*data_len > 0) ? 0 : UDS_NRC_CONDITIONS_NOT_CORRECT;
+}
+
+/*******************************************************************************
+ * UDS Service: 0x22 Read Data By Identifier
+ ******************************************************************************/
+
+boolean UDS_Service_ReadDataByIdentifier(const UDS_Request *request, UDS_Response *response)
+{
+    /* One to UDS_DID_MAX_PER_REQUEST DIDs (bounds checked by the service table) */
+    if ((request->data_len & 1) != 0)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return TRUE;
+    }
+
+    /* A cached DID alone: its frame is handed over instead of being rebuilt */
+    if (request->data_len == 2)
+    {
+        uint16 did = ((uint16)request->data[0] << 8) | request->data[1];
+        UDS_DIDCacheEntry *cached = (FindReadable(did) != NULL) ? GetCached(did) : NULL;
+
+        if (cached != NULL)
+        {
+            UDS_SetPrebuiltResponse(response, cached->frame, cached->data_len);
+            return TRUE;
+        }
+    }
+
+    UDS_CreatePositiveResponse(request, response);
+
+    /* Records are written in place: [DID][record] per supported DID, unsupported
+     * DIDs are skipped */
+    for (uint16 i = 0; i < request->data_len; i += 2)
+    {
+        uint16 did = ((uint16)request->data[i] << 8) | request->data[i + 1];
+        uint16 pos = response->data_len;
+
+        if (FindReadable(did) == NULL)
+        {
+            continue;
+        }
+
+        if (pos + 2 > UDS_MAX_RESPONSE_SIZE)
+        {
+            UDS_CreateNegativeResponse(request, UDS_NRC_RESPONSE_TOO_LONG, response);
+            return TRUE;
+        }
+
+        uint16 record_len = 0;
+        uint8 nrc = UDS_DID_Read(did, &response->data[pos + 2],
+                                 (uint16)(UDS_MAX_RESPONSE_SIZE - (pos + 2)), &record_len);
+        if (nrc != 0)
+        {
+            UDS_CreateNegativeResponse(request, nrc, response);
+            return TRUE;
+        }
+
+        response->data[pos] = request->data[i];
+        response->data[pos + 1] = request->data[i + 1];
+        response->data_len = pos + 2 + record_len;
+    }
+
+    if (response->data_len == 0)
+    {
+        /* None of the DIDs is supported in the active session */
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+    }
+
+    return TRUE;
+}
+
+/*******************************************************************************
+ * UDS Service: 0x2C Dynamically Define Data Identifier
+ ******************************************************************************/
+
+boolean UDS_Service_DynamicallyDefineDataIdentifier(const UDS_Request *request, UDS_Response *response)
+{
+    uint8 sub_function = request->data[0] & UDS_SUBFUNCTION_MASK;
+    uint16 did = (request->data_len >= 3) ? (((uint16)request->data[1] << 8) | request->data[2]) : 0;
+    UDS_CopyStep steps[UDS_DDDID_MAX_STEPS];
+    uint8 sessions = UDS_SESSIONS_ALL;
+    uint8 nrc = 0;
+
+    switch (sub_function)
+    {
+        case DDDID_DEFINE_BY_IDENTIFIER:
+        {
+            /* [DDDID] then 4 bytes per slice */
+            uint16 count = (request->data_len - 3) / 4;
+            if (request->data_len < 7 || ((request->data_len - 3) % 4) != 0)
+            {
+                nrc = UDS_NRC_INCORRECT_MESSAGE_LENGTH;
+            }
+            else if (count > UDS_DDDID_MAX_STEPS)
+            {
+                nrc = UDS_NRC_REQUEST_OUT_OF_RANGE;
+            }
+            else
+            {
+                nrc = ResolveByIdentifier(&request->data[3], (uint8)count, steps, &sessions);
+                if (nrc == 0)
+                {
+                    nrc = AppendSteps(did, steps, (uint8)count, sessions);
+                }
+            }
+            break;
+        }
+
+        case DDDID_DEFINE_BY_MEMORY:
+        {
+            /* [DDDID][ALFID] then address + size per slice */
+            uint8 size_len = (request->data_len >= 4) ? (request->data[3] >> 4) : 0;
+            uint8 address_len = (request->data_len >= 4) ? (request->data[3] & 0x0F) : 0;
+            uint8 item_len = size_len + address_len;
+
+            /* No memory through 0x22 where 0x23 is not allowed */
+            if ((UDS_MEMORY_READ_SESSIONS & UDS_SESSION_MASK(UDS_GetSession())) == 0)
+            {
+                nrc = UDS_NRC_SUBFUNCTION_NOT_SUPPORTED_IN_SESSION;
+            }
+            else if (request->data_len < 4)
+            {
+                nrc = UDS_NRC_INCORRECT_MESSAGE_LENGTH;
+            }
+            else if (size_len < 1 || size_len > 4 || address_len < 1 || address_len > 4)
+            {
+                nrc = UDS_NRC_REQUEST_OUT_OF_RANGE;
+            }
+            else if (request->data_len == 4 || ((request->data_len - 4) % item_len) != 0)
+            {
+                nrc = UDS_NRC_INCORRECT_MESSAGE_LENGTH;
+            }
+            else if ((request->data_len - 4) / item_len > UDS_DDDID_MAX_STEPS)
+            {
+                nrc = UDS_NRC_REQUEST_OUT_OF_RANGE;
+            }
+            else
+            {
+                uint8 count = (uint8)((request->data_len - 4) / item_len);
+                nrc = ResolveByMemory(&request->data[4], count, address_len, size_len, steps);
+                if (nrc == 0)
+                {
+                    nrc = AppendSteps(did, steps, count, UDS_MEMORY_READ_SESSIONS);
+                }
+            }
+            break;
+        }
+
+        case DDDID_CLEAR:
+        {
+            if (request->data_len != 1 && request->data_len != 3)
+            {
+                nrc = UDS_NRC_INCORRECT_MESSAGE_LENGTH;
+            }
+            else if (request->data_len == 1)
+            {
+                /* No DDDID: clear all definitions */
+                for (uint8 i = 0; i < UDS_DDDID_MAX_DEFINITIONS; i++)
+                {
+                    if (g_dynamic[i].did != 0)
+                    {
+                        ClearDynamic(&g_dynamic[i]);
+                    }
+                }
+            }
+            else if (did < DYNAMIC_DID_FIRST || did > DYNAMIC_DID_LAST)
+            {
+                nrc = UDS_NRC_REQUEST_OUT_OF_RANGE;
+            }
+            else if (FindDynamic(did) != NULL)
+            {
+                ClearDynamic(FindDynamic(did));
+            }
+            break;
+        }
+
+        default:
+            nrc = UDS_NRC_SUBFUNCTION_NOT_SUPPORTED;
+            break;
+    }
+
+    if (nrc != 0)
+    {
+        UDS_CreateNegativeResponse(request, nrc, response);
+        return TRUE;
+    }
+
+    /* [definitionType]([DDDID]) */
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = sub_function;
+    response->data_len = 1;
+    if (request->data_len >= 3)
+    {
+        response->data[1] = request->data[1];
+        response->data[2] = request->data[2];
+        response->data_len = 3;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file uds_did.h
+ * @brief UDS Data Identifier registry and ReadDataByIdentifier (0x22)
+ * @details Each DID is served by a provider that serializes its record straight
+ *          into the response buffer, so the data is copied once, from the live
+ *          variables. A 0x22 request may list several DIDs; their records are
+ *          returned back to back in one response (ISO 14229-1 10.2).
+ *          Modules register their DIDs at init, uds_handler.c stays unchanged.
+ *
+ *          DynamicallyDefineDataIdentifier (0x2C) composes DIDs 0xF200-0xF3FF
+ *          from slices of other DIDs or of memory (the memory-mapped windows of
+ *          ReadMemoryByAddress). The request is resolved once into a copy plan:
+ *          memory-backed slices become source pointers, provider slices an
+ *          offset into the provider's record. Reading the composite runs the
+ *          plan as a sequence of memcpy calls. A composite is readable only
+ *          in the sessions of all its sources; memory slices are those of
+ *          ReadMemoryByAddress (UDS_MEMORY_READ_SESSIONS).
+ *
+ *          The VCI and health DIDs (0xF194, 0xF195, 0xF1A0) change only when
+ *          their writers run, but are polled often by the VMG. A request for
+ *          one of them alone is answered from its encoded response frame,
+ *          built on the first read and handed to the TX path as it is. The
+ *          writers call UDS_DID_DataChanged(): the version counter it bumps
+ *          makes the next read rebuild the frame.
+ */
+
+#ifndef UDS_DID_H
+#define UDS_DID_H
+
+#include "uds_handler.h"
+
+/*******************************************************************************
+ * DID Registry Configuration
+ ******************************************************************************/
+
+#define UDS_DID_MAX_ENTRIES         32      /* Registered DIDs */
+#define UDS_DID_MAX_PER_REQUEST     8       /* DIDs in one 0x22 request */
+
+#define UDS_DDDID_MAX_DEFINITIONS   4       /* Dynamically defined DIDs */
+#define UDS_DDDID_MAX_STEPS         16      /* Slices per dynamically defined DID */
+#define UDS_DDDID_MAX_RECORD_LEN    512     /* Record of a dynamically defined DID */
+#define UDS_DDDID_MAX_SOURCE_LEN    512     /* Largest provider record usable as a source */
+
+#define UDS_DID_CACHE_ENTRIES       3       /* DIDs with a cached response frame */
+
+/*******************************************************************************
+ * DID Provider
+ ******************************************************************************/
+
+/* Write the record of did (without the DID itself) to data; return its length,
+ * 0 if the data is not available (NRC 0x22). max_len is at least the length
+ * given at registration. */
+typedef uint16 (*UDS_DIDReader)(uint16 did, uint8 *data, uint16 max_len);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize the registry with the gateway DIDs (call after UDS_Init)
+ */
+void UDS_DID_Init(void);
+
+/**
+ * @brief Register a DID provider
+ * @param did Data Identifier
+ * @param max_len Largest record the provider writes
+ * @param sessions Sessions in which the DID is readable (UDS_SESSION_MASK() bits)
+ * @param read Provider
+ * @return TRUE if registered, FALSE if the DID exists or the registry is full
+ */
+boolean UDS_DID_Register(uint16 did, uint16 max_len, uint8 sessions, UDS_DIDReader read);
+
+/**
+ * @brief Register a memory-backed DID: the record is len bytes at data, read
+ *        with one memcpy and usable by 0x2C without running a provider
+ * @param did Data Identifier
+ * @param data Record (static storage)
+ * @param len Record length
+ * @param sessions Sessions in which the DID is readable (UDS_SESSION_MASK() bits)
+ * @return TRUE if registered, FALSE if the DID exists or the registry is full
+ */
+boolean UDS_DID_RegisterData(uint16 did, const void *data, uint16 len, uint8 sessions);
+
+/**
+ * @brief Check whether a DID is registered and readable in the active session
+ * @param did Data Identifier
+ * @return TRUE if UDS_DID_Read() would serve it
+ */
+boolean UDS_DID_IsReadable(uint16 did);
+
+/**
+ * @brief Read a DID record in the active session
+ * @param did Data Identifier
+ * @param data Output buffer
+ * @param max_len Size of data
+ * @param data_len Output record length
+ * @return 0 if read, otherwise the NRC (0x31 unknown or not in this session,
+ *         0x14 record does not fit, 0x22 data not available)
+ */
+uint8 UDS_DID_Read(uint16 did, uint8 *data, uint16 max_len, uint16 *data_len);
+
+/**
+ * @brief Read a DID record in a given session (outside a request, e.g. a
+ *        periodic sample of the session it was scheduled in)
+ * @param did Data Identifier
+ * @param session UDS_SESSION_*
+ * @param data Output buffer
+ * @param max_len Size of data
+ * @param data_len Output record length
+ * @return As UDS_DID_Read()
+ */
+uint8 UDS_DID_ReadInSession(uint16 did, uint8 session, uint8 *data, uint16 max_len, uint16 *data_len);
+
+/**
+ * @brief Report a change of the VCI or health data (g_vci_database,
+ *        g_zone_ecu_count, g_vci_collection_complete, g_health_data):
+ *        cached response frames are rebuilt on their next read
+ */
+void UDS_DID_DataChanged(void);
+
+/**
+ * @brief Service 0x22 - Read Data By Identifier
+ * @param request UDS request [DID]{[DID]}
+ * @param response UDS response [DID][record]{[DID][record]}
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_ReadDataByIdentifier(const UDS_Request *request, UDS_Response *response);
+
+/**
+ * @brief Service 0x2C - Dynamically Define Data Identifier
+ * @param request UDS request [definitionType]([DDDID]{[source]})
+ * @param response UDS response [definitionType]([DDDID])
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_DynamicallyDefineDataIdentifier(const UDS_Request *request, UDS_Response *response);
+
+#endif /* UDS_DID_H */
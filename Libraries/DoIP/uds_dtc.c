@@ -0,0 +1,961 @@
+/**
+ * @file uds_dtc.c
+ * @brief Gateway DTC Memory Implementation
+ */
+
+#include "uds_dtc.h"
+#include "uds_did.h"
+#include "IfxFlash.h"
+#include "IfxScuWdt.h"
+#include "IfxStm.h"
+#include "UART_Logging.h"
+#include <string.h>
+#include <stdio.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+/* 0x19 reportType */
+#define DTC_REPORT_NUMBER_BY_STATUS_MASK    0x01
+#define DTC_REPORT_BY_STATUS_MASK           0x02
+#define DTC_REPORT_SNAPSHOT_IDENTIFICATION  0x03
+#define DTC_REPORT_SNAPSHOT_BY_DTC          0x04
+#define DTC_REPORT_EXT_DATA_BY_DTC          0x06
+#define DTC_REPORT_SUPPORTED_DTC            0x0A
+
+/* ControlDTCSetting sub-functions */
+#define DTC_SETTING_ON              0x01
+#define DTC_SETTING_OFF             0x02
+
+#define DTC_FORMAT_ISO14229_1       0x01
+#define DTC_GROUP_ALL               0xFFFFFFUL
+#define DTC_RECORD_ALL              0xFF
+
+/* Snapshot record 0x01: [F1B1 battery voltage (2)][F1B2 temperature (1)] */
+#define DTC_SNAPSHOT_RECORD         0x01
+#define DTC_SNAPSHOT_LEN            3
+
+/* Extended data records */
+#define DTC_EXT_OCCURRENCE          0x01    /* Test failed transitions since clear */
+#define DTC_EXT_AGING               0x02    /* Passed cycles since the last failure */
+
+/* Status after a clear */
+#define DTC_STATUS_CLEARED          (UDS_DTC_STATUS_NOT_COMPLETED_SINCE_CLEAR | \
+                                     UDS_DTC_STATUS_NOT_COMPLETED_THIS_CYCLE)
+
+typedef struct
+{
+    uint8 status;
+    uint8 occurrence;
+    uint8 aging;
+    uint8 snapshot_valid;
+    uint8 snapshot[DTC_SNAPSHOT_LEN];
+    uint8 reserved;
+
+} UDS_DTCRecord;
+
+/* DFLASH image: header + all records, programmed into one journal slot */
+#define DTC_IMAGE_MAGIC             0x44544331UL    /* "DTC1" */
+#define DFLASH_PAGE_SIZE            8
+#define DFLASH_ERROR_BITS           0x1FUL          /* HF_ERRSR: OPER, SQER, PROER, PVER, EVER */
+
+typedef struct
+{
+    uint32 magic;
+    uint32 sequence;            /* Newest valid image wins */
+    uint16 length;              /* sizeof(UDS_DTCImage) */
+    uint16 count;               /* UDS_DTC_COUNT */
+    uint32 crc;                 /* CRC-32 of the records */
+
+} UDS_DTCImageHeader;
+
+typedef struct
+{
+    UDS_DTCImageHeader header;
+    UDS_DTCRecord      records[UDS_DTC_COUNT];
+
+} UDS_DTCImage;
+
+#define DTC_SLOT_SIZE               ((sizeof(UDS_DTCImage) + DFLASH_PAGE_SIZE - 1) & ~(DFLASH_PAGE_SIZE - 1))
+#define DTC_SLOT_PAGES              (DTC_SLOT_SIZE / DFLASH_PAGE_SIZE)
+#define DTC_SLOTS_PER_SECTOR        (UDS_DTC_DFLASH_SECTOR_SIZE / DTC_SLOT_SIZE)
+
+typedef enum
+{
+    NVM_IDLE = 0,
+    NVM_ERASING,
+    NVM_PROGRAMMING
+} UDS_DTCNvmState;
+
+typedef struct
+{
+    UDS_DTCNvmState state;
+    uint8   sector;             /* Sector holding the newest image */
+    uint16  next_slot;          /* Next free slot there, DTC_SLOTS_PER_SECTOR if full */
+    uint32  sequence;           /* Sequence of the last commit attempt */
+    boolean dirty;              /* Records changed since the last commit started */
+    uint64  due;                /* Commit time: quiet time after the last change */
+    uint64  deadline;           /* ... but no later than this */
+    uint8   write_sector;
+    uint16  write_slot;
+    uint16  page;               /* Next page of the slot to program */
+    union
+    {
+        UDS_DTCImage image;
+        uint32       words[DTC_SLOT_SIZE / 4];
+    } buffer;                   /* Image being programmed */
+
+} UDS_DTCNvm;
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+/* DTC numbers, ascending, in UDS_DTCIndex order */
+static const uint32 g_dtc_numbers[UDS_DTC_COUNT] = {
+    [UDS_DTC_VMG_LINK_LOST]         = 0xD00087,
+    [UDS_DTC_ZONE_ECU_VCI_MISSING]  = 0xD00187,
+    [UDS_DTC_DTC_MEMORY_FAULT]      = 0xD00246,
+};
+
+static const uint32 g_sector_address[2] = { UDS_DTC_DFLASH_SECTOR_0, UDS_DTC_DFLASH_SECTOR_1 };
+
+static UDS_DTCRecord g_records[UDS_DTC_COUNT];
+
+/* Index: bit n of g_status_index[b] is set while record n has status bit b */
+static uint32 g_status_index[8];
+static uint32 g_snapshot_members;
+
+static UDS_DTCNvm g_nvm;
+static uint64     g_delay_ticks;
+static uint64     g_max_delay_ticks;
+static uint64     g_retry_ticks;
+
+static DoIP_HealthStatus_Info *g_health = NULL;
+
+/* ControlDTCSetting: bit n set while record n ignores test results */
+static uint32 g_setting_off = 0;
+
+/*******************************************************************************
+ * Private Functions - Records and Index
+ ******************************************************************************/
+
+static uint8 CountBits(uint32 bits)
+{
+    uint8 count = 0;
+
+    while (bits != 0)
+    {
+        bits &= bits - 1;
+        count++;
+    }
+
+    return count;
+}
+
+/* Records whose status shares a bit with the mask */
+static uint32 MatchStatusMask(uint8 status_mask)
+{
+    uint32 members = 0;
+
+    status_mask &= UDS_DTC_STATUS_AVAILABILITY_MASK;
+    for (uint8 bit = 0; status_mask != 0; bit++, status_mask >>= 1)
+    {
+        if (status_mask & 1)
+        {
+            members |= g_status_index[bit];
+        }
+    }
+
+    return members;
+}
+
+static uint8 FindDTC(uint32 number)
+{
+    uint8 low = 0;
+    uint8 high = UDS_DTC_COUNT;
+
+    while (low < high)
+    {
+        uint8 mid = (uint8)((low + high) / 2);
+        if (g_dtc_numbers[mid] == number)
+        {
+            return mid;
+        }
+        if (g_dtc_numbers[mid] < number)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return UDS_DTC_COUNT;
+}
+
+static void UpdateHealth(void)
+{
+    if (g_health != NULL && g_health->dtc_count != CountBits(g_status_index[0]))
+    {
+        g_health->dtc_count = CountBits(g_status_index[0]);
+        UDS_DID_DataChanged();
+    }
+}
+
+static void RebuildIndex(void)
+{
+    memset(g_status_index, 0, sizeof(g_status_index));
+    g_snapshot_members = 0;
+
+    for (uint8 i = 0; i < UDS_DTC_COUNT; i++)
+    {
+        for (uint8 bit = 0; bit < 8; bit++)
+        {
+            if (g_records[i].status & (1U << bit))
+            {
+                g_status_index[bit] |= (1UL << i);
+            }
+        }
+        if (g_records[i].snapshot_valid)
+        {
+            g_snapshot_members |= (1UL << i);
+        }
+    }
+
+    UpdateHealth();
+}
+
+/* Schedule a commit: after the quiet time, or right away if urgent */
+static void MarkDirty(boolean urgent)
+{
+    uint64 now = IfxStm_get(&MODULE_STM0);
+
+    if (!g_nvm.dirty)
+    {
+        g_nvm.dirty = TRUE;
+        g_nvm.deadline = now + g_max_delay_ticks;
+    }
+    if (urgent)
+    {
+        g_nvm.deadline = now;
+    }
+
+    g_nvm.due = now + g_delay_ticks;
+    if (g_nvm.due > g_nvm.deadline)
+    {
+        g_nvm.due = g_nvm.deadline;
+    }
+}
+
+/* Update a record's status and the status index; returns the changed bits */
+static uint8 ApplyStatus(uint8 index, uint8 status)
+{
+    uint8 changed = g_records[index].status ^ status;
+
+    if (changed == 0)
+    {
+        return 0;
+    }
+
+    g_records[index].status = status;
+    for (uint8 bit = 0; bit < 8; bit++)
+    {
+        if (changed & (1U << bit))
+        {
+            g_status_index[bit] ^= (1UL << index);
+        }
+    }
+
+    if (changed & UDS_DTC_STATUS_TEST_FAILED)
+    {
+        UpdateHealth();
+    }
+    return changed;
+}
+
+static void SetStatus(uint8 index, uint8 status)
+{
+    if (ApplyStatus(index, status) != 0)
+    {
+        MarkDirty(FALSE);
+    }
+}
+
+static void CaptureSnapshot(uint8 index)
+{
+    UDS_DTCRecord *record = &g_records[index];
+    uint16 voltage = (g_health != NULL) ? g_health->battery_voltage : 0;
+
+    record->snapshot[0] = (uint8)(voltage >> 8);
+    record->snapshot[1] = (uint8)(voltage & 0xFF);
+    record->snapshot[2] = (g_health != NULL) ? g_health->temperature : 0;
+    record->snapshot_valid = TRUE;
+    g_snapshot_members |= (1UL << index);
+}
+
+static void ClearRecord(uint8 index)
+{
+    g_records[index].occurrence = 0;
+    g_records[index].aging = 0;
+    g_records[index].snapshot_valid = FALSE;
+    memset(g_records[index].snapshot, 0, DTC_SNAPSHOT_LEN);
+    g_snapshot_members &= ~(1UL << index);
+    SetStatus(index, DTC_STATUS_CLEARED);
+}
+
+/* Power-up is the operation cycle: close the previous one, open a new one.
+ * Resetting the this-cycle bits alone is not committed (every power-up would
+ * write a record); pending, confirmed and aging changes are */
+static void StartOperationCycle(void)
+{
+    boolean changed = FALSE;
+
+    for (uint8 i = 0; i < UDS_DTC_COUNT; i++)
+    {
+        UDS_DTCRecord *record = &g_records[i];
+        uint8 status = record->status;
+        uint8 aging = record->aging;
+
+        if (status & UDS_DTC_STATUS_TEST_FAILED_THIS_CYCLE)
+        {
+            record->aging = 0;
+        }
+        else if (!(status & UDS_DTC_STATUS_NOT_COMPLETED_THIS_CYCLE))
+        {
+            /* Tested and passed in the previous cycle */
+            status &= ~UDS_DTC_STATUS_PENDING;
+            if (status & UDS_DTC_STATUS_CONFIRMED)
+            {
+                record->aging++;
+                if (record->aging >= UDS_DTC_AGING_CYCLES)
+                {
+                    status &= ~UDS_DTC_STATUS_CONFIRMED;
+                    record->aging = 0;
+                }
+            }
+        }
+
+        status &= ~UDS_DTC_STATUS_TEST_FAILED_THIS_CYCLE;
+        status |= UDS_DTC_STATUS_NOT_COMPLETED_THIS_CYCLE;
+
+        uint8 bits = ApplyStatus(i, status);
+        if ((bits & ~(UDS_DTC_STATUS_TEST_FAILED_THIS_CYCLE | UDS_DTC_STATUS_NOT_COMPLETED_THIS_CYCLE)) != 0
+            || record->aging != aging)
+        {
+            changed = TRUE;
+        }
+    }
+
+    if (changed)
+    {
+        MarkDirty(FALSE);
+    }
+}
+
+/* [DTC (3)][status] */
+static uint16 WriteDTCAndStatus(uint8 index, uint8 *data)
+{
+    data[0] = (uint8)(g_dtc_numbers[index] >> 16);
+    data[1] = (uint8)(g_dtc_numbers[index] >> 8);
+    data[2] = (uint8)(g_dtc_numbers[index] & 0xFF);
+    data[3] = g_records[index].status;
+    return 4;
+}
+
+static uint16 WriteDTCList(uint32 members, uint8 *data)
+{
+    uint16 len = 0;
+
+    for (uint8 i = 0; members != 0; i++, members >>= 1)
+    {
+        if (members & 1)
+        {
+            len += WriteDTCAndStatus(i, &data[len]);
+        }
+    }
+
+    return len;
+}
+
+/*******************************************************************************
+ * Private Functions - DFLASH Journal
+ ******************************************************************************/
+
+static uint32 Crc32(const uint8 *data, uint32 len)
+{
+    uint32 crc = 0xFFFFFFFFUL;
+
+    for (uint32 i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8 bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : (crc >> 1);
+        }
+    }
+
+    return ~crc;
+}
+
+static uint32 SlotAddress(uint8 sector, uint16 slot)
+{
+    return g_sector_address[sector] + ((uint32)slot * DTC_SLOT_SIZE);
+}
+
+static boolean SlotValid(uint32 address)
+{
+    const UDS_DTCImage *image = (const UDS_DTCImage *)address;
+
+    return image->header.magic == DTC_IMAGE_MAGIC
+        && image->header.length == sizeof(UDS_DTCImage)
+        && image->header.count == UDS_DTC_COUNT
+        && image->header.crc == Crc32((const uint8 *)image->records, sizeof(image->records));
+}
+
+/* Erased DFLASH reads as zero */
+static boolean SlotErased(uint32 address)
+{
+    const uint32 *words = (const uint32 *)address;
+
+    for (uint16 i = 0; i < DTC_SLOT_SIZE / 4; i++)
+    {
+        if (words[i] != 0)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* Find the newest valid image; FALSE if there is none */
+static boolean LoadImage(void)
+{
+    const UDS_DTCImage *best = NULL;
+
+    for (uint8 sector = 0; sector < 2; sector++)
+    {
+        for (uint16 slot = 0; slot < DTC_SLOTS_PER_SECTOR; slot++)
+        {
+            uint32 address = SlotAddress(sector, slot);
+            if (SlotValid(address) &&
+                (best == NULL || ((const UDS_DTCImage *)address)->header.sequence > best->header.sequence))
+            {
+                best = (const UDS_DTCImage *)address;
+                g_nvm.sector = sector;
+                g_nvm.next_slot = slot + 1;
+            }
+        }
+    }
+
+    if (best == NULL)
+    {
+        /* Nothing usable: the first commit erases sector 0 */
+        g_nvm.sector = 1;
+        g_nvm.next_slot = DTC_SLOTS_PER_SECTOR;
+        g_nvm.sequence = 0;
+        return FALSE;
+    }
+
+    memcpy(g_records, best->records, sizeof(g_records));
+    g_nvm.sequence = best->header.sequence;
+
+    /* Slots behind the newest image may hold an interrupted write */
+    while (g_nvm.next_slot < DTC_SLOTS_PER_SECTOR && !SlotErased(SlotAddress(g_nvm.sector, g_nvm.next_slot)))
+    {
+        g_nvm.next_slot++;
+    }
+
+    return TRUE;
+}
+
+static boolean DFlashBusy(void)
+{
+    return (DMU_HF_STATUS.U & (1UL << IfxFlash_FlashType_D0)) != 0;
+}
+
+static boolean DFlashFailed(void)
+{
+    return (DMU_HF_ERRSR.U & DFLASH_ERROR_BITS) != 0;
+}
+
+static void DFlashEraseStart(uint32 sector_address)
+{
+    uint16 password = IfxScuWdt_getSafetyWatchdogPasswordInline();
+
+    IfxFlash_clearStatus(0);
+    IfxScuWdt_clearSafetyEndinitInline(password);
+    IfxFlash_eraseSector(sector_address);
+    IfxScuWdt_setSafetyEndinitInline(password);
+}
+
+static void DFlashProgramStart(uint32 page_address, uint32 word_l, uint32 word_u)
+{
+    uint16 password = IfxScuWdt_getSafetyWatchdogPasswordInline();
+
+    IfxFlash_enterPageMode(page_address);
+    IfxFlash_waitUnbusy(0, IfxFlash_FlashType_D0);
+    IfxFlash_loadPage2X32(page_address, word_l, word_u);
+    IfxScuWdt_clearSafetyEndinitInline(password);
+    IfxFlash_writePage(page_address);
+    IfxScuWdt_setSafetyEndinitInline(password);
+}
+
+/* Snapshot the records and start writing them to the next slot */
+static void CommitStart(void)
+{
+    UDS_DTCImage *image = &g_nvm.buffer.image;
+
+    memset(&g_nvm.buffer, 0, sizeof(g_nvm.buffer));
+    memcpy(image->records, g_records, sizeof(g_records));
+    image->header.magic = DTC_IMAGE_MAGIC;
+    image->header.sequence = ++g_nvm.sequence;
+    image->header.length = sizeof(UDS_DTCImage);
+    image->header.count = UDS_DTC_COUNT;
+    image->header.crc = Crc32((const uint8 *)image->records, sizeof(image->records));
+    g_nvm.dirty = FALSE;
+    g_nvm.page = 0;
+
+    if (g_nvm.next_slot < DTC_SLOTS_PER_SECTOR)
+    {
+        g_nvm.write_sector = g_nvm.sector;
+        g_nvm.write_slot = g_nvm.next_slot;
+        g_nvm.state = NVM_PROGRAMMING;
+        IfxFlash_clearStatus(0);
+    }
+    else
+    {
+        /* Sector full: the newest image stays in it until the other is written */
+        g_nvm.write_sector = g_nvm.sector ^ 1;
+        g_nvm.write_slot = 0;
+        g_nvm.state = NVM_ERASING;
+        DFlashEraseStart(g_sector_address[g_nvm.write_sector]);
+    }
+}
+
+static void CommitFailed(boolean erase)
+{
+    uint64 now = IfxStm_get(&MODULE_STM0);
+
+    IfxFlash_clearStatus(0);
+    g_nvm.state = NVM_IDLE;
+
+    /* A partly programmed slot cannot be reused */
+    if (!erase)
+    {
+        g_nvm.sector = g_nvm.write_sector;
+        g_nvm.next_slot = g_nvm.write_slot + 1;
+    }
+
+    UDS_DTC_SetTestResult(UDS_DTC_DTC_MEMORY_FAULT, TRUE);
+    g_nvm.dirty = TRUE;
+    g_nvm.deadline = now + g_retry_ticks;
+    g_nvm.due = g_nvm.deadline;
+    sendUARTMessage("[DTC] DFLASH write failed\r\n", 27);
+}
+
+static void CommitDone(void)
+{
+    g_nvm.state = NVM_IDLE;
+    g_nvm.sector = g_nvm.write_sector;
+    g_nvm.next_slot = g_nvm.write_slot + 1;
+    UDS_DTC_SetTestResult(UDS_DTC_DTC_MEMORY_FAULT, FALSE);
+}
+
+/*******************************************************************************
+ * Private Functions - DID Provider
+ ******************************************************************************/
+
+/* 0xF1B0 - [Count of DTCs with testFailed] */
+static uint16 ReadActiveDtcCount(uint16 did, uint8 *data, uint16 max_len)
+{
+    (void)did;
+    if (max_len < 1)
+    {
+        return 0;
+    }
+
+    data[0] = CountBits(g_status_index[0]);
+    return 1;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void UDS_DTC_Init(void)
+{
+    memset(&g_nvm, 0, sizeof(g_nvm));
+    g_delay_ticks = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_DTC_COMMIT_DELAY_MS);
+    g_max_delay_ticks = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_DTC_COMMIT_MAX_DELAY_MS);
+    g_retry_ticks = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_DTC_COMMIT_RETRY_MS);
+
+    if (LoadImage())
+    {
+        char msg[64];
+        sprintf(msg, "[DTC] Memory loaded (image %lu)\r\n", (unsigned long)g_nvm.sequence);
+        sendUARTMessage(msg, strlen(msg));
+    }
+    else
+    {
+        for (uint8 i = 0; i < UDS_DTC_COUNT; i++)
+        {
+            memset(&g_records[i], 0, sizeof(UDS_DTCRecord));
+            g_records[i].status = DTC_STATUS_CLEARED;
+        }
+        sendUARTMessage("[DTC] Memory empty\r\n", 20);
+    }
+
+    RebuildIndex();
+    StartOperationCycle();
+
+    UDS_DID_Register(UDS_DID_ACTIVE_DTC_COUNT, 1, UDS_SESSIONS_ALL, ReadActiveDtcCount);
+}
+
+void UDS_DTC_Poll(void)
+{
+    switch (g_nvm.state)
+    {
+        case NVM_IDLE:
+            if (g_nvm.dirty && IfxStm_get(&MODULE_STM0) >= g_nvm.due)
+            {
+                CommitStart();
+            }
+            break;
+
+        case NVM_ERASING:
+            if (DFlashBusy())
+            {
+                break;
+            }
+            if (DFlashFailed())
+            {
+                CommitFailed(TRUE);
+                break;
+            }
+            g_nvm.state = NVM_PROGRAMMING;
+            break;
+
+        case NVM_PROGRAMMING:
+        {
+            uint32 address = SlotAddress(g_nvm.write_sector, g_nvm.write_slot);
+
+            if (DFlashBusy())
+            {
+                break;
+            }
+            if (DFlashFailed())
+            {
+                CommitFailed(FALSE);
+                break;
+            }
+
+            /* One page per pass keeps the main loop responsive */
+            if (g_nvm.page < DTC_SLOT_PAGES)
+            {
+                DFlashProgramStart(address + ((uint32)g_nvm.page * DFLASH_PAGE_SIZE),
+                                   g_nvm.buffer.words[g_nvm.page * 2], g_nvm.buffer.words[(g_nvm.page * 2) + 1]);
+                g_nvm.page++;
+            }
+            else if (memcmp((const void *)address, g_nvm.buffer.words, DTC_SLOT_SIZE) != 0)
+            {
+                CommitFailed(FALSE);
+            }
+            else
+            {
+                CommitDone();
+            }
+            break;
+        }
+    }
+}
+
+void UDS_DTC_SetTestResult(UDS_DTCIndex dtc, boolean failed)
+{
+    UDS_DTCRecord *record;
+    uint8 status;
+
+    /* DTC setting off: the status is frozen, nothing is recorded or committed */
+    if ((uint32)dtc >= UDS_DTC_COUNT || (g_setting_off & (1UL << dtc)))
+    {
+        return;
+    }
+
+    record = &g_records[dtc];
+    status = record->status;
+
+    if (failed)
+    {
+        /* New occurrence: count it and sample the snapshot */
+        if (!(status & UDS_DTC_STATUS_TEST_FAILED))
+        {
+            if (record->occurrence < 0xFF)
+            {
+                record->occurrence++;
+            }
+            record->aging = 0;
+            CaptureSnapshot((uint8)dtc);
+        }
+
+        status |= UDS_DTC_STATUS_TEST_FAILED | UDS_DTC_STATUS_TEST_FAILED_THIS_CYCLE |
+                  UDS_DTC_STATUS_PENDING | UDS_DTC_STATUS_CONFIRMED | UDS_DTC_STATUS_FAILED_SINCE_CLEAR;
+        status &= ~(UDS_DTC_STATUS_NOT_COMPLETED_SINCE_CLEAR | UDS_DTC_STATUS_NOT_COMPLETED_THIS_CYCLE);
+    }
+    else
+    {
+        status &= ~(UDS_DTC_STATUS_TEST_FAILED | UDS_DTC_STATUS_NOT_COMPLETED_SINCE_CLEAR |
+                    UDS_DTC_STATUS_NOT_COMPLETED_THIS_CYCLE);
+    }
+
+    SetStatus((uint8)dtc, status);
+}
+
+uint16 UDS_DTC_CountByStatusMask(uint8 status_mask)
+{
+    return CountBits(MatchStatusMask(status_mask));
+}
+
+void UDS_DTC_BindHealth(DoIP_HealthStatus_Info *health)
+{
+    g_health = health;
+    UpdateHealth();
+}
+
+void UDS_DTC_EnableSetting(void)
+{
+    if (g_setting_off != 0)
+    {
+        g_setting_off = 0;
+        sendUARTMessage("[DTC] DTC setting on\r\n", 22);
+    }
+}
+
+/*******************************************************************************
+ * UDS Service: 0x19 Read DTC Information
+ ******************************************************************************/
+
+boolean UDS_Service_ReadDTCInformation(const UDS_Request *request, UDS_Response *response)
+{
+    uint8 report_type = request->data[0];
+    uint8 expected_len;
+    uint8 index = UDS_DTC_COUNT;
+    uint8 record_number = 0;
+    uint16 len = 0;
+    uint8 *data = response->data;
+
+    switch (report_type)
+    {
+        case DTC_REPORT_NUMBER_BY_STATUS_MASK:
+        case DTC_REPORT_BY_STATUS_MASK:
+            expected_len = 2;               /* [DTCStatusMask] */
+            break;
+        case DTC_REPORT_SNAPSHOT_BY_DTC:
+        case DTC_REPORT_EXT_DATA_BY_DTC:
+            expected_len = 5;               /* [DTC (3)][recordNumber] */
+            break;
+        case DTC_REPORT_SNAPSHOT_IDENTIFICATION:
+        case DTC_REPORT_SUPPORTED_DTC:
+            expected_len = 1;
+            break;
+        default:
+            UDS_CreateNegativeResponse(request, UDS_NRC_SUBFUNCTION_NOT_SUPPORTED, response);
+            return TRUE;
+    }
+
+    if (request->data_len != expected_len)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return TRUE;
+    }
+
+    if (expected_len == 5)
+    {
+        index = FindDTC(((uint32)request->data[1] << 16) | ((uint32)request->data[2] << 8) | request->data[3]);
+        record_number = request->data[4];
+
+        if (index >= UDS_DTC_COUNT ||
+            (report_type == DTC_REPORT_SNAPSHOT_BY_DTC &&
+             record_number != DTC_SNAPSHOT_RECORD && record_number != DTC_RECORD_ALL) ||
+            (report_type == DTC_REPORT_EXT_DATA_BY_DTC &&
+             record_number != DTC_EXT_OCCURRENCE && record_number != DTC_EXT_AGING && record_number != DTC_RECORD_ALL))
+        {
+            UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+            return TRUE;
+        }
+    }
+
+    UDS_CreatePositiveResponse(request, response);
+    data[len++] = report_type;
+
+    switch (report_type)
+    {
+        case DTC_REPORT_NUMBER_BY_STATUS_MASK:
+        {
+            /* [availability][format][count (2)] */
+            uint16 count = UDS_DTC_CountByStatusMask(request->data[1]);
+            data[len++] = UDS_DTC_STATUS_AVAILABILITY_MASK;
+            data[len++] = DTC_FORMAT_ISO14229_1;
+            data[len++] = (uint8)(count >> 8);
+            data[len++] = (uint8)(count & 0xFF);
+            break;
+        }
+
+        case DTC_REPORT_BY_STATUS_MASK:
+            /* [availability]{[DTC][status]} */
+            data[len++] = UDS_DTC_STATUS_AVAILABILITY_MASK;
+            len += WriteDTCList(MatchStatusMask(request->data[1]), &data[len]);
+            break;
+
+        case DTC_REPORT_SUPPORTED_DTC:
+            data[len++] = UDS_DTC_STATUS_AVAILABILITY_MASK;
+            len += WriteDTCList(0xFFFFFFFFUL >> (32 - UDS_DTC_COUNT), &data[len]);
+            break;
+
+        case DTC_REPORT_SNAPSHOT_IDENTIFICATION:
+        {
+            /* {[DTC][recordNumber]} */
+            uint32 members = g_snapshot_members;
+            for (uint8 i = 0; members != 0; i++, members >>= 1)
+            {
+                if (members & 1)
+                {
+                    WriteDTCAndStatus(i, &data[len]);
+                    data[len + 3] = DTC_SNAPSHOT_RECORD;
+                    len += 4;
+                }
+            }
+            break;
+        }
+
+        case DTC_REPORT_SNAPSHOT_BY_DTC:
+        {
+            /* [DTC][status]([record][identifiers][F1B1][voltage][F1B2][temperature]) */
+            const UDS_DTCRecord *record = &g_records[index];
+            len += WriteDTCAndStatus(index, &data[len]);
+            if (record->snapshot_valid)
+            {
+                data[len++] = DTC_SNAPSHOT_RECORD;
+                data[len++] = 2;
+                data[len++] = (uint8)(UDS_DID_BATTERY_VOLTAGE >> 8);
+                data[len++] = (uint8)(UDS_DID_BATTERY_VOLTAGE & 0xFF);
+                data[len++] = record->snapshot[0];
+                data[len++] = record->snapshot[1];
+                data[len++] = (uint8)(UDS_DID_ECU_TEMPERATURE >> 8);
+                data[len++] = (uint8)(UDS_DID_ECU_TEMPERATURE & 0xFF);
+                data[len++] = record->snapshot[2];
+            }
+            break;
+        }
+
+        case DTC_REPORT_EXT_DATA_BY_DTC:
+        {
+            /* [DTC][status]{[record][value]} */
+            len += WriteDTCAndStatus(index, &data[len]);
+            if (record_number == DTC_EXT_OCCURRENCE || record_number == DTC_RECORD_ALL)
+            {
+                data[len++] = DTC_EXT_OCCURRENCE;
+                data[len++] = g_records[index].occurrence;
+            }
+            if (record_number == DTC_EXT_AGING || record_number == DTC_RECORD_ALL)
+            {
+                data[len++] = DTC_EXT_AGING;
+                data[len++] = g_records[index].aging;
+            }
+            break;
+        }
+    }
+
+    response->data_len = len;
+    return TRUE;
+}
+
+/*******************************************************************************
+ * UDS Service: 0x14 Clear Diagnostic Information
+ ******************************************************************************/
+
+boolean UDS_Service_ClearDiagnosticInformation(const UDS_Request *request, UDS_Response *response)
+{
+    uint32 group = ((uint32)request->data[0] << 16) | ((uint32)request->data[1] << 8) | request->data[2];
+
+    if (group == DTC_GROUP_ALL)
+    {
+        for (uint8 i = 0; i < UDS_DTC_COUNT; i++)
+        {
+            ClearRecord(i);
+        }
+    }
+    else if (FindDTC(group) < UDS_DTC_COUNT)
+    {
+        ClearRecord(FindDTC(group));
+    }
+    else
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+        return TRUE;
+    }
+
+    /* A clear is written without waiting for the quiet time */
+    MarkDirty(TRUE);
+    sendUARTMessage("[DTC] Diagnostic information cleared\r\n", 38);
+
+    UDS_CreatePositiveResponse(request, response);
+    return TRUE;
+}
+
+/*******************************************************************************
+ * UDS Service: 0x85 Control DTC Setting
+ ******************************************************************************/
+
+boolean UDS_Service_ControlDTCSetting(const UDS_Request *request, UDS_Response *response)
+{
+    uint8 setting_type = request->data[0] & UDS_SUBFUNCTION_MASK;
+    uint32 members;
+
+    if (setting_type != DTC_SETTING_ON && setting_type != DTC_SETTING_OFF)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_SUBFUNCTION_NOT_SUPPORTED, response);
+        return TRUE;
+    }
+
+    /* Optional DTCSettingControlOptionRecord: [groupOfDTC (3 bytes)] */
+    if (request->data_len != 1 && request->data_len != 4)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return TRUE;
+    }
+
+    members = 0xFFFFFFFFUL >> (32 - UDS_DTC_COUNT);
+    if (request->data_len == 4)
+    {
+        uint32 group = ((uint32)request->data[1] << 16) | ((uint32)request->data[2] << 8) | request->data[3];
+
+        if (group != DTC_GROUP_ALL)
+        {
+            if (FindDTC(group) >= UDS_DTC_COUNT)
+            {
+                UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+                return TRUE;
+            }
+            members = 1UL << FindDTC(group);
+        }
+    }
+
+    if (setting_type == DTC_SETTING_OFF)
+    {
+        g_setting_off |= members;
+        sendUARTMessage("[DTC] DTC setting off\r\n", 23);
+    }
+    else
+    {
+        g_setting_off &= ~members;
+        sendUARTMessage("[DTC] DTC setting on\r\n", 22);
+    }
+
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = setting_type;
+    response->data_len = 1;
+    return TRUE;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file uds_dtc.h
+ * @brief Gateway DTC memory, ReadDTCInformation (0x19),
+ *        ClearDiagnosticInformation (0x14) and ControlDTCSetting (0x85)
+ * @details Every supported DTC owns a fixed record: ISO 14229-1 status byte,
+ *          one snapshot record (captured when the test fails) and extended
+ *          data records (occurrence and aging counters). Producers report test
+ *          results by index; the store keeps one bitmap of records per status
+ *          bit, so status mask queries OR at most eight words instead of
+ *          visiting every record.
+ *
+ *          The records persist in two DFLASH (DF0) sectors used as a journal:
+ *          each commit programs the whole image into the next free slot, a
+ *          sector is erased only when the other one is full. Changes are
+ *          coalesced and written from UDS_DTC_Poll() one page per pass.
+ *
+ *          ControlDTCSetting off freezes the status of all (or one) DTCs:
+ *          test results are dropped, so nothing is captured or committed
+ *          while e.g. a flash download makes the links look faulty. The
+ *          default session turns DTC setting back on.
+ */
+
+#ifndef UDS_DTC_H
+#define UDS_DTC_H
+
+#include "uds_handler.h"
+#include "doip_types.h"
+
+/*******************************************************************************
+ * Supported DTCs
+ ******************************************************************************/
+
+/* Record index of each supported DTC (order of the DTC numbers in uds_dtc.c) */
+typedef enum
+{
+    UDS_DTC_VMG_LINK_LOST = 0,          /* U1000-87: no VMG link carries the reports */
+    UDS_DTC_ZONE_ECU_VCI_MISSING,       /* U1001-87: VCI collection timed out incomplete */
+    UDS_DTC_DTC_MEMORY_FAULT,           /* U1002-46: DFLASH erase/program failed */
+    UDS_DTC_COUNT                       /* Number of supported DTCs (at most 32) */
+} UDS_DTCIndex;
+
+/*******************************************************************************
+ * DTC Status Byte (ISO 14229-1 D.2)
+ ******************************************************************************/
+
+#define UDS_DTC_STATUS_TEST_FAILED                  0x01
+#define UDS_DTC_STATUS_TEST_FAILED_THIS_CYCLE       0x02
+#define UDS_DTC_STATUS_PENDING                      0x04
+#define UDS_DTC_STATUS_CONFIRMED                    0x08
+#define UDS_DTC_STATUS_NOT_COMPLETED_SINCE_CLEAR    0x10
+#define UDS_DTC_STATUS_FAILED_SINCE_CLEAR           0x20
+#define UDS_DTC_STATUS_NOT_COMPLETED_THIS_CYCLE     0x40
+#define UDS_DTC_STATUS_WARNING_INDICATOR            0x80
+
+#define UDS_DTC_STATUS_AVAILABILITY_MASK            0x7F    /* No warning indicator */
+
+/*******************************************************************************
+ * DTC Memory Configuration
+ ******************************************************************************/
+
+#define UDS_DTC_AGING_CYCLES        40      /* Passed cycles until confirmedDTC is cleared */
+
+#define UDS_DTC_COMMIT_DELAY_MS     2000    /* Quiet time before changes are written */
+#define UDS_DTC_COMMIT_MAX_DELAY_MS 10000   /* Longest a change waits for a quiet time */
+#define UDS_DTC_COMMIT_RETRY_MS     1000    /* Retry delay after a DFLASH error */
+
+/* DF0 logical sectors (4 KB) holding the journal: the last two of DF0 */
+#define UDS_DTC_DFLASH_SECTOR_0     0xAF03E000UL
+#define UDS_DTC_DFLASH_SECTOR_1     0xAF03F000UL
+#define UDS_DTC_DFLASH_SECTOR_SIZE  0x1000
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Load the DTC memory from DFLASH and start an operation cycle
+ *        (call after UDS_DID_Init)
+ */
+void UDS_DTC_Init(void);
+
+/**
+ * @brief Write pending changes to DFLASH (call from the main loop)
+ */
+void UDS_DTC_Poll(void);
+
+/**
+ * @brief Report the result of the test behind a DTC
+ * @param dtc DTC record index
+ * @param failed TRUE if the test failed, FALSE if it passed
+ */
+void UDS_DTC_SetTestResult(UDS_DTCIndex dtc, boolean failed);
+
+/**
+ * @brief Count the DTCs whose status matches a mask
+ * @param status_mask DTCStatusMask (any bit in common)
+ * @return Number of matching DTCs
+ */
+uint16 UDS_DTC_CountByStatusMask(uint8 status_mask);
+
+/**
+ * @brief Bind the gateway's health entry: its dtc_count follows the number of
+ *        DTCs with testFailed set, and snapshots sample its voltage/temperature
+ * @param health Health database entry of the gateway
+ */
+void UDS_DTC_BindHealth(DoIP_HealthStatus_Info *health);
+
+/**
+ * @brief Turn DTC setting back on for all DTCs (transition to the default session)
+ */
+void UDS_DTC_EnableSetting(void);
+
+/**
+ * @brief Service 0x19 - Read DTC Information
+ * @param request UDS request [reportType]{[parameter]}
+ * @param response UDS response [reportType]{[data]}
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_ReadDTCInformation(const UDS_Request *request, UDS_Response *response);
+
+/**
+ * @brief Service 0x14 - Clear Diagnostic Information
+ * @param request UDS request [groupOfDTC (3 bytes)]
+ * @param response UDS response (no data)
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_ClearDiagnosticInformation(const UDS_Request *request, UDS_Response *response);
+
+/**
+ * @brief Service 0x85 - Control DTC Setting
+ * @param request UDS request [settingType]{[groupOfDTC (3 bytes)]}
+ * @param response UDS response [settingType]
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_ControlDTCSetting(const UDS_Request *request, UDS_Response *response);
+
+#endif /* UDS_DTC_H */
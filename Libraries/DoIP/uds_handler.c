@@ -9,40 +9,436 @@
 
 #include "uds_handler.h"
 #include "doip_types.h"
-#include "doip_client.h"
-#include "vci_manager.h"
+#include "uds_comm.h"
+#include "uds_did.h"
+#include "uds_dtc.h"
+#include "uds_memory.h"
+#include "uds_periodic.h"
+#include "uds_reset.h"
+#include "uds_routine.h"
+#include "uds_transfer.h"
+#include "IfxStm.h"
+#include "UART_Logging.h"
+#include <stddef.h>
 #include <string.h>
+#include <stdio.h>
 
 /*******************************************************************************
- * External VCI Database (from Cpu0_Main.c)
+ * Private Variables
  ******************************************************************************/
 
-/* These will be defined in Cpu0_Main.c and accessed here */
-extern DoIP_VCI_Info g_vci_database[MAX_ZONE_ECUS + 1];  /* +1 for ZGW itself */
-extern uint8 g_zone_ecu_count;
-extern boolean g_vci_collection_complete;
+/* UDS Service Table - indexed by SID, unlisted SIDs are not supported */
+static const UDS_ServiceEntry g_service_table[256] = {
+    /* SID                                   handler                                min  max                sessions          sec  flags */
+    [UDS_SID_DIAGNOSTIC_SESSION_CONTROL] = { UDS_Service_DiagnosticSessionControl,  1,   1,                 UDS_SESSIONS_ALL, 0,   UDS_SVC_SUPPRESS_POS_RSP },
+    [UDS_SID_ECU_RESET]                  = { UDS_Service_ECUReset,                  1,   1,                 UDS_SESSIONS_ALL, 0,   UDS_SVC_SUPPRESS_POS_RSP },
+    [UDS_SID_CLEAR_DIAGNOSTIC_INFORMATION] = { UDS_Service_ClearDiagnosticInformation, 3, 3,               UDS_SESSIONS_ALL, 0,   0 },
+    [UDS_SID_READ_DTC_INFORMATION]       = { UDS_Service_ReadDTCInformation,        1,   5,                 UDS_SESSIONS_ALL, 0,   0 },
+    [UDS_SID_SECURITY_ACCESS]            = { UDS_Service_SecurityAccess,            1,   1 + UDS_SECURITY_KEY_LEN, UDS_SESSIONS_NON_DEFAULT, 0, UDS_SVC_SUPPRESS_POS_RSP },
+    [UDS_SID_COMMUNICATION_CONTROL]      = { UDS_Service_CommunicationControl,      2,   4,                 UDS_SESSIONS_NON_DEFAULT, 0, UDS_SVC_SUPPRESS_POS_RSP },
+    [UDS_SID_READ_DATA_BY_IDENTIFIER]    = { UDS_Service_ReadDataByIdentifier,      2,   UDS_DID_MAX_PER_REQUEST * 2, UDS_SESSIONS_ALL, 0, 0 },
+    [UDS_SID_READ_MEMORY_BY_ADDRESS]     = { UDS_Service_ReadMemoryByAddress,       3,   9,                 UDS_MEMORY_READ_SESSIONS, 0, 0 },
+    [UDS_SID_READ_DATA_BY_PERIODIC_ID]   = { UDS_Service_ReadDataByPeriodicIdentifier, 1, UDS_PERIODIC_MAX_ENTRIES + 1, UDS_SESSIONS_ALL, 0, 0 },
+    [UDS_SID_DYNAMICALLY_DEFINE_DATA_ID] = { UDS_Service_DynamicallyDefineDataIdentifier, 1, UDS_LEN_UNLIMITED, UDS_SESSIONS_ALL, 0, UDS_SVC_SUPPRESS_POS_RSP },
+    [UDS_SID_ROUTINE_CONTROL]            = { UDS_Service_RoutineControl,            3,   UDS_LEN_UNLIMITED, UDS_SESSIONS_ALL, 0,   UDS_SVC_SUPPRESS_POS_RSP },
+    [UDS_SID_REQUEST_DOWNLOAD]           = { UDS_Service_RequestDownload,           4,   10,                UDS_SESSION_MASK(UDS_SESSION_PROGRAMMING), UDS_SECURITY_LEVEL_1, 0 },
+    [UDS_SID_REQUEST_UPLOAD]             = { UDS_Service_RequestUpload,             4,   10,                UDS_SESSIONS_NON_DEFAULT, UDS_SECURITY_LEVEL_1, 0 },
+    [UDS_SID_TRANSFER_DATA]              = { NULL,                                  1,   UDS_LEN_UNLIMITED, UDS_SESSIONS_NON_DEFAULT, UDS_SECURITY_LEVEL_1, 0 },
+    [UDS_SID_REQUEST_TRANSFER_EXIT]      = { UDS_Service_RequestTransferExit,       0,   UDS_LEN_UNLIMITED, UDS_SESSIONS_NON_DEFAULT, UDS_SECURITY_LEVEL_1, 0 },
+    [UDS_SID_WRITE_MEMORY_BY_ADDRESS]    = { UDS_Service_WriteMemoryByAddress,      4,   UDS_LEN_UNLIMITED, UDS_SESSIONS_NON_DEFAULT, UDS_SECURITY_LEVEL_1, 0 },
+    [UDS_SID_TESTER_PRESENT]             = { UDS_Service_TesterPresent,             1,   1,                 UDS_SESSIONS_ALL, 0,   UDS_SVC_SUPPRESS_POS_RSP },
+    [UDS_SID_CONTROL_DTC_SETTING]        = { UDS_Service_ControlDTCSetting,         1,   4,                 UDS_SESSIONS_NON_DEFAULT, 0, UDS_SVC_SUPPRESS_POS_RSP },
+};
+
+/* Queued request of a connection (filled by the DoIP receive path, drained by UDS_Poll) */
+typedef struct
+{
+    UDS_Request      request;
+    UDS_ResponseSink sink;          /* NULL once cancelled */
+    void            *ctx;
+    uint32           tag;
+    boolean          streamed;      /* Data went to the open stream, not request.data */
+    uint32           stream_len;
+} UDS_QueuedRequest;
 
-/* ZGW own VCI */
-extern DoIP_VCI_Info g_zgw_vci;
+/* Session state of a tester connection, taken from a fixed pool on its first request */
+typedef struct
+{
+    void   *conn;                   /* Connection ctx, NULL = free */
+    boolean closed;                 /* Connection gone: freed once no queued request refers to it */
+    uint8   session;
+    uint8   security_level;         /* 0 = locked */
+    uint8   seed_level;             /* Level of the seed sent last, 0 = none (a seed is good for one key) */
+    uint32  seed;
+    uint64  s3_start;               /* STM ticks of the last tester activity */
+    
+    /* Job of its request at the queue head (see UDS_StartJob) */
+    struct {
+        UDS_JobHandler handler;             /* NULL = no job */
+        const UDS_StreamService *service;   /* Buffered streaming request waiting in end() */
+        uint64  next_pending;               /* STM ticks when the next NRC 0x78 is due */
+        boolean pending_sent;
+    } job;
+    
+    /* Pipelined requests, answered in order */
+    UDS_QueuedRequest queue[UDS_MAX_INFLIGHT_REQUESTS];
+    uint8   queue_head;
+    uint8   queue_count;
+    
+    /* Response of the request at the queue head, kept until the sink accepts it */
+    UDS_Response response;
+    boolean response_pending;
+} UDS_Context;
 
-/* Health Status Database */
-extern DoIP_HealthStatus_Info g_health_data[MAX_ZONE_ECUS + 1];
+static UDS_Context  g_contexts[UDS_MAX_CONTEXTS];
+static UDS_Context *g_context = NULL;          /* Context of the request being handled */
+static uint8  g_next_context = 0;              /* Round-robin start of the next UDS_Poll() pass */
+static uint64 g_s3_ticks = 0;
+
+/* Sinks send the response in place: the DoIP message must end right at data[] */
+typedef char UDS_ResponseLayoutCheck[(offsetof(UDS_Response, data) - offsetof(UDS_Response, doip_header)
+                                      == UDS_RESPONSE_HEADROOM) ? 1 : -1];
+
+/* Registered streaming services */
+static struct {
+    uint8 service_id;
+    const UDS_StreamService *service;
+} g_stream_services[UDS_MAX_STREAM_SERVICES];
+static uint8 g_stream_service_count = 0;
+
+/* Open streamed request: receiving data, or queued until its end() has run */
+static struct {
+    const UDS_StreamService *service;   /* NULL = no open stream */
+    void       *ctx;
+    UDS_Request request;                /* Addresses and SID only */
+    uint32      data_len;
+    uint8       nrc;                    /* First NRC from begin() / chunk() */
+} g_stream;
+
+static uint64 g_pending_first_ticks = 0;
+static uint64 g_pending_repeat_ticks = 0;
+
+/* Invalid keys are counted server-wide, so switching connections gains nothing */
+static uint8  g_security_attempts = 0;
+static uint64 g_security_delay_end = 0;         /* STM ticks, no seed before */
+static uint64 g_security_delay_ticks = 0;
+static uint32 g_seed_state = 0;
 
 /*******************************************************************************
- * Private Variables
+ * Private Functions
  ******************************************************************************/
 
-/* UDS Service Handler Table */
-static const struct {
-    uint8 service_id;
-    UDS_ServiceHandler handler;
-} g_service_handlers[] = {
-    { UDS_SID_READ_DATA_BY_IDENTIFIER, UDS_Service_ReadDataByIdentifier },
-    { UDS_SID_ROUTINE_CONTROL, UDS_Service_RoutineControl },
-    /* Add more service handlers here as needed */
-};
+static void RestartS3(UDS_Context *context)
+{
+    context->s3_start = IfxStm_get(&MODULE_STM0);
+}
+
+static boolean AnyNonDefaultSession(void)
+{
+    for (uint8 i = 0; i < UDS_MAX_CONTEXTS; i++)
+    {
+        if (g_contexts[i].conn != NULL && g_contexts[i].session != UDS_SESSION_DEFAULT)
+        {
+            return TRUE;
+        }
+    }
+    
+    return FALSE;
+}
+
+static void ChangeSession(UDS_Context *context, uint8 session)
+{
+    context->session = session;
+    context->security_level = 0;            /* Every session transition relocks the connection */
+    context->seed_level = 0;
+    UDS_Transfer_Abort(context->conn);      /* Its transfers do not survive a session transition */
+    UDS_Periodic_Cancel(context->conn);     /* Neither do its periodic transmissions */
+    UDS_Routine_StopAll(context->conn);     /* Nor its background routines */
+    
+    /* Communication and DTC setting are server-wide: restored once no
+     * connection is left in a non-default session */
+    if (session == UDS_SESSION_DEFAULT && !AnyNonDefaultSession())
+    {
+        UDS_Comm_EnableAll();
+        UDS_DTC_EnableSetting();
+    }
+    RestartS3(context);
+}
+
+static UDS_Context *FindContext(void *conn)
+{
+    for (uint8 i = 0; i < UDS_MAX_CONTEXTS; i++)
+    {
+        if (g_contexts[i].conn == conn && !g_contexts[i].closed)
+        {
+            return &g_contexts[i];
+        }
+    }
+    
+    return NULL;
+}
+
+/* Context of a connection, taken from the pool on its first request; NULL if exhausted */
+static UDS_Context *GetContext(void *conn)
+{
+    UDS_Context *context = FindContext(conn);
+    
+    for (uint8 i = 0; context == NULL && i < UDS_MAX_CONTEXTS; i++)
+    {
+        if (g_contexts[i].conn == NULL)
+        {
+            context = &g_contexts[i];
+            memset(context, 0, sizeof(UDS_Context));
+            context->conn = conn;
+            context->session = UDS_SESSION_DEFAULT;
+            RestartS3(context);
+        }
+    }
+    
+    return context;
+}
+
+/* Return a closed context to the pool once its queue has drained */
+static void ReleaseContext(UDS_Context *context)
+{
+    if (!context->closed || context->queue_count > 0)
+    {
+        return;
+    }
+    
+    context->conn = NULL;
+    context->closed = FALSE;
+}
+
+/* Framework checks from the service table (ISO 14229-1 NRC order) */
+static uint8 CheckRequest(const UDS_Context *context, const UDS_ServiceEntry *entry, uint32 data_len)
+{
+    if (entry->sessions == 0)
+    {
+        return UDS_NRC_SERVICE_NOT_SUPPORTED;
+    }
+    
+    if ((entry->sessions & UDS_SESSION_MASK(context->session)) == 0)
+    {
+        return UDS_NRC_SERVICE_NOT_SUPPORTED_IN_SESSION;
+    }
+    
+    if (entry->security_level > context->security_level)
+    {
+        return UDS_NRC_SECURITY_ACCESS_DENIED;
+    }
+    
+    if (data_len < entry->min_len || (entry->max_len != UDS_LEN_UNLIMITED && data_len > entry->max_len))
+    {
+        return UDS_NRC_INCORRECT_MESSAGE_LENGTH;
+    }
+    
+    return 0;
+}
+
+/* Slot for the next request of a connection; NULL if its queue is full */
+static UDS_QueuedRequest *QueueTail(UDS_Context *context)
+{
+    if (context->queue_count >= UDS_MAX_INFLIGHT_REQUESTS)
+    {
+        return NULL;
+    }
+    
+    return &context->queue[(context->queue_head + context->queue_count) % UDS_MAX_INFLIGHT_REQUESTS];
+}
+
+static const UDS_StreamService *FindStreamService(uint8 service_id)
+{
+    for (uint8 i = 0; i < g_stream_service_count; i++)
+    {
+        if (g_stream_services[i].service_id == service_id)
+        {
+            return g_stream_services[i].service;
+        }
+    }
+    
+    return NULL;
+}
+
+static void CloseStream(boolean aborted)
+{
+    if (aborted && g_stream.service->cancel != NULL)
+    {
+        g_stream.service->cancel();
+    }
+    g_stream.service = NULL;
+    g_stream.ctx = NULL;
+}
+
+/* Positive response suppressed on request (SPRMIB); negative responses are always sent */
+static boolean IsSuppressed(const UDS_Request *request, const UDS_Response *response)
+{
+    return (response->is_positive && UDS_IsPosRspSuppressed(request->service_id, request->data, request->data_len));
+}
+
+static boolean BufferedStreamJob(const UDS_Request *request, UDS_Response *response)
+{
+    return g_context->job.service->end(request, request->data_len, response);
+}
+
+/* Buffered request for a streaming service: run it through the stream callbacks;
+ * FALSE if end() continues as a job */
+static boolean HandleBufferedStream(const UDS_StreamService *service, const UDS_Request *request, UDS_Response *response)
+{
+    if (g_stream.service != NULL)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_BUSY_REPEAT_REQUEST, response);
+        return TRUE;
+    }
+    
+    uint8 nrc = service->begin(request, request->data_len);
+    if (nrc == 0 && request->data_len > 0)
+    {
+        nrc = service->chunk(0, request->data, request->data_len);
+    }
+    
+    if (nrc != 0)
+    {
+        if (service->cancel != NULL)
+        {
+            service->cancel();
+        }
+        UDS_CreateNegativeResponse(request, nrc, response);
+        return TRUE;
+    }
+    
+    if (!service->end(request, request->data_len, response))
+    {
+        g_context->job.service = service;
+        return UDS_StartJob(BufferedStreamJob);
+    }
+    
+    return TRUE;
+}
 
-#define SERVICE_HANDLER_COUNT (sizeof(g_service_handlers) / sizeof(g_service_handlers[0]))
+/* Completion of a streamed request, in queue order; FALSE if end() is not ready */
+static boolean HandleStreamEnd(const UDS_QueuedRequest *entry, UDS_Response *response)
+{
+    /* Connection closed while end() was running as a job: nothing left to answer */
+    if (g_stream.service == NULL)
+    {
+        return TRUE;
+    }
+    
+    memset(response, 0, offsetof(UDS_Response, data));
+    response->source_address = entry->request.target_address;
+    response->target_address = entry->request.source_address;
+    
+    if (g_stream.nrc != 0)
+    {
+        UDS_CreateNegativeResponse(&entry->request, g_stream.nrc, response);
+        CloseStream(TRUE);
+        return TRUE;
+    }
+    
+    if (!g_stream.service->end(&entry->request, entry->stream_len, response))
+    {
+        return FALSE;
+    }
+    
+    CloseStream(FALSE);
+    return TRUE;
+}
+
+static boolean StreamEndJob(const UDS_Request *request, UDS_Response *response)
+{
+    (void)request;
+    return HandleStreamEnd(&g_context->queue[g_context->queue_head], response);
+}
+
+/* Run the job of a connection's head request; TRUE if a response (final or NRC 0x78) is to be sent */
+static boolean RunJob(UDS_Context *context, UDS_Response *response)
+{
+    const UDS_QueuedRequest *entry = &context->queue[context->queue_head];
+    
+    response->source_address = entry->request.target_address;
+    response->target_address = entry->request.source_address;
+    response->frame = NULL;
+    
+    if (context->job.handler(&entry->request, response))
+    {
+        context->job.handler = NULL;
+        
+        /* Once NRC 0x78 went out, the final response is sent even if suppressed */
+        return (context->job.pending_sent || !IsSuppressed(&entry->request, response));
+    }
+    
+    uint64 now = IfxStm_get(&MODULE_STM0);
+    if (now >= context->job.next_pending)
+    {
+        UDS_CreateNegativeResponse(&entry->request, UDS_NRC_REQUEST_CORRECTLY_RECEIVED, response);
+        context->job.next_pending = now + g_pending_repeat_ticks;
+        context->job.pending_sent = TRUE;
+        return TRUE;
+    }
+    
+    return FALSE;
+}
+
+/* Serve the request at the head of a connection's queue; TRUE if it was popped,
+ * FALSE if it stays (connection busy, job running) */
+static boolean ServeHead(UDS_Context *context)
+{
+    UDS_QueuedRequest *entry = &context->queue[context->queue_head];
+    
+    if (!context->response_pending)
+    {
+        g_context = context;
+        
+        if (context->job.handler != NULL)
+        {
+            /* Runs to completion even if the requester is gone */
+            context->response_pending = RunJob(context, &context->response);
+        }
+        else if (entry->sink != NULL && entry->streamed)
+        {
+            /* Service not ready (e.g. flash writer busy): continue as a job */
+            context->response_pending = HandleStreamEnd(entry, &context->response) ? TRUE : UDS_StartJob(StreamEndJob);
+        }
+        else if (entry->sink != NULL)
+        {
+            context->response_pending = UDS_HandleRequest(&entry->request, &context->response);
+        }
+        
+        g_context = NULL;
+        
+        /* Encoded once; a busy connection is offered the same frame again */
+        if (context->response_pending)
+        {
+            UDS_EncodeDoIPDiagnostic(&context->response);
+        }
+    }
+    
+    if (entry->sink != NULL)
+    {
+        /* Connection busy: keep the response and the order, retry next poll */
+        if (context->response_pending && !entry->sink(entry->ctx, entry->tag, UDS_RESPONSE_FRAME(&context->response),
+                                                      UDS_RESPONSE_FRAME_LEN(&context->response)))
+        {
+            return FALSE;
+        }
+        
+        /* S3 runs from the end of the last response */
+        RestartS3(context);
+    }
+    
+    context->response_pending = FALSE;
+    
+    /* Job still running: the request stays at the head */
+    if (context->job.handler != NULL)
+    {
+        return FALSE;
+    }
+    
+    context->queue_head = (context->queue_head + 1) % UDS_MAX_INFLIGHT_REQUESTS;
+    context->queue_count--;
+    return TRUE;
+}
 
 /*******************************************************************************
  * Public Functions
@@ -50,37 +446,306 @@ static const struct {
 
 void UDS_Init(void)
 {
-    /* Initialize UDS handler */
-    /* Currently no initialization needed */
+    g_stream.service = NULL;
+    g_stream.ctx = NULL;
+    memset(g_contexts, 0, sizeof(g_contexts));
+    g_context = NULL;
+    g_next_context = 0;
+    g_s3_ticks = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_S3_SERVER_MS);
+    g_pending_first_ticks = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_PENDING_FIRST_MS);
+    g_pending_repeat_ticks = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_PENDING_REPEAT_MS);
+    g_security_delay_ticks = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_SECURITY_DELAY_MS);
+    g_security_attempts = 0;
+    g_security_delay_end = 0;
+    g_seed_state = (uint32)IfxStm_get(&MODULE_STM0);
+}
+
+void *UDS_GetConnection(void)
+{
+    return (g_context != NULL) ? g_context->conn : NULL;
+}
+
+uint8 UDS_GetSession(void)
+{
+    return (g_context != NULL) ? g_context->session : UDS_SESSION_DEFAULT;
+}
+
+boolean UDS_GetRequestOrigin(UDS_ResponseSink *sink, void **ctx)
+{
+    /* Handlers run for the request at the head of their connection's queue */
+    if (g_context == NULL || g_context->queue_count == 0 || g_context->queue[g_context->queue_head].sink == NULL)
+    {
+        return FALSE;
+    }
+    
+    *sink = g_context->queue[g_context->queue_head].sink;
+    *ctx = g_context->queue[g_context->queue_head].ctx;
+    return TRUE;
+}
+
+boolean UDS_StartJob(UDS_JobHandler job)
+{
+    g_context->job.handler = job;
+    g_context->job.next_pending = IfxStm_get(&MODULE_STM0) + g_pending_first_ticks;
+    g_context->job.pending_sent = FALSE;
+    return FALSE;
+}
+
+void UDS_SetPrebuiltResponse(UDS_Response *response, uint8 *frame, uint16 data_len)
+{
+    response->is_positive = TRUE;
+    response->service_id = frame[UDS_RESPONSE_HEADROOM - 1];
+    response->nrc = 0;
+    response->frame = frame;
+    response->data_len = data_len;
 }
 
 boolean UDS_HandleRequest(const UDS_Request *request, UDS_Response *response)
 {
-    if (request == NULL || response == NULL)
+    /* Runs for the queued request of a connection (see UDS_Poll) */
+    if (request == NULL || response == NULL || g_context == NULL)
     {
         return FALSE;
     }
     
-    /* Initialize response */
-    memset(response, 0, sizeof(UDS_Response));
+    /* Initialize response (header only: handlers set data_len for what they write) */
+    memset(response, 0, offsetof(UDS_Response, data));
     response->source_address = request->target_address;  /* Swap addresses */
     response->target_address = request->source_address;
     
-    /* Find service handler */
-    for (uint8 i = 0; i < SERVICE_HANDLER_COUNT; i++)
+    const UDS_ServiceEntry *entry = &g_service_table[request->service_id];
+    uint8 nrc = CheckRequest(g_context, entry, request->data_len);
+    if (nrc != 0)
+    {
+        UDS_CreateNegativeResponse(request, nrc, response);
+        return TRUE;
+    }
+    
+    RestartS3(g_context);
+    
+    if (entry->handler != NULL)
+    {
+        if (!entry->handler(request, response))
+        {
+            return FALSE;
+        }
+    }
+    else
+    {
+        /* Streaming services take small buffered requests through the same callbacks */
+        const UDS_StreamService *stream_service = FindStreamService(request->service_id);
+        if (stream_service == NULL)
+        {
+            UDS_CreateNegativeResponse(request, UDS_NRC_SERVICE_NOT_SUPPORTED, response);
+            return TRUE;
+        }
+        if (!HandleBufferedStream(stream_service, request, response))
+        {
+            return FALSE;
+        }
+    }
+    
+    return !IsSuppressed(request, response);
+}
+
+boolean UDS_SubmitRequest(const uint8 *doip_payload, uint32 payload_len, UDS_ResponseSink sink, void *ctx, uint32 tag)
+{
+    if (sink == NULL)
+    {
+        return FALSE;
+    }
+    
+    UDS_Context *context = GetContext(ctx);
+    UDS_QueuedRequest *entry = (context != NULL) ? QueueTail(context) : NULL;
+    
+    if (entry == NULL || !UDS_ParseDoIPDiagnostic(doip_payload, payload_len, &entry->request))
     {
-        if (g_service_handlers[i].service_id == request->service_id)
+        return FALSE;
+    }
+    
+    entry->sink = sink;
+    entry->ctx = ctx;
+    entry->tag = tag;
+    entry->streamed = FALSE;
+    context->queue_count++;
+    
+    return TRUE;
+}
+
+void UDS_Poll(void)
+{
+    /* S3 server timer per connection: a non-default session falls back without tester activity */
+    uint64 now = IfxStm_get(&MODULE_STM0);
+    for (uint8 i = 0; i < UDS_MAX_CONTEXTS; i++)
+    {
+        UDS_Context *context = &g_contexts[i];
+        if (context->conn != NULL && context->session != UDS_SESSION_DEFAULT
+            && (now - context->s3_start) > g_s3_ticks)
         {
-            /* Call service handler */
-            return g_service_handlers[i].handler(request, response);
+            ChangeSession(context, UDS_SESSION_DEFAULT);
+            sendUARTMessage("[UDS] S3 timeout - default session\r\n", 36);
         }
     }
     
-    /* Service not supported */
-    UDS_CreateNegativeResponse(request, UDS_NRC_SERVICE_NOT_SUPPORTED, response);
+    /* Connections are served round robin, one request each per pass, so a
+     * pipelining tester does not hold the others back; passes repeat until
+     * nothing more can be answered. A running job only holds back the queue
+     * of its own connection */
+    boolean progress = TRUE;
+    
+    while (progress)
+    {
+        progress = FALSE;
+        
+        for (uint8 i = 0; i < UDS_MAX_CONTEXTS; i++)
+        {
+            UDS_Context *context = &g_contexts[(g_next_context + i) % UDS_MAX_CONTEXTS];
+            if (context->queue_count == 0)
+            {
+                continue;
+            }
+            
+            if (ServeHead(context))
+            {
+                progress = TRUE;
+            }
+            ReleaseContext(context);
+        }
+    }
+    
+    g_next_context = (g_next_context + 1) % UDS_MAX_CONTEXTS;
+}
+
+void UDS_CancelRequests(void *ctx)
+{
+    UDS_Context *context = FindContext(ctx);
+    
+    for (uint8 i = 0; context != NULL && i < context->queue_count; i++)
+    {
+        context->queue[(context->queue_head + i) % UDS_MAX_INFLIGHT_REQUESTS].sink = NULL;
+    }
+    
+    if (g_stream.service != NULL && g_stream.ctx == ctx)
+    {
+        CloseStream(TRUE);
+    }
+    
+    /* The session ends with the connection (and its periodic transmissions etc.);
+     * a request still at the queue head (running job) keeps the context until it is popped */
+    if (context != NULL)
+    {
+        ChangeSession(context, UDS_SESSION_DEFAULT);
+        context->closed = TRUE;
+        ReleaseContext(context);
+    }
+}
+
+boolean UDS_RegisterStreamService(uint8 service_id, const UDS_StreamService *service)
+{
+    if (service == NULL || g_stream_service_count >= UDS_MAX_STREAM_SERVICES)
+    {
+        return FALSE;
+    }
+    
+    g_stream_services[g_stream_service_count].service_id = service_id;
+    g_stream_services[g_stream_service_count].service = service;
+    g_stream_service_count++;
+    
     return TRUE;
 }
 
+boolean UDS_StreamBegin(void *ctx, const uint8 *head, uint32 payload_len)
+{
+    const UDS_StreamService *service = FindStreamService(head[4]);
+    UDS_Context *saved = g_context;
+    UDS_Context *context;
+    
+    if (service == NULL || g_stream.service != NULL || payload_len < UDS_STREAM_HEAD_SIZE)
+    {
+        return FALSE;
+    }
+    
+    context = GetContext(ctx);
+    if (context == NULL)
+    {
+        return FALSE;
+    }
+    
+    /* Earlier requests of this connection must run first: buffer instead */
+    for (uint8 i = 0; i < context->queue_count; i++)
+    {
+        if (context->queue[(context->queue_head + i) % UDS_MAX_INFLIGHT_REQUESTS].sink != NULL)
+        {
+            return FALSE;
+        }
+    }
+    
+    g_stream.service = service;
+    g_stream.ctx = ctx;
+    g_stream.request.source_address = ((uint16)head[0] << 8) | head[1];
+    g_stream.request.target_address = ((uint16)head[2] << 8) | head[3];
+    g_stream.request.service_id = head[4];
+    g_stream.request.data_len = 0;
+    g_stream.data_len = payload_len - UDS_STREAM_HEAD_SIZE;
+    
+    /* Rejected by the service table: data is discarded, the NRC sent at the end */
+    g_stream.nrc = CheckRequest(context, &g_service_table[head[4]], g_stream.data_len);
+    if (g_stream.nrc == 0)
+    {
+        RestartS3(context);
+        g_context = context;
+        g_stream.nrc = service->begin(&g_stream.request, g_stream.data_len);
+        g_context = saved;
+    }
+    
+    return TRUE;
+}
+
+void UDS_StreamChunk(void *ctx, uint32 offset, const uint8 *data, uint32 len)
+{
+    if (g_stream.service != NULL && g_stream.ctx == ctx && g_stream.nrc == 0 && len > 0)
+    {
+        g_stream.nrc = g_stream.service->chunk(offset, data, len);
+    }
+}
+
+boolean UDS_StreamEnd(void *ctx, UDS_ResponseSink sink, uint32 tag)
+{
+    if (g_stream.service == NULL || g_stream.ctx != ctx)
+    {
+        return FALSE;
+    }
+    
+    UDS_Context *context = FindContext(ctx);     /* Taken in UDS_StreamBegin() */
+    UDS_QueuedRequest *entry = (context != NULL) ? QueueTail(context) : NULL;
+    
+    if (entry == NULL || sink == NULL)
+    {
+        CloseStream(TRUE);
+        return FALSE;
+    }
+    
+    /* Only the header is queued; end() runs from UDS_Poll() in request order */
+    entry->request.source_address = g_stream.request.source_address;
+    entry->request.target_address = g_stream.request.target_address;
+    entry->request.service_id = g_stream.request.service_id;
+    entry->request.data_len = 0;
+    entry->streamed = TRUE;
+    entry->stream_len = g_stream.data_len;
+    entry->sink = sink;
+    entry->ctx = ctx;
+    entry->tag = tag;
+    context->queue_count++;
+    
+    return TRUE;
+}
+
+boolean UDS_IsPosRspSuppressed(uint8 service_id, const uint8 *data, uint32 data_len)
+{
+    return ((g_service_table[service_id].flags & UDS_SVC_SUPPRESS_POS_RSP) != 0
+            && data_len > 0 && (data[0] & UDS_SUPPRESS_POS_RSP_BIT) != 0);
+}
+
 boolean UDS_ParseDoIPDiagnostic(const uint8 *doip_payload, uint32 payload_len, UDS_Request *request)
 {
     if (doip_payload == NULL || request == NULL || payload_len < 5)
@@ -92,15 +757,27 @@ boolean UDS_ParseDoIPDiagnostic(const uint8 *doip_payload, uint32 payload_len, U
     request->source_address = ((uint16)doip_payload[0] << 8) | doip_payload[1];
     request->target_address = ((uint16)doip_payload[2] << 8) | doip_payload[3];
     
+    /* Larger requests are only accepted by streaming services */
+    if (payload_len - 5 > UDS_MAX_REQUEST_SIZE)
+    {
+        return FALSE;
+    }
+    
     /* Parse UDS Message */
     request->service_id = doip_payload[4];
     request->data_len = (uint16)(payload_len - 5);
     
-    if (request->data_len > 0 && request->data_len < UDS_MAX_REQUEST_SIZE)
+    if (request->data_len > 0)
     {
         memcpy(request->data, &doip_payload[5], request->data_len);
     }
     
+    /* Muted by CommunicationControl: skip the formatting as well */
+    if (!isUARTLoggingEnabled())
+    {
+        return TRUE;
+    }
+    
     /* Debug: Log received UDS request */
     char log_msg[128];
     sprintf(log_msg, "[UDS] RX: SID=0x%02X, SA=0x%04X, TA=0x%04X, Len=%d\r\n",
@@ -124,50 +801,43 @@ boolean UDS_ParseDoIPDiagnostic(const uint8 *doip_payload, uint32 payload_len, U
     return TRUE;
 }
 
-uint16 UDS_BuildDoIPDiagnostic(const UDS_Response *response, uint8 *buffer, uint16 buffer_size)
+uint16 UDS_EncodeDoIPHeader(uint8 *frame, uint16 source_address, uint16 target_address, uint8 service_id, uint16 data_len)
 {
-    if (response == NULL || buffer == NULL)
-    {
-        return 0;
-    }
-    
-    /* Calculate required size */
-    uint32 payload_len = 4 + 1 + response->data_len;  /* Routing + SID + data */
-    uint16 total_len = DOIP_HEADER_SIZE + payload_len;
-    
-    if (total_len > buffer_size)
-    {
-        return 0;  /* Buffer too small */
-    }
-    
-    uint16 offset = 0;
+    uint32 payload_len = 4 + 1 + data_len;  /* Routing + SID + data */
     
     /* DoIP Header (8 bytes) */
-    buffer[offset++] = DOIP_PROTOCOL_VERSION;
-    buffer[offset++] = DOIP_INVERSE_VERSION;
-    buffer[offset++] = (DOIP_DIAGNOSTIC_MESSAGE >> 8) & 0xFF;
-    buffer[offset++] = DOIP_DIAGNOSTIC_MESSAGE & 0xFF;
-    
-    /* Payload Length (4 bytes) */
-    buffer[offset++] = (payload_len >> 24) & 0xFF;
-    buffer[offset++] = (payload_len >> 16) & 0xFF;
-    buffer[offset++] = (payload_len >> 8) & 0xFF;
-    buffer[offset++] = payload_len & 0xFF;
+    frame[0] = DOIP_PROTOCOL_VERSION;
+    frame[1] = DOIP_INVERSE_VERSION;
+    frame[2] = (DOIP_DIAGNOSTIC_MESSAGE >> 8) & 0xFF;
+    frame[3] = DOIP_DIAGNOSTIC_MESSAGE & 0xFF;
+    frame[4] = (payload_len >> 24) & 0xFF;
+    frame[5] = (payload_len >> 16) & 0xFF;
+    frame[6] = (payload_len >> 8) & 0xFF;
+    frame[7] = payload_len & 0xFF;
     
     /* DoIP Routing (4 bytes) */
-    buffer[offset++] = (response->source_address >> 8) & 0xFF;
-    buffer[offset++] = response->source_address & 0xFF;
-    buffer[offset++] = (response->target_address >> 8) & 0xFF;
-    buffer[offset++] = response->target_address & 0xFF;
+    frame[8] = (source_address >> 8) & 0xFF;
+    frame[9] = source_address & 0xFF;
+    frame[10] = (target_address >> 8) & 0xFF;
+    frame[11] = target_address & 0xFF;
+    
+    /* UDS SID */
+    frame[12] = service_id;
     
-    /* UDS Response */
-    buffer[offset++] = response->service_id;
+    return (uint16)(DOIP_HEADER_SIZE + payload_len);
+}
+
+void UDS_EncodeDoIPDiagnostic(UDS_Response *response)
+{
+    /* service_id already sits in front of data[]: it is rewritten with itself;
+     * a prebuilt frame only gets the addresses of this requester */
+    uint16 total_len = UDS_EncodeDoIPHeader(UDS_RESPONSE_FRAME(response), response->source_address,
+                                            response->target_address, response->service_id,
+                                            response->data_len);
     
-    /* Response Data */
-    if (response->data_len > 0)
+    if (!isUARTLoggingEnabled())
     {
-        memcpy(&buffer[offset], response->data, response->data_len);
-        offset += response->data_len;
+        return;
     }
     
     /* Debug: Log sent UDS response */
@@ -177,6 +847,7 @@ uint16 UDS_BuildDoIPDiagnostic(const UDS_Response *response, uint8 *buffer, uint
     sendUARTMessage(log_msg, strlen(log_msg));
     
     /* Hex dump of first 16 bytes */
+    const uint8 *frame = UDS_RESPONSE_FRAME(response);
     if (total_len > 0)
     {
         uint16 dump_len = (total_len > 16) ? 16 : total_len;
@@ -184,7 +855,7 @@ uint16 UDS_BuildDoIPDiagnostic(const UDS_Response *response, uint8 *buffer, uint
         uint16 len = strlen(log_msg);
         for (uint16 i = 0; i < dump_len; i++)
         {
-            sprintf(log_msg + len, "%02X ", buffer[i]);
+            sprintf(log_msg + len, "%02X ", frame[i]);
             len += 3;
             if (len >= 110)  /* Prevent buffer overflow */
                 break;
@@ -197,162 +868,176 @@ uint16 UDS_BuildDoIPDiagnostic(const UDS_Response *response, uint8 *buffer, uint
         sprintf(log_msg + len, "\r\n");
         sendUARTMessage(log_msg, strlen(log_msg));
     }
-    
-    return total_len;
 }
 
 /*******************************************************************************
  * UDS Service Handlers
  ******************************************************************************/
 
-boolean UDS_Service_ReadDataByIdentifier(const UDS_Request *request, UDS_Response *response)
+/*******************************************************************************
+ * UDS Service: 0x10 Diagnostic Session Control
+ ******************************************************************************/
+
+boolean UDS_Service_DiagnosticSessionControl(const UDS_Request *request, UDS_Response *response)
 {
-    /* 0x22 Read Data By Identifier requires at least 2 bytes (DID) */
-    if (request->data_len < 2)
+    uint8 session = request->data[0] & UDS_SUBFUNCTION_MASK;
+    
+    if (session < UDS_SESSION_DEFAULT || session > UDS_SESSION_EXTENDED)
     {
-        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        UDS_CreateNegativeResponse(request, UDS_NRC_SUBFUNCTION_NOT_SUPPORTED, response);
         return TRUE;
     }
     
-    /* Parse DID */
-    uint16 did = ((uint16)request->data[0] << 8) | request->data[1];
+    ChangeSession(g_context, session);
     
-    /* Prepare positive response */
+    /* Response: [session][P2 (ms)][P2* (10 ms)] */
     UDS_CreatePositiveResponse(request, response);
+    response->data[0] = session;
+    response->data[1] = (uint8)(UDS_P2_SERVER_MS >> 8);
+    response->data[2] = (uint8)UDS_P2_SERVER_MS;
+    response->data[3] = (uint8)((UDS_P2_STAR_SERVER_MS / 10) >> 8);
+    response->data[4] = (uint8)(UDS_P2_STAR_SERVER_MS / 10);
+    response->data_len = 5;
     
-    /* Echo DID in response */
-    response->data[0] = request->data[0];
-    response->data[1] = request->data[1];
-    response->data_len = 2;
-    
-    /* Handle DID */
-    uint16 did_data_len = 0;
-    if (UDS_ReadDID_VCI(did, &response->data[2], &did_data_len))
-    {
-        response->data_len += did_data_len;
-        return TRUE;
-    }
+    char log_msg[40];
+    sprintf(log_msg, "[UDS] Session 0x%02X\r\n", session);
+    sendUARTMessage(log_msg, strlen(log_msg));
     
-    /* DID not supported */
-    UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
     return TRUE;
 }
 
-boolean UDS_ReadDID_VCI(uint16 did, uint8 *data, uint16 *data_len)
+/*******************************************************************************
+ * UDS Service: 0x27 Security Access
+ ******************************************************************************/
+
+/* Seed from the STM timer stirred by xorshift; never 0 (0 = already unlocked) */
+static uint32 NextSeed(void)
 {
-    if (data == NULL || data_len == NULL)
-    {
-        return FALSE;
-    }
+    uint32 x = g_seed_state ^ (uint32)IfxStm_get(&MODULE_STM0);
     
-    switch (did)
-    {
-        case UDS_DID_VCI_ECU_ID:  /* 0xF194 - Individual ECU VCI */
-        {
-            /* Return ZGW's own VCI */
-            memcpy(data, &g_zgw_vci, sizeof(DoIP_VCI_Info));
-            *data_len = sizeof(DoIP_VCI_Info);
-            return TRUE;
-        }
-        
-        case UDS_DID_VCI_CONSOLIDATED:  /* 0xF195 - Consolidated VCI */
-        {
-            /* This triggers VCI collection from Zone ECUs */
-            DoIP_VCI_Info vci_array[MAX_ZONE_ECUS + 1];
-            uint8 vci_count = 0;
-            
-            if (UDS_ReadConsolidatedVCI(vci_array, &vci_count))
-            {
-                /* Build response: [Count][VCI_1][VCI_2]... */
-                data[0] = vci_count;
-                memcpy(&data[1], vci_array, vci_count * sizeof(DoIP_VCI_Info));
-                *data_len = 1 + (vci_count * sizeof(DoIP_VCI_Info));
-                return TRUE;
-            }
-            return FALSE;
-        }
-        
-        case UDS_DID_HEALTH_STATUS:  /* 0xF1A0 - Health Status */
-        {
-            DoIP_HealthStatus_Info health_array[MAX_ZONE_ECUS + 1];
-            uint8 health_count = 0;
-            
-            if (UDS_ReadHealthStatus(health_array, &health_count))
-            {
-                /* Build response: [Count][Health_1][Health_2]... */
-                data[0] = health_count;
-                memcpy(&data[1], health_array, health_count * sizeof(DoIP_HealthStatus_Info));
-                *data_len = 1 + (health_count * sizeof(DoIP_HealthStatus_Info));
-                return TRUE;
-            }
-            return FALSE;
-        }
-        
-        default:
-            return FALSE;  /* DID not supported */
-    }
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_seed_state = x;
+    
+    return (x != 0) ? x : 1;
+}
+
+static uint32 ComputeKey(uint32 seed)
+{
+    return ((seed << 7) | (seed >> 25)) ^ UDS_SECURITY_SECRET;
 }
 
-boolean UDS_ReadIndividualVCI(uint16 ecu_address, DoIP_VCI_Info *vci_info)
+static boolean RequestSeed(const UDS_Request *request, UDS_Response *response)
 {
-    /* TODO: Implement ECU-specific VCI request via DoIP */
-    /* For now, return ZGW's own VCI */
-    if (ecu_address == ZGW_ADDRESS)
+    if (request->data_len != 1)
     {
-        memcpy(vci_info, &g_zgw_vci, sizeof(DoIP_VCI_Info));
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
         return TRUE;
     }
     
-    return FALSE;
+    if (IfxStm_get(&MODULE_STM0) < g_security_delay_end)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUIRED_TIME_DELAY_NOT_EXPIRED, response);
+        return TRUE;
+    }
+    
+    /* Already unlocked: zero seed, no key expected */
+    uint32 seed = 0;
+    if (g_context->security_level < UDS_SECURITY_LEVEL_1)
+    {
+        seed = NextSeed();
+        g_context->seed = seed;
+        g_context->seed_level = UDS_SECURITY_LEVEL_1;
+    }
+    
+    /* Response: [sub-function][seed] */
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = UDS_SA_REQUEST_SEED;
+    response->data[1] = (uint8)(seed >> 24);
+    response->data[2] = (uint8)(seed >> 16);
+    response->data[3] = (uint8)(seed >> 8);
+    response->data[4] = (uint8)seed;
+    response->data_len = 1 + UDS_SECURITY_SEED_LEN;
+    
+    return TRUE;
 }
 
-boolean UDS_ReadConsolidatedVCI(DoIP_VCI_Info *vci_array, uint8 *vci_count)
+static boolean SendKey(const UDS_Request *request, UDS_Response *response)
 {
-    if (vci_array == NULL || vci_count == NULL)
+    if (request->data_len != 1 + UDS_SECURITY_KEY_LEN)
     {
-        return FALSE;
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return TRUE;
     }
     
-    /* Check if VCI collection is complete */
-    if (!g_vci_collection_complete)
+    if (g_context->seed_level != UDS_SECURITY_LEVEL_1)
     {
-        /* VCI collection not ready - return only ZGW VCI */
-        memcpy(&vci_array[0], &g_zgw_vci, sizeof(DoIP_VCI_Info));
-        *vci_count = 1;
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_SEQUENCE_ERROR, response);
         return TRUE;
     }
+    g_context->seed_level = 0;
     
-    /* Return all collected VCI (Zone ECUs + ZGW) */
-    uint8 total_count = g_zone_ecu_count + 1;  /* +1 for ZGW itself */
+    uint32 key = ((uint32)request->data[1] << 24) | ((uint32)request->data[2] << 16)
+               | ((uint32)request->data[3] << 8) | request->data[4];
     
-    if (total_count > MAX_ZONE_ECUS + 1)
+    if (key != ComputeKey(g_context->seed))
     {
-        total_count = MAX_ZONE_ECUS + 1;
+        /* The attempt that reaches the limit starts the delay */
+        uint8 nrc = UDS_NRC_INVALID_KEY;
+        if (++g_security_attempts >= UDS_SECURITY_MAX_ATTEMPTS)
+        {
+            g_security_attempts = 0;
+            g_security_delay_end = IfxStm_get(&MODULE_STM0) + g_security_delay_ticks;
+            nrc = UDS_NRC_EXCEED_NUMBER_OF_ATTEMPTS;
+        }
+        
+        sendUARTMessage("[UDS] SecurityAccess: invalid key\r\n", 35);
+        UDS_CreateNegativeResponse(request, nrc, response);
+        return TRUE;
     }
     
-    memcpy(vci_array, g_vci_database, total_count * sizeof(DoIP_VCI_Info));
-    *vci_count = total_count;
+    g_security_attempts = 0;
+    g_context->security_level = UDS_SECURITY_LEVEL_1;
+    
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = UDS_SA_SEND_KEY;
+    response->data_len = 1;
     
+    sendUARTMessage("[UDS] Security level 1 unlocked\r\n", 33);
     return TRUE;
 }
 
-boolean UDS_ReadHealthStatus(DoIP_HealthStatus_Info *health_array, uint8 *health_count)
+boolean UDS_Service_SecurityAccess(const UDS_Request *request, UDS_Response *response)
 {
-    if (health_array == NULL || health_count == NULL)
+    switch (request->data[0] & UDS_SUBFUNCTION_MASK)
     {
-        return FALSE;
+        case UDS_SA_REQUEST_SEED:
+            return RequestSeed(request, response);
+        case UDS_SA_SEND_KEY:
+            return SendKey(request, response);
+        default:
+            UDS_CreateNegativeResponse(request, UDS_NRC_SUBFUNCTION_NOT_SUPPORTED, response);
+            return TRUE;
     }
-    
-    /* Return health status for all ECUs (simulated for now) */
-    uint8 total_count = g_zone_ecu_count + 1;  /* +1 for ZGW itself */
-    
-    if (total_count > MAX_ZONE_ECUS + 1)
+}
+
+/*******************************************************************************
+ * UDS Service: 0x3E Tester Present
+ ******************************************************************************/
+
+boolean UDS_Service_TesterPresent(const UDS_Request *request, UDS_Response *response)
+{
+    /* Only zeroSubFunction; the S3 timer was restarted by the framework */
+    if ((request->data[0] & UDS_SUBFUNCTION_MASK) != 0x00)
     {
-        total_count = MAX_ZONE_ECUS + 1;
+        UDS_CreateNegativeResponse(request, UDS_NRC_SUBFUNCTION_NOT_SUPPORTED, response);
+        return TRUE;
     }
     
-    memcpy(health_array, g_health_data, total_count * sizeof(DoIP_HealthStatus_Info));
-    *health_count = total_count;
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = 0x00;
+    response->data_len = 1;
     
     return TRUE;
 }
@@ -366,6 +1051,7 @@ void UDS_CreateNegativeResponse(const UDS_Request *request, uint8 nrc, UDS_Respo
     response->is_positive = FALSE;
     response->service_id = UDS_SID_NEGATIVE_RESPONSE;
     response->nrc = nrc;
+    response->frame = NULL;
     response->data_len = 2;
     response->data[0] = request->service_id;  /* Rejected Service ID */
     response->data[1] = nrc;                  /* Negative Response Code */
@@ -376,100 +1062,7 @@ void UDS_CreatePositiveResponse(const UDS_Request *request, UDS_Response *respon
     response->is_positive = TRUE;
     response->service_id = request->service_id + UDS_POSITIVE_RESPONSE_OFFSET;
     response->nrc = 0;
+    response->frame = NULL;
     response->data_len = 0;
 }
 
-/*******************************************************************************
- * UDS Service: 0x31 Routine Control
- ******************************************************************************/
-
-boolean UDS_Service_RoutineControl(const UDS_Request *request, UDS_Response *response)
-{
-    /* 0x31 Routine Control requires at least 3 bytes: [sub-function][RID_high][RID_low] */
-    if (request->data_len < 3)
-    {
-        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
-        return TRUE;
-    }
-    
-    uint8 sub_function = request->data[0];
-    uint16 routine_id = ((uint16)request->data[1] << 8) | request->data[2];
-    
-    /* Handle only Start Routine (0x01) for now */
-    if (sub_function != UDS_RC_START_ROUTINE)
-    {
-        UDS_CreateNegativeResponse(request, UDS_NRC_SUBFUNCTION_NOT_SUPPORTED, response);
-        return TRUE;
-    }
-    
-    /* Prepare positive response */
-    UDS_CreatePositiveResponse(request, response);
-    
-    /* Echo sub-function and routine ID */
-    response->data[0] = sub_function;
-    response->data[1] = request->data[1];  /* RID high */
-    response->data[2] = request->data[2];  /* RID low */
-    response->data_len = 3;
-    
-    /* Handle routine based on RID */
-    switch (routine_id)
-    {
-        case UDS_RID_VCI_COLLECTION_START:  /* 0xF001 - Start VCI Collection */
-        {
-            /* Start VCI collection with UDP broadcast */
-            VCI_StartCollection();
-            
-            /* Response: [sub][RID_H][RID_L][status=0x00=success] */
-            response->data[3] = 0x00;  /* Success */
-            response->data_len = 4;
-            
-            return TRUE;
-        }
-        
-        case UDS_RID_VCI_SEND_REPORT:  /* 0xF002 - Send VCI Report */
-        {
-            /* Check if DoIP is active */
-            if (!DoIP_Client_IsActive())
-            {
-                /* Connection not ready */
-                response->data[3] = 0x01;  /* Failure: Not connected */
-                response->data_len = 4;
-                sendUARTMessage("[UDS] VCI send failed: DoIP not active\r\n", 41);
-                return TRUE;
-            }
-            
-            /* Send consolidated VCI report */
-            uint8 total_vci_count = g_zone_ecu_count + 1;  /* Zone ECUs + ZGW */
-            
-            if (DoIP_Client_SendVCIReport(total_vci_count, g_vci_database))
-            {
-                /* Response: [sub][RID_H][RID_L][status=0x00=success][count] */
-                response->data[3] = 0x00;  /* Success */
-                response->data[4] = total_vci_count;
-                response->data_len = 5;
-                
-                char log_msg[64];
-                sprintf(log_msg, "[UDS] VCI report sent (%d ECUs)\r\n", total_vci_count);
-                sendUARTMessage(log_msg, strlen(log_msg));
-                
-                return TRUE;
-            }
-            else
-            {
-                /* Send failed */
-                response->data[3] = 0x02;  /* Failure: Send error */
-                response->data_len = 4;
-                sendUARTMessage("[UDS] VCI send failed: TCP error\r\n", 35);
-                return TRUE;
-            }
-        }
-        
-        default:
-        {
-            /* Routine ID not supported */
-            UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
-            return TRUE;
-        }
-    }
-}
-
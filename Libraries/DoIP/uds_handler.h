@@ -25,6 +25,24 @@
 #define UDS_SID_TESTER_PRESENT                  0x3E
 #define UDS_SID_CONTROL_DTC_SETTING             0x85
 
+/* Diagnostic Sessions (0x10 sub-functions) */
+#define UDS_SESSION_DEFAULT                     0x01
+#define UDS_SESSION_PROGRAMMING                 0x02
+#define UDS_SESSION_EXTENDED                    0x03
+
+/* ECU Reset (0x11 sub-functions) */
+#define UDS_RESET_HARD                          0x01
+#define UDS_RESET_KEY_OFF_ON                    0x02
+#define UDS_RESET_SOFT                          0x03    /* Warm reset: runtime cache kept */
+
+/* Security Access (0x27 sub-functions) */
+#define UDS_SA_REQUEST_SEED                     0x01
+#define UDS_SA_SEND_KEY                         0x02
+
+/* Sub-function byte: suppressPosRspMsgIndicationBit + sub-function value */
+#define UDS_SUPPRESS_POS_RSP_BIT                0x80
+#define UDS_SUBFUNCTION_MASK                    0x7F
+
 /* Data Transmission */
 #define UDS_SID_READ_DATA_BY_IDENTIFIER         0x22
 #define UDS_SID_READ_MEMORY_BY_ADDRESS          0x23
@@ -52,6 +70,10 @@
 /* Routine IDs for VCI Management */
 #define UDS_RID_VCI_COLLECTION_START            0xF001  /* Start VCI collection from Zone ECUs */
 #define UDS_RID_VCI_SEND_REPORT                 0xF002  /* Send consolidated VCI report to VMG */
+#define UDS_RID_CAPTURE_CONTROL                 0xF010  /* Start/stop the Ethernet capture ring, read its counters */
+#define UDS_RID_CAPTURE_EXPORT                  0xF011  /* Read the capture ring as a pcap stream */
+#define UDS_RID_CHECK_MEMORY                    0x0202  /* CRC-32 over a Flash4/RAM range */
+#define UDS_RID_ERASE_MEMORY                    0xFF00  /* Erase Flash4 staging sectors */
 
 /* Upload/Download */
 #define UDS_SID_REQUEST_DOWNLOAD                0x34
@@ -78,9 +100,11 @@
 #define UDS_NRC_SUBFUNCTION_NOT_SUPPORTED       0x12
 #define UDS_NRC_INCORRECT_MESSAGE_LENGTH        0x13
 #define UDS_NRC_RESPONSE_TOO_LONG               0x14
+#define UDS_NRC_BUSY_REPEAT_REQUEST             0x21
 
 #define UDS_NRC_CONDITIONS_NOT_CORRECT          0x22
 #define UDS_NRC_REQUEST_SEQUENCE_ERROR          0x24
+#define UDS_NRC_NO_RESPONSE_FROM_SUBNET         0x25  /* Gateway: no response from zone ECU */
 #define UDS_NRC_REQUEST_OUT_OF_RANGE            0x31
 #define UDS_NRC_SECURITY_ACCESS_DENIED          0x33
 #define UDS_NRC_INVALID_KEY                     0x35
@@ -93,6 +117,8 @@
 #define UDS_NRC_WRONG_BLOCK_SEQUENCE_COUNTER    0x73
 
 #define UDS_NRC_REQUEST_CORRECTLY_RECEIVED      0x78  /* Response Pending */
+#define UDS_NRC_SUBFUNCTION_NOT_SUPPORTED_IN_SESSION 0x7E
+#define UDS_NRC_SERVICE_NOT_SUPPORTED_IN_SESSION     0x7F
 
 /*******************************************************************************
  * UDS Data Identifiers (DID) - Standard (ISO 14229-1)
@@ -126,6 +152,17 @@
 #define UDS_DID_BATTERY_VOLTAGE                 0xF1B1  /* Battery Voltage */
 #define UDS_DID_ECU_TEMPERATURE                 0xF1B2  /* ECU Temperature */
 
+/* Network DIDs */
+#define UDS_DID_DOIP_LINK_STATS                 0xF1C0  /* VMG link: state, reconnects, time to ACTIVE, failovers */
+
+/* Memory DIDs */
+#define UDS_DID_MEMORY_SCRATCH                  0xF1D0  /* WriteMemoryByAddress area: address, size */
+
+/* Periodic DIDs (0xF2xx, scheduled by 0x2A as periodicDataIdentifier xx) */
+#define UDS_DID_PERIODIC_BASE                   0xF200
+#define UDS_DID_PERIODIC_HEALTH_STATUS          0xF2A0  /* = 0xF1A0 */
+#define UDS_DID_PERIODIC_DOIP_LINK_STATS        0xF2C0  /* = 0xF1C0 */
+
 /*******************************************************************************
  * UDS Handler Configuration
  ******************************************************************************/
@@ -133,6 +170,43 @@
 #define UDS_MAX_REQUEST_SIZE                    256     /* Max UDS request size */
 #define UDS_MAX_RESPONSE_SIZE                   4096    /* Max UDS response size */
 #define UDS_TIMEOUT_MS                          5000    /* UDS timeout: 5 seconds */
+#define UDS_MAX_INFLIGHT_REQUESTS               4       /* Pipelined requests queued per connection */
+#define UDS_MAX_STREAM_SERVICES                 4       /* Services receiving request data incrementally */
+#define UDS_MAX_CONTEXTS                        (DOIP_SERVER_MAX_SOCKETS + DOIP_CLIENT_MAX_LINKS)  /* Tester connections with their own session */
+#define UDS_STREAM_HEAD_SIZE                    5       /* DoIP routing (4) + SID (1) before streamed data */
+#define UDS_RESPONSE_HEADROOM                   (DOIP_HEADER_SIZE + 4 + 1)  /* DoIP header + routing + SID before response data */
+
+/* Server timing (ISO 14229-2) */
+#define UDS_P2_SERVER_MS                        50      /* Response time, reported in 0x10 response */
+#define UDS_P2_STAR_SERVER_MS                   5000    /* Response time after NRC 0x78 */
+#define UDS_S3_SERVER_MS                        5000    /* Non-default session ends without requests */
+#define UDS_PENDING_FIRST_MS                    (UDS_P2_SERVER_MS / 2)      /* Job still running: first NRC 0x78 */
+#define UDS_PENDING_REPEAT_MS                   (UDS_P2_STAR_SERVER_MS / 2) /* then repeated within P2* */
+
+/* Security access (0x27): level 1 guards transfers and memory writes */
+#define UDS_SECURITY_LEVEL_1                    1       /* Unlocked by requestSeed 0x01 / sendKey 0x02 */
+#define UDS_SECURITY_SEED_LEN                   4
+#define UDS_SECURITY_KEY_LEN                    4
+#define UDS_SECURITY_SECRET                     0x5A3C96E1UL  /* key = rotl(seed, 7) ^ secret */
+#define UDS_SECURITY_MAX_ATTEMPTS               3       /* Invalid keys before the delay */
+#define UDS_SECURITY_DELAY_MS                   10000   /* No seed until then (NRC 0x37) */
+
+/*******************************************************************************
+ * UDS Service Table
+ ******************************************************************************/
+
+/* Session masks (bit = session ID - 1) */
+#define UDS_SESSION_MASK(session)               (1u << ((session) - 1))
+#define UDS_SESSIONS_ALL                        (UDS_SESSION_MASK(UDS_SESSION_DEFAULT) | \
+                                                 UDS_SESSION_MASK(UDS_SESSION_PROGRAMMING) | \
+                                                 UDS_SESSION_MASK(UDS_SESSION_EXTENDED))
+#define UDS_SESSIONS_NON_DEFAULT                (UDS_SESSION_MASK(UDS_SESSION_PROGRAMMING) | \
+                                                 UDS_SESSION_MASK(UDS_SESSION_EXTENDED))
+
+#define UDS_LEN_UNLIMITED                       0xFFFF  /* No upper bound on the request data length */
+
+/* Service flags */
+#define UDS_SVC_SUPPRESS_POS_RSP                0x01    /* First data byte is a sub-function with SPRMIB */
 
 /*******************************************************************************
  * UDS Request/Response Structures
@@ -148,18 +222,28 @@ typedef struct
     uint8  data[UDS_MAX_REQUEST_SIZE];  /* Service-specific data */
 } UDS_Request;
 
-/* UDS Response */
+/* UDS Response; doip_header, service_id and data[] are contiguous, so the
+ * DoIP diagnostic message is encoded in place in front of the data
+ * (UDS_EncodeDoIPDiagnostic) and sent from here without being assembled.
+ * A service may instead hand over a frame it keeps (UDS_SetPrebuiltResponse) */
 typedef struct
 {
     uint16 source_address;      /* DoIP source address */
     uint16 target_address;      /* DoIP target address */
+    uint16 data_len;            /* Length of data[] */
     boolean is_positive;        /* TRUE = Positive, FALSE = Negative */
-    uint8  service_id;          /* UDS Service ID (with +0x40 for positive) */
     uint8  nrc;                 /* Negative Response Code (if negative) */
-    uint16 data_len;            /* Length of data[] */
+    uint8 *frame;               /* Prebuilt frame of the service, NULL: encoded in place */
+    uint8  reserved[3];         /* Aligns data[] to 4 bytes (DMA moves) */
+    uint8  doip_header[UDS_RESPONSE_HEADROOM - 1];  /* DoIP header + routing addresses */
+    uint8  service_id;          /* UDS Service ID (with +0x40 for positive) */
     uint8  data[UDS_MAX_RESPONSE_SIZE];  /* Response data */
 } UDS_Response;
 
+/* DoIP diagnostic message of a response encoded by UDS_EncodeDoIPDiagnostic() */
+#define UDS_RESPONSE_FRAME(response)            (((response)->frame != NULL) ? (response)->frame : (response)->doip_header)
+#define UDS_RESPONSE_FRAME_LEN(response)        ((uint16)(UDS_RESPONSE_HEADROOM + (response)->data_len))
+
 /*******************************************************************************
  * UDS Handler Function Pointers
  ******************************************************************************/
@@ -167,6 +251,54 @@ typedef struct
 /* UDS Service Handler Function Type */
 typedef boolean (*UDS_ServiceHandler)(const UDS_Request *request, UDS_Response *response);
 
+/* Service table entry, indexed by SID; the framework checks session, security
+ * and length before the handler runs. sessions == 0: service not supported */
+typedef struct
+{
+    UDS_ServiceHandler handler;     /* NULL: served by a registered streaming service */
+    uint16 min_len;                 /* Request data length after the SID */
+    uint16 max_len;                 /* Or UDS_LEN_UNLIMITED */
+    uint8  sessions;                /* UDS_SESSION_MASK() bits */
+    uint8  security_level;          /* Required security level, 0 = none */
+    uint8  flags;                   /* UDS_SVC_* */
+    
+} UDS_ServiceEntry;
+
+/* Response delivery for queued requests; return FALSE if the connection cannot
+ * take the response yet (it is offered again on the next UDS_Poll()). The
+ * response arrives as its encoded DoIP message, sent as it is */
+typedef boolean (*UDS_ResponseSink)(void *ctx, uint32 tag, const uint8 *frame, uint16 len);
+
+/* Long-running request: a handler that cannot finish within P2 returns
+ * UDS_StartJob(job). UDS_Poll() then calls the job from the main loop until it
+ * builds the final response (return TRUE), sending NRC 0x78 in the meantime.
+ * Each connection has its own job: later requests of that connection wait for
+ * it, other connections are served meanwhile. Jobs sharing a resource (DMA
+ * channel, flash writer) must check it is free. */
+typedef boolean (*UDS_JobHandler)(const UDS_Request *request, UDS_Response *response);
+
+/* Streaming service: request data is handed over in pieces as the transport
+ * receives it, so the request size is not limited by UDS_Request.data.
+ * Small buffered requests for the same SID are replayed through the same
+ * callbacks from UDS_Poll(). Only one streamed request is open at a time. */
+typedef struct
+{
+    /* Addresses and SID known, data follows in chunk(); return 0 to accept or an NRC */
+    uint8   (*begin)(const UDS_Request *request, uint32 data_len);
+    
+    /* Next piece of the service data (after the SID); return 0 or an NRC to reject the rest */
+    uint8   (*chunk)(uint32 offset, const uint8 *data, uint32 len);
+    
+    /* All data received: build the response (runs from UDS_Poll() in request order);
+     * return FALSE if the response cannot be built yet - end() then runs as a job */
+    boolean (*end)(const UDS_Request *request, uint32 data_len, UDS_Response *response);
+    
+    /* Request dropped before end() (connection closed, rejected, queue full);
+     * also runs when the service table rejected the request before begin() */
+    void    (*cancel)(void);
+    
+} UDS_StreamService;
+
 /*******************************************************************************
  * Public Functions
  ******************************************************************************/
@@ -180,80 +312,176 @@ void UDS_Init(void);
  * @brief Handle incoming UDS request
  * @param request Pointer to UDS request structure
  * @param response Pointer to UDS response structure (output)
- * @return TRUE if handled successfully, FALSE otherwise
+ * @return TRUE if a response is to be sent, FALSE if none (e.g. suppressed positive response)
  */
 boolean UDS_HandleRequest(const UDS_Request *request, UDS_Response *response);
 
+/**
+ * @brief Queue a DoIP Diagnostic Message payload for processing in UDS_Poll()
+ * @param doip_payload DoIP diagnostic message payload (after DoIP header)
+ * @param payload_len Length of DoIP payload
+ * @param sink Function receiving the response
+ * @param ctx Connection context passed to the sink (identifies the requester)
+ * @param tag Caller value passed back to the sink (e.g. receive timestamp)
+ * @return TRUE if queued, FALSE if the connection's in-flight slots (or all contexts) are used
+ */
+boolean UDS_SubmitRequest(const uint8 *doip_payload, uint32 payload_len, UDS_ResponseSink sink, void *ctx, uint32 tag);
+
+/**
+ * @brief Process queued requests and deliver responses, run the S3 timer (call from main loop)
+ * @details Connections are served round robin, each in its own request order
+ */
+void UDS_Poll(void);
+
+/**
+ * @brief Continue the current request as a job (call from a service handler)
+ * @param job Called from UDS_Poll() until it returns TRUE with the final response
+ * @return FALSE (no response yet), for the handler to return
+ */
+boolean UDS_StartJob(UDS_JobHandler job);
+
+/**
+ * @brief Answer with a positive response frame kept by the service instead of
+ *        building it in the response buffer (call from a service handler); the
+ *        sink gets a pointer to the frame, which must stay unchanged until the
+ *        next request is handled
+ * @param response Response of the handler
+ * @param frame UDS_RESPONSE_HEADROOM bytes (DoIP header, routing, SID: encoded
+ *        for the requester by the framework) followed by the response data
+ * @param data_len Length of the response data
+ */
+void UDS_SetPrebuiltResponse(UDS_Response *response, uint8 *frame, uint16 data_len);
+
+/**
+ * @brief Get the connection of the request being handled (valid inside a service handler)
+ * @param sink Output response sink of the requester
+ * @param ctx Output connection context of the requester
+ * @return TRUE if the request came through UDS_SubmitRequest() / UDS_StreamEnd()
+ */
+boolean UDS_GetRequestOrigin(UDS_ResponseSink *sink, void **ctx);
+
+/**
+ * @brief Get the connection of the request being handled (valid inside a service
+ *        handler and inside the begin() / end() callbacks of a streaming service)
+ * @return Connection context given to UDS_SubmitRequest() / UDS_StreamBegin(), NULL outside
+ */
+void *UDS_GetConnection(void);
+
+/**
+ * @brief Get the diagnostic session of the connection being handled
+ * @return UDS_SESSION_DEFAULT, UDS_SESSION_PROGRAMMING or UDS_SESSION_EXTENDED
+ *         (UDS_SESSION_DEFAULT outside a request)
+ */
+uint8 UDS_GetSession(void);
+
+/**
+ * @brief Drop queued requests and an open streamed request of a connection and
+ *        end its session (call when it closes)
+ * @param ctx Connection context given to UDS_SubmitRequest() / UDS_StreamBegin()
+ */
+void UDS_CancelRequests(void *ctx);
+
+/**
+ * @brief Register a streaming service for a SID
+ * @param service_id UDS Service ID (service table entry with handler NULL)
+ * @param service Callbacks (static storage)
+ * @return TRUE if registered, FALSE if the table is full
+ */
+boolean UDS_RegisterStreamService(uint8 service_id, const UDS_StreamService *service);
+
+/**
+ * @brief Start a streamed request (transport, once routing and SID are received)
+ * @param ctx Connection context (as for UDS_SubmitRequest())
+ * @param head First UDS_STREAM_HEAD_SIZE payload bytes: SA, TA, SID
+ * @param payload_len Total DoIP payload length
+ * @return TRUE if the data is streamed (feed it with UDS_StreamChunk()), FALSE to buffer as usual
+ */
+boolean UDS_StreamBegin(void *ctx, const uint8 *head, uint32 payload_len);
+
+/**
+ * @brief Deliver streamed request data straight from the receive buffers
+ * @param ctx Connection context given to UDS_StreamBegin()
+ * @param offset Offset within the service data (after the SID)
+ * @param data Data
+ * @param len Length
+ */
+void UDS_StreamChunk(void *ctx, uint32 offset, const uint8 *data, uint32 len);
+
+/**
+ * @brief Complete a streamed request and queue its response
+ * @param ctx Connection context given to UDS_StreamBegin()
+ * @param sink Function receiving the response
+ * @param tag Caller value passed back to the sink
+ * @return TRUE if queued, FALSE if the connection's in-flight slots are used (request dropped)
+ */
+boolean UDS_StreamEnd(void *ctx, UDS_ResponseSink sink, uint32 tag);
+
+/**
+ * @brief Check whether a request suppresses its positive response (SPRMIB set
+ *        on a service with a sub-function, as flagged in the service table);
+ *        also used by the router for requests forwarded to zone ECUs
+ * @param service_id UDS Service ID
+ * @param data Request data after the SID
+ * @param data_len Length of data
+ * @return TRUE if no positive response is expected (NRCs still are)
+ */
+boolean UDS_IsPosRspSuppressed(uint8 service_id, const uint8 *data, uint32 data_len);
+
 /**
  * @brief Parse DoIP Diagnostic Message (0x8001) to UDS Request
  * @param doip_payload DoIP diagnostic message payload (after DoIP header)
  * @param payload_len Length of DoIP payload
  * @param request Output UDS request structure
- * @return TRUE if parsed successfully, FALSE otherwise
+ * @return TRUE if parsed successfully, FALSE if too short or the data exceeds UDS_MAX_REQUEST_SIZE
  */
 boolean UDS_ParseDoIPDiagnostic(const uint8 *doip_payload, uint32 payload_len, UDS_Request *request);
 
 /**
- * @brief Build DoIP Diagnostic Message from UDS Response
- * @param response UDS response structure
- * @param buffer Output buffer for DoIP message
- * @param buffer_size Size of output buffer
- * @return Length of DoIP message, or 0 on error
+ * @brief Encode a DoIP Diagnostic Message header (DoIP header, routing, SID)
+ * @param frame Output, UDS_RESPONSE_HEADROOM bytes; the UDS data follows it
+ * @param source_address DoIP source address
+ * @param target_address DoIP target address
+ * @param service_id UDS Service ID
+ * @param data_len Length of the UDS data after the SID
+ * @return Length of the whole DoIP message
+ */
+uint16 UDS_EncodeDoIPHeader(uint8 *frame, uint16 source_address, uint16 target_address, uint8 service_id, uint16 data_len);
+
+/**
+ * @brief Encode the DoIP Diagnostic Message of a response in place, in front of
+ *        its data; the message is then UDS_RESPONSE_FRAME(response) with
+ *        UDS_RESPONSE_FRAME_LEN(response) bytes (call before the sink)
+ * @param response UDS response
  */
-uint16 UDS_BuildDoIPDiagnostic(const UDS_Response *response, uint8 *buffer, uint16 buffer_size);
+void UDS_EncodeDoIPDiagnostic(UDS_Response *response);
 
 /*******************************************************************************
- * UDS Service Handlers (0x22 Read Data By Identifier)
+ * UDS Service Handlers
  ******************************************************************************/
 
 /**
- * @brief Handle 0x22 Read Data By Identifier
+ * @brief Handle 0x10 Diagnostic Session Control
  * @param request UDS request
  * @param response UDS response (output)
  * @return TRUE if handled, FALSE otherwise
  */
-boolean UDS_Service_ReadDataByIdentifier(const UDS_Request *request, UDS_Response *response);
+boolean UDS_Service_DiagnosticSessionControl(const UDS_Request *request, UDS_Response *response);
 
 /**
- * @brief Handle 0x31 Routine Control
+ * @brief Handle 0x27 Security Access (requestSeed / sendKey of level 1)
  * @param request UDS request
  * @param response UDS response (output)
  * @return TRUE if handled, FALSE otherwise
  */
-boolean UDS_Service_RoutineControl(const UDS_Request *request, UDS_Response *response);
-
-/**
- * @brief Read VCI Data for a specific DID
- * @param did Data Identifier
- * @param data Output buffer for DID data
- * @param data_len Output length of DID data
- * @return TRUE if DID is supported and data is available, FALSE otherwise
- */
-boolean UDS_ReadDID_VCI(uint16 did, uint8 *data, uint16 *data_len);
+boolean UDS_Service_SecurityAccess(const UDS_Request *request, UDS_Response *response);
 
 /**
- * @brief Read Individual ECU VCI (DID 0xF194)
- * @param ecu_address ECU address to query
- * @param vci_info Output VCI information
- * @return TRUE if successful, FALSE otherwise
- */
-boolean UDS_ReadIndividualVCI(uint16 ecu_address, DoIP_VCI_Info *vci_info);
-
-/**
- * @brief Read Consolidated VCI (DID 0xF195)
- * @param vci_array Output array of VCI information
- * @param vci_count Output count of VCI entries
- * @return TRUE if successful, FALSE otherwise
- */
-boolean UDS_ReadConsolidatedVCI(DoIP_VCI_Info *vci_array, uint8 *vci_count);
-
-/**
- * @brief Read Health Status (DID 0xF1A0)
- * @param health_array Output array of health status
- * @param health_count Output count of health entries
- * @return TRUE if successful, FALSE otherwise
+ * @brief Handle 0x3E Tester Present
+ * @param request UDS request
+ * @param response UDS response (output)
+ * @return TRUE if handled, FALSE otherwise
  */
-boolean UDS_ReadHealthStatus(DoIP_HealthStatus_Info *health_array, uint8 *health_count);
+boolean UDS_Service_TesterPresent(const UDS_Request *request, UDS_Response *response);
 
 /*******************************************************************************
  * Helper Functions
@@ -0,0 +1,348 @@
+/**
+ * @file uds_memory.c
+ * @brief UDS ReadMemoryByAddress / WriteMemoryByAddress Implementation
+ */
+
+#include "uds_memory.h"
+#include "uds_did.h"
+#include "uds_transfer.h"
+#include "AppConfig.h"
+#include "Flash4_Driver.h"
+#include "IfxDma_Dma.h"
+#include "IfxCpu.h"
+#include "IfxStm.h"
+#include "UART_Logging.h"
+#include <string.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define MEMORY_SCRATCH_SIZE         1024    /* Writable area for 0x3D, in CPU0 DSPR */
+#define MEMORY_SCRATCH_INFO_LEN     6       /* DID 0xF1D0: [address (4)][size (2)] */
+
+/* Address window of the whitelist */
+typedef struct
+{
+    uint32  start;
+    uint32  size;
+    uint8   access;         /* UDS_MEMORY_READ / UDS_MEMORY_WRITE */
+    boolean mapped;         /* FALSE: Flash4, read through the QSPI driver */
+
+} UDS_MemoryWindow;
+
+static const UDS_MemoryWindow g_windows[] = {
+    /* start                size                 access            mapped */
+    { UPLOAD_RAM_ADDR,      UPLOAD_RAM_SIZE,     UDS_MEMORY_READ,  TRUE  },
+    { PFLASH_READ_ADDR,     PFLASH_READ_SIZE,    UDS_MEMORY_READ,  TRUE  },
+    { PFLASH_READ_NC_ADDR,  PFLASH_READ_SIZE,    UDS_MEMORY_READ,  TRUE  },
+    { FLASH4_VIRTUAL_ADDR,  FLASH4_UPLOAD_LIMIT, UDS_MEMORY_READ,  FALSE },
+};
+
+#define MEMORY_WINDOW_COUNT         (sizeof(g_windows) / sizeof(g_windows[0]))
+
+/* Scratch area: the only window 0x3D writes to (its address is link-time, so
+ * the window is set up by UDS_Memory_Init and published through DID 0xF1D0) */
+static uint8  g_scratch[MEMORY_SCRATCH_SIZE];
+static UDS_MemoryWindow g_scratch_window;       /* Global (DMA-visible) address */
+static uint8  g_scratch_info[MEMORY_SCRATCH_INFO_LEN];
+
+/* DMA read in progress (completed by ReadMemoryJob) */
+static IfxDma_Dma         g_dma;
+static IfxDma_Dma_Channel g_dma_channel;
+static struct {
+    uint8       *tail_dst;      /* Bytes after the last full DMA move, copied by the CPU */
+    const uint8 *tail_src;
+    uint16       tail_len;
+    uint16       len;           /* Response data length */
+    uint64       deadline;      /* STM ticks */
+    boolean      active;        /* Channel busy: further reads are copied by the CPU */
+} g_read;
+static uint64 g_dma_timeout_ticks = 0;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static uint32 ReadBigEndian(const uint8 *data, uint8 len)
+{
+    uint32 value = 0;
+
+    for (uint8 i = 0; i < len; i++)
+    {
+        value = (value << 8) | data[i];
+    }
+
+    return value;
+}
+
+static boolean InRegion(uint32 address, uint32 size, uint32 region_start, uint32 region_size)
+{
+    return (address >= region_start && address - region_start < region_size
+            && size <= region_size - (address - region_start));
+}
+
+/* Window holding the whole range with the given rights, NULL if none */
+static const UDS_MemoryWindow *FindWindow(uint32 address, uint32 size, uint8 access)
+{
+    if (InRegion(address, size, g_scratch_window.start, g_scratch_window.size))
+    {
+        return &g_scratch_window;
+    }
+
+    for (uint8 i = 0; i < MEMORY_WINDOW_COUNT; i++)
+    {
+        if (InRegion(address, size, g_windows[i].start, g_windows[i].size))
+        {
+            return ((g_windows[i].access & access) == access) ? &g_windows[i] : NULL;
+        }
+    }
+
+    return NULL;
+}
+
+/* [ALFID][memoryAddress][memorySize]; returns the length of the parsed fields, 0 if malformed */
+static uint16 ParseAddressAndSize(const uint8 *record, uint16 record_len, uint32 *address, uint32 *size)
+{
+    uint8 size_len = record[0] >> 4;
+    uint8 address_len = record[0] & 0x0F;
+    uint16 fields_len = 1u + address_len + size_len;
+
+    if (size_len < 1 || size_len > 4 || address_len < 1 || address_len > 4 || record_len < fields_len)
+    {
+        return 0;
+    }
+
+    *address = ReadBigEndian(&record[1], address_len);
+    *size = ReadBigEndian(&record[1 + address_len], size_len);
+    return fields_len;
+}
+
+/* Address as seen by the DMA: local DSPR to global, cached PFLASH to non-cached;
+ * 0 if the DMA must not be used (e.g. cached LMU, where the CPU could read stale data) */
+static uint32 DmaAddress(const void *address)
+{
+    uint32 value = (uint32)address;
+
+    switch (value & 0xF0000000UL)
+    {
+        case 0xD0000000UL:
+            return IFXCPU_GLB_ADDR_DSPR(IfxCpu_getCoreId(), value);
+        case 0x70000000UL:
+        case 0xA0000000UL:
+            return value;
+        case 0x80000000UL:
+            return value | 0x20000000UL;
+        default:
+            return 0;
+    }
+}
+
+/* Start a DMA copy of the bulk of len bytes; FALSE if the addresses do not allow
+ * one or the channel is still copying for another connection */
+static boolean StartDmaRead(uint8 *dst, const uint8 *src, uint16 len)
+{
+    uint32 dst_address = DmaAddress(dst);
+    uint32 src_address = DmaAddress(src);
+
+    if (dst_address == 0 || src_address == 0 || g_read.active)
+    {
+        return FALSE;
+    }
+
+    /* Widest move both addresses are aligned to; the remainder goes to the CPU */
+    uint32 alignment = dst_address | src_address;
+    IfxDma_ChannelMoveSize move_size = IfxDma_ChannelMoveSize_8bit;
+    uint8 move_bytes = 1;
+
+    if ((alignment & 3u) == 0)
+    {
+        move_size = IfxDma_ChannelMoveSize_32bit;
+        move_bytes = 4;
+    }
+    else if ((alignment & 1u) == 0)
+    {
+        move_size = IfxDma_ChannelMoveSize_16bit;
+        move_bytes = 2;
+    }
+
+    uint16 moves = len / move_bytes;
+
+    IfxDma_Dma_ChannelConfig config;
+    IfxDma_Dma_initChannelConfig(&config, &g_dma);
+    config.channelId = (IfxDma_ChannelId)UDS_MEMORY_DMA_CHANNEL;
+    config.sourceAddress = src_address;
+    config.destinationAddress = dst_address;
+    config.transferCount = moves;
+    config.blockMode = IfxDma_ChannelMove_1;
+    config.moveSize = move_size;
+    config.requestMode = IfxDma_ChannelRequestMode_completeTransactionPerRequest;
+    config.operationMode = IfxDma_ChannelOperationMode_single;
+    config.hardwareRequestEnabled = FALSE;
+    IfxDma_Dma_initChannel(&g_dma_channel, &config);
+
+    g_read.tail_len = len - (uint16)(moves * move_bytes);
+    g_read.tail_dst = dst + (len - g_read.tail_len);
+    g_read.tail_src = src + (len - g_read.tail_len);
+    g_read.len = len;
+    g_read.deadline = IfxStm_get(&MODULE_STM0) + g_dma_timeout_ticks;
+    g_read.active = TRUE;
+
+    IfxDma_Dma_startChannelTransaction(&g_dma_channel);
+    return TRUE;
+}
+
+/* Completes the DMA read; finishes before UDS_PENDING_FIRST_MS, so no NRC 0x78
+ * overwrites the data the DMA is writing */
+static boolean ReadMemoryJob(const UDS_Request *request, UDS_Response *response)
+{
+    boolean pending = IfxDma_Dma_isChannelTransactionPending(&g_dma_channel);
+
+    if (pending && IfxStm_get(&MODULE_STM0) < g_read.deadline)
+    {
+        return FALSE;
+    }
+
+    g_read.active = FALSE;
+
+    uint32 errors = IfxDma_getErrorFlags(&MODULE_DMA, IfxDma_MoveEngine_0)
+                  | IfxDma_getErrorFlags(&MODULE_DMA, IfxDma_MoveEngine_1);
+
+    if (pending || (errors & (IFXDMA_ERROR_S | IFXDMA_ERROR_D)) != 0)
+    {
+        IfxDma_resetChannel(&MODULE_DMA, (IfxDma_ChannelId)UDS_MEMORY_DMA_CHANNEL);
+        IfxDma_clearErrorFlags(&MODULE_DMA, IfxDma_MoveEngine_0, IFXDMA_ERROR_S | IFXDMA_ERROR_D);
+        IfxDma_clearErrorFlags(&MODULE_DMA, IfxDma_MoveEngine_1, IFXDMA_ERROR_S | IFXDMA_ERROR_D);
+        sendUARTMessage("[UDS] ReadMemoryByAddress DMA failed\r\n", 38);
+        UDS_CreateNegativeResponse(request, UDS_NRC_GENERAL_REJECT, response);
+        return TRUE;
+    }
+
+    memcpy(g_read.tail_dst, g_read.tail_src, g_read.tail_len);
+
+    UDS_CreatePositiveResponse(request, response);
+    response->data_len = g_read.len;
+    return TRUE;
+}
+
+static uint16 ReadScratchInfo(uint16 did, uint8 *data, uint16 max_len)
+{
+    (void)did;
+    (void)max_len;
+    memcpy(data, g_scratch_info, MEMORY_SCRATCH_INFO_LEN);
+    return MEMORY_SCRATCH_INFO_LEN;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void UDS_Memory_Init(void)
+{
+    IfxDma_Dma_Config config;
+    IfxDma_Dma_initModuleConfig(&config, &MODULE_DMA);
+    IfxDma_Dma_initModule(&g_dma, &config);
+
+    g_dma_timeout_ticks = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_MEMORY_DMA_TIMEOUT_MS);
+
+    memset(g_scratch, 0, sizeof(g_scratch));
+    g_scratch_window.start = IFXCPU_GLB_ADDR_DSPR(IfxCpu_getCoreId(), g_scratch);
+    g_scratch_window.size = MEMORY_SCRATCH_SIZE;
+    g_scratch_window.access = UDS_MEMORY_READ | UDS_MEMORY_WRITE;
+    g_scratch_window.mapped = TRUE;
+    g_scratch_info[0] = (uint8)(g_scratch_window.start >> 24);
+    g_scratch_info[1] = (uint8)(g_scratch_window.start >> 16);
+    g_scratch_info[2] = (uint8)(g_scratch_window.start >> 8);
+    g_scratch_info[3] = (uint8)g_scratch_window.start;
+    g_scratch_info[4] = (uint8)(MEMORY_SCRATCH_SIZE >> 8);
+    g_scratch_info[5] = (uint8)MEMORY_SCRATCH_SIZE;
+
+    UDS_DID_Register(UDS_DID_MEMORY_SCRATCH, MEMORY_SCRATCH_INFO_LEN, UDS_SESSIONS_ALL, ReadScratchInfo);
+}
+
+boolean UDS_Memory_IsMapped(uint32 address, uint32 size, uint8 access)
+{
+    const UDS_MemoryWindow *window = FindWindow(address, size, access);
+
+    return (size > 0 && window != NULL && window->mapped);
+}
+
+/*******************************************************************************
+ * UDS Service: 0x23 Read Memory By Address
+ ******************************************************************************/
+
+boolean UDS_Service_ReadMemoryByAddress(const UDS_Request *request, UDS_Response *response)
+{
+    uint32 address;
+    uint32 size;
+    uint16 fields_len = ParseAddressAndSize(request->data, request->data_len, &address, &size);
+
+    if (fields_len == 0 || fields_len != request->data_len)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return TRUE;
+    }
+
+    const UDS_MemoryWindow *window = FindWindow(address, size, UDS_MEMORY_READ);
+    if (size == 0 || size > UDS_MAX_RESPONSE_SIZE || window == NULL)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+        return TRUE;
+    }
+
+    if (!window->mapped)
+    {
+        /* Flash4 shares the QSPI with the flash writer of RequestDownload */
+        if (!UDS_Transfer_Flash4Idle())
+        {
+            UDS_CreateNegativeResponse(request, UDS_NRC_CONDITIONS_NOT_CORRECT, response);
+            return TRUE;
+        }
+
+        Flash4_ReadFlash4(address - window->start, response->data, (uint16)size);
+    }
+    else if (size >= UDS_MEMORY_DMA_THRESHOLD
+             && StartDmaRead(response->data, (const uint8 *)address, (uint16)size))
+    {
+        return UDS_StartJob(ReadMemoryJob);
+    }
+    else
+    {
+        memcpy(response->data, (const uint8 *)address, size);
+    }
+
+    UDS_CreatePositiveResponse(request, response);
+    response->data_len = (uint16)size;
+    return TRUE;
+}
+
+/*******************************************************************************
+ * UDS Service: 0x3D Write Memory By Address
+ ******************************************************************************/
+
+boolean UDS_Service_WriteMemoryByAddress(const UDS_Request *request, UDS_Response *response)
+{
+    uint32 address;
+    uint32 size;
+    uint16 fields_len = ParseAddressAndSize(request->data, request->data_len, &address, &size);
+
+    if (fields_len == 0 || request->data_len - fields_len != size)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return TRUE;
+    }
+
+    if (size == 0 || FindWindow(address, size, UDS_MEMORY_WRITE) == NULL)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+        return TRUE;
+    }
+
+    memcpy((uint8 *)address, &request->data[fields_len], size);
+
+    /* Echo [ALFID][memoryAddress][memorySize] */
+    UDS_CreatePositiveResponse(request, response);
+    memcpy(response->data, request->data, fields_len);
+    response->data_len = fields_len;
+    return TRUE;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file uds_memory.h
+ * @brief UDS ReadMemoryByAddress (0x23) and WriteMemoryByAddress (0x3D)
+ * @details Accesses are checked against a whitelist of address windows:
+ *          CPU0 DSPR (read/write), PFLASH (read, cached and non-cached view)
+ *          and Flash4 mapped at FLASH4_VIRTUAL_ADDR (read). Reads of mapped
+ *          memory from UDS_MEMORY_DMA_THRESHOLD bytes on are moved by a DMA
+ *          channel straight into the response buffer; the request completes
+ *          as a UDS job, so the main loop keeps running during the copy.
+ *          While the channel is busy, reads of other connections are
+ *          copied by the CPU.
+ */
+
+#ifndef UDS_MEMORY_H
+#define UDS_MEMORY_H
+
+#include "uds_handler.h"
+
+/*******************************************************************************
+ * Memory Access Configuration
+ ******************************************************************************/
+
+#define UDS_MEMORY_DMA_CHANNEL      7       /* DMA channel (software triggered) */
+#define UDS_MEMORY_DMA_THRESHOLD    256     /* Smaller reads are copied by the CPU */
+#define UDS_MEMORY_DMA_TIMEOUT_MS   10      /* Below UDS_PENDING_FIRST_MS: no 0x78 */
+
+/* Sessions of ReadMemoryByAddress, also required for memory slices of 0x2C */
+#define UDS_MEMORY_READ_SESSIONS    UDS_SESSIONS_NON_DEFAULT
+
+/* Window access rights */
+#define UDS_MEMORY_READ             0x01
+#define UDS_MEMORY_WRITE            0x02
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize the DMA module for memory reads (call after UDS_Init)
+ */
+void UDS_Memory_Init(void);
+
+/**
+ * @brief Check that a range lies in one memory-mapped window with the given rights
+ * @param address Start address
+ * @param size Length in bytes
+ * @param access UDS_MEMORY_READ and/or UDS_MEMORY_WRITE
+ * @return TRUE if the range can be accessed directly (not Flash4)
+ */
+boolean UDS_Memory_IsMapped(uint32 address, uint32 size, uint8 access);
+
+/**
+ * @brief Service 0x23 - Read Memory By Address
+ * @param request UDS request [ALFID][memoryAddress][memorySize]
+ * @param response UDS response [dataRecord]
+ * @return TRUE if response is ready, FALSE if it follows from the job
+ */
+boolean UDS_Service_ReadMemoryByAddress(const UDS_Request *request, UDS_Response *response);
+
+/**
+ * @brief Service 0x3D - Write Memory By Address
+ * @param request UDS request [ALFID][memoryAddress][memorySize][dataRecord]
+ * @param response UDS response [ALFID][memoryAddress][memorySize]
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_WriteMemoryByAddress(const UDS_Request *request, UDS_Response *response);
+
+#endif /* UDS_MEMORY_H */
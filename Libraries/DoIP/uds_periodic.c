@@ -0,0 +1,308 @@
+/**
+ * @file uds_periodic.c
+ * @brief UDS ReadDataByPeriodicIdentifier Scheduler Implementation
+ */
+
+#include "uds_periodic.h"
+#include "uds_comm.h"
+#include "uds_did.h"
+#include "IfxStm.h"
+#include <string.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define PERIODIC_FREE           0x00    /* Entry mode: not scheduled */
+
+/* Largest 0xF2xx record: a dynamically defined DID (the fixed ones, health
+ * status and link stats, are well below it) */
+#define PERIODIC_MAX_RECORD_LEN UDS_DDDID_MAX_RECORD_LEN
+
+/* Message layout: DoIP/routing header and SID, PDID, record */
+#define PERIODIC_PDID_OFFSET    UDS_RESPONSE_HEADROOM
+#define PERIODIC_RECORD_OFFSET  (UDS_RESPONSE_HEADROOM + 1)
+
+typedef struct
+{
+    uint8            mode;              /* UDS_PERIODIC_MODE_SLOW..FAST, PERIODIC_FREE */
+    uint8            pdid;
+    uint8            session;           /* Session it was scheduled in (cancelled on change) */
+    UDS_ResponseSink sink;
+    void            *ctx;
+    uint16           tester_address;
+    uint16           server_address;
+    uint64           next_due;          /* STM ticks */
+
+} UDS_PeriodicEntry;
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static UDS_PeriodicEntry g_entries[UDS_PERIODIC_MAX_ENTRIES];
+static uint64            g_period_ticks[UDS_PERIODIC_MODE_FAST + 1];
+static uint32            g_ticks_per_us = 1;
+static UDS_PeriodicStats g_stats;
+
+/* Message being sent; the sink sends it from here */
+static uint8             g_message[PERIODIC_RECORD_OFFSET + PERIODIC_MAX_RECORD_LEN];
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static UDS_PeriodicEntry *FindEntry(void *ctx, uint8 pdid)
+{
+    for (uint8 i = 0; i < UDS_PERIODIC_MAX_ENTRIES; i++)
+    {
+        if (g_entries[i].mode != PERIODIC_FREE && g_entries[i].ctx == ctx && g_entries[i].pdid == pdid)
+        {
+            return &g_entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+static uint8 CountFree(void)
+{
+    uint8 count = 0;
+
+    for (uint8 i = 0; i < UDS_PERIODIC_MAX_ENTRIES; i++)
+    {
+        if (g_entries[i].mode == PERIODIC_FREE)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/* First due time of a new entry: in phase with the connection's other entries
+ * of that rate so they are sent together, otherwise right away */
+static uint64 FirstDue(void *ctx, uint8 mode, uint64 now)
+{
+    for (uint8 i = 0; i < UDS_PERIODIC_MAX_ENTRIES; i++)
+    {
+        if (g_entries[i].mode == mode && g_entries[i].ctx == ctx)
+        {
+            return g_entries[i].next_due;
+        }
+    }
+
+    return now;
+}
+
+static void Schedule(const UDS_Request *request, uint8 mode, uint8 pdid, UDS_ResponseSink sink, void *ctx, uint64 now)
+{
+    UDS_PeriodicEntry *entry = FindEntry(ctx, pdid);
+
+    if (entry == NULL)
+    {
+        for (uint8 i = 0; i < UDS_PERIODIC_MAX_ENTRIES && entry == NULL; i++)
+        {
+            if (g_entries[i].mode == PERIODIC_FREE)
+            {
+                entry = &g_entries[i];
+            }
+        }
+    }
+    else if (entry->mode == mode)
+    {
+        return;     /* Already scheduled at this rate */
+    }
+
+    /* Rate change moves the entry into the new rate's phase */
+    entry->mode = PERIODIC_FREE;
+    entry->next_due = FirstDue(ctx, mode, now);
+    entry->mode = mode;
+    entry->pdid = pdid;
+    entry->session = UDS_GetSession();
+    entry->sink = sink;
+    entry->ctx = ctx;
+    entry->tester_address = request->source_address;
+    entry->server_address = request->target_address;
+}
+
+static void Send(UDS_PeriodicEntry *entry, uint64 now)
+{
+    uint16 record_len = 0;
+
+    /* Nothing is sampled while switched off; the grid keeps running, so
+     * enabling again does not release a burst of overdue samples */
+    if (!UDS_Comm_TxEnabled(UDS_COMM_SUBNET_ETHERNET, UDS_COMM_TYPE_NORMAL))
+    {
+        g_stats.suppressed++;
+        return;
+    }
+
+    g_message[PERIODIC_PDID_OFFSET] = entry->pdid;
+
+    /* Sampled now, written straight into the message */
+    if (UDS_DID_ReadInSession(UDS_DID_PERIODIC_BASE | entry->pdid, entry->session, &g_message[PERIODIC_RECORD_OFFSET],
+                              PERIODIC_MAX_RECORD_LEN, &record_len) != 0)
+    {
+        g_stats.dropped++;
+        return;
+    }
+    uint16 len = UDS_EncodeDoIPHeader(g_message, entry->server_address, entry->tester_address,
+                                      UDS_SID_READ_DATA_BY_PERIODIC_ID + UDS_POSITIVE_RESPONSE_OFFSET,
+                                      (uint16)(1 + record_len));
+
+    /* A backlogged connection loses this sample; the next one is fresher */
+    if (!entry->sink(entry->ctx, UDS_PERIODIC_TAG, g_message, len))
+    {
+        g_stats.dropped++;
+        return;
+    }
+
+    uint32 late_us = (uint32)((now - entry->next_due) / g_ticks_per_us);
+    if (late_us > g_stats.late_max_us)
+    {
+        g_stats.late_max_us = late_us;
+    }
+    g_stats.sent++;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void UDS_Periodic_Init(void)
+{
+    memset(g_entries, 0, sizeof(g_entries));
+    memset(&g_stats, 0, sizeof(g_stats));
+
+    g_period_ticks[UDS_PERIODIC_MODE_SLOW] = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_PERIODIC_SLOW_MS);
+    g_period_ticks[UDS_PERIODIC_MODE_MEDIUM] = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_PERIODIC_MEDIUM_MS);
+    g_period_ticks[UDS_PERIODIC_MODE_FAST] = IfxStm_getTicksFromMilliseconds(&MODULE_STM0, UDS_PERIODIC_FAST_MS);
+    g_ticks_per_us = (uint32)IfxStm_getTicksFromMicroseconds(&MODULE_STM0, 1);
+}
+
+void UDS_Periodic_Poll(void)
+{
+    uint64 now = IfxStm_get(&MODULE_STM0);
+
+    for (uint8 i = 0; i < UDS_PERIODIC_MAX_ENTRIES; i++)
+    {
+        UDS_PeriodicEntry *entry = &g_entries[i];
+
+        if (entry->mode == PERIODIC_FREE || now < entry->next_due)
+        {
+            continue;
+        }
+
+        Send(entry, now);
+
+        /* Fixed grid, no drift; after a stall the grid restarts from now
+         * (entries of one rate stay in phase, they are due in the same pass) */
+        entry->next_due += g_period_ticks[entry->mode];
+        if (entry->next_due <= now)
+        {
+            entry->next_due = now + g_period_ticks[entry->mode];
+        }
+    }
+}
+
+void UDS_Periodic_Cancel(void *ctx)
+{
+    for (uint8 i = 0; i < UDS_PERIODIC_MAX_ENTRIES; i++)
+    {
+        if (ctx == NULL || g_entries[i].ctx == ctx)
+        {
+            g_entries[i].mode = PERIODIC_FREE;
+        }
+    }
+}
+
+const UDS_PeriodicStats *UDS_Periodic_GetStats(void)
+{
+    return &g_stats;
+}
+
+/*******************************************************************************
+ * UDS Service: 0x2A Read Data By Periodic Identifier
+ ******************************************************************************/
+
+boolean UDS_Service_ReadDataByPeriodicIdentifier(const UDS_Request *request, UDS_Response *response)
+{
+    uint8 mode = request->data[0];
+    const uint8 *pdids = &request->data[1];
+    uint16 pdid_count = request->data_len - 1;
+    UDS_ResponseSink sink;
+    void *ctx;
+
+    if (mode < UDS_PERIODIC_MODE_SLOW || mode > UDS_PERIODIC_MODE_STOP)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+        return TRUE;
+    }
+
+    /* Messages go to the requesting connection */
+    if (!UDS_GetRequestOrigin(&sink, &ctx))
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_CONDITIONS_NOT_CORRECT, response);
+        return TRUE;
+    }
+
+    if (mode == UDS_PERIODIC_MODE_STOP)
+    {
+        /* No PDIDs: stop everything this connection scheduled */
+        if (pdid_count == 0)
+        {
+            UDS_Periodic_Cancel(ctx);
+        }
+        for (uint16 i = 0; i < pdid_count; i++)
+        {
+            UDS_PeriodicEntry *entry = FindEntry(ctx, pdids[i]);
+            if (entry != NULL)
+            {
+                entry->mode = PERIODIC_FREE;
+            }
+        }
+
+        UDS_CreatePositiveResponse(request, response);
+        return TRUE;
+    }
+
+    if (pdid_count == 0)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_INCORRECT_MESSAGE_LENGTH, response);
+        return TRUE;
+    }
+
+    /* Unsupported PDIDs are ignored; all supported ones must fit */
+    uint8 supported = 0;
+    uint8 needed = 0;
+    for (uint16 i = 0; i < pdid_count; i++)
+    {
+        if (UDS_DID_IsReadable(UDS_DID_PERIODIC_BASE | pdids[i]))
+        {
+            supported++;
+            if (FindEntry(ctx, pdids[i]) == NULL)
+            {
+                needed++;
+            }
+        }
+    }
+
+    if (supported == 0 || needed > CountFree())
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+        return TRUE;
+    }
+
+    uint64 now = IfxStm_get(&MODULE_STM0);
+    for (uint16 i = 0; i < pdid_count; i++)
+    {
+        if (UDS_DID_IsReadable(UDS_DID_PERIODIC_BASE | pdids[i]))
+        {
+            Schedule(request, mode, pdids[i], sink, ctx, now);
+        }
+    }
+
+    UDS_CreatePositiveResponse(request, response);
+    return TRUE;
+}
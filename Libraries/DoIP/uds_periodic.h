@@ -0,0 +1,84 @@
+/**
+ * @file uds_periodic.h
+ * @brief UDS ReadDataByPeriodicIdentifier (0x2A) scheduler
+ * @details A tester schedules periodicDataIdentifiers (DID 0xF2xx) at a slow,
+ *          medium or fast rate; the scheduler samples them from the main loop
+ *          and sends each as an unsolicited [0x6A][PDID][record] message to
+ *          the connection that scheduled it. Identifiers of one rate share a
+ *          phase, so everything due in one pass is queued back to back and
+ *          leaves with the connection's next flush in one TCP segment.
+ */
+
+#ifndef UDS_PERIODIC_H
+#define UDS_PERIODIC_H
+
+#include "uds_handler.h"
+
+/*******************************************************************************
+ * Scheduler Configuration
+ ******************************************************************************/
+
+#define UDS_PERIODIC_MAX_ENTRIES    8       /* Scheduled PDIDs (all connections) */
+
+/* transmissionMode rates */
+#define UDS_PERIODIC_SLOW_MS        1000
+#define UDS_PERIODIC_MEDIUM_MS      200
+#define UDS_PERIODIC_FAST_MS        50
+
+/* transmissionMode (first request byte) */
+#define UDS_PERIODIC_MODE_SLOW      0x01
+#define UDS_PERIODIC_MODE_MEDIUM    0x02
+#define UDS_PERIODIC_MODE_FAST      0x03
+#define UDS_PERIODIC_MODE_STOP      0x04
+
+/* Sink tag of periodic messages: there is no request to time them against */
+#define UDS_PERIODIC_TAG            0xFFFFFFFFUL
+
+/*******************************************************************************
+ * Scheduler Statistics
+ ******************************************************************************/
+
+typedef struct
+{
+    uint32 sent;                /* Periodic messages accepted by a sink */
+    uint32 dropped;             /* Samples skipped: connection backlogged or DID unreadable */
+    uint32 suppressed;          /* Samples skipped: transmission off (CommunicationControl) */
+    uint32 late_max_us;         /* Largest delay of a sample behind its due time */
+
+} UDS_PeriodicStats;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize the scheduler (nothing scheduled)
+ */
+void UDS_Periodic_Init(void);
+
+/**
+ * @brief Send the periodic messages that are due (call from the main loop)
+ */
+void UDS_Periodic_Poll(void);
+
+/**
+ * @brief Stop periodic transmission of a connection
+ * @param ctx Connection context given with the 0x2A request, NULL for all
+ */
+void UDS_Periodic_Cancel(void *ctx);
+
+/**
+ * @brief Get scheduler statistics
+ * @return Pointer to the statistics
+ */
+const UDS_PeriodicStats *UDS_Periodic_GetStats(void);
+
+/**
+ * @brief Service 0x2A - Read Data By Periodic Identifier
+ * @param request UDS request [transmissionMode]{[PDID]}
+ * @param response UDS response (no data; the records follow as periodic messages)
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_ReadDataByPeriodicIdentifier(const UDS_Request *request, UDS_Response *response);
+
+#endif /* UDS_PERIODIC_H */
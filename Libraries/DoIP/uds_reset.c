@@ -0,0 +1,224 @@
+/**
+ * @file uds_reset.c
+ * @brief UDS ECUReset and Warm-Reset Cache Implementation
+ */
+
+#include "uds_reset.h"
+#include "uds_transfer.h"
+#include "IfxScuRcu.h"
+#include "IfxStm.h"
+#include "UART_Logging.h"
+#include <stddef.h>
+#include <string.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define CACHE_MAGIC             0x5A475743UL    /* "ZGWC" */
+#define CRC32_POLYNOMIAL        0xEDB88320UL
+
+#define RESET_IDLE              0
+#define RESET_RESPONDING        1   /* Waiting for the response to go out */
+#define RESET_CLOSING           2   /* Connections aborted, reset next */
+
+/* Runtime cache kept across a softReset; layout changes (new firmware)
+ * invalidate it through the size field */
+typedef struct
+{
+    uint32                 magic;
+    uint32                 size;
+    DoIP_VCI_Info          vci_database[MAX_ZONE_ECUS + 1];
+    uint8                  zone_ecu_count;
+    boolean                vci_complete;
+    DoIP_HealthStatus_Info health_data[MAX_ZONE_ECUS + 1];
+    DoIP_ClientResume      client;
+    uint32                 crc;             /* CRC-32 of everything above */
+
+} UDS_ResetCache;
+
+/*******************************************************************************
+ * External Runtime Data (from Cpu0_Main.c)
+ ******************************************************************************/
+
+extern DoIP_VCI_Info g_vci_database[MAX_ZONE_ECUS + 1];
+extern uint8 g_zone_ecu_count;
+extern boolean g_vci_collection_complete;
+extern DoIP_HealthStatus_Info g_health_data[MAX_ZONE_ECUS + 1];
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+/* Not cleared by the C startup code (bss_noInit / .bss_noClear in the linker files) */
+#if defined(__TASKING__)
+#pragma section farbss "farDsprNoInit.cpu0.32bit"
+#pragma noclear
+#elif defined(__GNUC__)
+#pragma section ".bss.farDsprNoInit.cpu0.32bit" aw
+#endif
+static UDS_ResetCache g_cache;
+#if defined(__TASKING__)
+#pragma clear
+#pragma section farbss restore
+#elif defined(__GNUC__)
+#pragma section
+#endif
+
+static boolean g_warm_boot = FALSE;
+
+/* Requested reset */
+static uint8  g_reset_state = RESET_IDLE;
+static uint8  g_reset_type = 0;
+static uint64 g_reset_time = 0;         /* STM ticks of the current stage */
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static uint32 CacheCrc(void)
+{
+    const uint8 *data = (const uint8 *)&g_cache;
+    uint32 crc = 0xFFFFFFFFUL;
+
+    for (uint32 i = 0; i < offsetof(UDS_ResetCache, crc); i++)
+    {
+        crc ^= data[i];
+        for (uint8 bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32_POLYNOMIAL : (crc >> 1);
+        }
+    }
+
+    return ~crc;
+}
+
+static void SaveCache(void)
+{
+    memset(&g_cache, 0, sizeof(g_cache));
+    g_cache.magic = CACHE_MAGIC;
+    g_cache.size = sizeof(g_cache);
+
+    memcpy(g_cache.vci_database, g_vci_database, sizeof(g_cache.vci_database));
+    g_cache.zone_ecu_count = g_zone_ecu_count;
+    g_cache.vci_complete = g_vci_collection_complete;
+    memcpy(g_cache.health_data, g_health_data, sizeof(g_cache.health_data));
+    DoIP_Client_Suspend(&g_cache.client);
+
+    g_cache.crc = CacheCrc();
+}
+
+static boolean StageElapsed(uint32 ms)
+{
+    return (IfxStm_get(&MODULE_STM0) - g_reset_time) >= IfxStm_getTicksFromMilliseconds(&MODULE_STM0, ms);
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+boolean UDS_Reset_RestoreCache(void)
+{
+    boolean valid = (g_cache.magic == CACHE_MAGIC && g_cache.size == sizeof(g_cache)
+                     && g_cache.crc == CacheCrc());
+
+    /* Consumed: only the reset that saved it boots warm */
+    g_cache.magic = 0;
+
+    if (!valid)
+    {
+        g_warm_boot = FALSE;
+        return FALSE;
+    }
+
+    memcpy(g_vci_database, g_cache.vci_database, sizeof(g_cache.vci_database));
+    g_zone_ecu_count = g_cache.zone_ecu_count;
+    g_vci_collection_complete = g_cache.vci_complete;
+    memcpy(g_health_data, g_cache.health_data, sizeof(g_cache.health_data));
+
+    g_warm_boot = TRUE;
+    return TRUE;
+}
+
+const DoIP_ClientResume *UDS_Reset_GetClientResume(void)
+{
+    return g_warm_boot ? &g_cache.client : NULL;
+}
+
+void UDS_Reset_Poll(void)
+{
+    switch (g_reset_state)
+    {
+        case RESET_RESPONDING:
+        {
+            if (!StageElapsed(UDS_RESET_DELAY_MS))
+            {
+                return;
+            }
+
+            if (g_reset_type == UDS_RESET_SOFT)
+            {
+                SaveCache();
+            }
+
+            /* RST to the VMGs: they drop the old connection instead of
+             * waiting for an alive check before accepting the new one */
+            DoIP_Client_Close();
+            sendUARTMessage("[UDS] ECU reset\r\n", 17);
+
+            g_reset_state = RESET_CLOSING;
+            g_reset_time = IfxStm_get(&MODULE_STM0);
+            return;
+        }
+
+        case RESET_CLOSING:
+        {
+            if (!StageElapsed(UDS_RESET_CLOSE_MS))
+            {
+                return;
+            }
+
+            /* Application reset keeps the RAM and the external PHY's link */
+            IfxScuRcu_performReset((g_reset_type == UDS_RESET_SOFT) ? IfxScuRcu_ResetType_application
+                                                                    : IfxScuRcu_ResetType_system,
+                                   g_reset_type);
+            return;
+        }
+
+        default:
+        {
+            return;
+        }
+    }
+}
+
+/*******************************************************************************
+ * UDS Service: 0x11 ECU Reset
+ ******************************************************************************/
+
+boolean UDS_Service_ECUReset(const UDS_Request *request, UDS_Response *response)
+{
+    uint8 reset_type = request->data[0] & UDS_SUBFUNCTION_MASK;
+
+    if (reset_type != UDS_RESET_HARD && reset_type != UDS_RESET_KEY_OFF_ON && reset_type != UDS_RESET_SOFT)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_SUBFUNCTION_NOT_SUPPORTED, response);
+        return TRUE;
+    }
+
+    /* Already resetting, or a page program still in flight */
+    if (g_reset_state != RESET_IDLE || !UDS_Transfer_Flash4Idle())
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_CONDITIONS_NOT_CORRECT, response);
+        return TRUE;
+    }
+
+    g_reset_type = reset_type;
+    g_reset_state = RESET_RESPONDING;
+    g_reset_time = IfxStm_get(&MODULE_STM0);
+
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = reset_type;
+    response->data_len = 1;
+    return TRUE;
+}
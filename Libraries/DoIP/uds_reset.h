@@ -0,0 +1,55 @@
+/**
+ * @file uds_reset.h
+ * @brief UDS ECUReset (0x11) with a warm-reset path
+ * @details hardReset and keyOffOnReset restart the gateway cold. softReset
+ *          first saves the runtime cache (VCI database, health data, DoIP
+ *          client link state) into a no-init RAM region guarded by a CRC-32.
+ *          The next boot restores it and skips the stages whose results it
+ *          holds: Flash4 self-test, blocking PHY link wait, VCI collection.
+ *          The cache is consumed on restore, so any later reset without a
+ *          new save (watchdog, trap) boots cold.
+ */
+
+#ifndef UDS_RESET_H
+#define UDS_RESET_H
+
+#include "uds_handler.h"
+#include "doip_client.h"
+
+/*******************************************************************************
+ * Reset Configuration
+ ******************************************************************************/
+
+#define UDS_RESET_DELAY_MS          20      /* Positive response on the wire before the reset */
+#define UDS_RESET_CLOSE_MS          5       /* TCP resets to the peers sent before the reset */
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Restore the runtime cache of a warm reset (call first in the boot path)
+ * @return TRUE on a warm boot (cache valid and restored), FALSE on a cold boot
+ */
+boolean UDS_Reset_RestoreCache(void);
+
+/**
+ * @brief DoIP client link state saved with the cache
+ * @return State to pass to DoIP_Client_Resume(), NULL on a cold boot
+ */
+const DoIP_ClientResume *UDS_Reset_GetClientResume(void);
+
+/**
+ * @brief Perform a requested reset once its response is sent (call from the main loop)
+ */
+void UDS_Reset_Poll(void);
+
+/**
+ * @brief Service 0x11 - ECU Reset
+ * @param request UDS request [resetType]
+ * @param response UDS response [resetType]
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_ECUReset(const UDS_Request *request, UDS_Response *response);
+
+#endif /* UDS_RESET_H */
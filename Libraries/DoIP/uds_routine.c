@@ -0,0 +1,466 @@
+/**
+ * @file uds_routine.c
+ * @brief UDS RoutineControl and Routine Registry Implementation
+ */
+
+#include "uds_routine.h"
+#include "doip_types.h"
+#include "doip_client.h"
+#include "doip_capture.h"
+#include "uds_comm.h"
+#include "vci_manager.h"
+#include "UART_Logging.h"
+#include <string.h>
+#include <stdio.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+typedef struct
+{
+    uint16             routine_id;
+    uint8              sessions;        /* UDS_SESSION_MASK() bits */
+    uint8              state;           /* Background: UDS_ROUTINE_*, NOT_STARTED */
+    uint8              nrc;             /* Failure reported by the last step */
+    void              *owner;           /* Connection that started it (UDS_GetConnection) */
+    const UDS_Routine *routine;
+
+} UDS_RoutineEntry;
+
+/*******************************************************************************
+ * External VCI Database (from Cpu0_Main.c)
+ ******************************************************************************/
+
+extern DoIP_VCI_Info g_vci_database[MAX_ZONE_ECUS + 1];  /* +1 for ZGW itself */
+extern uint8 g_zone_ecu_count;
+extern boolean g_vci_collection_complete;
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+static UDS_RoutineEntry g_routines[UDS_ROUTINE_MAX_ENTRIES];
+static uint8            g_routine_count = 0;
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static UDS_RoutineEntry *FindRoutine(uint16 routine_id)
+{
+    for (uint8 i = 0; i < g_routine_count; i++)
+    {
+        if (g_routines[i].routine_id == routine_id)
+        {
+            return &g_routines[i];
+        }
+    }
+
+    return NULL;
+}
+
+static uint8 Progress(const UDS_RoutineEntry *entry)
+{
+    if (entry->state == UDS_ROUTINE_COMPLETED)
+    {
+        return 100;
+    }
+
+    if (entry->state != UDS_ROUTINE_RUNNING || entry->routine->progress == NULL)
+    {
+        return UDS_ROUTINE_PROGRESS_UNKNOWN;
+    }
+
+    uint8 percent = entry->routine->progress();
+    return (percent > 100) ? 100 : percent;
+}
+
+static void StopRoutine(UDS_RoutineEntry *entry, const UDS_Request *request, UDS_Response *response)
+{
+    entry->routine->stop(request, response);
+
+    if (response->is_positive)
+    {
+        entry->state = UDS_ROUTINE_STOPPED;
+    }
+}
+
+/* Sub-functions of a background routine; the framework owns the status record */
+static void ControlBackground(UDS_RoutineEntry *entry, uint8 sub_function,
+                              const UDS_Request *request, UDS_Response *response)
+{
+    const UDS_Routine *routine = entry->routine;
+
+    switch (sub_function)
+    {
+        case UDS_RC_START_ROUTINE:
+        {
+            if (entry->state == UDS_ROUTINE_RUNNING)
+            {
+                UDS_CreateNegativeResponse(request, UDS_NRC_CONDITIONS_NOT_CORRECT, response);
+                return;
+            }
+
+            routine->start(request, response);
+            if (response->is_positive)
+            {
+                entry->state = UDS_ROUTINE_RUNNING;
+                entry->nrc = 0;
+                entry->owner = UDS_GetConnection();
+                response->data[3] = UDS_ROUTINE_RUNNING;
+                response->data_len = 4;
+            }
+            return;
+        }
+
+        case UDS_RC_STOP_ROUTINE:
+        {
+            if (routine->stop == NULL)
+            {
+                UDS_CreateNegativeResponse(request, UDS_NRC_SUBFUNCTION_NOT_SUPPORTED, response);
+                return;
+            }
+            if (entry->state != UDS_ROUTINE_RUNNING)
+            {
+                UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_SEQUENCE_ERROR, response);
+                return;
+            }
+
+            StopRoutine(entry, request, response);
+            if (response->is_positive)
+            {
+                response->data[3] = UDS_ROUTINE_STOPPED;
+                response->data_len = 4;
+            }
+            return;
+        }
+
+        default:
+        {
+            if (entry->state == UDS_ROUTINE_NOT_STARTED)
+            {
+                UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_SEQUENCE_ERROR, response);
+                return;
+            }
+
+            /* [routineInfo][progress] + results record or failure NRC */
+            response->data[3] = entry->state;
+            response->data[4] = Progress(entry);
+            response->data_len = 5;
+
+            if (entry->state == UDS_ROUTINE_FAILED)
+            {
+                response->data[5] = entry->nrc;
+                response->data_len = 6;
+            }
+            else if (entry->state == UDS_ROUTINE_COMPLETED && routine->results != NULL)
+            {
+                routine->results(request, response);
+            }
+            return;
+        }
+    }
+}
+
+/*******************************************************************************
+ * Gateway Routines
+ ******************************************************************************/
+
+/* 0xF001 VCI collection (background): broadcast, then wait for the Zone ECUs
+ * or the collection timeout; results: [Zone ECUs answered] */
+static void VciCollectionStart(const UDS_Request *request, UDS_Response *response)
+{
+    /* The broadcast and the answers are switched off by CommunicationControl */
+    if (!UDS_Comm_TxEnabled(UDS_COMM_SUBNET_ETHERNET, UDS_COMM_TYPE_NORMAL) ||
+        !UDS_Comm_RxEnabled(UDS_COMM_SUBNET_ETHERNET, UDS_COMM_TYPE_NORMAL))
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_CONDITIONS_NOT_CORRECT, response);
+        return;
+    }
+
+    VCI_StartCollection();
+}
+
+static uint8 VciCollectionStep(void)
+{
+    return g_vci_collection_complete ? UDS_ROUTINE_COMPLETED : UDS_ROUTINE_RUNNING;
+}
+
+static uint8 VciCollectionProgress(void)
+{
+    return (uint8)((g_zone_ecu_count * 100u) / MAX_ZONE_ECUS);
+}
+
+static void VciCollectionResults(const UDS_Request *request, UDS_Response *response)
+{
+    (void)request;
+    response->data[response->data_len++] = g_zone_ecu_count;
+}
+
+/* 0xF002 Send VCI report (synchronous): [status]([count]) */
+static void VciSendReportStart(const UDS_Request *request, UDS_Response *response)
+{
+    /* Reports are switched off by CommunicationControl */
+    if (!UDS_Comm_TxEnabled(UDS_COMM_SUBNET_ETHERNET, UDS_COMM_TYPE_NORMAL))
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_CONDITIONS_NOT_CORRECT, response);
+        return;
+    }
+
+    /* Check if DoIP is active */
+    if (!DoIP_Client_IsActive())
+    {
+        /* Connection not ready */
+        response->data[3] = 0x01;  /* Failure: Not connected */
+        response->data_len = 4;
+        sendUARTMessage("[UDS] VCI send failed: DoIP not active\r\n", 41);
+        return;
+    }
+
+    /* Send consolidated VCI report */
+    uint8 total_vci_count = g_zone_ecu_count + 1;  /* Zone ECUs + ZGW */
+
+    if (DoIP_Client_SendVCIReport(total_vci_count, g_vci_database))
+    {
+        /* Response: [sub][RID_H][RID_L][status=0x00=success][count] */
+        response->data[3] = 0x00;  /* Success */
+        response->data[4] = total_vci_count;
+        response->data_len = 5;
+
+        char log_msg[64];
+        sprintf(log_msg, "[UDS] VCI report sent (%d ECUs)\r\n", total_vci_count);
+        sendUARTMessage(log_msg, strlen(log_msg));
+    }
+    else
+    {
+        /* Send failed */
+        response->data[3] = 0x02;  /* Failure: Send error */
+        response->data_len = 4;
+        sendUARTMessage("[UDS] VCI send failed: TCP error\r\n", 35);
+    }
+}
+
+/* 0xF010 Capture control (synchronous) */
+static void CaptureControlStart(const UDS_Request *request, UDS_Response *response)
+{
+    /* Option record: 0x00 = all frames, 0x01 (default) = DoIP only */
+    boolean all = (request->data_len > 3 && request->data[3] == 0x00);
+    DoIP_Capture_Start(all ? DOIP_CAPTURE_PORT_ALL : DOIP_CAPTURE_PORT_DOIP);
+    response->data[3] = 0x00;
+    response->data_len = 4;
+}
+
+static void CaptureControlStop(const UDS_Request *request, UDS_Response *response)
+{
+    (void)request;
+    DoIP_Capture_Stop();
+    response->data[3] = 0x00;
+    response->data_len = 4;
+}
+
+static void CaptureControlResults(const UDS_Request *request, UDS_Response *response)
+{
+    (void)request;
+
+    /* Results: [running][stored][captured(4)][overwritten(4)][truncated(4)] */
+    const DoIP_CaptureStats *stats = DoIP_Capture_GetStats();
+    uint8 *p = &response->data[3];
+    *p++ = stats->running ? 0x01 : 0x00;
+    *p++ = stats->stored;
+    *p++ = (uint8)(stats->captured >> 24);
+    *p++ = (uint8)(stats->captured >> 16);
+    *p++ = (uint8)(stats->captured >> 8);
+    *p++ = (uint8)stats->captured;
+    *p++ = (uint8)(stats->overwritten >> 24);
+    *p++ = (uint8)(stats->overwritten >> 16);
+    *p++ = (uint8)(stats->overwritten >> 8);
+    *p++ = (uint8)stats->overwritten;
+    *p++ = (uint8)(stats->truncated >> 24);
+    *p++ = (uint8)(stats->truncated >> 16);
+    *p++ = (uint8)(stats->truncated >> 8);
+    *p++ = (uint8)stats->truncated;
+    response->data_len = (uint16)(p - response->data);
+}
+
+/* 0xF011 Capture export (synchronous) */
+static void CaptureExportStart(const UDS_Request *request, UDS_Response *response)
+{
+    (void)request;
+
+    /* Freeze the ring and rewind: [status][pcap size(4)] */
+    uint32 size = DoIP_Capture_ExportRewind();
+    response->data[3] = 0x00;
+    response->data[4] = (uint8)(size >> 24);
+    response->data[5] = (uint8)(size >> 16);
+    response->data[6] = (uint8)(size >> 8);
+    response->data[7] = (uint8)size;
+    response->data_len = 8;
+}
+
+static void CaptureExportResults(const UDS_Request *request, UDS_Response *response)
+{
+    (void)request;
+
+    /* Next part of the stream: [0x01][pcap bytes], [0x00] once complete */
+    uint32 n = DoIP_Capture_ExportRead(&response->data[4], UDS_MAX_RESPONSE_SIZE - 4);
+    response->data[3] = (n > 0) ? 0x01 : 0x00;
+    response->data_len = (uint16)(4 + n);
+}
+
+static const UDS_Routine g_vci_collection = {
+    .start    = VciCollectionStart,
+    .stop     = NULL,
+    .results  = VciCollectionResults,
+    .step     = VciCollectionStep,
+    .progress = VciCollectionProgress,
+    .cancel   = NULL
+};
+static const UDS_Routine g_vci_send_report = {
+    .start    = VciSendReportStart,
+    .stop     = NULL,
+    .results  = NULL,
+    .step     = NULL,
+    .progress = NULL,
+    .cancel   = NULL
+};
+static const UDS_Routine g_capture_control = {
+    .start    = CaptureControlStart,
+    .stop     = CaptureControlStop,
+    .results  = CaptureControlResults,
+    .step     = NULL,
+    .progress = NULL,
+    .cancel   = NULL
+};
+static const UDS_Routine g_capture_export = {
+    .start    = CaptureExportStart,
+    .stop     = NULL,
+    .results  = CaptureExportResults,
+    .step     = NULL,
+    .progress = NULL,
+    .cancel   = NULL
+};
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void UDS_Routine_Init(void)
+{
+    g_routine_count = 0;
+
+    UDS_Routine_Register(UDS_RID_VCI_COLLECTION_START, UDS_SESSIONS_ALL, &g_vci_collection);
+    UDS_Routine_Register(UDS_RID_VCI_SEND_REPORT, UDS_SESSIONS_ALL, &g_vci_send_report);
+    UDS_Routine_Register(UDS_RID_CAPTURE_CONTROL, UDS_SESSIONS_ALL, &g_capture_control);
+    UDS_Routine_Register(UDS_RID_CAPTURE_EXPORT, UDS_SESSIONS_ALL, &g_capture_export);
+}
+
+boolean UDS_Routine_Register(uint16 routine_id, uint8 sessions, const UDS_Routine *routine)
+{
+    if (routine == NULL || routine->start == NULL || g_routine_count >= UDS_ROUTINE_MAX_ENTRIES
+        || FindRoutine(routine_id) != NULL)
+    {
+        return FALSE;
+    }
+
+    UDS_RoutineEntry *entry = &g_routines[g_routine_count++];
+    entry->routine_id = routine_id;
+    entry->sessions = sessions;
+    entry->state = UDS_ROUTINE_NOT_STARTED;
+    entry->nrc = 0;
+    entry->routine = routine;
+    return TRUE;
+}
+
+void UDS_Routine_Poll(void)
+{
+    for (uint8 i = 0; i < g_routine_count; i++)
+    {
+        UDS_RoutineEntry *entry = &g_routines[i];
+        if (entry->state != UDS_ROUTINE_RUNNING)
+        {
+            continue;
+        }
+
+        /* One step per pass: the main loop keeps serving everything else */
+        uint8 result = entry->routine->step();
+        if (result == UDS_ROUTINE_COMPLETED)
+        {
+            entry->state = UDS_ROUTINE_COMPLETED;
+        }
+        else if (result != UDS_ROUTINE_RUNNING)
+        {
+            entry->state = UDS_ROUTINE_FAILED;
+            entry->nrc = result;
+        }
+    }
+}
+
+void UDS_Routine_StopAll(void *ctx)
+{
+    for (uint8 i = 0; i < g_routine_count; i++)
+    {
+        UDS_RoutineEntry *entry = &g_routines[i];
+        if (entry->state != UDS_ROUTINE_RUNNING || entry->routine->cancel == NULL
+            || (ctx != NULL && entry->owner != ctx))
+        {
+            continue;
+        }
+
+        entry->routine->cancel();
+        entry->state = UDS_ROUTINE_STOPPED;
+    }
+}
+
+/*******************************************************************************
+ * UDS Service: 0x31 Routine Control
+ ******************************************************************************/
+
+boolean UDS_Service_RoutineControl(const UDS_Request *request, UDS_Response *response)
+{
+    /* [sub-function][RID_high][RID_low] - length checked by the service table */
+    uint8 sub_function = request->data[0] & UDS_SUBFUNCTION_MASK;
+    uint16 routine_id = ((uint16)request->data[1] << 8) | request->data[2];
+
+    if (sub_function < UDS_RC_START_ROUTINE || sub_function > UDS_RC_REQUEST_ROUTINE_RESULTS)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_SUBFUNCTION_NOT_SUPPORTED, response);
+        return TRUE;
+    }
+
+    /* Unknown routines and routines of other sessions are out of range */
+    UDS_RoutineEntry *entry = FindRoutine(routine_id);
+    if (entry == NULL || (entry->sessions & UDS_SESSION_MASK(UDS_GetSession())) == 0)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_OUT_OF_RANGE, response);
+        return TRUE;
+    }
+
+    /* Prepare positive response */
+    UDS_CreatePositiveResponse(request, response);
+
+    /* Echo sub-function and routine ID */
+    response->data[0] = sub_function;
+    response->data[1] = request->data[1];  /* RID high */
+    response->data[2] = request->data[2];  /* RID low */
+    response->data_len = 3;
+
+    if (entry->routine->step != NULL)
+    {
+        ControlBackground(entry, sub_function, request, response);
+        return TRUE;
+    }
+
+    /* Synchronous routine: its handlers write the status record */
+    const UDS_Routine *routine = entry->routine;
+    UDS_RoutineHandler handler = (sub_function == UDS_RC_START_ROUTINE) ? routine->start :
+                                 (sub_function == UDS_RC_STOP_ROUTINE) ? routine->stop : routine->results;
+    if (handler == NULL)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_SUBFUNCTION_NOT_SUPPORTED, response);
+        return TRUE;
+    }
+
+    handler(request, response);
+    return TRUE;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file uds_routine.h
+ * @brief UDS RoutineControl (0x31) with a routine registry
+ * @details Modules register their routines at init, uds_handler.c stays
+ *          unchanged. A routine either completes within the request
+ *          (synchronous: its handlers write the whole status record), or runs
+ *          in the background: StartRoutine only begins it, UDS_Routine_Poll()
+ *          steps it from the main loop, and the tester polls its state and
+ *          progress with RequestRoutineResults instead of holding a request
+ *          open with NRC 0x78. StopRoutine ends it early where supported.
+ *
+ *          Status record of background routines (after [sub][RID]):
+ *            0x01 Start:   [routineInfo]
+ *            0x02 Stop:    [routineInfo]
+ *            0x03 Results: [routineInfo][progress %][results record, once completed]
+ *          routineInfo is one of UDS_ROUTINE_COMPLETED..UDS_ROUTINE_FAILED;
+ *          a failed routine reports its NRC as the results record.
+ */
+
+#ifndef UDS_ROUTINE_H
+#define UDS_ROUTINE_H
+
+#include "uds_handler.h"
+
+/*******************************************************************************
+ * Routine Registry Configuration
+ ******************************************************************************/
+
+#define UDS_ROUTINE_MAX_ENTRIES     12      /* Registered routines */
+
+/* routineInfo of background routines; also the return value of a step */
+#define UDS_ROUTINE_COMPLETED       0x00    /* Finished successfully */
+#define UDS_ROUTINE_RUNNING         0x01
+#define UDS_ROUTINE_STOPPED         0x02    /* Ended by StopRoutine or a session change */
+#define UDS_ROUTINE_FAILED          0x03
+#define UDS_ROUTINE_NOT_STARTED     0xFF    /* Internal: results requested before start (NRC 0x24) */
+
+#define UDS_ROUTINE_PROGRESS_UNKNOWN 0xFF
+
+/*******************************************************************************
+ * Routine Callbacks
+ ******************************************************************************/
+
+/* Sub-function handler: response holds [sub][RID_H][RID_L] (data_len 3);
+ * append the record or create a negative response. For a background routine,
+ * start() only begins the work (a negative response: not started), stop()
+ * ends it, results() appends the results record of a completed run. */
+typedef void (*UDS_RoutineHandler)(const UDS_Request *request, UDS_Response *response);
+
+/* Background step from UDS_Routine_Poll(); return UDS_ROUTINE_RUNNING,
+ * UDS_ROUTINE_COMPLETED, or an NRC (failure) */
+typedef uint8 (*UDS_RoutineStep)(void);
+
+/* Percent done (0-100) of a running background routine */
+typedef uint8 (*UDS_RoutineProgress)(void);
+
+/* End a running background routine without a request (session transition) */
+typedef void (*UDS_RoutineCancel)(void);
+
+typedef struct
+{
+    UDS_RoutineHandler  start;      /* 0x01, required */
+    UDS_RoutineHandler  stop;       /* 0x02, NULL: not supported */
+    UDS_RoutineHandler  results;    /* 0x03, NULL: not supported (synchronous) / none (background) */
+    UDS_RoutineStep     step;       /* NULL: synchronous routine */
+    UDS_RoutineProgress progress;   /* NULL: UDS_ROUTINE_PROGRESS_UNKNOWN */
+    UDS_RoutineCancel   cancel;     /* NULL: keeps running across session transitions */
+
+} UDS_Routine;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize the registry with the gateway routines (call after UDS_Init)
+ */
+void UDS_Routine_Init(void);
+
+/**
+ * @brief Register a routine
+ * @param routine_id Routine Identifier
+ * @param sessions Sessions in which the routine is available (UDS_SESSION_MASK() bits)
+ * @param routine Callbacks (static storage)
+ * @return TRUE if registered, FALSE if the RID exists or the registry is full
+ */
+boolean UDS_Routine_Register(uint16 routine_id, uint8 sessions, const UDS_Routine *routine);
+
+/**
+ * @brief Step the running background routines (call from the main loop)
+ */
+void UDS_Routine_Poll(void);
+
+/**
+ * @brief Cancel the running background routines that support it
+ *        (session transition)
+ * @param ctx Connection that started them, NULL for all
+ */
+void UDS_Routine_StopAll(void *ctx);
+
+/**
+ * @brief Service 0x31 - Routine Control
+ * @param request UDS request [sub][RID]{[optionRecord]}
+ * @param response UDS response [sub][RID]{[statusRecord]}
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_RoutineControl(const UDS_Request *request, UDS_Response *response);
+
+#endif /* UDS_ROUTINE_H */
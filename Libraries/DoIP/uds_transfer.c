@@ -0,0 +1,876 @@
+/**
+ * @file uds_transfer.c
+ * @brief UDS Data Transfer Implementation (download into / upload from Flash4)
+ */
+
+#include "uds_transfer.h"
+#include "uds_routine.h"
+#include "Flash4_Driver.h"
+#include "AppConfig.h"
+#include "IfxStm.h"
+#include "UART_Logging.h"
+#include <string.h>
+#include <stdio.h>
+
+/*******************************************************************************
+ * Private Definitions
+ ******************************************************************************/
+
+#define TRANSFER_IDLE           0
+#define TRANSFER_DOWNLOAD       1
+#define TRANSFER_UPLOAD         2
+
+#define TRANSFER_DFI_PLAIN      0x00    /* No compression, no encryption */
+
+#define UPLOAD_NO_BUFFER        0xFF
+
+#define CHECK_CHUNK_SIZE        4096    /* CRC-32 bytes per routine step */
+#define CRC32_POLYNOMIAL        0xEDB88320UL
+
+/*******************************************************************************
+ * Private Variables
+ ******************************************************************************/
+
+/* Transfer opened by RequestDownload / RequestUpload */
+static struct {
+    uint8   state;
+    void   *owner;              /* Connection that opened it (UDS_GetConnection) */
+    uint32  address;            /* Download: Flash4 address of the next block */
+    uint32  remaining;          /* memorySize bytes not yet transferred */
+    uint32  total;
+    uint8   bsc;                /* Counter of the last accepted block */
+    uint32  blocks;             /* Blocks accepted */
+    boolean failed;             /* Erase/program error reported by the device */
+    uint64  start;              /* STM ticks at RequestDownload / RequestUpload */
+} g_transfer;
+
+/* TransferData block being received */
+static struct {
+    uint32  len;                /* Data bytes after the BSC */
+    uint8   bsc;
+    boolean repeat;             /* Block already handled: answer it again */
+} g_block;
+
+/* Double buffer: download receives one block while the writer programs the
+ * other; upload sends one block while the next is read ahead */
+static uint8 g_block_buffer[2][UDS_TRANSFER_BLOCK_SIZE];
+static uint8 g_rx_buffer = 0;
+
+/* Flash writer, advanced one QSPI command at a time from UDS_Transfer_Poll() */
+static struct {
+    boolean      busy;
+    const uint8 *data;
+    uint32       address;
+    uint32       length;
+    uint32       done;
+    uint32       erased_end;    /* First address past the erased sectors */
+} g_writer;
+
+/* Upload read-ahead */
+static struct {
+    boolean ram;                /* Source is on-chip RAM, not Flash4 */
+    uint32  fetch_address;      /* Source address of the next block to read */
+    uint32  fetch_remaining;    /* Bytes not yet read */
+    uint32  len[2];             /* Bytes held per buffer, 0 = free */
+    uint8   send;               /* Buffer of the next block to send */
+    uint8   last;               /* Buffer of the last block sent (kept for a repeat) */
+} g_upload;
+
+/* EraseMemory / CheckMemory background routine (one at a time) */
+static struct {
+    boolean active;
+    uint32  start;
+    uint32  address;
+    uint32  end;
+    boolean ram;
+    uint32  crc;
+} g_routine;
+
+static uint32 g_crc_table[256];
+
+/*******************************************************************************
+ * Private Functions
+ ******************************************************************************/
+
+static void WriterStart(const uint8 *data, uint32 address, uint32 length)
+{
+    g_writer.data = data;
+    g_writer.address = address;
+    g_writer.length = length;
+    g_writer.done = 0;
+    g_writer.busy = TRUE;
+}
+
+/* Issue the next erase or page program once the device is ready */
+static void WriterPoll(void)
+{
+    if (!g_writer.busy)
+    {
+        return;
+    }
+
+    uint8 status = Flash4_ReadStatusReg();
+    if ((status & FLASH4_SR1_WIP) != 0)
+    {
+        return;
+    }
+
+    if ((status & (FLASH4_SR1_E_ERR | FLASH4_SR1_P_ERR)) != 0)
+    {
+        g_transfer.failed = TRUE;
+        g_writer.busy = FALSE;
+        return;
+    }
+
+    if (g_writer.done >= g_writer.length)
+    {
+        g_writer.busy = FALSE;
+        return;
+    }
+
+    uint32 address = g_writer.address + g_writer.done;
+
+    /* Sectors are erased as the write pointer enters them */
+    if (address >= g_writer.erased_end)
+    {
+        Flash4_SectorErase(g_writer.erased_end);
+        g_writer.erased_end += FLASH4_SECTOR_SIZE;
+        return;
+    }
+
+    /* Page programs must not cross a page boundary */
+    uint32 chunk = FLASH4_MAX_PAGE_SIZE - (address % FLASH4_MAX_PAGE_SIZE);
+    if (chunk > g_writer.length - g_writer.done)
+    {
+        chunk = g_writer.length - g_writer.done;
+    }
+
+    Flash4_PageProgramStart(address, &g_writer.data[g_writer.done], (uint16)chunk);
+    g_writer.done += chunk;
+}
+
+static boolean WriterIdle(void)
+{
+    WriterPoll();
+    return !g_writer.busy;
+}
+
+/* A stopped erase leaves its last sector erasing in the device */
+static boolean RoutineIdle(void)
+{
+    return !g_routine.active && (Flash4_ReadStatusReg() & FLASH4_SR1_WIP) == 0;
+}
+
+static void BuildCrcTable(void)
+{
+    for (uint32 i = 0; i < 256; i++)
+    {
+        uint32 crc = i;
+        for (uint8 bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32_POLYNOMIAL : (crc >> 1);
+        }
+        g_crc_table[i] = crc;
+    }
+}
+
+static uint32 UpdateCrc(uint32 crc, const uint8 *data, uint32 len)
+{
+    for (uint32 i = 0; i < len; i++)
+    {
+        crc = g_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+/* Read the next upload block into a free buffer; one block per call */
+static void UploadPrefetch(void)
+{
+    if (g_transfer.state != TRANSFER_UPLOAD || g_upload.fetch_remaining == 0)
+    {
+        return;
+    }
+
+    /* The block to send next is read first, then the one after it */
+    uint8 buffer = g_upload.send;
+    if (g_upload.len[buffer] != 0)
+    {
+        buffer ^= 1;
+        if (g_upload.len[buffer] != 0 || buffer == g_upload.last)
+        {
+            return;
+        }
+    }
+
+    uint32 n = (g_upload.fetch_remaining < UDS_TRANSFER_UPLOAD_BLOCK_SIZE)
+             ? g_upload.fetch_remaining : UDS_TRANSFER_UPLOAD_BLOCK_SIZE;
+
+    if (g_upload.ram)
+    {
+        memcpy(g_block_buffer[buffer], (const uint8 *)g_upload.fetch_address, n);
+    }
+    else
+    {
+        Flash4_ReadFlash4(g_upload.fetch_address, g_block_buffer[buffer], (uint16)n);
+    }
+
+    g_upload.len[buffer] = n;
+    g_upload.fetch_address += n;
+    g_upload.fetch_remaining -= n;
+}
+
+static uint32 ReadBigEndian(const uint8 *data, uint8 len)
+{
+    uint32 value = 0;
+
+    for (uint8 i = 0; i < len; i++)
+    {
+        value = (value << 8) | data[i];
+    }
+
+    return value;
+}
+
+/* [ALFID][memoryAddress][memorySize]; returns 0 or an NRC */
+static uint8 ParseAddressAndSize(const uint8 *record, uint32 record_len, uint32 *address, uint32 *size)
+{
+    if (record_len < 1)
+    {
+        return UDS_NRC_INCORRECT_MESSAGE_LENGTH;
+    }
+
+    uint8 size_len = record[0] >> 4;
+    uint8 address_len = record[0] & 0x0F;
+
+    if (size_len < 1 || size_len > 4 || address_len < 1 || address_len > 4
+        || record_len != 1u + size_len + address_len)
+    {
+        return UDS_NRC_INCORRECT_MESSAGE_LENGTH;
+    }
+
+    if (g_transfer.state != TRANSFER_IDLE || !RoutineIdle())
+    {
+        return UDS_NRC_CONDITIONS_NOT_CORRECT;
+    }
+
+    *address = ReadBigEndian(&record[1], address_len);
+    *size = ReadBigEndian(&record[1 + address_len], size_len);
+
+    return (*size == 0) ? UDS_NRC_REQUEST_OUT_OF_RANGE : 0;
+}
+
+/* Common request layout of 0x34 / 0x35: [DFI][ALFID][memoryAddress][memorySize] */
+static uint8 ParseTransferRequest(const UDS_Request *request, uint32 *address, uint32 *size)
+{
+    uint8 nrc = ParseAddressAndSize(&request->data[1], request->data_len - 1u, address, size);
+
+    if (nrc == 0 && request->data[0] != TRANSFER_DFI_PLAIN)
+    {
+        nrc = UDS_NRC_REQUEST_OUT_OF_RANGE;
+    }
+
+    return nrc;
+}
+
+static boolean InRegion(uint32 address, uint32 size, uint32 region_start, uint32 region_size)
+{
+    return (address >= region_start && address - region_start < region_size
+            && size <= region_size - (address - region_start));
+}
+
+static void StartTransfer(uint8 state, uint32 address, uint32 size)
+{
+    g_transfer.state = state;
+    g_transfer.owner = UDS_GetConnection();
+    g_transfer.address = address;
+    g_transfer.remaining = size;
+    g_transfer.total = size;
+    g_transfer.bsc = 0;
+    g_transfer.blocks = 0;
+    g_transfer.failed = FALSE;
+    g_transfer.start = IfxStm_get(&MODULE_STM0);
+}
+
+static void LogTransfer(const char *what)
+{
+    uint32 elapsed_ms = (uint32)((IfxStm_get(&MODULE_STM0) - g_transfer.start)
+                                 / IfxStm_getTicksFromMilliseconds(&MODULE_STM0, 1));
+    char log_msg[80];
+    sprintf(log_msg, "[UDS] %s complete: %lu bytes in %lu ms\r\n",
+            what, (unsigned long)g_transfer.total, (unsigned long)elapsed_ms);
+    sendUARTMessage(log_msg, strlen(log_msg));
+}
+
+/*******************************************************************************
+ * TransferData (0x36) Streaming Service
+ ******************************************************************************/
+
+static uint8 TransferData_Begin(const UDS_Request *request, uint32 data_len)
+{
+    (void)request;
+
+    /* Another connection's transfer is not continued from here */
+    if (g_transfer.state != TRANSFER_IDLE && g_transfer.owner != UDS_GetConnection())
+    {
+        return UDS_NRC_REQUEST_SEQUENCE_ERROR;
+    }
+
+    if (g_transfer.state == TRANSFER_UPLOAD)
+    {
+        /* Upload requests carry the BSC only */
+        return (data_len == 1) ? 0 : UDS_NRC_INCORRECT_MESSAGE_LENGTH;
+    }
+
+    if (g_transfer.state != TRANSFER_DOWNLOAD)
+    {
+        return UDS_NRC_REQUEST_SEQUENCE_ERROR;
+    }
+
+    if (g_transfer.failed)
+    {
+        return UDS_NRC_GENERAL_PROGRAMMING_FAILURE;
+    }
+
+    /* BSC plus at least one byte, at most the negotiated block length */
+    if (data_len < 2 || data_len - 1 > UDS_TRANSFER_BLOCK_SIZE)
+    {
+        return UDS_NRC_INCORRECT_MESSAGE_LENGTH;
+    }
+
+    g_block.len = data_len - 1;
+    g_block.repeat = FALSE;
+    return 0;
+}
+
+static uint8 TransferData_Chunk(uint32 offset, const uint8 *data, uint32 len)
+{
+    if (offset == 0)
+    {
+        g_block.bsc = data[0];
+        g_block.repeat = FALSE;
+
+        /* A repeated block (lost response) is answered again, not redone */
+        if (g_transfer.blocks > 0 && g_block.bsc == g_transfer.bsc)
+        {
+            g_block.repeat = TRUE;
+            return 0;
+        }
+
+        if (g_block.bsc != (uint8)(g_transfer.bsc + 1))
+        {
+            return UDS_NRC_WRONG_BLOCK_SEQUENCE_COUNTER;
+        }
+
+        if (g_transfer.state == TRANSFER_UPLOAD)
+        {
+            return (g_transfer.remaining > 0) ? 0 : UDS_NRC_REQUEST_SEQUENCE_ERROR;
+        }
+
+        if (g_block.len > g_transfer.remaining)
+        {
+            return UDS_NRC_TRANSFER_DATA_SUSPENDED;
+        }
+
+        data++;
+        len--;
+    }
+    else
+    {
+        offset--;
+    }
+
+    if (!g_block.repeat && len > 0)
+    {
+        memcpy(&g_block_buffer[g_rx_buffer][offset], data, len);
+    }
+
+    return 0;
+}
+
+static boolean TransferData_Upload(const UDS_Request *request, UDS_Response *response)
+{
+    uint8 buffer = g_upload.last;
+
+    if (!g_block.repeat)
+    {
+        /* The previous block is acknowledged by this request: free its buffer */
+        if (g_upload.last != UPLOAD_NO_BUFFER)
+        {
+            g_upload.len[g_upload.last] = 0;
+        }
+
+        /* Normally read ahead already; only a slow main loop reads it here */
+        UploadPrefetch();
+
+        buffer = g_upload.send;
+        g_upload.last = buffer;
+        g_upload.send ^= 1;
+
+        g_transfer.remaining -= g_upload.len[buffer];
+        g_transfer.bsc = g_block.bsc;
+        g_transfer.blocks++;
+    }
+
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = g_block.bsc;
+    memcpy(&response->data[1], g_block_buffer[buffer], g_upload.len[buffer]);
+    response->data_len = (uint16)(1 + g_upload.len[buffer]);
+    return TRUE;
+}
+
+static boolean TransferData_End(const UDS_Request *request, uint32 data_len, UDS_Response *response)
+{
+    (void)data_len;
+
+    if (g_transfer.state == TRANSFER_UPLOAD)
+    {
+        return TransferData_Upload(request, response);
+    }
+
+    /* Aborted by a session change while the block was arriving */
+    if (g_transfer.state != TRANSFER_DOWNLOAD)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_SEQUENCE_ERROR, response);
+        return TRUE;
+    }
+
+    if (!g_block.repeat)
+    {
+        /* The other buffer is still being programmed: respond once it is free */
+        WriterPoll();
+        if (g_writer.busy)
+        {
+            return FALSE;
+        }
+
+        if (g_transfer.failed)
+        {
+            UDS_CreateNegativeResponse(request, UDS_NRC_GENERAL_PROGRAMMING_FAILURE, response);
+            return TRUE;
+        }
+
+        WriterStart(g_block_buffer[g_rx_buffer], g_transfer.address, g_block.len);
+        g_rx_buffer ^= 1;
+
+        g_transfer.address += g_block.len;
+        g_transfer.remaining -= g_block.len;
+        g_transfer.bsc = g_block.bsc;
+        g_transfer.blocks++;
+    }
+
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = g_block.bsc;
+    response->data_len = 1;
+    return TRUE;
+}
+
+static const UDS_StreamService g_transfer_data_service = {
+    TransferData_Begin,
+    TransferData_Chunk,
+    TransferData_End,
+    NULL                        /* Nothing is committed before end() */
+};
+
+/*******************************************************************************
+ * Jobs (completed from UDS_Poll(), see UDS_StartJob)
+ ******************************************************************************/
+
+/* A request that found the writer busy (aborted download still finishing):
+ * run it again once the writer is idle */
+static boolean WriterIdleJob(const UDS_Request *request, UDS_Response *response)
+{
+    if (!WriterIdle())
+    {
+        return FALSE;
+    }
+
+    switch (request->service_id)
+    {
+        case UDS_SID_REQUEST_DOWNLOAD:
+            return UDS_Service_RequestDownload(request, response);
+        case UDS_SID_REQUEST_UPLOAD:
+            return UDS_Service_RequestUpload(request, response);
+        default:
+            return UDS_Service_RequestTransferExit(request, response);
+    }
+}
+
+/*******************************************************************************
+ * Flash Routines (RoutineControl, stepped from UDS_Routine_Poll())
+ ******************************************************************************/
+
+/* Option record after [sub][RID]: [ALFID][memoryAddress][memorySize]; returns 0 or an NRC */
+static uint8 RoutineRange(const UDS_Request *request)
+{
+    uint32 address;
+    uint32 size;
+
+    uint8 nrc = ParseAddressAndSize(&request->data[3], request->data_len - 3u, &address, &size);
+    if (nrc != 0)
+    {
+        return nrc;
+    }
+
+    g_routine.start = address;
+    g_routine.address = address;
+    g_routine.end = address + size;
+    return 0;
+}
+
+static uint8 RoutineProgress(void)
+{
+    return (uint8)(((g_routine.address - g_routine.start) * 100u) / (g_routine.end - g_routine.start));
+}
+
+static void RoutineCancel(void)
+{
+    /* A sector erase already issued completes in the device */
+    g_routine.active = FALSE;
+}
+
+static void RoutineStop(const UDS_Request *request, UDS_Response *response)
+{
+    (void)request;
+    (void)response;
+
+    RoutineCancel();
+}
+
+/* 0xFF00 EraseMemory: staging sectors, programming session */
+static void EraseMemoryStart(const UDS_Request *request, UDS_Response *response)
+{
+    uint8 nrc = RoutineRange(request);
+    if (nrc == 0 && ((g_routine.start % FLASH4_SECTOR_SIZE) != 0
+                     || !InRegion(g_routine.start, g_routine.end - g_routine.start,
+                                  FLASH4_STAGING_ADDR, FLASH4_STAGING_SIZE)))
+    {
+        nrc = UDS_NRC_REQUEST_OUT_OF_RANGE;
+    }
+
+    if (nrc != 0)
+    {
+        UDS_CreateNegativeResponse(request, nrc, response);
+        return;
+    }
+
+    Flash4_WriteCommand(FLASH4_CMD_CLEAR_STATUS_REG);
+    g_routine.active = TRUE;
+}
+
+/* One sector per step; the device is polled, never waited for */
+static uint8 EraseMemoryStep(void)
+{
+    if (!WriterIdle())
+    {
+        return UDS_ROUTINE_RUNNING;
+    }
+
+    uint8 status = Flash4_ReadStatusReg();
+    if ((status & FLASH4_SR1_WIP) != 0)
+    {
+        return UDS_ROUTINE_RUNNING;
+    }
+
+    if ((status & FLASH4_SR1_E_ERR) != 0)
+    {
+        g_routine.active = FALSE;
+        return UDS_NRC_GENERAL_PROGRAMMING_FAILURE;
+    }
+
+    if (g_routine.address < g_routine.end)
+    {
+        Flash4_SectorErase(g_routine.address);
+        g_routine.address += FLASH4_SECTOR_SIZE;
+        return UDS_ROUTINE_RUNNING;
+    }
+
+    g_routine.active = FALSE;
+    sendUARTMessage("[UDS] Erase complete\r\n", 22);
+    return UDS_ROUTINE_COMPLETED;
+}
+
+/* 0x0202 CheckMemory: CRC-32 of a Flash4 or RAM range */
+static void CheckMemoryStart(const UDS_Request *request, UDS_Response *response)
+{
+    uint8 nrc = RoutineRange(request);
+    if (nrc == 0)
+    {
+        uint32 size = g_routine.end - g_routine.start;
+
+        if (InRegion(g_routine.start, size, UPLOAD_RAM_ADDR, UPLOAD_RAM_SIZE))
+        {
+            g_routine.ram = TRUE;
+        }
+        else if (InRegion(g_routine.start, size, 0, FLASH4_UPLOAD_LIMIT))
+        {
+            g_routine.ram = FALSE;
+        }
+        else
+        {
+            nrc = UDS_NRC_REQUEST_OUT_OF_RANGE;
+        }
+    }
+
+    if (nrc != 0)
+    {
+        UDS_CreateNegativeResponse(request, nrc, response);
+        return;
+    }
+
+    g_routine.crc = 0xFFFFFFFFUL;
+    g_routine.active = TRUE;
+}
+
+/* CHECK_CHUNK_SIZE bytes per step */
+static uint8 CheckMemoryStep(void)
+{
+    if (!WriterIdle())
+    {
+        return UDS_ROUTINE_RUNNING;
+    }
+
+    if (g_routine.address < g_routine.end)
+    {
+        uint32 n = g_routine.end - g_routine.address;
+        if (n > CHECK_CHUNK_SIZE)
+        {
+            n = CHECK_CHUNK_SIZE;
+        }
+
+        if (g_routine.ram)
+        {
+            g_routine.crc = UpdateCrc(g_routine.crc, (const uint8 *)g_routine.address, n);
+        }
+        else
+        {
+            Flash4_ReadFlash4(g_routine.address, g_block_buffer[0], (uint16)n);
+            g_routine.crc = UpdateCrc(g_routine.crc, g_block_buffer[0], n);
+        }
+
+        g_routine.address += n;
+        return UDS_ROUTINE_RUNNING;
+    }
+
+    g_routine.active = FALSE;
+    return UDS_ROUTINE_COMPLETED;
+}
+
+/* Results record: [CRC-32] */
+static void CheckMemoryResults(const UDS_Request *request, UDS_Response *response)
+{
+    (void)request;
+
+    uint32 crc = ~g_routine.crc;
+    uint8 *p = &response->data[response->data_len];
+    p[0] = (uint8)(crc >> 24);
+    p[1] = (uint8)(crc >> 16);
+    p[2] = (uint8)(crc >> 8);
+    p[3] = (uint8)crc;
+    response->data_len += 4;
+}
+
+static const UDS_Routine g_erase_memory_routine = {
+    .start    = EraseMemoryStart,
+    .stop     = RoutineStop,
+    .results  = NULL,
+    .step     = EraseMemoryStep,
+    .progress = RoutineProgress,
+    .cancel   = RoutineCancel
+};
+static const UDS_Routine g_check_memory_routine = {
+    .start    = CheckMemoryStart,
+    .stop     = RoutineStop,
+    .results  = CheckMemoryResults,
+    .step     = CheckMemoryStep,
+    .progress = RoutineProgress,
+    .cancel   = RoutineCancel
+};
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+
+void UDS_Transfer_Init(void)
+{
+    memset(&g_transfer, 0, sizeof(g_transfer));
+    memset(&g_writer, 0, sizeof(g_writer));
+    memset(&g_upload, 0, sizeof(g_upload));
+    memset(&g_routine, 0, sizeof(g_routine));
+    g_rx_buffer = 0;
+    BuildCrcTable();
+
+    UDS_RegisterStreamService(UDS_SID_TRANSFER_DATA, &g_transfer_data_service);
+    UDS_Routine_Register(UDS_RID_ERASE_MEMORY, UDS_SESSION_MASK(UDS_SESSION_PROGRAMMING),
+                         &g_erase_memory_routine);
+    UDS_Routine_Register(UDS_RID_CHECK_MEMORY, UDS_SESSIONS_ALL, &g_check_memory_routine);
+}
+
+void UDS_Transfer_Poll(void)
+{
+    WriterPoll();
+    UploadPrefetch();
+}
+
+void UDS_Transfer_Abort(void *ctx)
+{
+    if (g_transfer.state == TRANSFER_IDLE || (ctx != NULL && g_transfer.owner != ctx))
+    {
+        return;
+    }
+
+    g_transfer.state = TRANSFER_IDLE;
+    g_writer.length = g_writer.done;
+    sendUARTMessage("[UDS] Transfer aborted\r\n", 24);
+}
+
+boolean UDS_Transfer_Flash4Idle(void)
+{
+    return WriterIdle() && RoutineIdle();
+}
+
+/*******************************************************************************
+ * UDS Service: 0x34 - Request Download
+ ******************************************************************************/
+
+boolean UDS_Service_RequestDownload(const UDS_Request *request, UDS_Response *response)
+{
+    uint32 address;
+    uint32 size;
+
+    uint8 nrc = ParseTransferRequest(request, &address, &size);
+    if (nrc == 0 && ((address % FLASH4_SECTOR_SIZE) != 0
+                     || !InRegion(address, size, FLASH4_STAGING_ADDR, FLASH4_STAGING_SIZE)))
+    {
+        nrc = UDS_NRC_REQUEST_OUT_OF_RANGE;
+    }
+
+    if (nrc != 0)
+    {
+        UDS_CreateNegativeResponse(request, nrc, response);
+        return TRUE;
+    }
+
+    /* Previous transfer aborted mid-page: let that program finish first */
+    if (!WriterIdle())
+    {
+        return UDS_StartJob(WriterIdleJob);
+    }
+    Flash4_WriteCommand(FLASH4_CMD_CLEAR_STATUS_REG);     /* E_ERR/P_ERR are sticky */
+
+    StartTransfer(TRANSFER_DOWNLOAD, address, size);
+    g_writer.erased_end = address;
+    g_rx_buffer = 0;
+
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = 0x20;                  /* lengthFormatIdentifier: 2-byte block length */
+    response->data[1] = (uint8)(UDS_TRANSFER_MAX_BLOCK_LENGTH >> 8);
+    response->data[2] = (uint8)UDS_TRANSFER_MAX_BLOCK_LENGTH;
+    response->data_len = 3;
+
+    char log_msg[64];
+    sprintf(log_msg, "[UDS] Download 0x%08lX, %lu bytes\r\n", (unsigned long)address, (unsigned long)size);
+    sendUARTMessage(log_msg, strlen(log_msg));
+
+    return TRUE;
+}
+
+/*******************************************************************************
+ * UDS Service: 0x35 - Request Upload
+ ******************************************************************************/
+
+boolean UDS_Service_RequestUpload(const UDS_Request *request, UDS_Response *response)
+{
+    uint32 address;
+    uint32 size;
+    boolean ram = FALSE;
+
+    uint8 nrc = ParseTransferRequest(request, &address, &size);
+    if (nrc == 0)
+    {
+        if (InRegion(address, size, UPLOAD_RAM_ADDR, UPLOAD_RAM_SIZE))
+        {
+            ram = TRUE;
+        }
+        else if (!InRegion(address, size, 0, FLASH4_UPLOAD_LIMIT))
+        {
+            nrc = UDS_NRC_REQUEST_OUT_OF_RANGE;
+        }
+    }
+
+    if (nrc != 0)
+    {
+        UDS_CreateNegativeResponse(request, nrc, response);
+        return TRUE;
+    }
+
+    /* Reads must not overlap a program left over from an aborted download */
+    if (!WriterIdle())
+    {
+        return UDS_StartJob(WriterIdleJob);
+    }
+
+    StartTransfer(TRANSFER_UPLOAD, address, size);
+    g_upload.ram = ram;
+    g_upload.fetch_address = address;
+    g_upload.fetch_remaining = size;
+    g_upload.len[0] = 0;
+    g_upload.len[1] = 0;
+    g_upload.send = 0;
+    g_upload.last = UPLOAD_NO_BUFFER;
+
+    /* First block is read before the tester asks for it */
+    UploadPrefetch();
+
+    UDS_CreatePositiveResponse(request, response);
+    response->data[0] = 0x20;                  /* lengthFormatIdentifier: 2-byte block length */
+    response->data[1] = (uint8)(UDS_TRANSFER_MAX_UPLOAD_LENGTH >> 8);
+    response->data[2] = (uint8)UDS_TRANSFER_MAX_UPLOAD_LENGTH;
+    response->data_len = 3;
+
+    char log_msg[64];
+    sprintf(log_msg, "[UDS] Upload 0x%08lX, %lu bytes\r\n", (unsigned long)address, (unsigned long)size);
+    sendUARTMessage(log_msg, strlen(log_msg));
+
+    return TRUE;
+}
+
+/*******************************************************************************
+ * UDS Service: 0x37 - Request Transfer Exit
+ ******************************************************************************/
+
+boolean UDS_Service_RequestTransferExit(const UDS_Request *request, UDS_Response *response)
+{
+    if (g_transfer.state == TRANSFER_IDLE || g_transfer.owner != UDS_GetConnection()
+        || g_transfer.remaining != 0)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_REQUEST_SEQUENCE_ERROR, response);
+        return TRUE;
+    }
+
+    if (g_transfer.state == TRANSFER_UPLOAD)
+    {
+        g_transfer.state = TRANSFER_IDLE;
+        UDS_CreatePositiveResponse(request, response);
+        LogTransfer("Upload");
+        return TRUE;
+    }
+
+    /* Last block: answered once the writer has programmed it */
+    if (!WriterIdle())
+    {
+        return UDS_StartJob(WriterIdleJob);
+    }
+
+    g_transfer.state = TRANSFER_IDLE;
+
+    if (g_transfer.failed)
+    {
+        UDS_CreateNegativeResponse(request, UDS_NRC_GENERAL_PROGRAMMING_FAILURE, response);
+        return TRUE;
+    }
+
+    UDS_CreatePositiveResponse(request, response);
+    LogTransfer("Download");
+
+    return TRUE;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file uds_transfer.h
+ * @brief UDS Data Transfer (0x34 / 0x35 / 0x36 / 0x37) with Flash4 and RAM
+ * @details RequestDownload opens a download into the Flash4 staging area and
+ *          negotiates a maxNumberOfBlockLength of UDS_TRANSFER_BLOCK_SIZE data
+ *          bytes. TransferData blocks arrive through the streaming service
+ *          interface into one of two block buffers; while the next block is
+ *          received over TCP, the flash writer programs the previous one from
+ *          the main loop (sector erase on entry, page programs, WIP polled).
+ *          A block is acknowledged once the writer has taken it over, so the
+ *          tester pipeline runs at the slower of network and QSPI throughput.
+ *
+ *          RequestUpload reads Flash4 (lower 16 MB) or CPU0 DSPR through the
+ *          same two buffers: the block after the one being sent is read from
+ *          the main loop, so each TransferData request is answered from RAM
+ *          and the QSPI read never sits between request and response.
+ */
+
+#ifndef UDS_TRANSFER_H
+#define UDS_TRANSFER_H
+
+#include "uds_handler.h"
+
+/*******************************************************************************
+ * Transfer Configuration
+ ******************************************************************************/
+
+#define UDS_TRANSFER_BLOCK_SIZE     8192    /* TransferData bytes per block (after the BSC) */
+
+/* maxNumberOfBlockLength counts the whole request: SID + BSC + data */
+#define UDS_TRANSFER_MAX_BLOCK_LENGTH   (UDS_TRANSFER_BLOCK_SIZE + 2)
+
+/* Upload blocks are sent as one UDS response: BSC + data */
+#define UDS_TRANSFER_UPLOAD_BLOCK_SIZE  (UDS_MAX_RESPONSE_SIZE - 1)
+#define UDS_TRANSFER_MAX_UPLOAD_LENGTH  (UDS_TRANSFER_UPLOAD_BLOCK_SIZE + 2)
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Initialize the transfer engine, register TransferData (0x36) as a
+ *        streaming service and the flash routines EraseMemory 0xFF00 (staging
+ *        sectors, programming session) and CheckMemory 0x0202 (CRC-32 of a
+ *        Flash4 or RAM range) as background routines (call after UDS_Routine_Init)
+ */
+void UDS_Transfer_Init(void);
+
+/**
+ * @brief Drive the flash writer and the upload prefetch (call from the main loop)
+ */
+void UDS_Transfer_Poll(void);
+
+/**
+ * @brief Abort an active transfer (session change); the page being
+ *        programmed completes, nothing further is written
+ * @param ctx Connection that opened the transfer, NULL for any
+ */
+void UDS_Transfer_Abort(void *ctx);
+
+/**
+ * @brief Check that Flash4 can be read (no program, erase or flash routine in progress)
+ * @return TRUE if the flash writer and the flash routines are idle
+ */
+boolean UDS_Transfer_Flash4Idle(void);
+
+/**
+ * @brief Service 0x34 - Request Download
+ * @param request UDS request [DFI][ALFID][memoryAddress][memorySize]
+ * @param response UDS response [LFID][maxNumberOfBlockLength]
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_RequestDownload(const UDS_Request *request, UDS_Response *response);
+
+/**
+ * @brief Service 0x35 - Request Upload
+ * @param request UDS request [DFI][ALFID][memoryAddress][memorySize]
+ * @param response UDS response [LFID][maxNumberOfBlockLength]
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_RequestUpload(const UDS_Request *request, UDS_Response *response);
+
+/**
+ * @brief Service 0x37 - Request Transfer Exit
+ * @param request UDS request
+ * @param response UDS response
+ * @return TRUE if response is ready
+ */
+boolean UDS_Service_RequestTransferExit(const UDS_Request *request, UDS_Response *response);
+
+#endif /* UDS_TRANSFER_H */
@@ -96,6 +96,7 @@
 #include "Ifx_Netif.h"
 #include "IfxGeth_Phy_Dp83825i.h"
 #include "Configuration.h"
+#include "doip_capture.h"
 #include <string.h>
 
 /* Define those to better describe your network interface. */
@@ -114,6 +115,9 @@ struct ethernetif
     /* Add whatever per-interface state that is needed here. */
 };
 
+/* Snapshot of a TX frame spread over a pbuf chain (e.g. TCP header and data apart) */
+static u8_t g_capture_tx[DOIP_CAPTURE_SNAPLEN];
+
 /* pin configuration DP83825I*/
 const IfxGeth_Eth_RmiiPins rmii_pins = {
                                    .crsDiv = &ETH_CRSDIV_PIN,   /* CRSDIV */
@@ -278,6 +282,17 @@ static err_t low_level_output(netif_t *netif, pbuf_t *p)
     pbuf_header(p, -ETH_PAD_SIZE); /* drop the padding word */
 #endif
 
+    /* the snapshot may reach past the first pbuf: collect it from the chain */
+    if (p->len >= DOIP_CAPTURE_SNAPLEN || p->next == NULL)
+    {
+        DoIP_Capture_Frame(p->payload, p->len, p->tot_len);
+    }
+    else if (DoIP_Capture_GetStats()->running)
+    {
+        u16_t snap = (p->tot_len < DOIP_CAPTURE_SNAPLEN) ? p->tot_len : DOIP_CAPTURE_SNAPLEN;
+        DoIP_Capture_Frame(g_capture_tx, pbuf_copy_partial(p, g_capture_tx, snap, 0), p->tot_len);
+    }
+
     if ((p->type_internal == PBUF_REF) || (p->type_internal == PBUF_ROM))
     {
         // if PBUF_REF or PBUF_ROM, no copy into ethernet RAM buffer is needed.
@@ -384,6 +399,9 @@ static pbuf_t *low_level_input(netif_t *netif)
 
         u8_t *src = IfxGeth_Eth_getReceiveBuffer(ethernetif, IfxGeth_RxDmaChannel_0);
 
+        /* the receive buffer holds the whole frame without padding */
+        DoIP_Capture_Frame(src, p->tot_len, p->tot_len);
+
         /* We iterate over the pbuf chain until we have read the entire
          * packet into the pbuf. */
         for (q = p; q != NULL; q = q->next)
@@ -188,37 +188,43 @@ void Flash4_SectorErase(uint32 address)
 
 void Flash4_PageProgram(uint32 address, const uint8 *data, uint16 length)
 {
-    uint8 txBuffer[516];
-    uint16 i;
     uint16 pageSize = 512;
     uint16 offset = 0;
     
     while (offset < length)
     {
         uint16 chunkSize = (length - offset) > pageSize ? pageSize : (length - offset);
-        uint16 totalLength = 4 + chunkSize;
-        
-        Flash4_WriteEnable();
-        
-        txBuffer[0] = FLASH4_CMD_PAGE_PROGRAM;
-        txBuffer[1] = (uint8)(((address + offset) >> 16) & 0xFF);
-        txBuffer[2] = (uint8)(((address + offset) >> 8) & 0xFF);
-        txBuffer[3] = (uint8)((address + offset) & 0xFF);
-        
-        for (i = 0; i < chunkSize; i++)
-        {
-            txBuffer[4 + i] = data[offset + i];
-        }
-        
-        IfxQspi_SpiMaster_exchange(&g_qspiFlashChannel, txBuffer, NULL_PTR, totalLength);
-        while (IfxQspi_SpiMaster_getStatus(&g_qspiFlashChannel) == IfxQspi_Status_busy);
         
+        Flash4_PageProgramStart(address + offset, &data[offset], chunkSize);
         Flash4_WaitReady(10);
         
         offset += chunkSize;
     }
 }
 
+/* Shift one page program command out and return while the device programs
+ * (poll WIP for completion). data may be reused once this returns. */
+void Flash4_PageProgramStart(uint32 address, const uint8 *data, uint16 length)
+{
+    static uint8 txBuffer[4 + FLASH4_MAX_PAGE_SIZE];
+    
+    if (length > FLASH4_MAX_PAGE_SIZE)
+    {
+        length = FLASH4_MAX_PAGE_SIZE;
+    }
+    
+    Flash4_WriteEnable();
+    
+    txBuffer[0] = FLASH4_CMD_PAGE_PROGRAM;
+    txBuffer[1] = (uint8)((address >> 16) & 0xFF);
+    txBuffer[2] = (uint8)((address >> 8) & 0xFF);
+    txBuffer[3] = (uint8)(address & 0xFF);
+    memcpy(&txBuffer[4], data, length);
+    
+    IfxQspi_SpiMaster_exchange(&g_qspiFlashChannel, txBuffer, NULL_PTR, 4 + length);
+    while (IfxQspi_SpiMaster_getStatus(&g_qspiFlashChannel) == IfxQspi_Status_busy);
+}
+
 void Flash4_ReadFlash4(uint32 address, uint8 *outData, uint16 nData)
 {
     uint8 txBuffer[516];
@@ -19,6 +19,7 @@
 #define FLASH4_CMD_READ_FLASH                    0x03
 #define FLASH4_CMD_PAGE_PROGRAM                  0x02
 #define FLASH4_CMD_SECTOR_ERASE                  0xD8
+#define FLASH4_CMD_CLEAR_STATUS_REG              0x30
 #define FLASH4_CMD_RESET_ENABLE                  0x66
 #define FLASH4_CMD_RESET                         0x99
 
@@ -29,6 +30,12 @@
 
 /* Configuration */
 #define FLASH4_MAX_PAGE_SIZE                     512
+#define FLASH4_SECTOR_SIZE                       0x40000UL   /* 256 KB uniform sectors */
+
+/* Status Register 1 bits */
+#define FLASH4_SR1_WIP                           0x01
+#define FLASH4_SR1_E_ERR                         0x20
+#define FLASH4_SR1_P_ERR                         0x40
 
 /* Return Values */
 #define FLASH4_OK                                0
@@ -40,6 +47,7 @@ void Flash4_WriteCommand(uint8 cmd);
 void Flash4_ReadManufacturerId(uint8 *deviceId);
 void Flash4_ReadFlash4(uint32 address, uint8 *outData, uint16 nData);
 void Flash4_PageProgram(uint32 address, const uint8 *data, uint16 length);
+void Flash4_PageProgramStart(uint32 address, const uint8 *data, uint16 length);
 void Flash4_SectorErase(uint32 address);
 void Flash4_WriteEnable(void);
 boolean Flash4_CheckWIP(void);
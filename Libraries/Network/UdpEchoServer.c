@@ -9,6 +9,11 @@
 #include "AppConfig.h"
 #include "UART_Logging.h"
 #include "Libraries/DoIP/doip_types.h"
+#include "Libraries/DoIP/doip_vehicle_id.h"
+#include "Libraries/DoIP/doip_router.h"
+#include "Libraries/DoIP/uds_comm.h"
+#include "Libraries/DoIP/uds_did.h"
+#include "Libraries/DoIP/uds_dtc.h"
 #include "lwip/udp.h"
 #include "lwip/pbuf.h"
 #include <string.h>
@@ -27,10 +32,29 @@ static void udp_echo_recv_callback(void *arg, struct udp_pcb *upcb, struct pbuf
         return;
     }
     
-    /* Check if this is a VCI message (Magic Number + 48 bytes) */
-    if (p->tot_len == (4 + 48)) {
-        uint8 buffer[52];
-        pbuf_copy_partial(p, buffer, 52, 0);
+    /* Responses from zone ECUs reached over UDP go back to the requester */
+    if (DoIP_Router_HandleDatagram(p, addr)) {
+        pbuf_free(p);
+        return;
+    }
+    
+    /* DoIP vehicle identification requests take the fast path */
+    if (DoIP_VehicleId_HandleDatagram(p, addr, port)) {
+        pbuf_free(p);
+        return;
+    }
+    
+    /* Check if this is a VCI message (Magic Number + 48 bytes);
+     * ignored while reception is off (CommunicationControl) */
+    if (p->tot_len == (4 + 48) && UDS_Comm_RxEnabled(UDS_COMM_SUBNET_ETHERNET, UDS_COMM_TYPE_NORMAL)) {
+        uint8 copy[52];
+        const uint8 *buffer = (const uint8 *)p->payload;
+        
+        /* Parse in place; copy only if the datagram is split across pbufs */
+        if (p->len < 52) {
+            pbuf_copy_partial(p, copy, 52, 0);
+            buffer = copy;
+        }
         
         /* Check VCI magic number */
         uint32 magic = ((uint32)buffer[0] << 24) | ((uint32)buffer[1] << 16) |
@@ -45,6 +69,7 @@ static void udp_echo_recv_callback(void *arg, struct udp_pcb *upcb, struct pbuf
             memcpy(vci->serial_num, &buffer[36], 16);
             
             g_zone_ecu_count++;
+            UDS_DID_DataChanged();
             
             /* Log received VCI */
             sendUARTMessage("[VCI] Received from ", 20);
@@ -62,6 +87,8 @@ static void udp_echo_recv_callback(void *arg, struct udp_pcb *upcb, struct pbuf
                 /* Add ZG's own VCI */
                 memcpy(&g_vci_database[g_zone_ecu_count], &g_zgw_vci, sizeof(DoIP_VCI_Info));
                 g_vci_collection_complete = TRUE;
+                UDS_DID_DataChanged();
+                UDS_DTC_SetTestResult(UDS_DTC_ZONE_ECU_VCI_MISSING, FALSE);
                 
                 sendUARTMessage("[VCI] Ready to send to VMG\r\n", 29);
             }
@@ -89,6 +116,7 @@ void udp_echo_server_init(void)
     }
     
     udp_recv(g_udp_server_pcb, udp_echo_recv_callback, NULL);
+    DoIP_VehicleId_Init(g_udp_server_pcb, DOIP_ZONAL_GW_ADDRESS);
     
     sendUARTMessage("UDP Echo Server started on port 13400\r\n", 40);
 }
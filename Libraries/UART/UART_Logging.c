@@ -49,6 +49,7 @@
 /*********************************************************************************************************************/
 IfxAsclin_Asc g_asc;                                                        /* Declaration of the ASC handle        */
 uint8 g_ascTxBuffer[ASC_TX_BUFFER_SIZE + sizeof(Ifx_Fifo) + 8];             /* Declaration of the FIFO parameters   */
+static boolean g_uartLoggingEnabled = TRUE;                                 /* Cleared by CommunicationControl      */
 
 /*********************************************************************************************************************/
 /*---------------------------------------------Function Implementations----------------------------------------------*/
@@ -93,5 +94,21 @@ void initUART(void)
 
 void sendUARTMessage(char * msg, Ifx_SizeT count)
 {
+    /* A muted log drops messages instead of blocking on the 64-byte FIFO */
+    if (!g_uartLoggingEnabled)
+    {
+        return;
+    }
+
     IfxAsclin_Asc_write(&g_asc, msg, &count, TIME_INFINITE);            /* Transfer of data                         */
 }
+
+void setUARTLogging(boolean enabled)
+{
+    g_uartLoggingEnabled = enabled;
+}
+
+boolean isUARTLoggingEnabled(void)
+{
+    return g_uartLoggingEnabled;
+}
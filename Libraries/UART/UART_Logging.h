@@ -38,5 +38,7 @@
 /*********************************************************************************************************************/
 void initUART(void);                                    /* Initialization function  */
 void sendUARTMessage(char * msg, Ifx_SizeT count);      /* Send function            */
+void setUARTLogging(boolean enabled);                   /* Mute/unmute the log      */
+boolean isUARTLoggingEnabled(void);                     /* Log currently enabled    */
 
 #endif /* UART_LOGGING_H_ */
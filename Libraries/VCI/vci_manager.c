@@ -9,6 +9,9 @@
 #include "AppConfig.h"
 #include "UART_Logging.h"
 #include "Libraries/DoIP/doip_types.h"
+#include "Libraries/DoIP/uds_comm.h"
+#include "Libraries/DoIP/uds_did.h"
+#include "Libraries/DoIP/uds_dtc.h"
 #include "IfxStm.h"
 #include "lwip/udp.h"
 #include "lwip/pbuf.h"
@@ -37,6 +40,12 @@ void VCI_SendCollectionRequest(void)
         return;
     }
     
+    if (!UDS_Comm_TxEnabled(UDS_COMM_SUBNET_ETHERNET, UDS_COMM_TYPE_NORMAL))
+    {
+        sendUARTMessage("[VCI] Broadcast suppressed\r\n", 28);
+        return;
+    }
+    
     /* Prepare VCI request packet: [Magic: "RQST"] */
     uint8 request[4] = {0x52, 0x51, 0x53, 0x54};  /* "RQST" */
     
@@ -83,6 +92,7 @@ void VCI_StartCollection(void)
     
     /* Re-add ZGW VCI to database at index 0 */
     memcpy(&g_vci_database[0], &g_zgw_vci, sizeof(DoIP_VCI_Info));
+    UDS_DID_DataChanged();
     
     /* Start collection timer */
     g_vci_collection_active = TRUE;
@@ -116,6 +126,10 @@ void VCI_CheckCollectionTimeout(void)
         
         /* Add ZG's VCI to the end */
         memcpy(&g_vci_database[g_zone_ecu_count], &g_zgw_vci, sizeof(DoIP_VCI_Info));
+        UDS_DID_DataChanged();
+        
+        /* Not every Zone ECU answered */
+        UDS_DTC_SetTestResult(UDS_DTC_ZONE_ECU_VCI_MISSING, TRUE);
         
         char msg[64];
         sprintf(msg, "[VCI] Collection timeout (%d Zone ECUs + ZGW)\r\n", g_zone_ecu_count);
@@ -18,7 +18,18 @@
 #include "lwip/udp.h"
 #include "lwip/pbuf.h"
 #include "Libraries/DoIP/doip_client.h"
+#include "Libraries/DoIP/doip_server.h"
+#include "Libraries/DoIP/doip_vehicle_id.h"
+#include "Libraries/DoIP/doip_router.h"
+#include "Libraries/DoIP/doip_capture.h"
 #include "Libraries/DoIP/uds_handler.h"
+#include "Libraries/DoIP/uds_did.h"
+#include "Libraries/DoIP/uds_dtc.h"
+#include "Libraries/DoIP/uds_memory.h"
+#include "Libraries/DoIP/uds_periodic.h"
+#include "Libraries/DoIP/uds_reset.h"
+#include "Libraries/DoIP/uds_routine.h"
+#include "Libraries/DoIP/uds_transfer.h"
 #include "Flash4_Driver.h"
 #include "Flash4_Test.h"
 #include "TcpEchoServer.h"
@@ -30,6 +41,7 @@ extern IFX_ALIGN(4) IfxCpu_syncEvent g_cpuSyncEvent;
 extern struct tcp_pcb *g_tcp_server_pcb;
 extern struct udp_pcb *g_udp_server_pcb;
 extern DoIP_VCI_Info g_zgw_vci;
+extern uint8 g_zone_ecu_count;
 extern DoIP_HealthStatus_Info g_health_data[MAX_ZONE_ECUS + 1];
 
 static void Init_System(void);
@@ -37,8 +49,8 @@ static void Init_STM_Timer(void);
 static void Init_Ethernet(void);
 static void Wait_PHY_Link(void);
 static void Init_DoIP(void);
-static void Init_VCI(void);
-static void Init_Health_Database(void);
+static void Init_VCI(boolean warm);
+static void Init_Health_Database(boolean warm);
 static void Print_System_Ready(void);
 
 static void Init_System(void)
@@ -109,18 +121,52 @@ static void Wait_PHY_Link(void)
 
 static void Init_DoIP(void)
 {
+    /* DoIP traffic is captured from startup; read out with RoutineControl 0xF011 */
+    DoIP_Capture_Init();
+    DoIP_Capture_Start(DOIP_CAPTURE_PORT_DOIP);
+    
     DoIP_ClientConfig doip_config;
-    IP4_ADDR(&doip_config.vmg_ip, VMG_IP_ADDR_0, VMG_IP_ADDR_1, VMG_IP_ADDR_2, VMG_IP_ADDR_3);
-    doip_config.vmg_port = VMG_PORT;
+    IP4_ADDR(&doip_config.vmg[0].ip, VMG_IP_ADDR_0, VMG_IP_ADDR_1, VMG_IP_ADDR_2, VMG_IP_ADDR_3);
+    doip_config.vmg[0].port = VMG_PORT;
+    IP4_ADDR(&doip_config.vmg[1].ip, VMG2_IP_ADDR_0, VMG2_IP_ADDR_1, VMG2_IP_ADDR_2, VMG2_IP_ADDR_3);
+    doip_config.vmg[1].port = VMG2_PORT;
+    doip_config.vmg_count = 2;
     doip_config.source_address = DOIP_ZONAL_GW_ADDRESS;
     DoIP_Client_Init(&doip_config);
-    sendUARTMessage("[DoIP] Client ready (will connect in 5s)\r\n", 43);
+    
+    /* Warm reset: reconnect to the VMG that was active, keep the link statistics */
+    const DoIP_ClientResume *resume = UDS_Reset_GetClientResume();
+    if (resume != NULL)
+    {
+        DoIP_Client_Resume(resume);
+    }
+    sendUARTMessage("[DoIP] Client ready\r\n", 21);
+    
+    if (DoIP_Server_Init(DOIP_ZONAL_GW_ADDRESS))
+    {
+        sendUARTMessage("[DoIP] Server listening on TCP 13400\r\n", 38);
+    }
+    
+    /* Requests addressed to zone ECUs are forwarded by the gateway */
+    ip_addr_t zone_ecu_ip;
+    IP4_ADDR(&zone_ecu_ip, ZONE_ECU_IP_ADDR_0, ZONE_ECU_IP_ADDR_1, ZONE_ECU_IP_ADDR_2, ZONE_ECU_IP_ADDR_3);
+    DoIP_Router_Init(DOIP_ZONAL_GW_ADDRESS, g_udp_server_pcb);
+    DoIP_Router_AddRoute(ZONE_ECU_LOGICAL_ADDR, &zone_ecu_ip, ZONE_ECU_DOIP_PORT, DOIP_ROUTE_UDP);
+    
+    /* Sent once the link is up: let testers discover the gateway */
+    DoIP_VehicleId_StartAnnouncement();
     
     UDS_Init();
+    UDS_DID_Init();
+    UDS_DTC_Init();
+    UDS_Memory_Init();
+    UDS_Periodic_Init();
+    UDS_Routine_Init();
+    UDS_Transfer_Init();
     sendUARTMessage("[UDS] Handler initialized\r\n", 27);
 }
 
-static void Init_VCI(void)
+static void Init_VCI(boolean warm)
 {
     memcpy(g_zgw_vci.ecu_id, ZGW_ECU_ID, sizeof(ZGW_ECU_ID));
     memcpy(g_zgw_vci.sw_version, ZGW_SW_VERSION, sizeof(ZGW_SW_VERSION));
@@ -136,6 +182,15 @@ static void Init_VCI(void)
     sendUARTMessage(g_zgw_vci.serial_num, strlen(g_zgw_vci.serial_num));
     sendUARTMessage("\r\n", 2);
     
+    /* Database from before the warm reset: no re-collection needed */
+    if (warm)
+    {
+        char msg[64];
+        sprintf(msg, "[VCI] Restored (%d/%d Zone ECUs)\r\n", g_zone_ecu_count, MAX_ZONE_ECUS);
+        sendUARTMessage(msg, strlen(msg));
+        return;
+    }
+    
     sendUARTMessage("[VCI] Waiting for Zone ECUs to send VCI (0/", 43);
     char max_str[4];
     sprintf(max_str, "%d", MAX_ZONE_ECUS);
@@ -143,8 +198,15 @@ static void Init_VCI(void)
     sendUARTMessage(")...\r\n", 6);
 }
 
-static void Init_Health_Database(void)
+static void Init_Health_Database(boolean warm)
 {
+    if (warm)
+    {
+        UDS_DTC_BindHealth(&g_health_data[1]);
+        sendUARTMessage("[Health] Status restored\r\n", 26);
+        return;
+    }
+    
     memcpy(g_health_data[0].ecu_id, ZONE_ECU_ID, sizeof(ZONE_ECU_ID));
     g_health_data[0].health_status = HEALTH_STATUS_OK;
     g_health_data[0].dtc_count = 0;
@@ -153,9 +215,9 @@ static void Init_Health_Database(void)
     
     memcpy(g_health_data[1].ecu_id, ZGW_ECU_ID, sizeof(ZGW_ECU_ID));
     g_health_data[1].health_status = HEALTH_STATUS_OK;
-    g_health_data[1].dtc_count = 0;
     g_health_data[1].battery_voltage = 1320;
     g_health_data[1].temperature = 68;
+    UDS_DTC_BindHealth(&g_health_data[1]);  /* dtc_count follows the DTC memory */
     
     sendUARTMessage("[Health] Status initialized (2 ECUs)\r\n", 39);
 }
@@ -167,6 +229,9 @@ static void Print_System_Ready(void)
     sendUARTMessage("- TCP Echo:    8765\r\n", 21);
     sendUARTMessage("- UDP Echo:    13400\r\n", 22);
     sendUARTMessage("- DoIP Client: VMG @ 192.168.1.100:13400\r\n", 43);
+    sendUARTMessage("               standby 192.168.1.101:13400\r\n", 44);
+    sendUARTMessage("- DoIP Server: 13400 (4 tester sockets)\r\n", 41);
+    sendUARTMessage("- DoIP Router: 0x0011 -> 192.168.1.11 (UDP)\r\n", 45);
     sendUARTMessage("- VCI:         Command-based (use UDS 0x31)\r\n", 46);
     sendUARTMessage("  * 0x31 01 F001: Start VCI collection\r\n", 40);
     sendUARTMessage("  * 0x31 01 F002: Send VCI report\r\n", 34);
@@ -177,21 +242,35 @@ void SystemInit_All(void)
 {
     Init_System();
     
+    /* Before anything writes the runtime data the cache restores */
+    boolean warm = UDS_Reset_RestoreCache();
+    
     initUART();
     sendUARTMessage("Zonal Gateway Starting...\r\n", 28);
+    if (warm)
+    {
+        sendUARTMessage("Warm reset: runtime cache restored\r\n", 36);
+    }
     
     Init_STM_Timer();
     Flash4_Init();
-    Test_Flash4();
+    if (!warm)
+    {
+        Test_Flash4();
+    }
     Init_Ethernet();
     
     tcp_echo_server_init();
     udp_echo_server_init();
     
-    Wait_PHY_Link();
+    /* Warm: the PHY kept its link; DoIP connects once lwIP reports it */
+    if (!warm)
+    {
+        Wait_PHY_Link();
+    }
     Init_DoIP();
-    Init_VCI();
-    Init_Health_Database();
+    Init_VCI(warm);
+    Init_Health_Database(warm);
     Print_System_Ready();
 }
 
@@ -6,6 +6,15 @@
 #include "SystemMain.h"
 #include "Ifx_Lwip.h"
 #include "Libraries/DoIP/doip_client.h"
+#include "Libraries/DoIP/doip_server.h"
+#include "Libraries/DoIP/doip_router.h"
+#include "Libraries/DoIP/doip_vehicle_id.h"
+#include "Libraries/DoIP/uds_handler.h"
+#include "Libraries/DoIP/uds_dtc.h"
+#include "Libraries/DoIP/uds_periodic.h"
+#include "Libraries/DoIP/uds_reset.h"
+#include "Libraries/DoIP/uds_routine.h"
+#include "Libraries/DoIP/uds_transfer.h"
 #include "vci_manager.h"
 
 void SystemMain_Loop(void)
@@ -14,7 +23,16 @@ void SystemMain_Loop(void)
     {
         Ifx_Lwip_pollTimerFlags();
         Ifx_Lwip_pollReceiveFlags();
+        UDS_Poll();
+        UDS_Periodic_Poll();
+        UDS_Routine_Poll();
+        UDS_Transfer_Poll();
+        UDS_DTC_Poll();
+        UDS_Reset_Poll();
         DoIP_Client_Poll();
+        DoIP_Server_Poll();
+        DoIP_Router_Poll();
+        DoIP_VehicleId_Poll();
         VCI_CheckCollectionTimeout();
     }
 }
@@ -1,7 +1,12 @@
 #!/usr/bin/env python3
 """
 ECU_011 Simulator
-Simulates Zone ECU that listens for VCI broadcast requests and responds
+Simulates Zone ECU that listens for VCI broadcast requests and responds.
+Also answers UDS requests forwarded by the ZGW router (DoIP over UDP 13400).
+
+Benchmark mode (--benchmark) additionally acts as tester: it connects to the
+ZGW on TCP 13400, sends requests addressed to ECU_011 and measures the
+gateway's forwarding latency in both directions.
 """
 
 import socket
@@ -17,6 +22,17 @@ class ECU_011_Simulator:
     VCI_MAGIC = 0x56434921  # "VCI!"
     VCI_REQUEST_MAGIC = b'RQST'  # VCI collection request from ZGW
     
+    # DoIP
+    DOIP_VERSION = 0x02
+    DOIP_INVERSE = 0xFD
+    DOIP_ROUTING_ACTIVATION_REQ = 0x0005
+    DOIP_ROUTING_ACTIVATION_RES = 0x0006
+    DOIP_DIAG_MESSAGE = 0x8001
+    DOIP_DIAG_ACK = 0x8002
+    DOIP_DIAG_NACK = 0x8003
+    
+    ECU_ADDRESS = 0x0011
+    
     def __init__(self, listen_port=13400):
         self.listen_port = listen_port
         
@@ -33,6 +49,9 @@ class ECU_011_Simulator:
         
         self.running = False
         
+        # Benchmark: receive / send time of forwarded requests, keyed by DID
+        self.forward_times = {}
+        
     def create_vci_message(self):
         """Create VCI message payload"""
         # Message format:
@@ -67,6 +86,37 @@ class ECU_011_Simulator:
             print(f"[ECU_011] Failed to send VCI response: {e}")
             return False
     
+    def handle_diagnostic_message(self, data, addr):
+        """Answer a UDS request forwarded by the ZGW (DoIP diagnostic message)"""
+        t_rx = time.perf_counter()
+        
+        if len(data) < 13:
+            return False
+        
+        version, inverse, payload_type, length = struct.unpack('!BBHI', data[:8])
+        if version != self.DOIP_VERSION or inverse != self.DOIP_INVERSE:
+            return False
+        if payload_type != self.DOIP_DIAG_MESSAGE:
+            return True
+        
+        source, target = struct.unpack('!HH', data[8:12])
+        uds = data[12:8 + length]
+        if target != self.ECU_ADDRESS:
+            return True
+        
+        # Positive response: SID + 0x40, echo parameters, 4 bytes of data
+        response = bytes([uds[0] + 0x40]) + uds[1:] + b'\x01\x02\x03\x04'
+        payload = struct.pack('!HH', self.ECU_ADDRESS, source) + response
+        frame = struct.pack('!BBHI', self.DOIP_VERSION, self.DOIP_INVERSE,
+                            self.DOIP_DIAG_MESSAGE, len(payload)) + payload
+        
+        t_tx = time.perf_counter()
+        self.sock.sendto(frame, addr)
+        
+        if len(uds) >= 3:
+            self.forward_times[(uds[1] << 8) | uds[2]] = (t_rx, t_tx)
+        return True
+    
     def listen_for_requests(self):
         """Listen for VCI collection requests from ZGW"""
         try:
@@ -83,6 +133,10 @@ class ECU_011_Simulator:
                     self.sock.settimeout(1.0)  # 1 second timeout for clean shutdown
                     data, addr = self.sock.recvfrom(1024)
                     
+                    # UDS request routed by the ZGW
+                    if self.handle_diagnostic_message(data, addr):
+                        continue
+                    
                     # Check if this is a VCI collection request
                     if data == self.VCI_REQUEST_MAGIC:
                         print(f"\n[ECU_011] ✓ VCI Request received from {addr[0]}:{addr[1]}")
@@ -120,11 +174,112 @@ class ECU_011_Simulator:
             self.running = False
 
 
+def recv_doip_frame(sock):
+    """Read one DoIP frame from a TCP socket: (payload_type, payload)"""
+    def recv_exact(n):
+        buf = b''
+        while len(buf) < n:
+            chunk = sock.recv(n - len(buf))
+            if not chunk:
+                raise ConnectionError("connection closed")
+            buf += chunk
+        return buf
+    
+    header = recv_exact(8)
+    _, _, payload_type, length = struct.unpack('!BBHI', header)
+    return payload_type, recv_exact(length)
+
+
+def percentile(values, pct):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * pct / 100))]
+
+
+def run_benchmark(ecu, zgw_ip, count, tester_address=0x0E00):
+    """Measure ZGW forwarding latency: tester -> ZGW -> ECU_011 -> ZGW -> tester"""
+    C = ECU_011_Simulator
+    
+    listener = threading.Thread(target=ecu.listen_for_requests, daemon=True)
+    listener.start()
+    time.sleep(0.5)
+    
+    sock = socket.create_connection((zgw_ip, 13400), timeout=5.0)
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    
+    # Routing activation as external tester
+    payload = struct.pack('!HB4s', tester_address, 0x00, b'\x00' * 4)
+    sock.sendall(struct.pack('!BBHI', C.DOIP_VERSION, C.DOIP_INVERSE,
+                             C.DOIP_ROUTING_ACTIVATION_REQ, len(payload)) + payload)
+    payload_type, payload = recv_doip_frame(sock)
+    if payload_type != C.DOIP_ROUTING_ACTIVATION_RES or payload[4] != 0x10:
+        print(f"[Bench] Routing activation failed (type 0x{payload_type:04X})")
+        return
+    print(f"[Bench] Routing active, sending {count} requests to 0x{C.ECU_ADDRESS:04X}")
+    
+    round_trip, forward, reverse = [], [], []
+    timeouts = 0
+    
+    for i in range(count):
+        did = i & 0xFFFF
+        payload = struct.pack('!HHBH', tester_address, C.ECU_ADDRESS, 0x22, did)
+        frame = struct.pack('!BBHI', C.DOIP_VERSION, C.DOIP_INVERSE,
+                            C.DOIP_DIAG_MESSAGE, len(payload)) + payload
+        
+        t_send = time.perf_counter()
+        sock.sendall(frame)
+        
+        # Skip the diagnostic ACK; stop at the routed response
+        while True:
+            try:
+                payload_type, payload = recv_doip_frame(sock)
+            except socket.timeout:
+                payload_type = None
+                break
+            if payload_type == C.DOIP_DIAG_MESSAGE:
+                break
+            if payload_type == C.DOIP_DIAG_NACK:
+                print(f"[Bench] Request {i} NACK 0x{payload[4]:02X}")
+                payload_type = None
+                break
+        t_resp = time.perf_counter()
+        
+        if payload_type is None or payload[4] != 0x62:
+            timeouts += 1
+            continue
+        
+        times = ecu.forward_times.pop(did, None)
+        round_trip.append(t_resp - t_send)
+        if times is not None:
+            forward.append(times[0] - t_send)
+            reverse.append(t_resp - times[1])
+    
+    sock.close()
+    ecu.running = False
+    
+    print("=" * 60)
+    print(f"Forwarding benchmark: {len(round_trip)}/{count} responses, {timeouts} failed")
+    for name, values in (("Round trip", round_trip),
+                         ("Tester -> ECU", forward),
+                         ("ECU -> Tester", reverse)):
+        if values:
+            us = [v * 1e6 for v in values]
+            print(f"  {name:14s} min {min(us):8.1f} us  avg {sum(us) / len(us):8.1f} us  "
+                  f"p99 {percentile(us, 99):8.1f} us  max {max(us):8.1f} us")
+    print("=" * 60)
+
+
 def main():
     """Main function"""
     # Default configuration
     listen_port = 13400
     
+    # Benchmark: ecu_011_simulator.py --benchmark [zgw_ip] [count]
+    if len(sys.argv) > 1 and sys.argv[1] == '--benchmark':
+        zgw_ip = sys.argv[2] if len(sys.argv) > 2 else '192.168.1.10'
+        count = int(sys.argv[3]) if len(sys.argv) > 3 else 1000
+        run_benchmark(ECU_011_Simulator(listen_port), zgw_ip, count)
+        return
+    
     # Parse command line arguments
     if len(sys.argv) > 1:
         listen_port = int(sys.argv[1])
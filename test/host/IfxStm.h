@@ -0,0 +1,35 @@
+/**
+ * @file IfxStm.h
+ * @brief Host stand-in for the iLLD STM driver
+ * @details The system timer is emulated with a 100 MHz clock derived from
+ *          CLOCK_MONOTONIC. Only used with "-I test/host".
+ */
+
+#ifndef IFXSTM_H
+#define IFXSTM_H
+
+#include "Ifx_Types.h"
+#include <time.h>
+
+#define HOST_STM_FREQUENCY  100000000ULL
+
+typedef uint64 Ifx_TickTime;
+typedef struct { int unused; } Ifx_STM;
+
+static Ifx_STM MODULE_STM0;
+
+static inline uint64 IfxStm_get(Ifx_STM *stm)
+{
+    struct timespec ts;
+    (void)stm;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * HOST_STM_FREQUENCY + (uint64)ts.tv_nsec / (1000000000ULL / HOST_STM_FREQUENCY);
+}
+
+static inline Ifx_TickTime IfxStm_getTicksFromMicroseconds(Ifx_STM *stm, uint32 us)
+{
+    (void)stm;
+    return (Ifx_TickTime)us * (HOST_STM_FREQUENCY / 1000000ULL);
+}
+
+#endif /* IFXSTM_H */
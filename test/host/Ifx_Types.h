@@ -0,0 +1,34 @@
+/**
+ * @file Ifx_Types.h
+ * @brief Host stand-in for the iLLD base types
+ * @details Lets target-independent modules (e.g. doip_stream.c) be compiled
+ *          on a PC for benchmarks. Only used with "-I test/host".
+ */
+
+#ifndef IFX_TYPES_H
+#define IFX_TYPES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t   uint8;
+typedef uint16_t  uint16;
+typedef uint32_t  uint32;
+typedef uint64_t  uint64;
+typedef int8_t    sint8;
+typedef int16_t   sint16;
+typedef int32_t   sint32;
+typedef uint8_t   boolean;
+
+#ifndef TRUE
+#define TRUE      1
+#endif
+#ifndef FALSE
+#define FALSE     0
+#endif
+
+#ifndef NULL_PTR
+#define NULL_PTR  ((void *)0)
+#endif
+
+#endif /* IFX_TYPES_H */
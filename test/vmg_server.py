@@ -4,6 +4,8 @@ VMG (Vehicle Mobile Gateway) Server Simulator
 Accepts DoIP connection from Zonal Gateway and processes UDS commands
 """
 
+import os
+import queue
 import socket
 import struct
 import time
@@ -18,16 +20,75 @@ DOIP_PAYLOAD_TYPE_ALIVE_CHECK_REQ = 0x0007
 DOIP_PAYLOAD_TYPE_ALIVE_CHECK_RES = 0x0008
 DOIP_PAYLOAD_TYPE_DIAG_MSG = 0x8001
 DOIP_PAYLOAD_TYPE_DIAG_ACK = 0x8002
+DOIP_PAYLOAD_TYPE_DIAG_NACK = 0x8003
 DOIP_PAYLOAD_TYPE_VCI_REPORT = 0x9000  # VCI Report from ZGW
 
 # UDS Configuration
+UDS_SID_DIAGNOSTIC_SESSION_CONTROL = 0x10
+UDS_SID_READ_DTC_INFORMATION = 0x19
+UDS_SID_READ_DATA_BY_IDENTIFIER = 0x22
+UDS_SID_READ_MEMORY_BY_ADDRESS = 0x23
+UDS_SID_READ_DATA_BY_PERIODIC_ID = 0x2A
+UDS_SID_SECURITY_ACCESS = 0x27
 UDS_SID_ROUTINE_CONTROL = 0x31
+UDS_SID_REQUEST_DOWNLOAD = 0x34
+UDS_SID_REQUEST_UPLOAD = 0x35
+UDS_SID_TRANSFER_DATA = 0x36
+UDS_SID_REQUEST_TRANSFER_EXIT = 0x37
+UDS_SID_ECU_RESET = 0x11
+UDS_SID_COMMUNICATION_CONTROL = 0x28
+UDS_SID_CONTROL_DTC_SETTING = 0x85
+UDS_SID_NEGATIVE_RESPONSE = 0x7F
+UDS_NRC_RESPONSE_PENDING = 0x78
+UDS_SESSION_PROGRAMMING = 0x02
+UDS_SESSION_EXTENDED = 0x03
+UDS_RESET_HARD = 0x01
+UDS_RESET_SOFT = 0x03           # Warm reset: ZGW keeps its VCI / health cache
+UDS_SA_REQUEST_SEED = 0x01      # SecurityAccess level 1 (transfers, memory writes)
+UDS_SA_SEND_KEY = 0x02
+UDS_SECURITY_SECRET = 0x5A3C96E1  # UDS_SECURITY_SECRET of the ZGW build
+UDS_CC_ENABLE_RX_AND_TX = 0x00
+UDS_CC_DISABLE_RX_AND_TX = 0x03
+UDS_CC_NORMAL_ALL_SUBNETS = 0x01  # communicationType: normal messages, subnet 0 (Ethernet + UART log)
+UDS_DTC_SETTING_ON = 0x01
+UDS_DTC_SETTING_OFF = 0x02
 UDS_RC_START_ROUTINE = 0x01
+UDS_RC_REQUEST_RESULTS = 0x03
+PERIODIC_MODE_SLOW = 0x01
+PERIODIC_MODE_STOP = 0x04
 UDS_POSITIVE_RESPONSE = 0x40
 
+# ReadDTCInformation (0x19)
+DTC_REPORT_BY_STATUS_MASK = 0x02
+DTC_STATUS_BITS = ['TF', 'TFTOC', 'PDTC', 'CDTC', 'TNCSLC', 'TFSLC', 'TNCTOC', 'WIR']
+
 # Routine IDs
 RID_VCI_COLLECTION_START = 0xF001
 RID_VCI_SEND_REPORT = 0xF002
+RID_CAPTURE_EXPORT = 0xF011     # Read the ZGW capture ring as pcap
+
+# routineInfo of background routines (start / results response)
+ROUTINE_STATES = {0x00: 'Completed', 0x01: 'Running', 0x02: 'Stopped', 0x03: 'Failed'}
+ROUTINE_POLL_INTERVAL = 0.2     # seconds between RequestRoutineResults polls
+
+CAPTURE_FILE = 'zgw_capture.pcap'
+
+# Data Identifiers
+DID_VCI_ECU_ID = 0xF194
+DID_VCI_CONSOLIDATED = 0xF195
+DID_HEALTH_STATUS = 0xF1A0
+DID_DOIP_LINK_STATS = 0xF1C0
+DID_PERIODIC_RECORD_BASE = 0xF100  # PDID xx = DID 0xF2xx, same record as 0xF1xx
+VCI_SIZE = 48       # DoIP_VCI_Info
+HEALTH_SIZE = 24    # DoIP_HealthStatus_Info
+
+# Download benchmark (ZGW Flash4 staging area, see AppConfig.h)
+FLASH4_STAGING_ADDR = 0x00800000
+BENCH_DOWNLOAD_SIZE = 1024 * 1024
+PFLASH_READ_NC_ADDR = 0xA0000000    # ReadMemoryByAddress: PFLASH, non-cached view
+FLASH4_VIRTUAL_ADDR = 0x20000000    # ReadMemoryByAddress: Flash4 at this virtual base
+BENCH_MEMORY_READ_SIZE = 256 * 1024
+BENCH_MEMORY_READ_BLOCK = 4096      # UDS_MAX_RESPONSE_SIZE (data after the SID)
 
 # DoIP Addresses
 ADDR_VMG = 0x0E00
@@ -40,6 +101,10 @@ class VMGServer:
         self.server_sock = None
         self.client_sock = None
         self.running = False
+        self.capture_data = b''
+        self.bench_responses = None     # Queue of UDS responses while a benchmark runs
+        self.bench_image = None         # Last image downloaded, checked by the upload benchmark
+        self.reset_sent_at = None       # ECUReset request time: reset -> routing activation KPI
         
     def start(self):
         """Start VMG server"""
@@ -77,9 +142,14 @@ class VMGServer:
         """Handle DoIP client (ZGW)"""
         try:
             while self.running:
-                # Receive DoIP header (8 bytes)
-                header = self.client_sock.recv(8)
-                if not header or len(header) < 8:
+                # Receive DoIP header (8 bytes, may arrive split at speed)
+                header = b''
+                while len(header) < 8:
+                    chunk = self.client_sock.recv(8 - len(header))
+                    if not chunk:
+                        break
+                    header += chunk
+                if len(header) < 8:
                     print("[VMG] Connection closed by client")
                     break
                     
@@ -112,14 +182,29 @@ class VMGServer:
         if payload_type == DOIP_PAYLOAD_TYPE_ROUTING_ACT_REQ:
             print("\n[RX] Routing Activation Request")
             self.send_routing_activation_response()
+            if self.reset_sent_at is not None:
+                elapsed_ms = (time.time() - self.reset_sent_at) * 1000
+                print(f"[VMG] ✓ ECU reset -> DoIP ACTIVE in {elapsed_ms:.0f} ms")
+                self.reset_sent_at = None
             
         elif payload_type == DOIP_PAYLOAD_TYPE_ALIVE_CHECK_RES:
             print("[RX] Alive Check Response")
             
+        elif payload_type == DOIP_PAYLOAD_TYPE_DIAG_MSG and self.bench_responses is not None:
+            self.bench_responses.put(payload[4:])
+            
         elif payload_type == DOIP_PAYLOAD_TYPE_DIAG_MSG:
             print("\n[RX] Diagnostic Message")
             self.process_diagnostic_message(payload)
             
+        elif payload_type == DOIP_PAYLOAD_TYPE_DIAG_ACK:
+            if self.bench_responses is None:
+                print("[RX] Diagnostic Message ACK")
+            
+        elif payload_type == DOIP_PAYLOAD_TYPE_DIAG_NACK:
+            code = payload[4] if len(payload) >= 5 else 0xFF
+            print(f"[RX] Diagnostic Message NACK (code 0x{code:02X})")
+            
         elif payload_type == DOIP_PAYLOAD_TYPE_VCI_REPORT:
             print("\n" + "="*60)
             print("[RX] ✓ VCI REPORT RECEIVED FROM ZGW")
@@ -211,6 +296,14 @@ class VMGServer:
                 rid = (uds_data[2] << 8) | uds_data[3]
                 status = uds_data[4] if len(uds_data) > 4 else None
                 
+                if rid == RID_CAPTURE_EXPORT:
+                    self.process_capture_export(sub, uds_data[4:])
+                    return
+                    
+                if rid == RID_VCI_COLLECTION_START:
+                    self.process_vci_collection(uds_data[4:])
+                    return
+                    
                 print(f"    Sub-function: 0x{sub:02X}")
                 print(f"    Routine ID: 0x{rid:04X}")
                 if status is not None:
@@ -235,17 +328,17 @@ class VMGServer:
                 
         elif sid == 0x62:  # Read Data By Identifier Response
             print(" (Read Data By Identifier Response)")
-            if len(uds_data) >= 3:
-                did = (uds_data[1] << 8) | uds_data[2]
-                print(f"    DID: 0x{did:04X}")
-                
-                # Check if this is VCI data
-                if did == 0xF195:  # Consolidated VCI
-                    print("    → Consolidated VCI Data")
-                    self.parse_vci_data(uds_data[3:])
-                elif did == 0xF194:  # Individual VCI
-                    print("    → Individual VCI Data")
-                    self.parse_vci_data(uds_data[3:])
+            self.parse_did_records(uds_data[1:])
+            
+        elif sid == 0x59:  # Read DTC Information Response
+            print(" (Read DTC Information Response)")
+            if len(uds_data) >= 3 and uds_data[1] == DTC_REPORT_BY_STATUS_MASK:
+                self.parse_dtc_list(uds_data[3:])
+            
+        elif sid == 0x6A:  # Periodic message: [PDID][record] of DID 0xF2xx
+            print(" (Periodic Data)")
+            if len(uds_data) >= 2:
+                self.parse_did_records(bytes([DID_PERIODIC_RECORD_BASE >> 8, uds_data[1]]) + uds_data[2:])
                     
         else:
             print(f" (Unknown/Other Service)")
@@ -256,6 +349,334 @@ class VMGServer:
         if response_data:
             self.send_diagnostic_response(ta, sa, response_data)
             
+    def process_capture_export(self, sub, record):
+        """Collect the pcap stream read out of the ZGW capture ring"""
+        if sub == UDS_RC_START_ROUTINE:
+            size = struct.unpack('>I', record[1:5])[0] if len(record) >= 5 else 0
+            print(f"    Capture export started ({size} bytes)")
+            self.capture_data = b''
+            self.send_routine_request(UDS_RC_REQUEST_RESULTS, RID_CAPTURE_EXPORT)
+            
+        elif sub == UDS_RC_REQUEST_RESULTS:
+            if len(record) > 0 and record[0] == 0x01:
+                self.capture_data += record[1:]
+                self.send_routine_request(UDS_RC_REQUEST_RESULTS, RID_CAPTURE_EXPORT)
+            else:
+                with open(CAPTURE_FILE, 'wb') as f:
+                    f.write(self.capture_data)
+                print(f"[VMG] ✓ Capture saved to {CAPTURE_FILE} ({len(self.capture_data)} bytes)")
+                
+    def process_vci_collection(self, record):
+        """Background routine status: poll the results until the collection ends"""
+        if len(record) < 1:
+            return
+        state = ROUTINE_STATES.get(record[0], f'0x{record[0]:02X}')
+        progress = f", {record[1]}%" if len(record) > 1 and record[1] != 0xFF else ""
+        print(f"    VCI collection: {state}{progress}")
+        
+        if record[0] == 0x01:
+            timer = threading.Timer(ROUTINE_POLL_INTERVAL, self.send_routine_request,
+                                    (UDS_RC_REQUEST_RESULTS, RID_VCI_COLLECTION_START))
+            timer.daemon = True
+            timer.start()
+        elif record[0] == 0x00 and len(record) > 2:
+            print(f"[VMG] ✓ VCI collection complete ({record[2]} Zone ECUs)")
+            
+    def send_ecu_reset(self, reset_type):
+        """Reset the ZGW and time its return (next routing activation)"""
+        self.reset_sent_at = time.time()
+        self.send_uds_request(bytes([UDS_SID_ECU_RESET, reset_type]))
+        
+    def send_routine_request(self, sub, rid):
+        """Send a RoutineControl request to the ZGW"""
+        uds_data = bytes([UDS_SID_ROUTINE_CONTROL, sub, (rid >> 8) & 0xFF, rid & 0xFF])
+        payload = struct.pack('>HH', ADDR_VMG, ADDR_ZGW) + uds_data
+        header = struct.pack('>BBHL', DOIP_PROTOCOL_VERSION,
+                           DOIP_INVERSE_VERSION,
+                           DOIP_PAYLOAD_TYPE_DIAG_MSG,
+                           len(payload))
+        self.client_sock.sendall(header + payload)
+        
+    def send_uds_request(self, uds_data):
+        """Send a UDS request to the ZGW"""
+        payload = struct.pack('>HH', ADDR_VMG, ADDR_ZGW) + uds_data
+        header = struct.pack('>BBHL', DOIP_PROTOCOL_VERSION,
+                           DOIP_INVERSE_VERSION,
+                           DOIP_PAYLOAD_TYPE_DIAG_MSG,
+                           len(payload))
+        self.client_sock.sendall(header + payload)
+        
+    def uds_request(self, uds_data, timeout=10.0):
+        """Send a UDS request and wait for its final response (benchmark mode)"""
+        self.send_uds_request(uds_data)
+        while True:
+            response = self.bench_responses.get(timeout=timeout)
+            if (len(response) >= 3 and response[0] == UDS_SID_NEGATIVE_RESPONSE
+                    and response[2] == UDS_NRC_RESPONSE_PENDING):
+                continue
+            return response
+            
+    def expect_positive(self, response, sid, what):
+        """Raise if response is not the positive response to sid"""
+        if len(response) < 1 or response[0] != sid + UDS_POSITIVE_RESPONSE:
+            raise RuntimeError(f"{what} rejected: {' '.join(f'{b:02X}' for b in response)}")
+            
+    def security_unlock(self):
+        """Unlock SecurityAccess level 1: key = rotl(seed, 7) ^ secret"""
+        response = self.uds_request(bytes([UDS_SID_SECURITY_ACCESS, UDS_SA_REQUEST_SEED]))
+        self.expect_positive(response, UDS_SID_SECURITY_ACCESS, "SecurityAccess requestSeed")
+        seed = int.from_bytes(response[2:6], 'big')
+        if seed == 0:
+            return      # Already unlocked
+        key = (((seed << 7) | (seed >> 25)) & 0xFFFFFFFF) ^ UDS_SECURITY_SECRET
+        response = self.uds_request(bytes([UDS_SID_SECURITY_ACCESS, UDS_SA_SEND_KEY]) + struct.pack('>I', key))
+        self.expect_positive(response, UDS_SID_SECURITY_ACCESS, "SecurityAccess sendKey")
+        
+    def set_quiet_mode(self, quiet):
+        """Silence (or restore) nonessential ZGW traffic: DTC setting and normal communication"""
+        response = self.uds_request(bytes([UDS_SID_CONTROL_DTC_SETTING,
+                                           UDS_DTC_SETTING_OFF if quiet else UDS_DTC_SETTING_ON]))
+        self.expect_positive(response, UDS_SID_CONTROL_DTC_SETTING, "ControlDTCSetting")
+        response = self.uds_request(bytes([UDS_SID_COMMUNICATION_CONTROL,
+                                           UDS_CC_DISABLE_RX_AND_TX if quiet else UDS_CC_ENABLE_RX_AND_TX,
+                                           UDS_CC_NORMAL_ALL_SUBNETS]))
+        self.expect_positive(response, UDS_SID_COMMUNICATION_CONTROL, "CommunicationControl")
+        
+    def run_download_benchmark(self, size=BENCH_DOWNLOAD_SIZE, quiet=False):
+        """Download size bytes into the ZGW Flash4 staging area and report the throughput
+        
+        quiet: silence nonessential traffic (0x85 / 0x28) for the transfer.
+        Returns the throughput in bytes/s, None on failure.
+        """
+        image = os.urandom(size)
+        self.bench_responses = queue.Queue()
+        rate = None
+        
+        try:
+            response = self.uds_request(bytes([UDS_SID_DIAGNOSTIC_SESSION_CONTROL, UDS_SESSION_PROGRAMMING]))
+            self.expect_positive(response, UDS_SID_DIAGNOSTIC_SESSION_CONTROL, "Programming session")
+            self.security_unlock()
+            
+            if quiet:
+                self.set_quiet_mode(True)
+                
+            # DFI 0x00, 4-byte address and size
+            response = self.uds_request(bytes([UDS_SID_REQUEST_DOWNLOAD, 0x00, 0x44]) +
+                                        struct.pack('>II', FLASH4_STAGING_ADDR, size))
+            self.expect_positive(response, UDS_SID_REQUEST_DOWNLOAD, "RequestDownload")
+            length_bytes = response[1] >> 4
+            max_block = int.from_bytes(response[2:2 + length_bytes], 'big')
+            block_size = max_block - 2      # SID + BSC
+            print(f"[BENCH] Download {size} bytes to 0x{FLASH4_STAGING_ADDR:08X}, "
+                  f"maxNumberOfBlockLength {max_block}")
+            
+            start = time.time()
+            bsc = 1
+            blocks = 0
+            for offset in range(0, size, block_size):
+                response = self.uds_request(bytes([UDS_SID_TRANSFER_DATA, bsc]) +
+                                            image[offset:offset + block_size])
+                self.expect_positive(response, UDS_SID_TRANSFER_DATA, f"TransferData block {blocks + 1}")
+                if response[1] != bsc:
+                    raise RuntimeError(f"TransferData answered BSC 0x{response[1]:02X}, expected 0x{bsc:02X}")
+                bsc = (bsc + 1) & 0xFF
+                blocks += 1
+                
+            response = self.uds_request(bytes([UDS_SID_REQUEST_TRANSFER_EXIT]))
+            self.expect_positive(response, UDS_SID_REQUEST_TRANSFER_EXIT, "RequestTransferExit")
+            elapsed = time.time() - start
+            
+            print(f"[BENCH] ✓ {blocks} blocks in {elapsed:.2f} s: "
+                  f"{size / elapsed / 1e6:.3f} MB/s ({size / elapsed / 1024:.0f} KB/s)")
+            self.bench_image = image
+            rate = size / elapsed
+            
+            if quiet:
+                self.set_quiet_mode(False)
+                
+        except queue.Empty:
+            print("[BENCH] Timeout waiting for the ZGW response")
+        except RuntimeError as e:
+            print(f"[BENCH] {e}")
+        finally:
+            self.bench_responses = None
+            
+        return rate
+        
+    def run_ota_benchmark(self, size=BENCH_DOWNLOAD_SIZE):
+        """Download benchmark without and with nonessential traffic silenced; report the delta"""
+        print("[BENCH] Download, normal communication:")
+        normal = self.run_download_benchmark(size)
+        print("[BENCH] Download, 0x85 DTC setting off + 0x28 normal communication off:")
+        quiet = self.run_download_benchmark(size, quiet=True)
+        
+        if normal and quiet:
+            print(f"[BENCH] Throughput {normal / 1024:.0f} KB/s -> {quiet / 1024:.0f} KB/s "
+                  f"({(quiet - normal) / normal * 100:+.1f} %)")
+            
+    def run_upload_benchmark(self, size=BENCH_DOWNLOAD_SIZE):
+        """Upload size bytes from the ZGW Flash4 staging area and report the throughput"""
+        self.bench_responses = queue.Queue()
+        
+        try:
+            response = self.uds_request(bytes([UDS_SID_DIAGNOSTIC_SESSION_CONTROL, UDS_SESSION_PROGRAMMING]))
+            self.expect_positive(response, UDS_SID_DIAGNOSTIC_SESSION_CONTROL, "Programming session")
+            self.security_unlock()
+            
+            response = self.uds_request(bytes([UDS_SID_REQUEST_UPLOAD, 0x00, 0x44]) +
+                                        struct.pack('>II', FLASH4_STAGING_ADDR, size))
+            self.expect_positive(response, UDS_SID_REQUEST_UPLOAD, "RequestUpload")
+            length_bytes = response[1] >> 4
+            max_block = int.from_bytes(response[2:2 + length_bytes], 'big')
+            print(f"[BENCH] Upload {size} bytes from 0x{FLASH4_STAGING_ADDR:08X}, "
+                  f"maxNumberOfBlockLength {max_block}")
+            
+            start = time.time()
+            bsc = 1
+            blocks = 0
+            image = bytearray()
+            while len(image) < size:
+                response = self.uds_request(bytes([UDS_SID_TRANSFER_DATA, bsc]))
+                self.expect_positive(response, UDS_SID_TRANSFER_DATA, f"TransferData block {blocks + 1}")
+                if response[1] != bsc or len(response) <= 2:
+                    raise RuntimeError(f"TransferData answered BSC 0x{response[1]:02X} "
+                                       f"with {len(response) - 2} bytes, expected 0x{bsc:02X}")
+                image += response[2:]
+                bsc = (bsc + 1) & 0xFF
+                blocks += 1
+                
+            response = self.uds_request(bytes([UDS_SID_REQUEST_TRANSFER_EXIT]))
+            self.expect_positive(response, UDS_SID_REQUEST_TRANSFER_EXIT, "RequestTransferExit")
+            elapsed = time.time() - start
+            
+            print(f"[BENCH] ✓ {blocks} blocks in {elapsed:.2f} s: "
+                  f"{size / elapsed / 1e6:.3f} MB/s ({size / elapsed / 1024:.0f} KB/s)")
+            if self.bench_image is not None and len(self.bench_image) == size:
+                match = bytes(image) == self.bench_image
+                print(f"[BENCH] {'✓' if match else '✗'} Read-back "
+                      f"{'matches' if match else 'differs from'} the last downloaded image")
+            
+        except queue.Empty:
+            print("[BENCH] Timeout waiting for the ZGW response")
+        except RuntimeError as e:
+            print(f"[BENCH] {e}")
+        finally:
+            self.bench_responses = None
+            
+    def run_memory_read_benchmark(self, size=BENCH_MEMORY_READ_SIZE):
+        """Read PFLASH (DMA-backed) and Flash4 with 0x23 and report the throughput"""
+        self.bench_responses = queue.Queue()
+        
+        try:
+            response = self.uds_request(bytes([UDS_SID_DIAGNOSTIC_SESSION_CONTROL, UDS_SESSION_EXTENDED]))
+            self.expect_positive(response, UDS_SID_DIAGNOSTIC_SESSION_CONTROL, "Extended session")
+            
+            for name, base in (("PFLASH", PFLASH_READ_NC_ADDR), ("Flash4", FLASH4_VIRTUAL_ADDR + FLASH4_STAGING_ADDR)):
+                start = time.time()
+                requests = 0
+                for offset in range(0, size, BENCH_MEMORY_READ_BLOCK):
+                    n = min(BENCH_MEMORY_READ_BLOCK, size - offset)
+                    # ALFID 0x24: 2-byte size, 4-byte address
+                    response = self.uds_request(bytes([UDS_SID_READ_MEMORY_BY_ADDRESS, 0x24]) +
+                                                struct.pack('>IH', base + offset, n))
+                    self.expect_positive(response, UDS_SID_READ_MEMORY_BY_ADDRESS, f"{name} read at +0x{offset:X}")
+                    if len(response) - 1 != n:
+                        raise RuntimeError(f"{name} read returned {len(response) - 1} bytes, expected {n}")
+                    requests += 1
+                elapsed = time.time() - start
+                
+                print(f"[BENCH] ✓ {name}: {size} bytes in {requests} requests, {elapsed:.2f} s: "
+                      f"{size / elapsed / 1024:.0f} KB/s")
+            
+        except queue.Empty:
+            print("[BENCH] Timeout waiting for the ZGW response")
+        except RuntimeError as e:
+            print(f"[BENCH] {e}")
+        finally:
+            self.bench_responses = None
+            
+    def did_record_length(self, did, data):
+        """Length of a DID record at the start of data (records are not length-prefixed)"""
+        if did == DID_VCI_ECU_ID:
+            return VCI_SIZE
+        if did in (DID_VCI_CONSOLIDATED, DID_HEALTH_STATUS):
+            size = VCI_SIZE if did == DID_VCI_CONSOLIDATED else HEALTH_SIZE
+            return 1 + data[0] * size if data else 0
+        if did == DID_DOIP_LINK_STATS:
+            return 1 + 7 * 4
+        return len(data)
+        
+    def parse_did_records(self, data):
+        """Walk the [DID][record] pairs of a (multi-DID) 0x62 response"""
+        offset = 0
+        while offset + 2 <= len(data):
+            did = (data[offset] << 8) | data[offset + 1]
+            offset += 2
+            length = self.did_record_length(did, data[offset:])
+            record = data[offset:offset + length]
+            offset += length
+            print(f"    DID: 0x{did:04X} ({len(record)} bytes)")
+            
+            if did == DID_VCI_CONSOLIDATED:
+                print("    → Consolidated VCI Data")
+                self.parse_vci_data(record)
+            elif did == DID_VCI_ECU_ID:
+                print("    → Individual VCI Data")
+                self.parse_vci_data(bytes([1]) + record)
+            elif did == DID_HEALTH_STATUS:
+                self.parse_health_data(record)
+            elif did == DID_DOIP_LINK_STATS and len(record) == 29:
+                values = struct.unpack('>7I', record[1:])
+                print(f"    → Link state {record[0]}, attempts {values[0]}, activations {values[1]}, "
+                      f"losses {values[2]}, time to ACTIVE {values[3]}/{values[4]} ms, "
+                      f"failovers {values[5]}, replayed {values[6]}")
+            else:
+                print(f"    Data: {' '.join(f'{b:02X}' for b in record)}")
+                
+    def parse_health_data(self, data):
+        """Parse the health status record (DID 0xF1A0)"""
+        if len(data) < 1:
+            return
+        for i in range(data[0]):
+            entry = data[1 + i * HEALTH_SIZE:1 + (i + 1) * HEALTH_SIZE]
+            if len(entry) < HEALTH_SIZE:
+                print(f"    [Health {i+1}] Incomplete data")
+                break
+            ecu_id = entry[0:16].decode('ascii', errors='ignore').rstrip('\x00')
+            status, dtc_count, voltage, temp = struct.unpack('<BBHB', entry[16:21])
+            print(f"    → {ecu_id}: status {status}, DTCs {dtc_count}, "
+                  f"{voltage / 1000:.2f} V, {temp - 40} °C")
+            
+    def parse_dtc_list(self, data):
+        """Parse the [DTC][status] pairs of a 0x19 0x02 response"""
+        if len(data) == 0:
+            print("    → No DTCs")
+        for i in range(0, len(data) - 3, 4):
+            dtc = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2]
+            status = data[i + 3]
+            bits = ' '.join(name for bit, name in enumerate(DTC_STATUS_BITS) if status & (1 << bit))
+            print(f"    → DTC 0x{dtc:06X}: status 0x{status:02X} ({bits})")
+            
+    def send_dtc_poll(self):
+        """Read all DTCs with any status bit set"""
+        self.send_uds_request(bytes([UDS_SID_READ_DTC_INFORMATION, DTC_REPORT_BY_STATUS_MASK, 0xFF]))
+        
+    def send_health_poll(self):
+        """Read health and link statistics in one ReadDataByIdentifier request"""
+        self.send_uds_request(bytes([UDS_SID_READ_DATA_BY_IDENTIFIER,
+                                     DID_HEALTH_STATUS >> 8, DID_HEALTH_STATUS & 0xFF,
+                                     DID_DOIP_LINK_STATS >> 8, DID_DOIP_LINK_STATS & 0xFF]))
+        
+    def toggle_periodic_health(self):
+        """Schedule health + link statistics at the slow rate (0x2A), or stop them"""
+        self.periodic_active = not getattr(self, 'periodic_active', False)
+        if self.periodic_active:
+            self.send_uds_request(bytes([UDS_SID_READ_DATA_BY_PERIODIC_ID, PERIODIC_MODE_SLOW,
+                                         DID_HEALTH_STATUS & 0xFF, DID_DOIP_LINK_STATS & 0xFF]))
+        else:
+            self.send_uds_request(bytes([UDS_SID_READ_DATA_BY_PERIODIC_ID, PERIODIC_MODE_STOP]))
+        return self.periodic_active
+        
     def parse_vci_data(self, data):
         """Parse and display VCI data in human-readable format"""
         if len(data) < 1:
@@ -372,6 +793,16 @@ def main():
     print("Commands:")
     print("  1 - Send VCI Collection Start")
     print("  2 - Send VCI Report Request")
+    print(f"  3 - Export packet capture ({CAPTURE_FILE})")
+    print(f"  4 - Download benchmark ({BENCH_DOWNLOAD_SIZE // 1024} KB into Flash4)")
+    print(f"  5 - Upload benchmark ({BENCH_DOWNLOAD_SIZE // 1024} KB from Flash4)")
+    print("  6 - Read health + link statistics (multi-DID 0x22)")
+    print("  7 - Start/stop periodic health + link statistics (0x2A, slow)")
+    print("  8 - Read ZGW DTCs (0x19 0x02, all status bits)")
+    print(f"  9 - ReadMemoryByAddress benchmark ({BENCH_MEMORY_READ_SIZE // 1024} KB PFLASH + Flash4)")
+    print(f"  o - OTA benchmark ({BENCH_DOWNLOAD_SIZE // 1024} KB, without / with 0x28 + 0x85 silencing)")
+    print("  r - ECU soft reset (warm, timed until DoIP ACTIVE)")
+    print("  h - ECU hard reset (cold, timed until DoIP ACTIVE)")
     print("  q - Quit")
     print("="*60)
     
@@ -413,6 +844,65 @@ def main():
                 else:
                     print("[VMG] No active connection")
                     
+            elif cmd == '3':
+                if server.client_sock:
+                    server.send_routine_request(UDS_RC_START_ROUTINE, RID_CAPTURE_EXPORT)
+                    print("[TX] Capture Export command sent")
+                else:
+                    print("[VMG] No active connection")
+                    
+            elif cmd == '4':
+                if server.client_sock:
+                    server.run_download_benchmark()
+                else:
+                    print("[VMG] No active connection")
+                    
+            elif cmd == '5':
+                if server.client_sock:
+                    server.run_upload_benchmark()
+                else:
+                    print("[VMG] No active connection")
+                    
+            elif cmd == '6':
+                if server.client_sock:
+                    server.send_health_poll()
+                    print("[TX] Health poll sent (DIDs 0xF1A0, 0xF1C0)")
+                else:
+                    print("[VMG] No active connection")
+                    
+            elif cmd == '7':
+                if server.client_sock:
+                    started = server.toggle_periodic_health()
+                    print(f"[TX] Periodic health {'started' if started else 'stopped'}")
+                else:
+                    print("[VMG] No active connection")
+                    
+            elif cmd == '8':
+                if server.client_sock:
+                    server.send_dtc_poll()
+                    print("[TX] DTC read sent")
+                else:
+                    print("[VMG] No active connection")
+                    
+            elif cmd == '9':
+                if server.client_sock:
+                    server.run_memory_read_benchmark()
+                else:
+                    print("[VMG] No active connection")
+                    
+            elif cmd == 'o':
+                if server.client_sock:
+                    server.run_ota_benchmark()
+                else:
+                    print("[VMG] No active connection")
+                    
+            elif cmd in ('r', 'h'):
+                if server.client_sock:
+                    server.send_ecu_reset(UDS_RESET_SOFT if cmd == 'r' else UDS_RESET_HARD)
+                    print("[TX] ECU reset sent")
+                else:
+                    print("[VMG] No active connection")
+                    
     except KeyboardInterrupt:
         print("\n[VMG] Interrupted")
     finally: